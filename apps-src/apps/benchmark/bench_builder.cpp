@@ -0,0 +1,89 @@
+#include "benchmark.hpp"
+#include "environment.hpp"
+
+#include "image.hpp"
+#include "builder.hpp"
+#include "config.hpp"
+#include "loadscreen.hpp"
+#include "map.hpp"
+#include "rose_config.hpp"
+
+#include <boost/foreach.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <sstream>
+
+//
+// terrain_builder's rule matching on a generated map, with tb-hexagonal.dat of apps-res.
+// items are map tiles.
+//
+namespace {
+
+bool load_terrain_types()
+{
+	if (tmap::terrain_types.child("terrain_type")) {
+		return true;
+	}
+	config cfg;
+	wml_config_from_file(game_config::path + "/xwml/data.bin", cfg);
+	BOOST_FOREACH (const config& t, cfg.child_range("terrain_type")) {
+		tmap::terrain_types.add_child("terrain_type", t);
+	}
+	return tmap::terrain_types.child("terrain_type");
+}
+
+// deterministic mix of water, grass, forest, hills and mountains, in patches as real maps.
+std::string generate_map(int w, int h)
+{
+	const char* codes[] = {"Gg", "Gs", "Gs^Fp", "Hh", "Mm", "Ww", "Wo", "Dd", "Rr", "Ss"};
+	const int ncodes = sizeof(codes) / sizeof(codes[0]);
+
+	std::stringstream ss;
+	ss << tmap::default_map_header;
+	uint32_t seed = 0x2545f491;
+	// border is included, so size is w+2 x h+2.
+	for (int y = 0; y < h + 2; y ++) {
+		for (int x = 0; x < w + 2; x ++) {
+			seed = seed * 1103515245 + 12345;
+			int at = ((x / 4) * 7 + (y / 3) * 13) % ncodes;
+			if ((seed >> 16) % 5 == 0) {
+				at = (seed >> 20) % ncodes;
+			}
+			ss << (x? ", ": "") << codes[at];
+		}
+		ss << "\n";
+	}
+	return ss.str();
+}
+
+void run_builder(benchmark::tstate& state, int w, int h)
+{
+	if (!benchmark::init_res()) {
+		state.skip("apps-res isn't found");
+		return;
+	}
+	boost::scoped_ptr<tmap> map;
+	boost::scoped_ptr<terrain_builder> builder;
+	try {
+		if (!load_terrain_types()) {
+			state.skip("data.bin has no [terrain_type]");
+			return;
+		}
+		map.reset(new tmap(generate_map(w, h)));
+		builder.reset(new terrain_builder("hexagonal", map.get()));
+	} catch (...) {
+		state.skip("can't create terrain_builder");
+		return;
+	}
+
+	while (state.keep_running()) {
+		builder->rebuild_all();
+	}
+	state.set_items_processed(w * h);
+}
+
+}
+
+static void builder_rebuild_all_64(benchmark::tstate& state) { run_builder(state, 64, 64); }
+BENCHMARK(builder_rebuild_all_64);
+static void builder_rebuild_all_200(benchmark::tstate& state) { run_builder(state, 200, 200); }
+BENCHMARK(builder_rebuild_all_200);
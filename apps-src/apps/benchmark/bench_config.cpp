@@ -0,0 +1,250 @@
+#include "benchmark.hpp"
+
+#include "config.hpp"
+
+#include <boost/foreach.hpp>
+#include <sstream>
+
+//
+// compare config's arena/flat storage with map-based layout that config used before.
+// dataset is shaped like gui.bin: many [window]s, every one has nested widgets with a few attributes.
+//
+namespace {
+
+// map-based layout: child_map and attribute_map are std::map, every node is new-ed.
+struct tmap_node
+{
+	typedef std::vector<tmap_node*> child_list;
+	std::map<std::string, child_list> children;
+	std::map<std::string, config::attribute_value> values;
+
+	~tmap_node()
+	{
+		for (std::map<std::string, child_list>::iterator it = children.begin(); it != children.end(); ++ it) {
+			for (child_list::iterator it2 = it->second.begin(); it2 != it->second.end(); ++ it2) {
+				delete *it2;
+			}
+		}
+	}
+
+	tmap_node& add_child(const std::string& key)
+	{
+		children[key].push_back(new tmap_node);
+		return *children[key].back();
+	}
+
+	const config::attribute_value* get(const std::string& key) const
+	{
+		std::map<std::string, config::attribute_value>::const_iterator it = values.find(key);
+		return it != values.end()? &it->second: NULL;
+	}
+
+	const tmap_node* child(const std::string& key) const
+	{
+		std::map<std::string, child_list>::const_iterator it = children.find(key);
+		return it != children.end() && !it->second.empty()? it->second.front(): NULL;
+	}
+};
+
+const char* widget_tags[] = {"button", "label", "text_box", "listbox", "toggle_button", "image", "spacer", "scroll_label"};
+const char* attribute_keys[] = {"id", "definition", "label", "tooltip", "width", "height", "border", "border_size", "horizontal_alignment", "vertical_alignment", "grow_factor", "linked_group"};
+const int windows = 300;
+const int rows = 12;
+const int widgets_per_row = 4;
+const int nattribute_keys = sizeof(attribute_keys) / sizeof(attribute_keys[0]);
+
+struct tinput_attribute
+{
+	std::string key;
+	std::string value;
+};
+
+// flat description of the dataset, so both layouts are built from same input without extra work.
+struct tinput_widget
+{
+	std::string tag;
+	std::vector<tinput_attribute> attributes;
+};
+
+const std::vector<tinput_widget>& dataset()
+{
+	static std::vector<tinput_widget> widgets;
+	if (!widgets.empty()) {
+		return widgets;
+	}
+	for (int n = 0; n < windows * rows * widgets_per_row; n ++) {
+		tinput_widget widget;
+		widget.tag = widget_tags[n % (sizeof(widget_tags) / sizeof(widget_tags[0]))];
+		for (int at = 0; at < 4 + n % 8; at ++) {
+			tinput_attribute attr;
+			attr.key = attribute_keys[(n + at * 5) % nattribute_keys];
+			std::stringstream ss;
+			ss << "value_" << n << "_" << at;
+			attr.value = ss.str();
+			widget.attributes.push_back(attr);
+		}
+		widgets.push_back(widget);
+	}
+	return widgets;
+}
+
+void build_config(config& root)
+{
+	const std::vector<tinput_widget>& widgets = dataset();
+	std::vector<tinput_widget>::const_iterator it = widgets.begin();
+	for (int w = 0; w < windows; w ++) {
+		config& window = root.add_child("window");
+		window["id"] = w;
+		config& grid = window.add_child("resolution").add_child("grid");
+		for (int r = 0; r < rows; r ++) {
+			config& row = grid.add_child("row");
+			for (int c = 0; c < widgets_per_row; c ++, ++ it) {
+				config& widget = row.add_child("column").add_child(it->tag);
+				for (std::vector<tinput_attribute>::const_iterator a = it->attributes.begin(); a != it->attributes.end(); ++ a) {
+					widget[a->key] = a->value;
+				}
+			}
+		}
+	}
+}
+
+void build_map(tmap_node& root)
+{
+	const std::vector<tinput_widget>& widgets = dataset();
+	std::vector<tinput_widget>::const_iterator it = widgets.begin();
+	for (int w = 0; w < windows; w ++) {
+		tmap_node& window = root.add_child("window");
+		window.values["id"] = w;
+		tmap_node& grid = window.add_child("resolution").add_child("grid");
+		for (int r = 0; r < rows; r ++) {
+			tmap_node& row = grid.add_child("row");
+			for (int c = 0; c < widgets_per_row; c ++, ++ it) {
+				tmap_node& widget = row.add_child("column").add_child(it->tag);
+				for (std::vector<tinput_attribute>::const_iterator a = it->attributes.begin(); a != it->attributes.end(); ++ a) {
+					widget.values[a->key] = a->value;
+				}
+			}
+		}
+	}
+}
+
+int lookup_config(const config& root)
+{
+	int found = 0;
+	BOOST_FOREACH (const config& window, root.child_range("window")) {
+		const config& grid = window.child("resolution").child("grid");
+		BOOST_FOREACH (const config& row, grid.child_range("row")) {
+			BOOST_FOREACH (const config& column, row.child_range("column")) {
+				BOOST_FOREACH (const config::any_child& widget, column.all_children_range()) {
+					for (int at = 0; at < nattribute_keys; at ++) {
+						if (widget.cfg.get(attribute_keys[at])) {
+							found ++;
+						}
+					}
+				}
+			}
+		}
+	}
+	return found;
+}
+
+int lookup_map(const tmap_node& root)
+{
+	int found = 0;
+	const tmap_node::child_list& windows = root.children.find("window")->second;
+	for (tmap_node::child_list::const_iterator w = windows.begin(); w != windows.end(); ++ w) {
+		const tmap_node& grid = *(*w)->child("resolution")->child("grid");
+		const tmap_node::child_list& rows = grid.children.find("row")->second;
+		for (tmap_node::child_list::const_iterator r = rows.begin(); r != rows.end(); ++ r) {
+			const tmap_node::child_list& columns = (*r)->children.find("column")->second;
+			for (tmap_node::child_list::const_iterator c = columns.begin(); c != columns.end(); ++ c) {
+				for (std::map<std::string, tmap_node::child_list>::const_iterator it = (*c)->children.begin(); it != (*c)->children.end(); ++ it) {
+					for (int at = 0; at < nattribute_keys; at ++) {
+						if (it->second.front()->get(attribute_keys[at])) {
+							found ++;
+						}
+					}
+				}
+			}
+		}
+	}
+	return found;
+}
+
+}
+
+static void config_storage_load(benchmark::tstate& state)
+{
+	dataset();
+	while (state.keep_running()) {
+		config* root = new config;
+		build_config(*root);
+		state.pause_timing();
+		delete root;
+		state.resume_timing();
+	}
+}
+BENCHMARK(config_storage_load);
+
+static void config_storage_load_map(benchmark::tstate& state)
+{
+	dataset();
+	while (state.keep_running()) {
+		tmap_node* root = new tmap_node;
+		build_map(*root);
+		state.pause_timing();
+		delete root;
+		state.resume_timing();
+	}
+}
+BENCHMARK(config_storage_load_map);
+
+static void config_storage_lookup(benchmark::tstate& state)
+{
+	config root;
+	build_config(root);
+	int found = 0;
+	while (state.keep_running()) {
+		found += lookup_config(root);
+	}
+	BENCHMARK_DONT_OPTIMIZE(found);
+}
+BENCHMARK(config_storage_lookup);
+
+static void config_storage_lookup_map(benchmark::tstate& state)
+{
+	tmap_node root;
+	build_map(root);
+	int found = 0;
+	while (state.keep_running()) {
+		found += lookup_map(root);
+	}
+	BENCHMARK_DONT_OPTIMIZE(found);
+}
+BENCHMARK(config_storage_lookup_map);
+
+static void config_storage_destroy(benchmark::tstate& state)
+{
+	dataset();
+	while (state.keep_running()) {
+		state.pause_timing();
+		config* root = new config;
+		build_config(*root);
+		state.resume_timing();
+		delete root;
+	}
+}
+BENCHMARK(config_storage_destroy);
+
+static void config_storage_destroy_map(benchmark::tstate& state)
+{
+	dataset();
+	while (state.keep_running()) {
+		state.pause_timing();
+		tmap_node* root = new tmap_node;
+		build_map(*root);
+		state.resume_timing();
+		delete root;
+	}
+}
+BENCHMARK(config_storage_destroy_map);
@@ -0,0 +1,227 @@
+#include "benchmark.hpp"
+#include "environment.hpp"
+
+#include "drawing_buffer.hpp"
+#include "render_target_pool.hpp"
+#include "sdl_utils.hpp"
+
+//
+// display's render queue on software renderer of dummy video driver.
+// frame is a 40x20 hex board: terrain, overlay and grid layers of every tile, as display::draw adds them.
+// items are blits.
+//
+namespace {
+
+const int board_w = 40;
+const int board_h = 20;
+const int hex_size = 72;
+
+enum {LAYER_TERRAIN_BG = 1, LAYER_TERRAIN_FG = 5, LAYER_GRID = 9};
+
+// order as display's drawing_buffer_key: layer in high bits, then location.
+uint32_t order(int layer, int x, int y)
+{
+	return (layer << 24) | (y << 12) | x;
+}
+
+void add_frame(tdrawing_buffer& buffer, const std::vector<surface>& tiles)
+{
+	// add by location, like display does, so sort has to regroup layers.
+	for (int y = 0; y < board_h; y ++) {
+		for (int x = 0; x < board_w; x ++) {
+			const int px = x * hex_size * 3 / 4;
+			const int py = y * hex_size + (x & 1) * hex_size / 2;
+			const surface& surf = tiles[(x * 7 + y * 3) % tiles.size()];
+			buffer.add(order(LAYER_TERRAIN_BG, x, y), px, py, image::tblit(surf, 0, 0, 0, 0));
+			if ((x + y) % 3 == 0) {
+				buffer.add(order(LAYER_TERRAIN_FG, x, y), px, py, image::tblit(image::BLITM_RECT, 0, 0, hex_size / 2, hex_size / 2, 0x80204060));
+			}
+			buffer.add(order(LAYER_GRID, x, y), px, py, image::tblit(image::BLITM_FRAME, 0, 0, hex_size, hex_size, 0x40ffffff));
+		}
+	}
+}
+
+std::vector<surface> make_tiles()
+{
+	std::vector<surface> tiles;
+	for (int at = 0; at < 4; at ++) {
+		surface surf = create_neutral_surface(hex_size, hex_size);
+		uint32_t* pixels = reinterpret_cast<uint32_t*>(surf->pixels);
+		for (int n = 0; n < hex_size * hex_size; n ++) {
+			pixels[n] = 0xff000000 | (at * 0x304050 + n * 0x010203);
+		}
+		tiles.push_back(surf);
+	}
+	return tiles;
+}
+
+}
+
+static void display_drawing_buffer_sort(benchmark::tstate& state)
+{
+	const std::vector<surface> tiles = make_tiles();
+	tdrawing_buffer buffer;
+	size_t blits = 0;
+	while (state.keep_running()) {
+		add_frame(buffer, tiles);
+		blits = buffer.size();
+		buffer.sort();
+		buffer.clear();
+	}
+	state.set_items_processed(blits);
+}
+BENCHMARK(display_drawing_buffer_sort);
+
+static void display_drawing_buffer_commit(benchmark::tstate& state)
+{
+	SDL_Renderer* renderer = benchmark::renderer();
+	if (!renderer) {
+		state.skip("no software renderer");
+		return;
+	}
+	const std::vector<surface> tiles = make_tiles();
+	tdrawing_buffer buffer;
+	size_t blits = 0;
+	while (state.keep_running()) {
+		add_frame(buffer, tiles);
+		blits = buffer.size();
+		buffer.commit(renderer);
+	}
+	state.set_items_processed(blits);
+}
+BENCHMARK(display_drawing_buffer_commit);
+
+// terrain layer of locator blits, as display::draw adds them. consecutive blits of same locator
+// are one run of render_blits, texture lookup and state change are once per run.
+namespace {
+
+const char* terrain_images[] = {
+	"terrain-square/grass/green.png",
+	"terrain-square/grass/dry.png",
+	"terrain-square/grass/semi-dry.png",
+	"terrain-square/grass/leaf-litter.png"
+};
+const int nterrain_images = sizeof(terrain_images) / sizeof(terrain_images[0]);
+
+// image's textures are of video's renderer, so locator blits need gui. return false if it fails.
+bool make_terrains(benchmark::tstate& state, std::vector<image::locator>& terrains)
+{
+	if (!benchmark::init_gui()) {
+		state.skip("gui isn't available");
+		return false;
+	}
+	for (int at = 0; at < nterrain_images; at ++) {
+		image::locator loc(terrain_images[at]);
+		if (!loc.file_exists()) {
+			state.skip(std::string("no ") + terrain_images[at]);
+			return false;
+		}
+		terrains.push_back(loc);
+	}
+	return true;
+}
+
+// @band is rows that use one locator, 0 changes locator every tile. return number of runs.
+int add_terrain_frame(tdrawing_buffer& buffer, const std::vector<image::locator>& terrains, int band)
+{
+	int runs = 0, last = -1;
+	for (int y = 0; y < board_h; y ++) {
+		for (int x = 0; x < board_w; x ++) {
+			const int px = x * hex_size * 3 / 4;
+			const int py = y * hex_size + (x & 1) * hex_size / 2;
+			const int at = band? (y / band) % terrains.size(): (x * 7 + y * 3) % terrains.size();
+			buffer.add(order(LAYER_TERRAIN_BG, x, y), px, py, image::tblit(terrains[at], image::UNSCALED, 0, 0, 0, 0));
+			if (at != last) {
+				runs ++;
+				last = at;
+			}
+		}
+	}
+	return runs;
+}
+
+void commit_terrain(benchmark::tstate& state, int band)
+{
+	std::vector<image::locator> terrains;
+	if (!make_terrains(state, terrains)) {
+		return;
+	}
+	tdrawing_buffer buffer;
+	size_t blits = 0;
+	int runs = 0;
+	while (state.keep_running()) {
+		runs = add_terrain_frame(buffer, terrains, band);
+		blits = buffer.size();
+		buffer.commit(get_renderer());
+	}
+	state.set_items_processed(blits);
+	state.set_counter("runs", runs);
+}
+
+}
+
+// every 5 rows use one locator, so a run is up to 200 blits.
+static void display_drawing_buffer_commit_loc_runs(benchmark::tstate& state)
+{
+	commit_terrain(state, 5);
+}
+BENCHMARK(display_drawing_buffer_commit_loc_runs);
+
+// neighbour tiles use different locator, every run is one blit.
+static void display_drawing_buffer_commit_loc_mixed(benchmark::tstate& state)
+{
+	commit_terrain(state, 0);
+}
+BENCHMARK(display_drawing_buffer_commit_loc_mixed);
+
+// repaint of 20 listbox rows: every canvas gets a target texture of its size, draws and drops it.
+namespace {
+
+const int row_sizes[][2] = {{320, 48}, {320, 49}, {318, 48}, {64, 64}};
+const int nrow_sizes = sizeof(row_sizes) / sizeof(row_sizes[0]);
+const int rows = 20;
+
+}
+
+static void display_canvas_target_create(benchmark::tstate& state)
+{
+	SDL_Renderer* renderer = benchmark::renderer();
+	if (!renderer) {
+		state.skip("no software renderer");
+		return;
+	}
+	while (state.keep_running()) {
+		for (int at = 0; at < rows; at ++) {
+			const int* size = row_sizes[at % nrow_sizes];
+			texture tex = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, size[0], size[1]);
+			trender_target_lock lock(renderer, tex);
+			SDL_RenderClear(renderer);
+		}
+	}
+	state.set_items_processed(rows);
+}
+BENCHMARK(display_canvas_target_create);
+
+static void display_canvas_target_pool(benchmark::tstate& state)
+{
+	SDL_Renderer* renderer = benchmark::renderer();
+	if (!renderer) {
+		state.skip("no software renderer");
+		return;
+	}
+	trender_target_pool& pool = trender_target_pool::singleton();
+	const trender_target_pool::tcounters start = pool.counters();
+	while (state.keep_running()) {
+		for (int at = 0; at < rows; at ++) {
+			const int* size = row_sizes[at % nrow_sizes];
+			texture tex = pool.lease(renderer, SDL_PIXELFORMAT_ARGB8888, size[0], size[1]);
+			trender_target_lock lock(renderer, tex);
+			SDL_RenderClear(renderer);
+		}
+	}
+	state.set_items_processed(rows);
+	state.set_counter("creations", pool.counters().creations - start.creations);
+	state.set_counter("reuses", pool.counters().reuses - start.reuses);
+	pool.clear();
+}
+BENCHMARK(display_canvas_target_pool);
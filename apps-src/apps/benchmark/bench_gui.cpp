@@ -0,0 +1,376 @@
+#include "benchmark.hpp"
+#include "environment.hpp"
+
+#include "gui/auxiliary/formula.hpp"
+#include "gui/widgets/listbox.hpp"
+#include "gui/widgets/toggle_panel.hpp"
+#include "gui/widgets/window.hpp"
+#include "font.hpp"
+#include "help.hpp"
+#include "integrate.hpp"
+
+#include <sstream>
+#include <boost/bind.hpp>
+
+//
+// gui2 work that runs on every layout and redraw: canvas/placement formulas and rich text of tintegrate.
+//
+namespace {
+
+// shapes of formulas in gui.bin, evaluated with variables that canvas sets.
+const char* int_formulas[] = {
+	"(ref_width - width)",
+	"(-1 * height / 2)",
+	"(if(width < 72, 72, width) + 4)",
+	"((screen_width - width) / 2)",
+};
+const int nint_formulas = sizeof(int_formulas) / sizeof(int_formulas[0]);
+
+void set_variables(game_logic::map_formula_callable& variables)
+{
+	variables.add("width", variant(320));
+	variables.add("height", variant(48));
+	variables.add("ref_width", variant(1280));
+	variables.add("ref_height", variant(720));
+	variables.add("screen_width", variant(1280));
+	variables.add("screen_height", variant(720));
+}
+
+std::string rich_text()
+{
+	return tintegrate::generate_format("Rose", "red", 0, true) + " lays out " + tintegrate::generate_format("rich text", "blue")
+		+ " with line breaks. It wraps at maximum width, so long paragraphs are split into several lines of glyphs.\n"
+		+ "Second paragraph: " + tintegrate::generate_format("italic", "", 0, false, true) + ", numbers 1234567890, and punctuation!?";
+}
+}
+
+static void gui_formula_int(benchmark::tstate& state)
+{
+	std::vector<gui2::tformula<int> > formulas;
+	for (int at = 0; at < nint_formulas; at ++) {
+		formulas.push_back(gui2::tformula<int>(int_formulas[at]));
+	}
+	game_logic::map_formula_callable variables;
+	set_variables(variables);
+
+	int sum = 0;
+	while (state.keep_running()) {
+		for (int at = 0; at < nint_formulas; at ++) {
+			sum += formulas[at](variables);
+		}
+	}
+	BENCHMARK_DONT_OPTIMIZE(sum);
+	state.set_items_processed(nint_formulas);
+}
+BENCHMARK(gui_formula_int);
+
+// what tformula did before formulas were interned: tokenize and parse on every evaluation.
+static void gui_formula_int_reparse(benchmark::tstate& state)
+{
+	game_logic::map_formula_callable variables;
+	set_variables(variables);
+
+	int sum = 0;
+	while (state.keep_running()) {
+		for (int at = 0; at < nint_formulas; at ++) {
+			sum += game_logic::formula(int_formulas[at]).evaluate(variables).as_int();
+		}
+	}
+	BENCHMARK_DONT_OPTIMIZE(sum);
+	state.set_items_processed(nint_formulas);
+}
+BENCHMARK(gui_formula_int_reparse);
+
+// temporary tformula per draw, as canvas does for color formulas.
+static void gui_formula_construct(benchmark::tstate& state)
+{
+	game_logic::map_formula_callable variables;
+	set_variables(variables);
+
+	int sum = 0;
+	while (state.keep_running()) {
+		for (int at = 0; at < nint_formulas; at ++) {
+			sum += gui2::tformula<int>(int_formulas[at])(variables);
+		}
+	}
+	BENCHMARK_DONT_OPTIMIZE(sum);
+	state.set_items_processed(nint_formulas);
+}
+BENCHMARK(gui_formula_construct);
+
+static void gui_formula_bool(benchmark::tstate& state)
+{
+	const gui2::tformula<bool> formula("(width > 100 and height < ref_height)");
+	game_logic::map_formula_callable variables;
+	set_variables(variables);
+
+	int sum = 0;
+	while (state.keep_running()) {
+		sum += formula(variables)? 1: 0;
+	}
+	BENCHMARK_DONT_OPTIMIZE(sum);
+	state.set_items_processed(1);
+}
+BENCHMARK(gui_formula_bool);
+
+static void gui_integrate_layout(benchmark::tstate& state)
+{
+	if (!benchmark::init_fonts()) {
+		state.skip("fonts aren't available");
+		return;
+	}
+	const std::string text = rich_text();
+	const SDL_Color color = {0, 0, 0, 255};
+	int height = 0;
+	while (state.keep_running()) {
+		tintegrate integrate(text, 480, -1, help::normal_font_size, color);
+		height += integrate.get_size().y;
+	}
+	BENCHMARK_DONT_OPTIMIZE(height);
+	state.set_bytes_processed(text.size());
+}
+BENCHMARK(gui_integrate_layout);
+
+static void gui_integrate_measure(benchmark::tstate& state)
+{
+	if (!benchmark::init_fonts()) {
+		state.skip("fonts aren't available");
+		return;
+	}
+	const std::string text = rich_text();
+	const SDL_Color color = {0, 0, 0, 255};
+	int height = 0;
+	while (state.keep_running()) {
+		tintegrate integrate(text, 480, -1, help::normal_font_size, color, false, true);
+		height += integrate.get_size().y;
+	}
+	BENCHMARK_DONT_OPTIMIZE(height);
+	state.set_bytes_processed(text.size());
+}
+BENCHMARK(gui_integrate_measure);
+
+// keystroke in text box holding about 200KB: text is edited, laid out again and cursor is located.
+static void gui_integrate_type_200k(benchmark::tstate& state)
+{
+	if (!benchmark::init_fonts()) {
+		state.skip("fonts aren't available");
+		return;
+	}
+	std::string text;
+	while (text.size() < 200 * 1024) {
+		text += "Typing into a long document lays out only the paragraph that changed.\n";
+	}
+	const SDL_Color color = {0, 0, 0, 255};
+	tintegrate integrate(text, 480, -1, help::normal_font_size, color, true);
+	int at = 0;
+	int y = 0;
+	while (state.keep_running()) {
+		at = (at + 7919) % text.size();
+		text.insert(at, "x");
+		integrate.set_src(text);
+		y += integrate.calculate_cursor(at + 1).y;
+	}
+	BENCHMARK_DONT_OPTIMIZE(y);
+	state.set_items_processed(1);
+}
+BENCHMARK(gui_integrate_type_200k);
+
+// window layout pass: every label asks its text size.
+static void gui_text_size_layout_pass(benchmark::tstate& state)
+{
+	if (!benchmark::init_fonts()) {
+		state.skip("fonts aren't available");
+		return;
+	}
+	std::vector<std::string> labels;
+	for (int at = 0; at < 300; at ++) {
+		std::stringstream ss;
+		ss << "Label " << at << " with a few words";
+		labels.push_back(ss.str());
+	}
+	int width = 0;
+	while (state.keep_running()) {
+		for (std::vector<std::string>::const_iterator it = labels.begin(); it != labels.end(); ++ it) {
+			width += font::get_rendered_text_size(*it, 240, help::normal_font_size).x;
+		}
+	}
+	BENCHMARK_DONT_OPTIMIZE(width);
+	state.set_items_processed(labels.size());
+}
+BENCHMARK(gui_text_size_layout_pass);
+
+// listbox of 200 rows scrolled back and forth: every row text is rendered again when it shows.
+static void gui_text_render_rows(benchmark::tstate& state)
+{
+	if (!benchmark::init_fonts()) {
+		state.skip("fonts aren't available");
+		return;
+	}
+	std::vector<std::string> rows;
+	for (int at = 0; at < 200; at ++) {
+		std::stringstream ss;
+		ss << "Row " << at << ": hero " << (at * 7919) % 1000 << ", city " << (at * 104729) % 97;
+		rows.push_back(ss.str());
+	}
+	const SDL_Color color = {255, 255, 255, 255};
+	int width = 0;
+	while (state.keep_running()) {
+		for (std::vector<std::string>::const_iterator it = rows.begin(); it != rows.end(); ++ it) {
+			width += font::get_rendered_text(*it, help::normal_font_size, color, 0)->w;
+		}
+	}
+	BENCHMARK_DONT_OPTIMIZE(width);
+	state.set_items_processed(rows.size());
+}
+BENCHMARK(gui_text_render_rows);
+
+// listbox of combo_box dialog in row model mode, 100k rows. only rows near visible area have panel,
+// panels of rows that scroll out are recycled and filled again.
+namespace {
+
+const int model_rows = 100000;
+
+class trow_model
+{
+public:
+	trow_model()
+		: fills(0)
+	{}
+
+	void fill(gui2::tlistbox& list, gui2::ttoggle_panel& widget, const int at)
+	{
+		std::stringstream ss;
+		ss << "Row " << at << ": hero " << (at * 7919) % 1000 << ", city " << (at * 104729) % 97;
+		gui2::find_widget<gui2::tcontrol>(&widget, "label", false).set_label(ss.str());
+		fills ++;
+	}
+
+	int fills;
+};
+
+// window is laid out, so rows in visible area have panel. NULL if gui isn't available.
+gui2::twindow* row_model_window(benchmark::tstate& state, trow_model& model, gui2::tlistbox*& list)
+{
+	gui2::twindow* window = benchmark::build_window("rose__combo_box");
+	if (!window) {
+		state.skip("gui isn't available");
+		return NULL;
+	}
+	list = gui2::find_widget<gui2::tlistbox>(window, "listbox", false, true);
+	list->set_row_model(boost::bind(&trow_model::fill, &model, _1, _2, _3), model_rows);
+	window->layout();
+	return window;
+}
+
+}
+
+// model is reloaded: heights index is built again, rows of visible area are filled and measured.
+static void gui_row_model_populate_100k(benchmark::tstate& state)
+{
+	trow_model model;
+	gui2::tlistbox* list = NULL;
+	gui2::twindow* window = row_model_window(state, model, list);
+	if (!window) {
+		return;
+	}
+	while (state.keep_running()) {
+		list->set_model_rows(0, 0);
+		list->set_model_rows(model_rows, 0);
+		window->layout();
+	}
+	state.set_items_processed(model_rows);
+	state.set_counter("panels", list->iterator().size);
+	delete window;
+}
+BENCHMARK(gui_row_model_populate_100k);
+
+// scroll to random rows: panels of rows that leave window are recycled for rows that enter it.
+static void gui_row_model_scroll_100k(benchmark::tstate& state)
+{
+	trow_model model;
+	gui2::tlistbox* list = NULL;
+	gui2::twindow* window = row_model_window(state, model, list);
+	if (!window) {
+		return;
+	}
+	uint32_t seed = 0x2468ace;
+	model.fills = 0;
+	int scrolls = 0;
+	while (state.keep_running()) {
+		for (int at = 0; at < 100; at ++) {
+			seed = seed * 1103515245 + 12345;
+			list->scroll_to_row((seed >> 8) % model_rows);
+		}
+		scrolls += 100;
+	}
+	state.set_items_processed(100);
+	state.set_counter("fills_per_scroll", scrolls? (double)model.fills / scrolls: 0);
+	delete window;
+}
+BENCHMARK(gui_row_model_scroll_100k);
+
+// mouse motion through a window of 10 levels: as window and distributor, root has pre handler,
+// containers on the way have post handlers, leaf has child handler. most levels have none.
+namespace {
+
+const int dispatch_levels = 10;
+
+class tdispatch_widget: public gui2::twidget
+{
+public:
+	tdispatch_widget()
+		: motions(0)
+	{}
+
+	void signal_handler_mouse_motion() { motions ++; }
+
+	int motions;
+
+private:
+	tpoint calculate_best_size() const override { return tpoint(0, 0); }
+	bool disable_click_dismiss() const override { return false; }
+	const std::string& get_control_type() const override
+	{
+		static const std::string type = "dispatch";
+		return type;
+	}
+};
+
+}
+
+static void gui_dispatch_mouse_motion_10_levels(benchmark::tstate& state)
+{
+	std::vector<std::unique_ptr<tdispatch_widget> > widgets;
+	for (int at = 0; at < dispatch_levels; at ++) {
+		widgets.push_back(std::unique_ptr<tdispatch_widget>(new tdispatch_widget));
+		tdispatch_widget& widget = *widgets.back();
+		if (at) {
+			widget.set_parent(widgets[at - 1].get());
+		}
+		gui2::event::tdispatcher::tposition position = gui2::event::tdispatcher::back_post_child;
+		if (!at) {
+			position = gui2::event::tdispatcher::back_pre_child;
+		} else if (at == dispatch_levels - 1) {
+			position = gui2::event::tdispatcher::back_child;
+		} else if (at % 4) {
+			continue;
+		}
+		widget.connect_signal<gui2::event::MOUSE_MOTION>(boost::bind(&tdispatch_widget::signal_handler_mouse_motion, &widget), position);
+	}
+
+	tdispatch_widget& root = *widgets.front();
+	tdispatch_widget& leaf = *widgets.back();
+	const tpoint coordinate(100, 100);
+	while (state.keep_running()) {
+		root.fire(gui2::event::MOUSE_MOTION, leaf, coordinate, coordinate);
+	}
+	BENCHMARK_DONT_OPTIMIZE(leaf.motions);
+	state.set_items_processed(1);
+
+	// children first, so no widget notifies a destroyed parent.
+	for (int at = dispatch_levels - 1; at > 0; at --) {
+		widgets[at]->set_parent(NULL);
+		widgets.pop_back();
+	}
+}
+BENCHMARK(gui_dispatch_mouse_motion_10_levels);
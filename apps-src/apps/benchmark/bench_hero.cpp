@@ -0,0 +1,120 @@
+#include "benchmark.hpp"
+#include "environment.hpp"
+
+#include "filesystem.hpp"
+#include "hero.hpp"
+#include "serialization/string_utils.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <sstream>
+#include <stdlib.h>
+
+//
+// heros file loaded by hero_map, and accessed in place by thero_store.
+// file is generated: hero_map holds at most HEROS_MAX_HEROS, store is measured with tens of thousands.
+//
+namespace {
+
+std::string heros_file(benchmark::tstate& state, int count)
+{
+	if (benchmark::work_dir().empty()) {
+		state.skip("no writable directory");
+		return null_str;
+	}
+	std::stringstream fname;
+	fname << benchmark::work_dir() << "hero-" << count << ".dat";
+	if (file_exists(fname.str())) {
+		return fname.str();
+	}
+
+	std::vector<uint8_t> data(HEROS_FILE_PREFIX_BYTES + count * HEROS_BYTES_PER_HERO, 0);
+	*(uint32_t*)&data[0] = mmioFOURCC('H', 'E', 'R', '0');
+	srand(1);
+	for (int number = 0; number < count; number ++) {
+		hero h(number, ftofxp9(rand() % 100), ftofxp9(rand() % 100), ftofxp9(rand() % 100), ftofxp9(rand() % 100), ftofxp9(rand() % 100));
+		h.side_ = rand() % 16;
+		h.city_ = rand() % 256;
+		h.feature_ = rand() % 64;
+		h.write(&data[HEROS_FILE_PREFIX_BYTES + number * HEROS_BYTES_PER_HERO]);
+	}
+	tfile lock(fname.str(), GENERIC_WRITE, CREATE_ALWAYS);
+	if (!lock.valid()) {
+		state.skip("cannot write " + fname.str());
+		return null_str;
+	}
+	posix_fwrite(lock.fp, &data[0], data.size());
+	return fname.str();
+}
+
+void run_hero_map_load(benchmark::tstate& state, int count)
+{
+	const std::string fname = heros_file(state, count);
+	if (fname.empty()) {
+		return;
+	}
+	hero_map heros;
+	while (state.keep_running()) {
+		heros.map_from_file(fname);
+	}
+	state.set_bytes_processed(file_size(fname, false));
+	state.set_counter("heros", (double)heros.size());
+}
+
+void run_hero_store_open(benchmark::tstate& state, int count)
+{
+	const std::string fname = heros_file(state, count);
+	if (fname.empty()) {
+		return;
+	}
+	int size = 0;
+	while (state.keep_running()) {
+		thero_store store(fname);
+		size = store.size();
+	}
+	BENCHMARK_DONT_OPTIMIZE(size);
+	state.set_bytes_processed(file_size(fname, false));
+	state.set_counter("heros", (double)size);
+}
+
+// heros of one side whose force is in a range, by columns or by scanning records.
+void run_hero_store_query(benchmark::tstate& state, int count, bool columns)
+{
+	const std::string fname = heros_file(state, count);
+	if (fname.empty()) {
+		return;
+	}
+	thero_store store(fname);
+	std::vector<int> side, force, result;
+	while (state.keep_running()) {
+		result.clear();
+		if (columns) {
+			store.select(thero_store::COLUMN_SIDE, 3, 3, side);
+			store.select(thero_store::COLUMN_FORCE, 60, 80, force);
+			std::set_intersection(side.begin(), side.end(), force.begin(), force.end(), std::back_inserter(result));
+		} else {
+			for (int number = 0; number < store.size(); number ++) {
+				const hero_fields_t& fields = store.fields(number);
+				const int value = fxptoi9(fields.force_);
+				if (fields.number_ != HEROS_INVALID_NUMBER && fields.side_ == 3 && value >= 60 && value <= 80) {
+					result.push_back(number);
+				}
+			}
+		}
+	}
+	BENCHMARK_DONT_OPTIMIZE(result);
+	state.set_counter("matches", (double)result.size());
+}
+
+}
+
+static void hero_map_load_8k(benchmark::tstate& state) { run_hero_map_load(state, 8000); }
+BENCHMARK(hero_map_load_8k);
+static void hero_store_open_8k(benchmark::tstate& state) { run_hero_store_open(state, 8000); }
+BENCHMARK(hero_store_open_8k);
+static void hero_store_open_50k(benchmark::tstate& state) { run_hero_store_open(state, 50000); }
+BENCHMARK(hero_store_open_50k);
+static void hero_store_query_columns_50k(benchmark::tstate& state) { run_hero_store_query(state, 50000, true); }
+BENCHMARK(hero_store_query_columns_50k);
+static void hero_store_query_scan_50k(benchmark::tstate& state) { run_hero_store_query(state, 50000, false); }
+BENCHMARK(hero_store_query_scan_50k);
@@ -0,0 +1,168 @@
+#include "benchmark.hpp"
+
+#include "sdl_pixel.hpp"
+
+#include <map>
+#include <vector>
+
+//
+// per-pixel kernels behind image modification functions. items are pixels.
+// 72x72 is a hex tile, 512x512 a big portrait or map overlay.
+//
+namespace {
+
+std::vector<uint32_t> make_pixels(int count)
+{
+	// opaque color with some transparent pixels, like the edge of a hex tile.
+	std::vector<uint32_t> pixels(count);
+	uint32_t seed = 0x12345678;
+	for (int at = 0; at < count; at ++) {
+		seed = seed * 1103515245 + 12345;
+		pixels[at] = (at % 7)? seed | 0xff000000: seed & 0x00ffffff;
+	}
+	return pixels;
+}
+
+// kernels are in place, so every iteration restores source first. copy cost is part of result,
+// it's small compared with kernels.
+struct tpixels
+{
+	tpixels(int w, int h)
+		: w(w)
+		, h(h)
+		, src(make_pixels(w * h))
+		, dst(src)
+	{}
+
+	uint32_t* reset()
+	{
+		dst = src;
+		return &dst[0];
+	}
+
+	void finish(benchmark::tstate& state)
+	{
+		BENCHMARK_DONT_OPTIMIZE(dst[0]);
+		state.set_items_processed(w * h);
+		state.set_bytes_processed(w * h * 4);
+	}
+
+	int w, h;
+	std::vector<uint32_t> src;
+	std::vector<uint32_t> dst;
+};
+
+void run_add(benchmark::tstate& state, int w, int h)
+{
+	tpixels pixels(w, h);
+	while (state.keep_running()) {
+		pixel_add(pixels.reset(), w * h, 40, -30, 20, 0);
+	}
+	pixels.finish(state);
+}
+
+void run_multiply(benchmark::tstate& state, int w, int h)
+{
+	tpixels pixels(w, h);
+	while (state.keep_running()) {
+		pixel_multiply(pixels.reset(), w * h, 384, 384, 384, 256);
+	}
+	pixels.finish(state);
+}
+
+void run_greyscale(benchmark::tstate& state, int w, int h)
+{
+	tpixels pixels(w, h);
+	while (state.keep_running()) {
+		pixel_greyscale(pixels.reset(), w * h);
+	}
+	pixels.finish(state);
+}
+
+void run_light(benchmark::tstate& state, int w, int h)
+{
+	tpixels pixels(w, h);
+	const std::vector<uint32_t> light = make_pixels(w * h);
+	while (state.keep_running()) {
+		pixel_light(pixels.reset(), &light[0], w * h);
+	}
+	pixels.finish(state);
+}
+
+void run_mask(benchmark::tstate& state, int w, int h)
+{
+	tpixels pixels(w, h);
+	const std::vector<uint32_t> mask = make_pixels(w * h);
+	bool empty = false;
+	while (state.keep_running()) {
+		empty |= pixel_mask(pixels.reset(), &mask[0], w * h);
+	}
+	BENCHMARK_DONT_OPTIMIZE(empty);
+	pixels.finish(state);
+}
+
+void run_recolor(benchmark::tstate& state, int w, int h)
+{
+	// team color palette, ~20 entries. map about a quarter of colors that appear.
+	tpixels pixels(w, h);
+	std::map<uint32_t, uint32_t> map;
+	for (int at = 0; at < (int)pixels.src.size() && map.size() < 20; at += 13) {
+		map[pixels.src[at] & 0x00ffffff] = (pixels.src[at] ^ 0x5a5a5a) & 0x00ffffff;
+	}
+	const tcolor_lut lut(map);
+	while (state.keep_running()) {
+		pixel_recolor(pixels.reset(), w * h, lut);
+	}
+	pixels.finish(state);
+}
+
+void run_blend(benchmark::tstate& state, int w, int h)
+{
+	uint8_t table[256];
+	for (int c = 0; c < 256; c ++) {
+		table[c] = uint8_t(c * 0.75) + uint8_t(255 * 0.25);
+	}
+	tpixels pixels(w, h);
+	while (state.keep_running()) {
+		pixel_lut(pixels.reset(), w * h, table, table, table);
+	}
+	pixels.finish(state);
+}
+
+void run_blur(benchmark::tstate& state, int w, int h, int depth)
+{
+	tpixels pixels(w, h);
+	while (state.keep_running()) {
+		pixel_blur(pixels.reset(), w, h, w, depth, true);
+	}
+	pixels.finish(state);
+}
+
+}
+
+static void pixel_add_hex(benchmark::tstate& state) { run_add(state, 72, 72); }
+BENCHMARK(pixel_add_hex);
+static void pixel_add_512(benchmark::tstate& state) { run_add(state, 512, 512); }
+BENCHMARK(pixel_add_512);
+static void pixel_multiply_hex(benchmark::tstate& state) { run_multiply(state, 72, 72); }
+BENCHMARK(pixel_multiply_hex);
+static void pixel_multiply_512(benchmark::tstate& state) { run_multiply(state, 512, 512); }
+BENCHMARK(pixel_multiply_512);
+static void pixel_greyscale_hex(benchmark::tstate& state) { run_greyscale(state, 72, 72); }
+BENCHMARK(pixel_greyscale_hex);
+static void pixel_greyscale_512(benchmark::tstate& state) { run_greyscale(state, 512, 512); }
+BENCHMARK(pixel_greyscale_512);
+static void pixel_light_hex(benchmark::tstate& state) { run_light(state, 72, 72); }
+BENCHMARK(pixel_light_hex);
+static void pixel_mask_hex(benchmark::tstate& state) { run_mask(state, 72, 72); }
+BENCHMARK(pixel_mask_hex);
+static void pixel_recolor_hex(benchmark::tstate& state) { run_recolor(state, 72, 72); }
+BENCHMARK(pixel_recolor_hex);
+static void pixel_recolor_512(benchmark::tstate& state) { run_recolor(state, 512, 512); }
+BENCHMARK(pixel_recolor_512);
+static void pixel_blend_512(benchmark::tstate& state) { run_blend(state, 512, 512); }
+BENCHMARK(pixel_blend_512);
+static void pixel_blur2_hex(benchmark::tstate& state) { run_blur(state, 72, 72, 2); }
+BENCHMARK(pixel_blur2_hex);
+static void pixel_blur8_512(benchmark::tstate& state) { run_blur(state, 512, 512, 8); }
+BENCHMARK(pixel_blur8_512);
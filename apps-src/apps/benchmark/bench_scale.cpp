@@ -0,0 +1,60 @@
+#include "benchmark.hpp"
+
+#include "sdl_scale.hpp"
+
+#include <vector>
+
+//
+// throughput of cpu scaling kernels. items are destination pixels.
+// *_c cases run portable version, for comparing with vectorized one.
+//
+namespace {
+
+typedef void (*tscale)(const uint32_t* src, int src_w, int src_h, int src_stride, uint32_t* dst, int dst_w, int dst_h, int dst_stride);
+
+void run_scale(benchmark::tstate& state, tscale scale, int src_w, int src_h, int dst_w, int dst_h)
+{
+	// fixed pattern with transparent pixels, like a hex tile or a portrait with alpha edge.
+	std::vector<uint32_t> src(src_w * src_h);
+	uint32_t seed = 0x12345678;
+	for (size_t at = 0; at < src.size(); at ++) {
+		seed = seed * 1103515245 + 12345;
+		src[at] = (at % 7)? seed | 0xff000000: seed & 0x00ffffff;
+	}
+	std::vector<uint32_t> dst(dst_w * dst_h);
+
+	while (state.keep_running()) {
+		scale(&src[0], src_w, src_h, src_w, &dst[0], dst_w, dst_h, dst_w);
+	}
+	BENCHMARK_DONT_OPTIMIZE(dst[0]);
+	state.set_items_processed(dst_w * dst_h);
+	state.set_bytes_processed(src_w * src_h * 4);
+}
+
+}
+
+// hex tile to zoomed tile, downscale and upscale.
+static void scale_bilinear_hex_down(benchmark::tstate& state) { run_scale(state, scale_argb_bilinear, 72, 72, 54, 54); }
+BENCHMARK(scale_bilinear_hex_down);
+static void scale_bilinear_hex_down_c(benchmark::tstate& state) { run_scale(state, scale_argb_bilinear_c, 72, 72, 54, 54); }
+BENCHMARK(scale_bilinear_hex_down_c);
+static void scale_bilinear_hex_up(benchmark::tstate& state) { run_scale(state, scale_argb_bilinear, 72, 72, 144, 144); }
+BENCHMARK(scale_bilinear_hex_up);
+static void scale_bilinear_hex_up_c(benchmark::tstate& state) { run_scale(state, scale_argb_bilinear_c, 72, 72, 144, 144); }
+BENCHMARK(scale_bilinear_hex_up_c);
+
+// portrait to thumbnail/full screen.
+static void scale_bilinear_portrait(benchmark::tstate& state) { run_scale(state, scale_argb_bilinear, 480, 640, 720, 960); }
+BENCHMARK(scale_bilinear_portrait);
+static void scale_bilinear_portrait_c(benchmark::tstate& state) { run_scale(state, scale_argb_bilinear_c, 480, 640, 720, 960); }
+BENCHMARK(scale_bilinear_portrait_c);
+static void scale_box_portrait(benchmark::tstate& state) { run_scale(state, scale_argb_box, 480, 640, 160, 213); }
+BENCHMARK(scale_box_portrait);
+static void scale_box_portrait_c(benchmark::tstate& state) { run_scale(state, scale_argb_box_c, 480, 640, 160, 213); }
+BENCHMARK(scale_box_portrait_c);
+
+// minimap tile.
+static void scale_box_minimap_tile(benchmark::tstate& state) { run_scale(state, scale_argb_box, 72, 72, 8, 8); }
+BENCHMARK(scale_box_minimap_tile);
+static void scale_box_minimap_tile_c(benchmark::tstate& state) { run_scale(state, scale_argb_box_c, 72, 72, 8, 8); }
+BENCHMARK(scale_box_minimap_tile_c);
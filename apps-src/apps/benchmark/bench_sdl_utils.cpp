@@ -0,0 +1,150 @@
+#include "benchmark.hpp"
+
+#include "sdl_utils.hpp"
+
+#include <map>
+
+//
+// surface level image functions of sdl_utils, as image path modifications and display call them:
+// each call allocates result, converts format when needed, then runs kernel. items are source pixels.
+//
+namespace {
+
+surface make_surface(int w, int h)
+{
+	// opaque color with transparent pixels, like a hex tile or a portrait with alpha edge.
+	surface surf = create_neutral_surface(w, h);
+	uint32_t* pixels = reinterpret_cast<uint32_t*>(surf->pixels);
+	uint32_t seed = 0x12345678;
+	for (int y = 0; y < h; y ++) {
+		for (int x = 0; x < w; x ++) {
+			seed = seed * 1103515245 + 12345;
+			const int at = y * w + x;
+			pixels[y * surf->pitch / 4 + x] = (at % 7)? seed | 0xff000000: seed & 0x00ffffff;
+		}
+	}
+	return surf;
+}
+
+// hex shaped alpha mask, as image::get_hexmask.
+surface make_hex_mask(int size)
+{
+	surface surf = create_neutral_surface(size, size);
+	uint32_t* pixels = reinterpret_cast<uint32_t*>(surf->pixels);
+	const int quarter = size / 4;
+	for (int y = 0; y < size; y ++) {
+		const int dy = y < size / 2? size / 2 - 1 - y: y - size / 2;
+		for (int x = 0; x < size; x ++) {
+			const bool in = x >= quarter * dy / (size / 2) && x < size - quarter * dy / (size / 2);
+			pixels[y * surf->pitch / 4 + x] = in? 0xffffffff: 0;
+		}
+	}
+	return surf;
+}
+
+void finish(benchmark::tstate& state, const surface& src, const surface& result)
+{
+	BENCHMARK_DONT_OPTIMIZE(result);
+	state.set_items_processed(src->w * src->h);
+	state.set_bytes_processed(src->w * src->h * 4);
+}
+
+}
+
+static void sdl_utils_scale_surface_hex(benchmark::tstate& state)
+{
+	const surface src = make_surface(72, 72);
+	surface result;
+	while (state.keep_running()) {
+		result = scale_surface(src, 54, 54);
+	}
+	finish(state, src, result);
+}
+BENCHMARK(sdl_utils_scale_surface_hex);
+
+static void sdl_utils_scale_surface_blended_portrait(benchmark::tstate& state)
+{
+	const surface src = make_surface(480, 640);
+	surface result;
+	while (state.keep_running()) {
+		result = scale_surface_blended(src, 160, 213);
+	}
+	finish(state, src, result);
+}
+BENCHMARK(sdl_utils_scale_surface_blended_portrait);
+
+static void sdl_utils_adjust_surface_color(benchmark::tstate& state)
+{
+	const surface src = make_surface(512, 512);
+	surface result;
+	while (state.keep_running()) {
+		result = adjust_surface_color(src, 40, -30, 20);
+	}
+	finish(state, src, result);
+}
+BENCHMARK(sdl_utils_adjust_surface_color);
+
+static void sdl_utils_greyscale_image(benchmark::tstate& state)
+{
+	const surface src = make_surface(512, 512);
+	surface result;
+	while (state.keep_running()) {
+		result = greyscale_image(src);
+	}
+	finish(state, src, result);
+}
+BENCHMARK(sdl_utils_greyscale_image);
+
+static void sdl_utils_recolor_image(benchmark::tstate& state)
+{
+	// team color: a magenta palette of 19 colors to another palette.
+	std::map<Uint32, Uint32> map_rgb;
+	for (int at = 0; at < 19; at ++) {
+		map_rgb.insert(std::make_pair(0xf000f0 - at * 0x0a000a, 0x2040f0 - at * 0x01020a));
+	}
+	surface src = make_surface(72, 72);
+	uint32_t* pixels = reinterpret_cast<uint32_t*>(src->pixels);
+	for (int at = 0; at < 72 * 72; at += 3) {
+		pixels[at] = 0xff000000 | (0xf000f0 - (at % 19) * 0x0a000a);
+	}
+	surface result;
+	while (state.keep_running()) {
+		result = recolor_image(src, map_rgb);
+	}
+	finish(state, src, result);
+}
+BENCHMARK(sdl_utils_recolor_image);
+
+static void sdl_utils_mask_surface_hex(benchmark::tstate& state)
+{
+	const surface src = make_surface(72, 72);
+	const surface mask = make_hex_mask(72);
+	surface result;
+	while (state.keep_running()) {
+		result = mask_surface(src, mask);
+	}
+	finish(state, src, result);
+}
+BENCHMARK(sdl_utils_mask_surface_hex);
+
+static void sdl_utils_blur_alpha_surface(benchmark::tstate& state)
+{
+	const surface src = make_surface(256, 256);
+	surface result;
+	while (state.keep_running()) {
+		result = blur_alpha_surface(src, 3);
+	}
+	finish(state, src, result);
+}
+BENCHMARK(sdl_utils_blur_alpha_surface);
+
+static void sdl_utils_rotate_surface(benchmark::tstate& state)
+{
+	const surface src = make_surface(72, 72);
+	surface result;
+	while (state.keep_running()) {
+		result = rotate_surface(src, 30);
+	}
+	finish(state, src, result);
+}
+BENCHMARK(sdl_utils_rotate_surface);
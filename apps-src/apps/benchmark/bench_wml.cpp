@@ -0,0 +1,268 @@
+#include "benchmark.hpp"
+#include "environment.hpp"
+
+#include "config.hpp"
+#include "filesystem.hpp"
+#include "loadscreen.hpp"
+#include "rose_config.hpp"
+#include "serialization/parser.hpp"
+#include "serialization/preprocessor.hpp"
+#include "xwml.hpp"
+
+#include <boost/scoped_ptr.hpp>
+#include <sstream>
+
+//
+// config loading from apps-res: binary xwml that app loads at startup,
+// and text cfg through preprocessor and parser, which is what wml2bin does. bytes are input size.
+//
+namespace {
+
+void run_xwml(benchmark::tstate& state, const std::string& name)
+{
+	if (!benchmark::init_res()) {
+		state.skip("apps-res isn't found");
+		return;
+	}
+	const std::string fname = game_config::path + "/xwml/" + name;
+	if (!file_exists(fname)) {
+		state.skip(fname + " isn't found");
+		return;
+	}
+	config cfg;
+	while (state.keep_running()) {
+		cfg.clear();
+		wml_config_from_file(fname, cfg);
+	}
+	state.set_bytes_processed(file_size(fname, false));
+	state.set_counter("children", (double)std::distance(cfg.ordered_begin(), cfg.ordered_end()));
+}
+
+void run_preprocess(benchmark::tstate& state, const std::string& name, bool parse)
+{
+	if (!benchmark::init_res()) {
+		state.skip("apps-res isn't found");
+		return;
+	}
+	const std::string fname = game_config::path + "/" + name;
+	if (!file_exists(fname)) {
+		state.skip(fname + " isn't found");
+		return;
+	}
+
+	int64_t bytes = 0;
+	config cfg;
+	while (state.keep_running()) {
+		preproc_map defines;
+		boost::scoped_ptr<std::istream> stream(preprocess_file(fname, &defines));
+		if (parse) {
+			cfg.clear();
+			read(cfg, *stream);
+		} else {
+			// drain, preprocessor works while stream is read.
+			char buf[4096];
+			bytes = 0;
+			while (stream->read(buf, sizeof(buf)) || stream->gcount()) {
+				bytes += stream->gcount();
+			}
+		}
+	}
+	BENCHMARK_DONT_OPTIMIZE(cfg);
+	state.set_bytes_processed(file_size(fname, false));
+	if (!parse) {
+		state.set_counter("output_bytes", (double)bytes);
+	}
+}
+
+// copy of bin in work directory, xwml v2 if @v2, else v1 with index section that txwml_view reads.
+// it is generated from bin of apps-res at first use, and again when that one is rebuilt. empty if it fails.
+std::string xwml_copy(benchmark::tstate& state, const std::string& name, bool v2)
+{
+	if (!benchmark::init_res()) {
+		state.skip("apps-res isn't found");
+		return null_str;
+	}
+	if (benchmark::work_dir().empty()) {
+		state.skip("no writable directory");
+		return null_str;
+	}
+	const std::string fname = benchmark::work_dir() + (v2? "v2-": "index-") + name;
+	const std::string src = game_config::path + "/xwml/" + name;
+	// mtime is in seconds, v1 that is rebuilt within the second v2 is written must not be missed.
+	if (!file_exists(fname) || file_create_time(src) >= file_create_time(fname)) {
+		config cfg;
+		wml_config_from_file(src, cfg);
+		if (v2) {
+			wml_config_to_file_v2(fname, cfg);
+		} else {
+			wml_config_to_file(fname, cfg, 0, 0, 0, std::map<std::string, std::string>(), true);
+		}
+	}
+	return fname;
+}
+
+// same bin as run_xwml reads, through txwml_view. materialized one decodes all to config as
+// wml_config_from_file does, else only id of every top-level child is decoded.
+void run_xwml_view(benchmark::tstate& state, const std::string& name, bool materialize)
+{
+	const std::string fname = xwml_copy(state, name, false);
+	if (fname.empty()) {
+		return;
+	}
+	if (!txwml_view(fname).valid()) {
+		state.skip(fname + " hasn't index section");
+		return;
+	}
+	config cfg;
+	size_t bytes = 0;
+	while (state.keep_running()) {
+		txwml_view view(fname);
+		if (materialize) {
+			view.root().to_config(cfg);
+		} else {
+			bytes = 0;
+			for (tconfig_view child = view.root().first_child(); child.valid(); child = child.next_sibling()) {
+				bytes += child["id"].str().size();
+			}
+		}
+	}
+	BENCHMARK_DONT_OPTIMIZE(cfg);
+	BENCHMARK_DONT_OPTIMIZE(bytes);
+	state.set_bytes_processed(file_size(fname, false));
+	state.set_counter("v1_bytes", (double)file_size(game_config::path + "/xwml/" + name, false));
+}
+
+// blocks with tag @skip aren't parsed, as gui2::load_settings doesn't parse [window]s.
+void run_xwml_v2(benchmark::tstate& state, const std::string& name, const std::string& skip)
+{
+	const std::string fname = xwml_copy(state, name, true);
+	if (fname.empty()) {
+		return;
+	}
+	config cfg;
+	while (state.keep_running()) {
+		txwml_archive archive(fname);
+		archive.to_config(cfg, skip);
+	}
+	state.set_bytes_processed(file_size(fname, false));
+	state.set_counter("v1_bytes", (double)file_size(game_config::path + "/xwml/" + name, false));
+}
+
+// open archive and parse one child, what a caller that needs one [window] pays.
+void run_xwml_v2_find(benchmark::tstate& state, const std::string& name, const std::string& key)
+{
+	const std::string fname = xwml_copy(state, name, true);
+	if (fname.empty()) {
+		return;
+	}
+	std::string id;
+	{
+		txwml_archive archive(fname);
+		const int at = archive.find(key);
+		if (at == -1) {
+			state.skip("[" + key + "] isn't found");
+			return;
+		}
+		id = archive.blocks()[at].id;
+	}
+	int attributes = 0;
+	while (state.keep_running()) {
+		txwml_archive archive(fname);
+		const config& cfg = archive.find_child(key, id);
+		attributes = std::distance(cfg.attribute_range().first, cfg.attribute_range().second);
+	}
+	BENCHMARK_DONT_OPTIMIZE(attributes);
+	state.set_bytes_processed(file_size(fname, false));
+}
+
+// preprocessor and parser work as one pass, parser reads preprocessor's output by chunks.
+// materialized one preprocesses to a string first, that is what it costs without streaming.
+// bytes are preprocessor's output, so MB/s is of expanded text.
+void run_pipeline(benchmark::tstate& state, const std::string& name, const std::string& define, bool materialize)
+{
+	if (!benchmark::init_res()) {
+		state.skip("apps-res isn't found");
+		return;
+	}
+	const std::string fname = game_config::path + "/" + name;
+	if (!file_exists(fname) && !is_directory(fname)) {
+		state.skip(fname + " isn't found");
+		return;
+	}
+	preproc_map defines;
+	if (!define.empty()) {
+		defines[define] = preproc_define();
+	}
+
+	int64_t bytes = 0;
+	{
+		preproc_map tmp = defines;
+		boost::scoped_ptr<std::istream> stream(preprocess_file(fname, &tmp));
+		char buf[4096];
+		while (stream->read(buf, sizeof(buf)) || stream->gcount()) {
+			bytes += stream->gcount();
+		}
+	}
+
+	config cfg;
+	reset_preproc_cache_stats();
+	while (state.keep_running()) {
+		preproc_map tmp = defines;
+		boost::scoped_ptr<std::istream> stream(preprocess_file(fname, &tmp));
+		cfg.clear();
+		if (materialize) {
+			std::stringstream text;
+			text << stream->rdbuf();
+			read(cfg, text);
+		} else {
+			read(cfg, *stream);
+		}
+	}
+	BENCHMARK_DONT_OPTIMIZE(cfg);
+	state.set_bytes_processed(bytes);
+	state.set_counter("children", (double)std::distance(cfg.ordered_begin(), cfg.ordered_end()));
+	if (preproc_cache_mode() != PREPROC_CACHE_OFF) {
+		const tpreproc_cache_stats stats = preproc_cache_stats();
+		state.set_counter("cache_hits", (double)stats.hits);
+		if (preproc_cache_mode() == PREPROC_CACHE_VERIFY) {
+			state.set_counter("cache_mismatches", (double)stats.mismatches);
+		}
+	}
+}
+
+}
+
+static void wml_load_data_bin(benchmark::tstate& state) { run_xwml(state, "data.bin"); }
+BENCHMARK(wml_load_data_bin);
+static void wml_load_gui_bin(benchmark::tstate& state) { run_xwml(state, "gui.bin"); }
+BENCHMARK(wml_load_gui_bin);
+static void wml_view_data_bin(benchmark::tstate& state) { run_xwml_view(state, "data.bin", true); }
+BENCHMARK(wml_view_data_bin);
+static void wml_view_scan_data_bin(benchmark::tstate& state) { run_xwml_view(state, "data.bin", false); }
+BENCHMARK(wml_view_scan_data_bin);
+static void wml_load_data_bin_v2(benchmark::tstate& state) { run_xwml_v2(state, "data.bin", null_str); }
+BENCHMARK(wml_load_data_bin_v2);
+static void wml_load_gui_bin_v2(benchmark::tstate& state) { run_xwml_v2(state, "gui.bin", null_str); }
+BENCHMARK(wml_load_gui_bin_v2);
+static void wml_load_gui_bin_v2_without_windows(benchmark::tstate& state) { run_xwml_v2(state, "gui.bin", "window"); }
+BENCHMARK(wml_load_gui_bin_v2_without_windows);
+static void wml_find_window_v2(benchmark::tstate& state) { run_xwml_v2_find(state, "gui.bin", "window"); }
+BENCHMARK(wml_find_window_v2);
+
+static void wml_preprocess_terrain(benchmark::tstate& state) { run_preprocess(state, "data/core/terrain.cfg", false); }
+BENCHMARK(wml_preprocess_terrain);
+static void wml_preprocess_parse_terrain(benchmark::tstate& state) { run_preprocess(state, "data/core/terrain.cfg", true); }
+BENCHMARK(wml_preprocess_parse_terrain);
+static void wml_preprocess_parse_fonts(benchmark::tstate& state) { run_preprocess(state, "data/hardwired/fonts.cfg", true); }
+BENCHMARK(wml_preprocess_parse_fonts);
+
+static void wml_pipeline_data(benchmark::tstate& state) { run_pipeline(state, "data", "CORE", false); }
+BENCHMARK(wml_pipeline_data);
+static void wml_pipeline_data_materialized(benchmark::tstate& state) { run_pipeline(state, "data", "CORE", true); }
+BENCHMARK(wml_pipeline_data_materialized);
+static void wml_pipeline_gui(benchmark::tstate& state) { run_pipeline(state, "data/gui", "", false); }
+BENCHMARK(wml_pipeline_gui);
+static void wml_pipeline_gui_materialized(benchmark::tstate& state) { run_pipeline(state, "data/gui", "", true); }
+BENCHMARK(wml_pipeline_gui_materialized);
+static void wml_pipeline_tb(benchmark::tstate& state) { run_pipeline(state, "data/tb.cfg", "TB_HEXAGONAL", false); }
+BENCHMARK(wml_pipeline_tb);
@@ -0,0 +1,89 @@
+#include "benchmark.hpp"
+
+#include <chrono>
+
+namespace benchmark {
+
+tstate::tstate(int min_time_ms)
+	: min_time_ms_(min_time_ms)
+	, iterations_(0)
+	, started_(false)
+	, paused_(false)
+	, start_ns_(0)
+	, elapsed_ns_(0)
+	, items_(0)
+	, bytes_(0)
+	, counters_()
+	, skipped_()
+{}
+
+bool tstate::keep_running()
+{
+	const int64_t now = now_ns();
+	if (!started_) {
+		started_ = true;
+		start_ns_ = now;
+		return true;
+	}
+	if (!paused_) {
+		elapsed_ns_ += now - start_ns_;
+	}
+	iterations_ ++;
+	// at least 3 iterations, so that a cold first run doesn't dominate.
+	if (iterations_ >= 3 && elapsed_ns_ >= min_time_ms_ * 1000000.0) {
+		return false;
+	}
+	paused_ = false;
+	start_ns_ = now_ns();
+	return true;
+}
+
+void tstate::pause_timing()
+{
+	if (!paused_) {
+		elapsed_ns_ += now_ns() - start_ns_;
+		paused_ = true;
+	}
+}
+
+void tstate::resume_timing()
+{
+	if (paused_) {
+		start_ns_ = now_ns();
+		paused_ = false;
+	}
+}
+
+std::vector<tcase>& cases()
+{
+	static std::vector<tcase> ret;
+	return ret;
+}
+
+int64_t now_ns()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+tregister::tregister(const char* name, tfunction function)
+{
+	tcase c;
+	c.name = name;
+	c.function = function;
+	cases().push_back(c);
+}
+
+void dont_optimize(const void* ptr)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	// ptr escapes to asm, memory clobber makes compiler assume what it points to is read.
+	__asm__ __volatile__("" : : "r"(ptr) : "memory");
+#else
+	// store to volatile can't be dropped, reading it back makes sink a used variable.
+	static const void* volatile sink;
+	sink = ptr;
+	(void)sink;
+#endif
+}
+
+}
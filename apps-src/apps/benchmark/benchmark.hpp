@@ -0,0 +1,92 @@
+#ifndef BENCHMARK_BENCHMARK_HPP_INCLUDED
+#define BENCHMARK_BENCHMARK_HPP_INCLUDED
+
+#include <map>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+//
+// minimal benchmark harness. every bench_*.cpp registers its cases with BENCHMARK,
+// main runs them in registration order.
+//
+// void bench_foo(benchmark::tstate& state)
+// {
+//     prepare fixed dataset...
+//     while (state.keep_running()) {
+//         measured work
+//     }
+//     state.set_counter("bytes", ...);
+// }
+// BENCHMARK(bench_foo);
+//
+namespace benchmark {
+
+class tstate
+{
+public:
+	explicit tstate(int min_time_ms);
+
+	// returns true while loop should run one more iteration.
+	bool keep_running();
+
+	// exclude work from timing, i.e. rebuild input that measured work consumed.
+	void pause_timing();
+	void resume_timing();
+
+	// case can't run here, i.e. dataset is missing. call it before keep_running, then return.
+	void skip(const std::string& reason) { skipped_ = reason; }
+
+	void set_counter(const std::string& name, double value) { counters_[name] = value; }
+	void set_items_processed(int64_t items) { items_ = items; }
+	void set_bytes_processed(int64_t bytes) { bytes_ = bytes; }
+
+	int iterations() const { return iterations_; }
+	double elapsed_ns() const { return elapsed_ns_; }
+	int64_t items_processed() const { return items_; }
+	int64_t bytes_processed() const { return bytes_; }
+	const std::map<std::string, double>& counters() const { return counters_; }
+	const std::string& skipped() const { return skipped_; }
+
+private:
+	int min_time_ms_;
+	int iterations_;
+	bool started_;
+	bool paused_;
+	int64_t start_ns_;
+	double elapsed_ns_;
+	int64_t items_;
+	int64_t bytes_;
+	std::map<std::string, double> counters_;
+	std::string skipped_;
+};
+
+typedef void (*tfunction)(tstate& state);
+
+struct tcase
+{
+	std::string name;
+	tfunction function;
+};
+
+std::vector<tcase>& cases();
+int64_t now_ns();
+
+struct tregister
+{
+	tregister(const char* name, tfunction function);
+};
+
+}
+
+#define BENCHMARK(function) \
+	static benchmark::tregister benchmark_register_##function(#function, function)
+
+// prevent compiler from optimizing away result of measured work.
+#define BENCHMARK_DONT_OPTIMIZE(value) benchmark::dont_optimize(&(value))
+
+namespace benchmark {
+void dont_optimize(const void* ptr);
+}
+
+#endif
@@ -0,0 +1,199 @@
+#include "environment.hpp"
+
+#include "filesystem.hpp"
+#include "font.hpp"
+#include "rose_config.hpp"
+#include "video.hpp"
+#include "wml_exception.hpp"
+#include "gui/auxiliary/event/handler.hpp"
+#include "gui/auxiliary/window_builder.hpp"
+#include "gui/widgets/helper.hpp"
+#include "gui/widgets/settings.hpp"
+#include "gui/widgets/window.hpp"
+
+#include <stdio.h>
+
+namespace benchmark {
+
+namespace {
+
+#ifdef BENCHMARK_RES_DIR
+std::string res = BENCHMARK_RES_DIR;
+#else
+std::string res;
+#endif
+
+int res_state = -1;
+bool video_init = false;
+SDL_Window* window = NULL;
+SDL_Renderer* software_renderer = NULL;
+font::manager* fonts = NULL;
+int fonts_state = -1;
+CVideo* video = NULL;
+gui2::event::tmanager* gui_events = NULL;
+int gui_state = -1;
+bool work_dir_init = false;
+std::string work;
+int user_data_state = -1;
+
+}
+
+const std::string& res_dir()
+{
+	return res;
+}
+
+void set_res_dir(const std::string& dir)
+{
+	res = dir;
+	res_state = -1;
+}
+
+bool init_res()
+{
+	if (res_state == -1) {
+		res_state = !res.empty() && file_exists(res + "/xwml/data.bin") && file_exists(res + "/data/_main.cfg");
+		if (res_state) {
+			game_config::path = res;
+		} else {
+			fprintf(stderr, "apps-res isn't found at '%s', use --res=<dir>\n", res.c_str());
+		}
+	}
+	return res_state == 1;
+}
+
+SDL_Renderer* renderer()
+{
+	if (video_init) {
+		return software_renderer;
+	}
+	video_init = true;
+
+	// keep driver that user selected explicitly.
+	SDL_setenv("SDL_VIDEODRIVER", "dummy", 0);
+	if (SDL_InitSubSystem(SDL_INIT_VIDEO) < 0) {
+		fprintf(stderr, "SDL_InitSubSystem(SDL_INIT_VIDEO): %s\n", SDL_GetError());
+		return NULL;
+	}
+	window = SDL_CreateWindow("benchmark", 0, 0, 1280, 720, SDL_WINDOW_HIDDEN);
+	if (!window) {
+		fprintf(stderr, "SDL_CreateWindow: %s\n", SDL_GetError());
+		return NULL;
+	}
+	software_renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_SOFTWARE);
+	if (!software_renderer) {
+		fprintf(stderr, "SDL_CreateRenderer: %s\n", SDL_GetError());
+	}
+	return software_renderer;
+}
+
+bool init_fonts()
+{
+	if (fonts_state == -1) {
+		fonts_state = 0;
+		if (init_res()) {
+			try {
+				fonts = new font::manager;
+				fonts_state = font::load_font_config();
+			} catch (font::manager::error&) {
+				fprintf(stderr, "TTF_Init fail\n");
+			}
+		}
+	}
+	return fonts_state == 1;
+}
+
+bool init_gui()
+{
+	if (gui_state == -1) {
+		gui_state = 0;
+		if (init_fonts() && renderer()) {
+			try {
+				video = new CVideo;
+				if (gui2::init()) {
+					gui_events = new gui2::event::tmanager;
+					gui_state = 1;
+				}
+			} catch (CVideo::error&) {
+				fprintf(stderr, "CVideo fail\n");
+			} catch (twml_exception& e) {
+				fprintf(stderr, "gui2::init fail: %s\n", e.user_message.c_str());
+			}
+		}
+	}
+	return gui_state == 1;
+}
+
+gui2::twindow* build_window(const std::string& type)
+{
+	if (!init_gui()) {
+		return NULL;
+	}
+	gui2::twindow* window = NULL;
+	try {
+		window = gui2::build(*video, type, 0, 0);
+	} catch (gui2::twindow_builder_invalid_id&) {
+		fprintf(stderr, "window %s isn't found\n", type.c_str());
+		return NULL;
+	} catch (twml_exception& e) {
+		fprintf(stderr, "build %s fail: %s\n", type.c_str(), e.user_message.c_str());
+		return NULL;
+	}
+	// there is no video mode, build takes screen size from it, so set one after.
+	gui2::settings::screen_width = 1280;
+	gui2::settings::screen_height = 720;
+	return window;
+}
+
+const std::string& work_dir()
+{
+	if (!work_dir_init) {
+		work_dir_init = true;
+		char* path = SDL_GetPrefPath("rose", "benchmark");
+		if (path) {
+			work = path;
+			SDL_free(path);
+		} else {
+			fprintf(stderr, "no writable directory, cases that generate file are skipped\n");
+		}
+	}
+	return work;
+}
+
+bool init_user_data()
+{
+	if (user_data_state == -1) {
+		user_data_state = !work_dir().empty();
+		if (user_data_state) {
+			set_preferences_dir(work_dir() + "userdata");
+		}
+	}
+	return user_data_state == 1;
+}
+
+void release_environment()
+{
+	// video isn't deleted, its destructor requires app's instance.
+	if (gui_events) {
+		delete gui_events;
+		gui_events = NULL;
+	}
+	if (fonts) {
+		delete fonts;
+		fonts = NULL;
+	}
+	if (software_renderer) {
+		SDL_DestroyRenderer(software_renderer);
+		software_renderer = NULL;
+	}
+	if (window) {
+		SDL_DestroyWindow(window);
+		window = NULL;
+	}
+	if (video_init) {
+		SDL_QuitSubSystem(SDL_INIT_VIDEO);
+		video_init = false;
+	}
+}
+
+}
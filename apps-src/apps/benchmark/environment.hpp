@@ -0,0 +1,51 @@
+#ifndef BENCHMARK_ENVIRONMENT_HPP_INCLUDED
+#define BENCHMARK_ENVIRONMENT_HPP_INCLUDED
+
+#include "SDL.h"
+
+#include <string>
+
+namespace gui2 {
+class twindow;
+}
+
+//
+// shared setup of cases that run librose beyond pure kernels.
+// everything is created at first use, so filtering to kernel cases doesn't pay for it.
+// when setup fails, case calls state.skip() with reason and returns.
+//
+namespace benchmark {
+
+// apps-res directory. default is BENCHMARK_RES_DIR that build defines, --res overrides it.
+const std::string& res_dir();
+void set_res_dir(const std::string& dir);
+
+// point game_config::path to res_dir(). return false if it isn't apps-res.
+bool init_res();
+
+// writable directory for files that cases generate, ends with '/'. empty if there is none.
+const std::string& work_dir();
+
+// user data directory of librose, i.e. where cache is, under work_dir(). return false if there is no work_dir().
+bool init_user_data();
+
+// SDL with dummy video driver, and a hidden window with software renderer.
+// return NULL if it fails.
+SDL_Renderer* renderer();
+
+// TTF and fonts.cfg of res_dir(). return false if it fails.
+bool init_fonts();
+
+// gui2 definitions of gui.bin, event manager and video, on top of init_fonts(). return false if it fails.
+bool init_gui();
+
+// window of registered type, i.e. "rose__combo_box", on a screen of 1280x720. it isn't laid out,
+// caller sets data then calls twindow::layout(), and deletes it. NULL if it fails.
+gui2::twindow* build_window(const std::string& type);
+
+// release what above created. main calls it before exit.
+void release_environment();
+
+}
+
+#endif
@@ -0,0 +1,191 @@
+#include "benchmark.hpp"
+#include "environment.hpp"
+
+#include "serialization/preprocessor.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <thread>
+
+namespace {
+
+struct tresult
+{
+	std::string name;
+	int iterations;
+	double ns_per_iter;
+	double bytes_per_second;
+	double items_per_second;
+	std::map<std::string, double> counters;
+	std::string skipped;
+};
+
+std::string json_string(const std::string& str)
+{
+	std::string ret = "\"";
+	for (std::string::const_iterator it = str.begin(); it != str.end(); ++ it) {
+		const unsigned char ch = *it;
+		if (ch == '"' || ch == '\\') {
+			ret.push_back('\\');
+			ret.push_back(ch);
+		} else if (ch < 0x20) {
+			char buf[8];
+			sprintf(buf, "\\u%04x", ch);
+			ret += buf;
+		} else {
+			ret.push_back(ch);
+		}
+	}
+	ret.push_back('"');
+	return ret;
+}
+
+// same layout as google benchmark's --benchmark_format=json, so existing tools can compare two runs.
+void write_json(FILE* fp, const std::vector<tresult>& results, int min_time_ms)
+{
+	char date[32];
+	const time_t now = time(NULL);
+	strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", localtime(&now));
+
+	fprintf(fp, "{\n  \"context\": {\n");
+	fprintf(fp, "    \"date\": %s,\n", json_string(date).c_str());
+	fprintf(fp, "    \"num_cpus\": %u,\n", std::thread::hardware_concurrency());
+	fprintf(fp, "    \"min_time_ms\": %d,\n", min_time_ms);
+#ifdef NDEBUG
+	fprintf(fp, "    \"library_build_type\": \"release\"\n");
+#else
+	fprintf(fp, "    \"library_build_type\": \"debug\"\n");
+#endif
+	fprintf(fp, "  },\n  \"benchmarks\": [");
+
+	for (std::vector<tresult>::const_iterator it = results.begin(); it != results.end(); ++ it) {
+		const tresult& r = *it;
+		fprintf(fp, "%s\n    {\n      \"name\": %s", it != results.begin()? ",": "", json_string(r.name).c_str());
+		if (!r.skipped.empty()) {
+			fprintf(fp, ",\n      \"error_occurred\": true,\n      \"error_message\": %s\n    }", json_string(r.skipped).c_str());
+			continue;
+		}
+		fprintf(fp, ",\n      \"iterations\": %d", r.iterations);
+		fprintf(fp, ",\n      \"real_time\": %.3f,\n      \"time_unit\": \"ns\"", r.ns_per_iter);
+		if (r.bytes_per_second) {
+			fprintf(fp, ",\n      \"bytes_per_second\": %.3f", r.bytes_per_second);
+		}
+		if (r.items_per_second) {
+			fprintf(fp, ",\n      \"items_per_second\": %.3f", r.items_per_second);
+		}
+		for (std::map<std::string, double>::const_iterator it2 = r.counters.begin(); it2 != r.counters.end(); ++ it2) {
+			fprintf(fp, ",\n      %s: %g", json_string(it2->first).c_str(), it2->second);
+		}
+		fprintf(fp, "\n    }");
+	}
+	fprintf(fp, "\n  ]\n}\n");
+}
+
+void print_result(const tresult& r)
+{
+	if (!r.skipped.empty()) {
+		printf("%-48s skipped: %s\n", r.name.c_str(), r.skipped.c_str());
+		return;
+	}
+	printf("%-48s %10d %14.0f ns", r.name.c_str(), r.iterations, r.ns_per_iter);
+	if (r.bytes_per_second) {
+		printf(" %10.2f MB/s", r.bytes_per_second / (1024 * 1024));
+	}
+	if (r.items_per_second) {
+		printf(" %12.0f items/s", r.items_per_second);
+	}
+	for (std::map<std::string, double>::const_iterator it = r.counters.begin(); it != r.counters.end(); ++ it) {
+		printf(" %s=%g", it->first.c_str(), it->second);
+	}
+	printf("\n");
+}
+
+}
+
+// usage: benchmark [--json[=file]] [--res=dir] [--preproc-cache=off|on|verify] [filter] [min_time_ms]
+// runs every case whose name contains filter.
+// --json writes machine readable result to file, or to stdout instead of table when file is omitted.
+// --res is apps-res directory, datasets of config, terrain and font cases are read from it.
+// --preproc-cache is mode of preprocessor's macro cache, verify expands every cached call again and counts differences.
+int main(int argc, char** argv)
+{
+	const char* filter = NULL;
+	int min_time_ms = 200;
+	bool json = false;
+	std::string json_file;
+
+	int positional = 0;
+	for (int at = 1; at < argc; at ++) {
+		const char* arg = argv[at];
+		if (!strcmp(arg, "--json")) {
+			json = true;
+		} else if (!strncmp(arg, "--json=", 7)) {
+			json = true;
+			json_file = arg + 7;
+		} else if (!strncmp(arg, "--res=", 6)) {
+			benchmark::set_res_dir(arg + 6);
+		} else if (!strncmp(arg, "--preproc-cache=", 16)) {
+			const char* mode = arg + 16;
+			if (!strcmp(mode, "off")) {
+				set_preproc_cache_mode(PREPROC_CACHE_OFF);
+			} else if (!strcmp(mode, "on")) {
+				set_preproc_cache_mode(PREPROC_CACHE_ON);
+			} else if (!strcmp(mode, "verify")) {
+				set_preproc_cache_mode(PREPROC_CACHE_VERIFY);
+			} else {
+				fprintf(stderr, "unknown preproc-cache mode: %s\n", mode);
+				return 1;
+			}
+		} else if (positional == 0) {
+			filter = arg[0]? arg: NULL;
+			positional ++;
+		} else if (positional == 1) {
+			min_time_ms = atoi(arg);
+			positional ++;
+		}
+	}
+	const bool table = !json || !json_file.empty();
+
+	std::vector<tresult> results;
+	const std::vector<benchmark::tcase>& cases = benchmark::cases();
+	for (std::vector<benchmark::tcase>::const_iterator it = cases.begin(); it != cases.end(); ++ it) {
+		if (filter && !strstr(it->name.c_str(), filter)) {
+			continue;
+		}
+		benchmark::tstate state(min_time_ms);
+		it->function(state);
+
+		tresult r;
+		r.name = it->name;
+		r.iterations = state.iterations();
+		r.ns_per_iter = state.iterations()? state.elapsed_ns() / state.iterations(): 0;
+		const double seconds = state.elapsed_ns() / 1e9;
+		r.bytes_per_second = seconds? state.bytes_processed() * state.iterations() / seconds: 0;
+		r.items_per_second = seconds? state.items_processed() * state.iterations() / seconds: 0;
+		r.counters = state.counters();
+		r.skipped = state.skipped();
+		results.push_back(r);
+
+		if (table) {
+			print_result(r);
+			fflush(stdout);
+		}
+	}
+
+	if (json) {
+		FILE* fp = json_file.empty()? stdout: fopen(json_file.c_str(), "w");
+		if (!fp) {
+			fprintf(stderr, "can't open %s\n", json_file.c_str());
+			return 1;
+		}
+		write_json(fp, results, min_time_ms);
+		if (fp != stdout) {
+			fclose(fp);
+		}
+	}
+
+	benchmark::release_environment();
+	return 0;
+}
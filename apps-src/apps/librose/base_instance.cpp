@@ -31,6 +31,7 @@
 #include "ble.hpp"
 #include "webrtc/voice_engine/include/voe_base.h"
 #include "theme.hpp"
+#include "xwml.hpp"
 
 #include <iostream>
 #include <clocale>
@@ -40,7 +41,6 @@ base_instance* instance = nullptr;
 void base_instance::regenerate_heros(hero_map& heros, bool allow_empty)
 {
 	const std::string hero_data_path = game_config::path + "/xwml/" + "hero.dat";
-	heros.map_from_file(hero_data_path);
 	if (!heros.map_from_file(hero_data_path)) {
 		if (allow_empty) {
 			// allow no hero.dat
@@ -545,14 +545,25 @@ bool base_instance::load_data_bin()
 	cursor::setter cur(cursor::WAIT);
 
 	try {		
-		wml_config_from_file(game_config::path + "/xwml/" + BASENAME_DATA, app_cfg_);
+		const std::string fname = game_config::path + "/xwml/" + BASENAME_DATA;
+		txwml_view view(fname);
+		if (view.valid()) {
+			// [terrain_type] is decoded to where it is used, not copied out of app_cfg_.
+			for (tconfig_view child = view.root().first_child(); child.valid(); child = child.next_sibling()) {
+				const std::string key = child.key();
+				child.to_config(key == "terrain_type"? tmap::terrain_types.add_child(key): app_cfg_.add_child(key));
+			}
+		} else {
+			// bin is written without index section.
+			wml_config_from_file(fname, app_cfg_);
 	
-		// [terrain_type]
-		const config::const_child_itors& terrains = app_cfg_.child_range("terrain_type");
-		BOOST_FOREACH (const config &t, terrains) {
-			tmap::terrain_types.add_child("terrain_type", t);
+			// [terrain_type]
+			const config::const_child_itors& terrains = app_cfg_.child_range("terrain_type");
+			BOOST_FOREACH (const config &t, terrains) {
+				tmap::terrain_types.add_child("terrain_type", t);
+			}
+			app_cfg_.clear_children("terrain_type");
 		}
-		app_cfg_.clear_children("terrain_type");
 
 		// animation
 		anim2::fill_anims(app_cfg_.child("units"));
@@ -727,6 +738,12 @@ void base_instance::initialize()
 	}
 	gui2_event_manager_ = new gui2::event::tmanager;
 
+	// common dialogs, builders resolve them when gui is idle so they open faster.
+	const char* prewarm_dialogs[] = {"simple_message", "menu", "combo_box", "edit_box"};
+	for (size_t at = 0; at < sizeof(prewarm_dialogs) / sizeof(prewarm_dialogs[0]); at ++) {
+		gui2::queue_prewarm(utils::generate_app_prefix_id("rose", prewarm_dialogs[at]));
+	}
+
 	// load core config require some time, so execute after gui2::init.
 	res = load_data_bin();
 	if (!res) {
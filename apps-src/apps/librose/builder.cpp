@@ -24,19 +24,22 @@
 #include "serialization/string_utils.hpp"
 #include "image.hpp"
 #include "base_map.hpp"
+#include "thread.hpp"
 
 #include <boost/foreach.hpp>
+#include <boost/bind.hpp>
 #include "rose_config.hpp"
 #include "posix2.h"
 
 terrain_builder::building_rule* terrain_builder::building_rules_ = NULL;
 uint32_t terrain_builder::building_rules_size_ = 0;
 uint32_t terrain_builder::unit_rules_size_;
+uint32_t terrain_builder::flag_words_ = 0;
+bool terrain_builder::flags_interned_ = false;
 const std::string terrain_builder::tb_dat_prefix = "tb-";
 std::string terrain_builder::using_id;
 
 terrain_builder::tile::tile() :
-	flags(),
 	images(),
 	minimum_unit_index(-1),
 	images_foreground(),
@@ -94,14 +97,10 @@ void terrain_builder::tile::rebuild_cache(const std::string& tod, logs* log)
 			break; // found a matching variant
 		}
 	}
-
-	// in order to both unit and reduce memroy, clear flags
-	flags.clear();
 }
 
 void terrain_builder::tile::clear(bool full)
 {
-	flags.clear();
 	if (full) {
 		images.clear();
 		minimum_unit_index = -1;
@@ -252,6 +251,8 @@ void terrain_builder::release_heap()
 		building_rules_ = NULL;
 	}
 	building_rules_size_ = 0;
+	flag_words_ = 0;
+	flags_interned_ = false;
 }
 
 void terrain_builder::change_map(const tmap* m)
@@ -997,27 +998,29 @@ bool terrain_builder::rule_matches(const terrain_builder::building_rule &rule,
 
 		//std::cout << "testing..." << builder_letter(map().get_terrain(tloc))
 
+		const int index = tile_map_.index(tloc);
+
 		// check if terrain matches except if we already know that it does
 		if (&cons != type_checked) {
 			if (selector_ == SELECTOR_MAP) {
-				if (!terrain_matches(map().get_terrain(tloc), cons.terrain_types_match)) {
+				if (!terrain_matches(terrains_[index], cons.terrain_types_match)) {
 					return false;
 				}
 			} else if (!units_->terrain_matches(tloc, cons.terrain_types_match)) {
 				return false;
 			}
 		}
-		const std::set<std::string> &flags = tile_map_[tloc].flags;
+		const uint64_t* flags = &flags_[index * flag_words_];
 
-		BOOST_FOREACH(const std::string &s, cons.no_flag) {
+		BOOST_FOREACH(const flag_word &w, cons.no_flag_mask) {
 			// If a flag listed in "no_flag" is present, the rule does not match
-			if (flags.find(s) != flags.end()) {
+			if (flags[w.word] & w.bits) {
 				return false;
 			}
 		}
-		BOOST_FOREACH(const std::string &s, cons.has_flag) {
+		BOOST_FOREACH(const flag_word &w, cons.has_flag_mask) {
 			// If a flag listed in "has_flag" is not present, this rule does not match
-			if (flags.find(s) == flags.end()) {
+			if ((flags[w.word] & w.bits) != w.bits) {
 				return false;
 			}
 		}
@@ -1026,6 +1029,13 @@ bool terrain_builder::rule_matches(const terrain_builder::building_rule &rule,
 	return true;
 }
 
+void terrain_builder::match_candidates(const building_rule *rule, const terrain_constraint *type_checked, int begin, int end)
+{
+	for(int at = begin; at < end; ++at) {
+		matched_[at] = rule_matches(*rule, candidates_[at], type_checked);
+	}
+}
+
 void terrain_builder::apply_rule(const terrain_builder::building_rule &rule, const map_location &loc)
 {
 	unsigned int rand_seed = get_noise(loc, rule.get_hash());
@@ -1049,8 +1059,9 @@ void terrain_builder::apply_rule(const terrain_builder::building_rule &rule, con
 		}
 
 		// Sets flags
-		BOOST_FOREACH(const std::string &flag, constraint.set_flag) {
-			btile.flags.insert(flag);
+		uint64_t* flags = &flags_[tile_map_.index(tloc) * flag_words_];
+		BOOST_FOREACH(const flag_word &w, constraint.set_flag_mask) {
+			flags[w.word] |= w.bits;
 		}
 
 	}
@@ -1088,18 +1099,93 @@ unsigned int terrain_builder::building_rule::get_hash() const
 	return hash_;
 }
 
+static void intern_flag_names(const std::vector<std::string> &names, std::map<std::string, int> &ids,
+		terrain_builder::flag_mask &mask, std::set<int> &rule_ids)
+{
+	mask.clear();
+	BOOST_FOREACH(const std::string &name, names) {
+		std::map<std::string, int>::iterator it = ids.find(name);
+		if(it == ids.end()) {
+			it = ids.insert(std::make_pair(name, static_cast<int>(ids.size()))).first;
+		}
+		rule_ids.insert(it->second);
+
+		const int word = it->second / 64;
+		const uint64_t bit = static_cast<uint64_t>(1) << (it->second % 64);
+		terrain_builder::flag_mask::iterator w = mask.begin();
+		for(; w != mask.end() && w->word != word; ++w) {}
+		if(w != mask.end()) {
+			w->bits |= bit;
+		} else {
+			mask.push_back(terrain_builder::flag_word(word, bit));
+		}
+	}
+}
+
+void terrain_builder::intern_flags()
+{
+	std::map<std::string, int> ids;
+
+	for(uint32_t rule_index = 0; rule_index < building_rules_size_; ++rule_index) {
+		building_rule &rule = building_rules_[rule_index];
+		std::set<int> set_ids, no_ids, has_ids;
+
+		BOOST_FOREACH(terrain_constraint &cons, rule.constraints) {
+			intern_flag_names(cons.set_flag, ids, cons.set_flag_mask, set_ids);
+			intern_flag_names(cons.no_flag, ids, cons.no_flag_mask, no_ids);
+			intern_flag_names(cons.has_flag, ids, cons.has_flag_mask, has_ids);
+		}
+
+		// constraints of one rule overlap when it is applied at near locations,
+		// so compare flags of all constraints, regardless of their position.
+		rule.flag_dependence = FLAG_INDEPENDENT;
+		BOOST_FOREACH(int id, set_ids) {
+			if(has_ids.count(id)) {
+				rule.flag_dependence = FLAG_HAS_FLAG;
+				break;
+			}
+			if(no_ids.count(id)) {
+				rule.flag_dependence = FLAG_NO_FLAG;
+			}
+		}
+	}
+
+	// at least one word, so a tile always has storage
+	flag_words_ = ids.size() / 64 + 1;
+	flags_interned_ = true;
+}
+
+// candidates of a rule per worker chunk. below it, dispatching costs more than matching.
+#define MATCH_GRAIN		256
+
 void terrain_builder::build_terrains()
 {
+	if (!flags_interned_) {
+		intern_flags();
+	}
+	flags_.assign(tile_map_.size() * flag_words_, 0);
+
 	// Builds the terrain_by_type_ cache
 	if (selector_ == SELECTOR_MAP) {
+		terrains_.resize(tile_map_.size());
 		for(int x = -2; x <= map().w(); ++x) {
 			for(int y = -2; y <= map().h(); ++y) {
 				const map_location loc(x,y);
 				const t_translation::t_terrain t = map().get_terrain(loc);
 
+				terrains_[tile_map_.index(loc)] = t;
 				terrain_by_type_[t].push_back(loc);
 			}
 		}
+		// the outmost column and row aren't candidates, but constraints reach them.
+		for(int x = -2; x <= map().w() + 1; ++x) {
+			const map_location loc(x, map().h() + 1);
+			terrains_[tile_map_.index(loc)] = map().get_terrain(loc);
+		}
+		for(int y = -2; y <= map().h(); ++y) {
+			const map_location loc(map().w() + 1, y);
+			terrains_[tile_map_.index(loc)] = map().get_terrain(loc);
+		}
 	} else {
 		units_->build_terrains(terrain_by_type_);
 	}
@@ -1157,6 +1243,7 @@ void terrain_builder::build_terrains()
 		}
 
 		//NOTE: if min_types is not empty, we have found a valid min_constraint;
+		candidates_.clear();
 		for(t_translation::t_list::const_iterator t = min_types.begin();
 				t != min_types.end(); ++t) {
 
@@ -1164,19 +1251,55 @@ void terrain_builder::build_terrains()
 
 			for(std::vector<map_location>::const_iterator itor = locations->begin();
 					itor != locations->end(); ++itor) {
-				const map_location loc = itor->legacy_difference(min_constraint->loc);
+				candidates_.push_back(itor->legacy_difference(min_constraint->loc));
+			}
+		}
+		if (candidates_.empty()) {
+			continue;
+		}
 
-				if(rule_matches(rule, loc, min_constraint)) {
-					if (!rule.image_loaded_) {
-						load_images(rule);
-					}
-					apply_rule(rule, loc);
+		// rules are applied one by one, a rule sees flags set by all previous rules.
+		// inside a rule, every candidate is matched against flags before this rule in parallel,
+		// then matches are applied in candidate order, as serial matching does.
+		// units_ may not be thread safe, and a rule that sets its own has_flag can match
+		// more locations than were before it, both stay serial.
+		const int count = candidates_.size();
+		const bool parallel = selector_ == SELECTOR_MAP && rule.flag_dependence != FLAG_HAS_FLAG;
+		if (parallel) {
+			// hash is calculated lazily, don't let worker threads do it.
+			rule.get_hash();
+			matched_.resize(count);
+			threading::parallel_for(count, MATCH_GRAIN,
+				boost::bind(&terrain_builder::match_candidates, this, &rule, min_constraint, _1, _2));
+		}
+
+		for (int at = 0; at < count; at ++) {
+			const map_location& loc = candidates_[at];
+			if (parallel) {
+				if (!matched_[at]) {
+					continue;
+				}
+				// applying this rule at a previous candidate may have set one of its no_flag.
+				if (rule.flag_dependence == FLAG_NO_FLAG && !rule_matches(rule, loc, min_constraint)) {
+					continue;
 				}
+			} else if (!rule_matches(rule, loc, min_constraint)) {
+				continue;
 			}
-		}
 
+			if (!rule.image_loaded_) {
+				load_images(rule);
+			}
+			apply_rule(rule, loc);
+		}
 	}
 
+	// flags are only needed during building.
+	std::vector<uint64_t>().swap(flags_);
+	std::vector<t_translation::t_terrain>().swap(terrains_);
+	std::vector<map_location>().swap(candidates_);
+	std::vector<unsigned char>().swap(matched_);
+
 	// in order to reduce memory, release terrain_by_type_
 	// but in map_type of siege, require this variable.
 	// retain it when total grid less than 400.
@@ -265,6 +265,24 @@ public:
 	 */
 	typedef std::vector<rule_image> rule_imagelist;
 
+	/**
+	 * Some flags of a constraint, all of them in one 64-bit word of
+	 * the per-tile flag bitset. Flag names are interned to bit indexes
+	 * once per ruleset, see intern_flags().
+	 */
+	struct flag_word
+	{
+		flag_word(int word, uint64_t bits) :
+			word(word),
+			bits(bits)
+			{};
+
+		int word;
+		uint64_t bits;
+	};
+
+	typedef std::vector<flag_word> flag_mask;
+
 	/**
 	 * The in-memory representation of a [tile] WML rule
 	 * inside of a [terrain_graphics] WML rule.
@@ -277,6 +295,9 @@ public:
 			set_flag(),
 			no_flag(),
 			has_flag(),
+			set_flag_mask(),
+			no_flag_mask(),
+			has_flag_mask(),
 			images()
 			{};
 
@@ -286,6 +307,9 @@ public:
 			set_flag(),
 			no_flag(),
 			has_flag(),
+			set_flag_mask(),
+			no_flag_mask(),
+			has_flag_mask(),
 			images()
 			{};
 
@@ -294,6 +318,10 @@ public:
 		std::vector<std::string> set_flag;
 		std::vector<std::string> no_flag;
 		std::vector<std::string> has_flag;
+		/** The flags above as bit masks, filled by intern_flags(). */
+		flag_mask set_flag_mask;
+		flag_mask no_flag_mask;
+		flag_mask has_flag_mask;
 		rule_imagelist images;
 	};
 
@@ -322,9 +350,6 @@ public:
 		/** Clears all data in this tile, and resets the cache */
 		void clear(bool full = true);
 
-		/** The list of flags present in this tile */
-		std::set<std::string> flags;
-
 		/** Represent a rule_image applied with a random seed.*/
 		struct rule_image_rand{
 			rule_image_rand(const rule_image* r_i, unsigned int rnd) : ri(r_i), rand(rnd) {}
@@ -373,6 +398,17 @@ public:
 	 */
 	typedef std::vector<terrain_constraint> constraint_set;
 
+	/**
+	 * How the flags set by a rule interact with the flags it tests.
+	 * Matching at one location may be changed by applying the same
+	 * rule at a previous location only through these flags.
+	 */
+	enum FLAG_DEPENDENCE {
+			FLAG_INDEPENDENT,	/**< sets none of the flags it tests */
+			FLAG_NO_FLAG,		/**< sets some of its no_flag, never its has_flag */
+			FLAG_HAS_FLAG		/**< sets some of its has_flag */
+	};
+
 	/**
 	 * The in-memory representation of a [terrain_graphics] WML rule.
 	 */
@@ -385,6 +421,7 @@ public:
 			precedence(0),
 			local(false),
 			image_loaded_(false),
+			flag_dependence(FLAG_INDEPENDENT),
 			hash_(DUMMY_HASH)
 		{}
 
@@ -419,6 +456,9 @@ public:
 
 		bool image_loaded_;
 
+		/** Filled by intern_flags(). */
+		FLAG_DEPENDENCE flag_dependence;
+
 		bool operator<(building_rule const &that) const
 		{ return precedence < that.precedence; }
 
@@ -466,6 +506,16 @@ public:
 		 */
 		bool on_map(const map_location &loc) const;
 
+		/**
+		 * Returns the index of the tile at loc, from 0 to size() - 1.
+		 * The location MUST be on the map!
+		 */
+		int index(const map_location &loc) const
+			{ return (loc.x + 2) + (loc.y + 2) * (x_ + 4); }
+
+		/** Returns the number of tiles, including the border. */
+		int size() const { return tiles_.size(); }
+
 		/**
 		 * Resets the whole tile map
 		 */
@@ -776,6 +826,12 @@ public:
 	 */
 	bool rule_matches(const building_rule &rule, const map_location &loc, const terrain_constraint *type_checked) const;
 
+	/**
+	 * Calls rule_matches() on candidates_[begin, end) and stores
+	 * the results in matched_. Called by the worker threads.
+	 */
+	void match_candidates(const building_rule *rule, const terrain_constraint *type_checked, int begin, int end);
+
 	/**
 	 * Applies a rule at a given location: applies the result of a
 	 * matching rule at a given location: attachs the images corresponding
@@ -792,6 +848,13 @@ public:
 	 */
 	void build_terrains();
 
+	/**
+	 * Interns the flag names of all building rules to bit indexes,
+	 * fills the flag masks of the constraints and the flag
+	 * dependence of the rules. Done once per ruleset.
+	 */
+	static void intern_flags();
+
 	/**
 	 * A pointer to the tmap class used in the current level.
 	 */
@@ -817,12 +880,33 @@ public:
 	 */
 	terrain_by_type_map terrain_by_type_;
 
+	/**
+	 * The flags present in each tile, flag_words_ words per tile in
+	 * tile_map_ index order. Only valid during build_terrains().
+	 */
+	std::vector<uint64_t> flags_;
+
+	/**
+	 * The terrain of each tile in tile_map_ index order, read once so
+	 * worker threads never call tmap::get_terrain(), which writes
+	 * its border cache. Only valid during build_terrains().
+	 */
+	std::vector<t_translation::t_terrain> terrains_;
+
+	/** The locations where the current rule may match, and the result. */
+	std::vector<map_location> candidates_;
+	std::vector<unsigned char> matched_;
+
 	/** Parsed terrain rules. Cached between instances */
 	// static building_ruleset building_rules_;
 	static terrain_builder::building_rule* building_rules_;
 	static uint32_t building_rules_size_;
 	static uint32_t unit_rules_size_;
 
+	/** The number of 64-bit words of flags per tile. */
+	static uint32_t flag_words_;
+	static bool flags_interned_;
+
 	static std::string using_id;
 };
 
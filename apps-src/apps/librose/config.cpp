@@ -443,16 +443,139 @@ void config::check_valid(const config &cfg) const
 	VALIDATE(*this && cfg, "Mandatory WML child missing yet untested for. Please report.");
 }
 
-config::config() : values(), children(), ordered_children()
+/* ** Attribute map implementation ** */
+
+config::attribute_map::~attribute_map()
 {
+	clear();
+	release();
 }
 
-config::config(const config& cfg) : values(cfg.values), children(), ordered_children()
+void config::attribute_map::release()
 {
-	append_children(cfg);
+	if (arena_) {
+		arena_->deallocate(items_, capacity_ * sizeof(item));
+		arena_->unref();
+	}
+	items_ = NULL;
+	capacity_ = 0;
+	arena_ = NULL;
+}
+
+config::attribute_map::const_iterator config::attribute_map::lower_bound(const std::string& key) const
+{
+	const item* first = items_;
+	uint32_t count = size_;
+	while (count) {
+		const uint32_t step = count / 2;
+		const item* it = first + step;
+		if (it->key->compare(key) < 0) {
+			first = it + 1;
+			count -= step + 1;
+		} else {
+			count = step;
+		}
+	}
+	return first;
+}
+
+config::attribute_map::const_iterator config::attribute_map::find(const std::string& key) const
+{
+	const item* it = lower_bound(key);
+	if (it != items_ + size_ && *it->key == key) {
+		return it;
+	}
+	return items_ + size_;
+}
+
+config::attribute_value& config::attribute_map::get_or_insert(const std::string& key, tconfig_arena& arena)
+{
+	item* it = const_cast<item*>(lower_bound(key));
+	if (it != items_ + size_ && *it->key == key) {
+		return *it->value;
+	}
+	if (!arena_) {
+		arena_ = &arena;
+		arena_->ref();
+	}
+	const uint32_t at = it - items_;
+	if (size_ == capacity_) {
+		// most node has a few attributes, grow from 4.
+		const uint32_t capacity = capacity_? capacity_ * 2: 4;
+		item* items = (item*)arena_->allocate(capacity * sizeof(item));
+		if (size_) {
+			memcpy(items, items_, size_ * sizeof(item));
+		}
+		arena_->deallocate(items_, capacity_ * sizeof(item));
+		items_ = items;
+		capacity_ = capacity;
+	}
+	// config is loaded from sorted source mostly, that appends at end.
+	if (at < size_) {
+		memmove(items_ + at + 1, items_ + at, (size_ - at) * sizeof(item));
+	}
+	items_[at].key = &config_intern(key);
+	items_[at].value = new (arena_->allocate(sizeof(attribute_value))) attribute_value();
+	size_ ++;
+	return *items_[at].value;
+}
+
+void config::attribute_map::erase(const std::string& key)
+{
+	item* it = find(key);
+	if (it == items_ + size_) {
+		return;
+	}
+	it->value->~attribute_value();
+	arena_->deallocate(it->value, sizeof(attribute_value));
+	memmove(it, it + 1, (items_ + size_ - it - 1) * sizeof(item));
+	size_ --;
+}
+
+void config::attribute_map::clear()
+{
+	for (uint32_t at = 0; at < size_; at ++) {
+		items_[at].value->~attribute_value();
+		arena_->deallocate(items_[at].value, sizeof(attribute_value));
+	}
+	size_ = 0;
+}
+
+void config::attribute_map::swap(attribute_map& that)
+{
+	std::swap(items_, that.items_);
+	std::swap(size_, that.size_);
+	std::swap(capacity_, that.capacity_);
+	std::swap(arena_, that.arena_);
+}
+
+bool config::attribute_map::operator==(const attribute_map& that) const
+{
+	if (size_ != that.size_) {
+		return false;
+	}
+	for (uint32_t at = 0; at < size_; at ++) {
+		// key is interned, compare pointer is enough.
+		if (items_[at].key != that.items_[at].key || *items_[at].value != *that.items_[at].value) {
+			return false;
+		}
+	}
+	return true;
 }
 
-config::config(const std::string& child) : values(), children(), ordered_children()
+
+/* ** config implementation ** */
+
+config::config() : values(), children(), ordered_children(), arena_(NULL)
+{
+}
+
+config::config(const config& cfg) : values(), children(), ordered_children(), arena_(NULL)
+{
+	append(cfg);
+}
+
+config::config(const std::string& child) : values(), children(), ordered_children(), arena_(NULL)
 {
 	add_child(child);
 }
@@ -460,6 +583,36 @@ config::config(const std::string& child) : values(), children(), ordered_childre
 config::~config()
 {
 	clear();
+	if (arena_) {
+		arena_->unref();
+	}
+}
+
+tconfig_arena& config::arena()
+{
+	if (!arena_) {
+		arena_ = tconfig_arena::create();
+	}
+	return *arena_;
+}
+
+config* config::new_child()
+{
+	tconfig_arena& a = arena();
+	config* cfg = new (a.allocate(sizeof(config))) config();
+	cfg->arena_ = &a;
+	a.ref();
+	return cfg;
+}
+
+void config::delete_child(config* cfg)
+{
+	// node is allocated from its arena_, destructor releases the reference of node.
+	tconfig_arena* a = cfg->arena_;
+	a->ref();
+	cfg->~config();
+	a->deallocate(cfg, sizeof(config));
+	a->unref();
 }
 
 config& config::operator=(const config& cfg)
@@ -469,17 +622,18 @@ config& config::operator=(const config& cfg)
 	}
 
 	clear();
-	append_children(cfg);
-	values.insert(cfg.values.begin(), cfg.values.end());
+	append(cfg);
 	return *this;
 }
 
 #ifdef HAVE_CXX11
 config::config(config &&cfg):
-	values(std::move(cfg.values)),
+	values(),
 	children(std::move(cfg.children)),
-	ordered_children(std::move(cfg.ordered_children))
+	ordered_children(std::move(cfg.ordered_children)),
+	arena_(NULL)
 {
+	values.swap(cfg.values);
 }
 
 config &config::operator=(config &&cfg)
@@ -528,8 +682,8 @@ void config::append_children(const config &cfg)
 void config::append(const config &cfg)
 {
 	append_children(cfg);
-	BOOST_FOREACH(const attribute &v, cfg.values) {
-		values[v.first] = v.second;
+	BOOST_FOREACH(const attribute &v, cfg.attribute_range()) {
+		values.get_or_insert(v.first, arena()) = v.second;
 	}
 }
 
@@ -674,7 +828,7 @@ config& config::add_child(const std::string& key)
 	check_valid();
 
 	child_list& v = children[key];
-	v.push_back(new config());
+	v.push_back(new_child());
 	ordered_children.push_back(child_pos(children.find(key),v.size()-1));
 	return *v.back();
 }
@@ -684,7 +838,8 @@ config& config::add_child(const std::string& key, const config& val)
 	check_valid(val);
 
 	child_list& v = children[key];
-	v.push_back(new config(val));
+	v.push_back(new_child());
+	*v.back() = val;
 	ordered_children.push_back(child_pos(children.find(key),v.size()-1));
 	return *v.back();
 }
@@ -695,7 +850,8 @@ config &config::add_child(const std::string &key, config &&val)
 	check_valid(val);
 
 	child_list &v = children[key];
-	v.push_back(new config(std::move(val)));
+	v.push_back(new_child());
+	v.back()->swap(val);
 	ordered_children.push_back(child_pos(children.find(key), v.size() - 1));
 	return *v.back();
 }
@@ -710,7 +866,8 @@ config &config::add_child_at(const std::string &key, const config &val, unsigned
 		throw error("illegal index to add child at");
 	}
 
-	v.insert(v.begin()+index,new config(val));
+	v.insert(v.begin()+index,new_child());
+	*v[index] = val;
 
 	bool inserted = false;
 
@@ -759,7 +916,7 @@ void config::clear_children(const std::string& key)
 		ordered_children.end(), remove_ordered(i)), ordered_children.end());
 
 	BOOST_FOREACH(config *c, i->second) {
-		delete c;
+		delete_child(c);
 	}
 
 	children.erase(i);
@@ -815,7 +972,7 @@ std::vector<config::child_pos>::iterator config::remove_child(
 	}
 
 	// Remove from the child map.
-	delete pos->second[index];
+	delete_child(pos->second[index]);
 	pos->second.erase(pos->second.begin() + index);
 
 	// Erase from the ordering and return the next position.
@@ -827,6 +984,56 @@ config::all_children_iterator config::erase(const config::all_children_iterator&
 	return all_children_iterator(remove_child(i.i_->pos, i.i_->index));
 }
 
+config& config::ordered_child(unsigned index)
+{
+	check_valid();
+
+	if (index >= ordered_children.size()) {
+		throw error("illegal index of ordered child");
+	}
+	const child_pos& pos = ordered_children[index];
+	return *pos.pos->second[pos.index];
+}
+
+void config::replace_ordered_children(unsigned first, unsigned count, config& src)
+{
+	check_valid(src);
+
+	if (first + count > ordered_children.size()) {
+		throw error("illegal range of ordered children");
+	}
+
+	// take out every child in order, then put them back with src's children in place of range.
+	std::vector<std::pair<std::string, config*> > order;
+	order.reserve(ordered_children.size() - count + src.ordered_children.size());
+	for (unsigned at = 0; at < first; at ++) {
+		const child_pos& pos = ordered_children[at];
+		order.push_back(std::make_pair(pos.pos->first, pos.pos->second[pos.index]));
+	}
+	BOOST_FOREACH (const child_pos& pos, src.ordered_children) {
+		order.push_back(std::make_pair(pos.pos->first, pos.pos->second[pos.index]));
+	}
+	for (unsigned at = first; at < ordered_children.size(); at ++) {
+		const child_pos& pos = ordered_children[at];
+		if (at < first + count) {
+			delete_child(pos.pos->second[pos.index]);
+		} else {
+			order.push_back(std::make_pair(pos.pos->first, pos.pos->second[pos.index]));
+		}
+	}
+	// node holds reference of its own arena, so it can outlive src.
+	src.children.clear();
+	src.ordered_children.clear();
+
+	children.clear();
+	ordered_children.clear();
+	for (std::vector<std::pair<std::string, config*> >::const_iterator it = order.begin(); it != order.end(); ++ it) {
+		child_list& v = children[it->first];
+		v.push_back(it->second);
+		ordered_children.push_back(child_pos(children.find(it->first), v.size() - 1));
+	}
+}
+
 void config::remove_child(const std::string &key, unsigned index)
 {
 	check_valid();
@@ -846,7 +1053,7 @@ const config::attribute_value &config::operator[](const std::string &key) const
 	check_valid();
 
 	const attribute_map::const_iterator i = values.find(key);
-	if (i != values.end()) return i->second;
+	if (i != values.end()) return *i->value;
 	static const attribute_value empty_attribute;
 	return empty_attribute;
 }
@@ -855,13 +1062,13 @@ const config::attribute_value *config::get(const std::string &key) const
 {
 	check_valid();
 	attribute_map::const_iterator i = values.find(key);
-	return i != values.end() ? &i->second : NULL;
+	return i != values.end() ? i->value : NULL;
 }
 
 config::attribute_value &config::operator[](const std::string &key)
 {
 	check_valid();
-	return values[key];
+	return values.get_or_insert(key, arena());
 }
 
 const config::attribute_value &config::get_old_attribute(const std::string &key, const std::string &old_key, const std::string &msg) const
@@ -870,13 +1077,13 @@ const config::attribute_value &config::get_old_attribute(const std::string &key,
 
 	attribute_map::const_iterator i = values.find(key);
 	if (i != values.end())
-		return i->second;
+		return *i->value;
 
 	i = values.find(old_key);
 	if (i != values.end()) {
 		if (!msg.empty())
 			lg::wml_error << msg;
-		return i->second;
+		return *i->value;
 	}
 
 	static const attribute_value empty_attribute;
@@ -889,14 +1096,15 @@ void config::merge_attributes(const config &cfg)
 	check_valid(cfg);
 
 	assert(this != &cfg);
-	BOOST_FOREACH(const attribute &v, cfg.values) {
+	BOOST_FOREACH(const attribute &v, cfg.attribute_range()) {
 
 		std::string key = v.first;
 		if (key.substr(0,7) == "add_to_") {
 			std::string add_to = key.substr(7);
-			values[add_to] = values[add_to].to_int() + v.second.to_int();
+			attribute_value& value = values.get_or_insert(add_to, arena());
+			value = value.to_int() + v.second.to_int();
 		} else
-			values[v.first] = v.second;
+			values.get_or_insert(v.first, arena()) = v.second;
 	}
 }
 
@@ -993,7 +1201,7 @@ void config::clear()
 					config* c = v[state.vi];
 					++state.vi;
 					if (c->children.empty()) {
-						delete c; //special case for a slight speed increase?
+						delete_child(c); //special case for a slight speed increase?
 					} else {
 						//descend to the next level
 						config_clear_state next;
@@ -1011,7 +1219,7 @@ void config::clear()
 				//have been deleted, so it's safe to clear the map, delete the
 				//node and move up one level
 				state.c->children.clear();
-				if (state.c != this) delete state.c;
+				if (state.c != this) delete_child(state.c);
 				l.pop_back();
 			}
 		}
@@ -1068,26 +1276,26 @@ void config::get_diff(const config& c, config& res) const
 
 	attribute_map::const_iterator i;
 	for(i = values.begin(); i != values.end(); ++i) {
-		const attribute_map::const_iterator j = c.values.find(i->first);
-		if(j == c.values.end() || (i->second != j->second && i->second != "")) {
+		const attribute_map::const_iterator j = c.values.find(*i->key);
+		if(j == c.values.end() || (*i->value != *j->value && *i->value != "")) {
 			if(inserts == NULL) {
 				inserts = &res.add_child("insert");
 			}
 
-			(*inserts)[i->first] = i->second;
+			(*inserts)[*i->key] = *i->value;
 		}
 	}
 
 	config* deletes = NULL;
 
 	for(i = c.values.begin(); i != c.values.end(); ++i) {
-		const attribute_map::const_iterator itor = values.find(i->first);
-		if(itor == values.end() || itor->second == "") {
+		const attribute_map::const_iterator itor = values.find(*i->key);
+		if(itor == values.end() || *itor->value == "") {
 			if(deletes == NULL) {
 				deletes = &res.add_child("delete");
 			}
 
-			(*deletes)[i->first] = "x";
+			(*deletes)[*i->key] = "x";
 		}
 	}
 
@@ -1132,7 +1340,7 @@ void config::get_diff(const config& c, config& res) const
 				if(b.size() - bi > a.size() - ai) {
 					config& new_delete = res.add_child("delete_child");
 					buf << bi - ndeletes;
-					new_delete.values["index"] = buf.str();
+					new_delete["index"] = buf.str();
 					new_delete.add_child(*itor);
 
 					++ndeletes;
@@ -1144,7 +1352,7 @@ void config::get_diff(const config& c, config& res) const
 				else if(b.size() - bi < a.size() - ai) {
 					config& new_insert = res.add_child("insert_child");
 					buf << ai;
-					new_insert.values["index"] = buf.str();
+					new_insert["index"] = buf.str();
 					new_insert.add_child(*itor,*a[ai]);
 
 					++ai;
@@ -1155,7 +1363,7 @@ void config::get_diff(const config& c, config& res) const
 				else {
 					config& new_change = res.add_child("change_child");
 					buf << bi;
-					new_change.values["index"] = buf.str();
+					new_change["index"] = buf.str();
 					new_change.add_child(*itor,a[ai]->get_diff(*b[bi]));
 
 					++ai;
@@ -1170,11 +1378,11 @@ void config::apply_diff(const config& diff, bool track /* = false */)
 {
 	check_valid(diff);
 
-	if (track) values[diff_track_attribute] = "modified";
+	if (track) (*this)[diff_track_attribute] = "modified";
 
 	if (const config &inserts = diff.child("insert")) {
 		BOOST_FOREACH(const attribute &v, inserts.attribute_range()) {
-			values[v.first] = v.second;
+			(*this)[v.first] = v.second;
 		}
 	}
 
@@ -1222,7 +1430,7 @@ void config::apply_diff(const config& diff, bool track /* = false */)
 				if(itor == children.end() || index >= itor->second.size()) {
 					throw error("error in diff: could not find element '" + item.key + "'");
 				}
-				itor->second[index]->values[diff_track_attribute] = "deleted";
+				(*itor->second[index])[diff_track_attribute] = "deleted";
 			}
 		}
 	}
@@ -1398,7 +1606,7 @@ std::string config::hash() const
 	hash_str[hash_length] = 0;
 
 	i = 0;
-	BOOST_FOREACH(const attribute &val, values)
+	BOOST_FOREACH(const attribute &val, attribute_range())
 	{
 		for (c = val.first.begin(); c != val.first.end(); ++c) {
 			hash_str[i] ^= *c;
@@ -38,6 +38,7 @@
 #include <boost/variant/apply_visitor.hpp>
 #include <boost/variant/variant.hpp>
 
+#include "config_arena.hpp"
 #include "game_errors.hpp"
 #include "tstring.hpp"
 
@@ -305,24 +306,103 @@ public:
 		static const std::string s_true, s_false;
 	};
 
-	typedef std::map<std::string, attribute_value> attribute_map;
-	typedef attribute_map::value_type attribute;
+	/**
+	 * Attribute exposed by attribute_range().
+	 * key is interned and value lives in arena of tree, so both references
+	 * are valid until the attribute is erased.
+	 */
+	struct attribute
+	{
+		attribute(const std::string& first, const attribute_value& second)
+			: first(first)
+			, second(second)
+		{}
+
+		const std::string& first;
+		const attribute_value& second;
+	};
+
+	/**
+	 * Attributes of one node, a small vector sorted by key.
+	 * Iteration order is same as std::map<std::string, attribute_value>.
+	 * attribute_value is allocated separately, so reference returned by
+	 * operator[] isn't invalidated by inserting other keys.
+	 */
+	class attribute_map
+	{
+	public:
+		struct item
+		{
+			const std::string* key;
+			attribute_value* value;
+		};
+		typedef item* iterator;
+		typedef const item* const_iterator;
+
+		attribute_map()
+			: items_(NULL)
+			, size_(0)
+			, capacity_(0)
+			, arena_(NULL)
+		{}
+		~attribute_map();
+
+		const_iterator begin() const { return items_; }
+		const_iterator end() const { return items_ + size_; }
+		iterator begin() { return items_; }
+		iterator end() { return items_ + size_; }
+		bool empty() const { return !size_; }
+		size_t size() const { return size_; }
+
+		const_iterator find(const std::string& key) const;
+		iterator find(const std::string& key) { return const_cast<iterator>(static_cast<const attribute_map*>(this)->find(key)); }
+
+		/** Returns value of @a key, inserts a blank one from @a arena if it does not exist. */
+		attribute_value& get_or_insert(const std::string& key, tconfig_arena& arena);
+		void erase(const std::string& key);
+		void clear();
+		void swap(attribute_map& that);
+
+		bool operator==(const attribute_map& that) const;
+		bool operator!=(const attribute_map& that) const { return !operator==(that); }
+
+	private:
+		attribute_map(const attribute_map&);
+		void operator=(const attribute_map&);
+
+		const_iterator lower_bound(const std::string& key) const;
+		void release();
+
+	private:
+		item* items_;
+		uint32_t size_;
+		uint32_t capacity_;
+		// buffer of items_ and every value are allocated from it.
+		tconfig_arena* arena_;
+	};
 
 	struct const_attribute_iterator
 	{
+		struct arrow_helper
+		{
+			attribute data;
+			arrow_helper(const const_attribute_iterator &i): data(*i) {}
+			const attribute *operator->() const { return &data; }
+		};
+
 		typedef attribute value_type;
 		typedef std::forward_iterator_tag iterator_category;
 		typedef int difference_type;
-		typedef const attribute *pointer;
-		typedef const attribute &reference;
+		typedef const arrow_helper pointer;
+		typedef const attribute reference;
 		typedef attribute_map::const_iterator Itor;
 		explicit const_attribute_iterator(const Itor &i): i_(i) {}
 
 		const_attribute_iterator &operator++() { ++i_; return *this; }
 		const_attribute_iterator operator++(int) { return const_attribute_iterator(i_++); }
 
-		const attribute &operator*() const { return *i_; }
-		const attribute *operator->() const { return &*i_; }
+		reference operator*() const { return attribute(*i_->key, *i_->value); }
+		pointer operator->() const { return *this; }
 
 		bool operator==(const const_attribute_iterator &i) const { return i_ == i.i_; }
 		bool operator!=(const const_attribute_iterator &i) const { return i_ != i.i_; }
@@ -496,7 +576,7 @@ public:
 
 	struct any_child
 	{
-		const child_map::key_type &key;
+		const std::string &key;
 		const config &cfg;
 		any_child(const child_map::key_type *k, const config *c): key(*k), cfg(*c) {}
 	};
@@ -542,6 +622,16 @@ public:
 	all_children_iterator ordered_end() const;
 	all_children_iterator erase(const all_children_iterator& i);
 
+	unsigned all_children_count() const { return ordered_children.size(); }
+	/** Child at @a index of in-order iteration. */
+	config& ordered_child(unsigned index);
+
+	/**
+	 * Replaces @a count children from in-order position @a first with all children of @a src,
+	 * children are moved, so @a src has no child after it.
+	 */
+	void replace_ordered_children(unsigned first, unsigned count, config& src);
+
 	/**
 	 * A function to get the differences between this object,
 	 * and 'c', as another config object.
@@ -622,6 +712,14 @@ private:
 	 */
 	std::vector<child_pos>::iterator remove_child(const child_map::iterator &l, unsigned pos);
 
+	/**
+	 * Arena that new child and attribute are allocated from.
+	 * Child node shares the arena of its parent, root creates one when first needed.
+	 */
+	tconfig_arena& arena();
+	config* new_child();
+	static void delete_child(config* cfg);
+
 	/** All the attributes of this node. */
 	attribute_map values;
 
@@ -629,6 +727,9 @@ private:
 	child_map children;
 
 	std::vector<child_pos> ordered_children;
+
+	/** Arena this node is allocated from, or that root has created. */
+	tconfig_arena* arena_;
 };
 
 extern const config null_cfg;
@@ -0,0 +1,104 @@
+#define GETTEXT_DOMAIN "rose-lib"
+
+#include "global.hpp"
+#include "config_arena.hpp"
+
+#include "SDL_atomic.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unordered_set>
+
+tconfig_arena::tconfig_arena()
+	: refs_(1)
+	, chunks_()
+	, cur_(NULL)
+	, end_(NULL)
+	, next_chunk_size_(min_chunk_size)
+	, reserved_(0)
+	, used_(0)
+{
+	memset(free_lists_, 0, sizeof(free_lists_));
+}
+
+tconfig_arena::~tconfig_arena()
+{
+	for (std::vector<char*>::const_iterator it = chunks_.begin(); it != chunks_.end(); ++ it) {
+		free(*it);
+	}
+}
+
+void* tconfig_arena::alloc_from_chunk(size_t size)
+{
+	if (cur_ + size > end_) {
+		// the rest of current chunk is wasted, it is less than max_class_size.
+		size_t chunk_size = next_chunk_size_;
+		while (chunk_size < size) {
+			chunk_size <<= 1;
+		}
+		cur_ = (char*)malloc(chunk_size);
+		end_ = cur_ + chunk_size;
+		chunks_.push_back(cur_);
+		reserved_ += chunk_size;
+		if (next_chunk_size_ < max_chunk_size) {
+			next_chunk_size_ <<= 1;
+		}
+	}
+	void* ret = cur_;
+	cur_ += size;
+	return ret;
+}
+
+void* tconfig_arena::allocate(size_t size)
+{
+	size = posix_align_ceil(size, (size_t)align);
+	used_ += size;
+	if (size > max_class_size) {
+		return malloc(size);
+	}
+	const int cls = size / align - 1;
+	if (free_lists_[cls]) {
+		void* ret = free_lists_[cls];
+		free_lists_[cls] = *(void**)ret;
+		return ret;
+	}
+	return alloc_from_chunk(size);
+}
+
+void tconfig_arena::deallocate(void* ptr, size_t size)
+{
+	if (!ptr) {
+		return;
+	}
+	size = posix_align_ceil(size, (size_t)align);
+	used_ -= size;
+	if (size > max_class_size) {
+		free(ptr);
+		return;
+	}
+	const int cls = size / align - 1;
+	*(void**)ptr = free_lists_[cls];
+	free_lists_[cls] = ptr;
+}
+
+// never destructed, static config may still reference it when exit.
+static std::unordered_set<std::string>* interned_keys = NULL;
+static SDL_SpinLock interned_lock = 0;
+
+const std::string& config_intern(const std::string& str)
+{
+	SDL_AtomicLock(&interned_lock);
+	if (!interned_keys) {
+		interned_keys = new std::unordered_set<std::string>;
+	}
+	const std::string& ret = *interned_keys->insert(str).first;
+	SDL_AtomicUnlock(&interned_lock);
+	return ret;
+}
+
+size_t config_interned_count()
+{
+	SDL_AtomicLock(&interned_lock);
+	size_t ret = interned_keys? interned_keys->size(): 0;
+	SDL_AtomicUnlock(&interned_lock);
+	return ret;
+}
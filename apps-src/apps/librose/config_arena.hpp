@@ -0,0 +1,59 @@
+#ifndef LIBROSE_CONFIG_ARENA_HPP_INCLUDED
+#define LIBROSE_CONFIG_ARENA_HPP_INCLUDED
+
+#include <string>
+#include <vector>
+#include <stddef.h>
+
+//
+// bump arena of one config tree. child nodes, attribute tables and attribute values are allocated from it.
+// freed block is linked to free-list of its size class, and will be reused by later allocation of this tree.
+// memory returns to system only when the last reference is released, so a node moved to other tree
+// keeps its arena alive.
+// like config itself, one arena must not be used by two threads at the same time.
+//
+class tconfig_arena
+{
+public:
+	static tconfig_arena* create() { return new tconfig_arena(); }
+
+	void ref() { refs_ ++; }
+	void unref()
+	{
+		if (!-- refs_) {
+			delete this;
+		}
+	}
+
+	void* allocate(size_t size);
+	void deallocate(void* ptr, size_t size);
+
+	size_t reserved_bytes() const { return reserved_; }
+	size_t used_bytes() const { return used_; }
+
+private:
+	tconfig_arena();
+	~tconfig_arena();
+
+	enum {align = 16, max_class_size = 1024, classes = max_class_size / align};
+	enum {min_chunk_size = 1024, max_chunk_size = 64 * 1024};
+
+	void* alloc_from_chunk(size_t size);
+
+private:
+	int refs_;
+	std::vector<char*> chunks_;
+	char* cur_;
+	char* end_;
+	size_t next_chunk_size_;
+	void* free_lists_[classes];
+
+	size_t reserved_;
+	size_t used_;
+};
+
+// process-wide symbol table of attribute key. returned reference is valid until process exits.
+const std::string& config_intern(const std::string& str);
+size_t config_interned_count();
+
+#endif
@@ -26,6 +26,11 @@
 #include "builder.hpp"
 #include "base_instance.hpp"
 #include "gui/dialogs/message.hpp"
+#include "thread.hpp"
+#include "wml_exception.hpp"
+#include "xwml.hpp"
+
+#include <boost/bind.hpp>
 
 namespace game_config {
 
@@ -256,6 +261,8 @@ teditor_::teditor_(const std::string& working_dir)
 	: cache_(game_config::config_cache::instance())
 	, working_dir_(working_dir)
 	, wml2bin_descs_()
+	, build_timings_()
+	, cancel_(NULL)
 {
 }
 
@@ -289,24 +296,16 @@ bool teditor_::make_system_bins_exist()
 		return true;
 	}
 	get_wml2bin_desc_from_wml(system_bins);
-	const std::vector<std::pair<BIN_TYPE, wml2bin_desc> >& descs = wml2bin_descs();
-
-	int count = (int)descs.size();
-	for (int at = 0; at < count; at ++) {
-		const std::pair<BIN_TYPE, wml2bin_desc>& desc = descs[at];
 
-		bool ret = false;
-		try {
-			ret = cfgs_2_cfg(desc.first, desc.second.bin_name, desc.second.app, true, desc.second.wml_nfiles, desc.second.wml_sum_size, (uint32_t)desc.second.wml_modified);
-		} catch (twml_exception& /*e*/) {
-			return false;
-		}
-		if (!ret) {
-			return false;
-		}
+	std::vector<int> ats;
+	for (int at = 0; at < (int)wml2bin_descs_.size(); at ++) {
+		ats.push_back(at);
+	}
+	try {
+		return cfgs_2_cfgs(ats, std::map<std::string, std::string>());
+	} catch (twml_exception& /*e*/) {
+		return false;
 	}
-
-	return true;
 }
 
 // check location:
@@ -617,18 +616,20 @@ bool teditor_::cfgs_2_cfg(const BIN_TYPE type, const std::string& name, const st
 			// no pre-defined
 			VALIDATE(write_file, "write_file must be true when generate GUI!");
 
-			cache_.get_config(working_dir_ + "/data/gui", tmpcfg);
+			tpreproc_record record;
+			get_system_config(working_dir_ + "/data/gui", BASENAME_GUI, cache_.get_preproc_map(), tmpcfg, record);
 			if (write_file) {
-				wml_config_to_file(working_dir_ + "/xwml/" + BASENAME_GUI, tmpcfg, nfiles, sum_size, modified, app_domains);
+				write_system_bin(working_dir_ + "/data/gui", BASENAME_GUI, cache_.get_preproc_map(), tmpcfg, record, nfiles, sum_size, modified, app_domains);
 			}
 
 		} else if (type == LANGUAGE)  {
 			// no pre-defined
 			VALIDATE(write_file, "write_file must be true when generate LANGUAGE!");
 
-			cache_.get_config(working_dir_ + "/data/languages", tmpcfg);
+			tpreproc_record record;
+			get_system_config(working_dir_ + "/data/languages", BASENAME_LANGUAGE, cache_.get_preproc_map(), tmpcfg, record);
 			if (write_file) {
-				wml_config_to_file(working_dir_ + "/xwml/" + BASENAME_LANGUAGE, tmpcfg, nfiles, sum_size, modified, app_domains);
+				write_system_bin(working_dir_ + "/data/languages", BASENAME_LANGUAGE, cache_.get_preproc_map(), tmpcfg, record, nfiles, sum_size, modified, app_domains);
 			}
 		} else if (type == EXTENDABLE)  {
 			// no pre-defined
@@ -645,7 +646,8 @@ bool teditor_::cfgs_2_cfg(const BIN_TYPE type, const std::string& name, const st
 		} else {
 			// type == MAIN_DATA
 			cache_.add_define("CORE");
-			cache_.get_config(working_dir_ + "/data", tmpcfg);
+			tpreproc_record record;
+			get_system_config(working_dir_ + "/data", BASENAME_DATA, cache_.get_preproc_map(), tmpcfg, record);
 
 			// check scenario config valid
 			std::string err_str = check_data_bin(tmpcfg);
@@ -654,7 +656,7 @@ bool teditor_::cfgs_2_cfg(const BIN_TYPE type, const std::string& name, const st
 			}
 
 			if (write_file) {
-				wml_config_to_file(working_dir_ + "/xwml/" + BASENAME_DATA, tmpcfg, nfiles, sum_size, modified, app_domains);
+				write_system_bin(working_dir_ + "/data", BASENAME_DATA, cache_.get_preproc_map(), tmpcfg, record, nfiles, sum_size, modified, app_domains);
 			}
 
 			// in order to safe, require sync with main-thread in ther future.
@@ -669,6 +671,588 @@ bool teditor_::cfgs_2_cfg(const BIN_TYPE type, const std::string& name, const st
 	return true;
 }
 
+static std::string define_names(const preproc_map& defines)
+{
+	std::stringstream ss;
+	for (preproc_map::const_iterator it = defines.begin(); it != defines.end(); ++ it) {
+		ss << it->first << ",";
+	}
+	return ss.str();
+}
+
+// put children of segment @id's file, that is parsed apart into @sub, in place of ones it has in @cfg,
+// then shift segments after it in same parent, or under parent's later children.
+static void splice_segment(config& cfg, tpreproc_record& record, int id, config& sub)
+{
+	tpreproc_record::tsegment& segment = record.segments[id];
+
+	config* parent = &cfg;
+	for (std::vector<int>::const_iterator it = segment.parent.begin(); it != segment.parent.end(); ++ it) {
+		parent = &parent->ordered_child(*it);
+	}
+	const int count = sub.all_children_count();
+	parent->replace_ordered_children(segment.first, segment.count, sub);
+
+	const int delta = count - segment.count;
+	const int end = segment.first + segment.count;
+	const size_t level = segment.parent.size();
+	for (int at = 0; at < (int)record.segments.size(); at ++) {
+		tpreproc_record::tsegment& that = record.segments[at];
+		if (at == id || that.parent.size() < level || !std::equal(segment.parent.begin(), segment.parent.end(), that.parent.begin())) {
+			continue;
+		}
+		if (that.parent.size() == level) {
+			if (at < id && that.last >= id) {
+				// count of segment that isn't clean is left 0, as parser leaves it.
+				if (that.clean) {
+					that.count += delta;
+				}
+			} else if (at > id) {
+				that.first += delta;
+			}
+		} else if (that.parent[level] >= end) {
+			that.parent[level] += delta;
+		}
+	}
+	segment.count = count;
+}
+
+std::string teditor_::preproc_record_file(const std::string& bin) const
+{
+	// out of xwml, it isn't a resource. one record for every <res>.
+	std::stringstream ss;
+	ss << get_dir(get_user_data_dir() + "/cache") << "/" << file_main_name(bin) << "-";
+	ss << std::hex << preproc_crc(working_dir_.c_str(), working_dir_.size()) << ".preproc";
+	return ss.str();
+}
+
+void teditor_::get_system_config(const std::string& path, const std::string& bin, const preproc_map& defines, config& cfg, tpreproc_record& record)
+{
+	if (incremental_config(path, bin, defines, cfg, record)) {
+		return;
+	}
+	cfg.clear();
+	record = tpreproc_record();
+	preproc_map copy_map(defines);
+	scoped_istream stream = preprocess_file(path, &copy_map, &record);
+	read(cfg, *stream, record);
+}
+
+// last build's config is read from bin, changed files are preprocessed and parsed alone,
+// then their children replace ones they had. return false if tree must be parsed again.
+// a changed file can be reparsed when it is included as a segment, isn't in a macro, only adds
+// whole children to one element, defines no macro and includes no file. if a file is added
+// to or removed from an included directory, or #ifhave is used, whole tree is parsed.
+bool teditor_::incremental_config(const std::string& path, const std::string& bin, const preproc_map& defines, config& cfg, tpreproc_record& record)
+{
+	const std::string bin_file = working_dir_ + "/xwml/" + bin;
+	const std::string record_file = preproc_record_file(bin);
+	if (!file_exists(bin_file) || !file_exists(record_file)) {
+		return false;
+	}
+
+	config record_cfg;
+	wml_config_from_file(record_file, record_cfg);
+	const config& desc = record_cfg.child("preproc_record");
+	if (!desc || desc["path"].str() != path || desc["defines"].str() != define_names(defines)) {
+		return false;
+	}
+	uint32_t bin_nfiles, bin_sum_size, bin_modified;
+	if (!wml_checksum_from_file(bin_file, &bin_nfiles, &bin_sum_size, &bin_modified)) {
+		return false;
+	}
+	// record is of this bin, bin isn't written by other build since.
+	if (desc["bin_nfiles"].to_unsigned() != bin_nfiles || desc["bin_sum_size"].to_unsigned() != bin_sum_size ||
+		desc["bin_modified"].to_unsigned() != bin_modified || desc["bin_size"].str() != str_cast(file_size(bin_file, false))) {
+		return false;
+	}
+	record.read(desc);
+	if (record.ifhave) {
+		return false;
+	}
+
+	for (std::map<std::string, std::string>::const_iterator it = record.dirs.begin(); it != record.dirs.end(); ++ it) {
+		if (preproc_dir_listing(it->first) != it->second) {
+			return false;
+		}
+	}
+
+	std::set<std::string> changed;
+	for (std::map<std::string, tpreproc_record::tfile>::const_iterator it = record.files.begin(); it != record.files.end(); ++ it) {
+		if (!file_exists(it->first)) {
+			return false;
+		}
+		const std::string data = read_file(it->first);
+		if ((int)data.size() == it->second.size && preproc_crc(data.c_str(), data.size()) == it->second.crc) {
+			continue;
+		}
+		if (it->second.reads != 1 || it->second.segments != 1) {
+			return false;
+		}
+		changed.insert(it->first);
+	}
+
+	std::vector<int> targets;
+	for (int id = 0; id < (int)record.segments.size(); id ++) {
+		const tpreproc_record::tsegment& segment = record.segments[id];
+		if (!changed.count(segment.file)) {
+			continue;
+		}
+		if (!segment.clean || segment.defines || segment.reads != 1) {
+			return false;
+		}
+		targets.push_back(id);
+	}
+
+	wml_config_from_file(bin_file, cfg);
+
+	try {
+		// from last, so position of every segment that is still to be replaced keeps valid.
+		for (std::vector<int>::const_reverse_iterator it = targets.rbegin(); it != targets.rend(); ++ it) {
+			const int id = *it;
+			tpreproc_record::tsegment& segment = record.segments[id];
+
+			preproc_map defines;
+			record.replay_defines(segment.define_events, defines);
+			tpreproc_record sub;
+			config sub_cfg;
+			{
+				scoped_istream stream = preprocess_segment(segment.file, &defines, segment.textdomain, sub);
+				read(sub_cfg, *stream, sub);
+			}
+			if (sub.segments.size() != 1 || !sub.segments[0].clean || sub.reads != 1 || !sub.define_events.empty() || sub.ifhave) {
+				return false;
+			}
+
+			splice_segment(cfg, record, id, sub_cfg);
+
+			tpreproc_record::tfile& file = record.files[segment.file];
+			file.crc = sub.files[segment.file].crc;
+			file.size = sub.files[segment.file].size;
+		}
+	} catch (config::error&) {
+		// bin doesn't match record.
+		return false;
+	}
+	return true;
+}
+
+void teditor_::write_system_bin(const std::string& path, const std::string& bin, const preproc_map& defines, const config& cfg, const tpreproc_record& record, uint32_t nfiles, uint32_t sum_size, uint32_t modified, const std::map<std::string, std::string>& app_domains)
+{
+	const std::string bin_file = working_dir_ + "/xwml/" + bin;
+	if (bin == BASENAME_GUI) {
+		// gui2::load_settings parses a [window] when it is built first.
+		wml_config_to_file_v2(bin_file, cfg, nfiles, sum_size, modified, app_domains);
+	} else {
+		// base_instance::load_data_bin and load_language_list read them through txwml_view.
+		wml_config_to_file(bin_file, cfg, nfiles, sum_size, modified, app_domains, true);
+	}
+
+	// root attributes aren't written to bin, record is a child.
+	config record_cfg;
+	config& desc = record_cfg.add_child("preproc_record");
+	record.write(desc);
+	desc["path"] = path;
+	desc["defines"] = define_names(defines);
+	desc["bin_nfiles"] = nfiles;
+	desc["bin_sum_size"] = sum_size;
+	desc["bin_modified"] = modified;
+	desc["bin_size"] = str_cast(file_size(bin_file, false));
+	wml_config_to_file(preproc_record_file(bin), record_cfg);
+}
+
+struct teditor_::tbin_task
+{
+	tbin_task(int at, const std::pair<BIN_TYPE, wml2bin_desc>& desc)
+		: at(at)
+		, desc(desc)
+		, paths()
+		, bin()
+		, defines()
+		, cfg()
+		, record()
+		, deferred()
+		, scenario_child()
+		, error()
+		, wml_error()
+		, timing()
+		, cancelled(false)
+	{}
+
+	bool system() const { return desc.first <= BIN_SYSTEM_MAX; }
+	bool ok() const { return error.empty() && !wml_error.get() && !cancelled; }
+
+	int at;
+	const std::pair<BIN_TYPE, wml2bin_desc>& desc;
+	// system bin: directory. scenario bin: macros file if there is, and scenario file.
+	std::vector<std::string> paths;
+	// system bin: name in <res>/xwml. scenario bin: full path.
+	std::string bin;
+	preproc_map defines;
+	config cfg;
+	tpreproc_record record;
+	tpreproc_deferred deferred;
+	std::string scenario_child;
+	std::string error;
+	boost::shared_ptr<twml_exception> wml_error;
+	tbuild_timing timing;
+	bool cancelled;
+};
+
+struct teditor_::tsegment_task
+{
+	tsegment_task(tbin_task& bin, int deferred)
+		: bin(&bin)
+		, deferred(deferred)
+		, cfg()
+		, ok(false)
+		, ticks(0)
+	{}
+
+	tbin_task* bin;
+	// index in bin->deferred.files.
+	int deferred;
+	config cfg;
+	bool ok;
+	uint32_t ticks;
+};
+
+static void parse_tree(const std::string& path, preproc_map& defines, config& cfg, tpreproc_record* record, tpreproc_deferred* deferred)
+{
+	scoped_istream stream = preprocess_file(path, &defines, record, deferred);
+	if (record) {
+		read(cfg, *stream, *record);
+	} else {
+		read(cfg, *stream);
+	}
+}
+
+void teditor_::parse_bins(std::vector<tbin_task*>& tasks, int begin, int end)
+{
+	for (int at = begin; at < end; at ++) {
+		tbin_task& task = *tasks[at];
+		if (cancelled()) {
+			task.cancelled = true;
+			continue;
+		}
+		const uint32_t start = SDL_GetTicks();
+		try {
+			if (task.system()) {
+				if (incremental_config(task.paths.front(), task.bin, task.defines, task.cfg, task.record)) {
+					task.timing.incremental = true;
+				} else {
+					task.cfg.clear();
+					task.record = tpreproc_record();
+					preproc_map defines(task.defines);
+					parse_tree(task.paths.front(), defines, task.cfg, &task.record, &task.deferred);
+				}
+			} else {
+				// macros defined by first file are kept for next, as one transaction of cache_ does.
+				preproc_map defines(task.defines);
+				for (std::vector<std::string>::const_iterator it = task.paths.begin(); it != task.paths.end(); ++ it) {
+					parse_tree(*it, defines, task.cfg, NULL, NULL);
+				}
+			}
+		} catch (twml_exception& e) {
+			task.wml_error.reset(new twml_exception(e));
+		} catch (game::error& e) {
+			task.error = e.message;
+		}
+		task.timing.parse = SDL_GetTicks() - start;
+		task.timing.deferred = task.deferred.files.size();
+	}
+}
+
+void teditor_::parse_segments(std::vector<tsegment_task>& tasks, int begin, int end)
+{
+	// preprocessor may change defines, so every chunk works on its own copy.
+	preproc_map defines;
+	const preproc_map* copied = NULL;
+	for (int at = begin; at < end; at ++) {
+		tsegment_task& task = tasks[at];
+		if (cancelled()) {
+			// cfgs_2_cfgs cancels bin of it.
+			continue;
+		}
+		const uint32_t start = SDL_GetTicks();
+		const tpreproc_deferred::tfile& file = task.bin->deferred.files[task.deferred];
+		const tpreproc_record::tsegment& segment = task.bin->record.segments[file.segment];
+		if (file.defines.get() != copied) {
+			defines = *file.defines;
+			copied = file.defines.get();
+		}
+		try {
+			tpreproc_record sub;
+			{
+				scoped_istream stream = preprocess_segment(segment.file, &defines, segment.textdomain, sub);
+				read(task.cfg, *stream, sub);
+			}
+			task.ok = sub.segments.size() == 1 && sub.segments[0].clean && sub.reads == 1 && sub.define_events.empty() && !sub.ifhave;
+			if (!sub.define_events.empty()) {
+				copied = NULL;
+			}
+		} catch (twml_exception&) {
+			// bin is parsed again on one thread, that reports error.
+			copied = NULL;
+		} catch (game::error&) {
+			copied = NULL;
+		}
+		task.ticks = SDL_GetTicks() - start;
+	}
+}
+
+void teditor_::merge_bin(tbin_task& task, std::vector<tsegment_task>& segments, int begin, int end)
+{
+	const uint32_t start = SDL_GetTicks();
+	bool ok = true;
+	for (int at = begin; at < end; at ++) {
+		const tsegment_task& segment = segments[at];
+		task.timing.segments += segment.ticks;
+		if (!segment.ok || !task.record.segments[task.deferred.files[segment.deferred].segment].clean) {
+			ok = false;
+		}
+	}
+	if (ok) {
+		try {
+			// from last, so position of every segment that is still to be put in keeps valid.
+			for (int at = end - 1; at >= begin; at --) {
+				splice_segment(task.cfg, task.record, task.deferred.files[segments[at].deferred].segment, segments[at].cfg);
+			}
+		} catch (config::error&) {
+			ok = false;
+		}
+	}
+	if (!ok) {
+		// a file isn't what its text looks like, parse whole tree as cfgs_2_cfg does.
+		task.timing.fallback = true;
+		task.cfg.clear();
+		task.record = tpreproc_record();
+		try {
+			preproc_map defines(task.defines);
+			parse_tree(task.paths.front(), defines, task.cfg, &task.record, NULL);
+		} catch (twml_exception& e) {
+			task.wml_error.reset(new twml_exception(e));
+		} catch (game::error& e) {
+			task.error = e.message;
+		}
+	}
+	task.timing.merge = SDL_GetTicks() - start;
+}
+
+void teditor_::write_bins(std::vector<tbin_task*>& tasks, const std::map<std::string, std::string>& app_domains, int begin, int end)
+{
+	for (int at = begin; at < end; at ++) {
+		tbin_task& task = *tasks[at];
+		if (cancelled()) {
+			task.cancelled = true;
+		}
+		if (!task.ok()) {
+			continue;
+		}
+		const uint32_t start = SDL_GetTicks();
+		const wml2bin_desc& desc = task.desc.second;
+		try {
+			if (task.system()) {
+				write_system_bin(task.paths.front(), task.bin, task.defines, task.cfg, task.record, desc.wml_nfiles, desc.wml_sum_size, (uint32_t)desc.wml_modified, app_domains);
+			} else {
+				wml_config_to_file(task.bin, task.cfg.child(task.scenario_child), desc.wml_nfiles, desc.wml_sum_size, (uint32_t)desc.wml_modified, app_domains);
+			}
+		} catch (twml_exception& e) {
+			task.wml_error.reset(new twml_exception(e));
+		} catch (game::error& e) {
+			task.error = e.message;
+		}
+		task.timing.write = SDL_GetTicks() - start;
+		task.timing.done = SDL_GetTicks();
+	}
+}
+
+bool teditor_::cfgs_2_cfgs(const std::vector<int>& ats, const std::map<std::string, std::string>& app_domains, const boost::function<void (int at, bool ret)>& did_build, const bool* cancel)
+{
+	const uint32_t start = SDL_GetTicks();
+	build_timings_.clear();
+	cancel_ = cancel;
+	reset_preproc_cache_stats();
+
+	std::vector<tbin_task> tasks;
+	tasks.reserve(ats.size());
+	{
+		tres_path_lock lock(*this);
+		cache_.clear_defines();
+
+		std::vector<tbin_task*> parallel;
+		for (std::vector<int>::const_iterator it = ats.begin(); it != ats.end(); ++ it) {
+			const std::pair<BIN_TYPE, wml2bin_desc>& desc = wml2bin_descs_[*it];
+			const BIN_TYPE type = desc.first;
+			tasks.push_back(tbin_task(*it, desc));
+			tbin_task& task = tasks.back();
+			task.defines = cache_.get_preproc_map();
+			task.timing.type = type;
+			task.timing.bin_name = desc.second.bin_name;
+
+			if (type == MAIN_DATA) {
+				task.defines["CORE"] = preproc_define();
+				task.paths.push_back(working_dir_ + "/data");
+				task.bin = BASENAME_DATA;
+			} else if (type == GUI) {
+				task.paths.push_back(working_dir_ + "/data/gui");
+				task.bin = BASENAME_GUI;
+			} else if (type == LANGUAGE) {
+				task.paths.push_back(working_dir_ + "/data/languages");
+				task.bin = BASENAME_LANGUAGE;
+			} else if (type == SCENARIO_DATA) {
+				std::string name_str = desc.second.bin_name;
+				name_str = name_str.substr(0, name_str.rfind("."));
+
+				const config& app_cfg = campaigns_config_.find_child("bin", "app", desc.second.app);
+				const config& campaign_cfg = app_cfg.find_child(app_cfg[BINKEY_ID_CHILD], "id", name_str);
+				if (!campaign_cfg["define"].empty()) {
+					task.defines[campaign_cfg["define"].str()] = preproc_define();
+				}
+				if (!app_cfg[BINKEY_MACROS].empty()) {
+					task.paths.push_back(working_dir_ + "/data/" + app_cfg[BINKEY_MACROS]);
+				}
+				task.paths.push_back(working_dir_ + "/data/" + app_cfg[BINKEY_PATH] + "/" + name_str);
+				task.scenario_child = app_cfg[BINKEY_SCENARIO_CHILD].str();
+
+				const std::string xwml_app_path = working_dir_ + "/xwml/" + game_config::generate_app_dir(desc.second.app);
+				SDL_MakeDirectory(xwml_app_path.c_str());
+				task.bin = xwml_app_path + "/" + desc.second.bin_name;
+			} else {
+				// terrain builder isn't thread safe, cfgs_2_cfg builds it later.
+				continue;
+			}
+			parallel.push_back(&task);
+		}
+		// records are written into it by several threads.
+		get_dir(get_user_data_dir() + "/cache");
+
+		threading::parallel_for(parallel.size(), 1, boost::bind(&teditor_::parse_bins, this, boost::ref(parallel), _1, _2));
+
+		std::vector<tsegment_task> segments;
+		std::vector<int> firsts;
+		for (std::vector<tbin_task*>::const_iterator it = parallel.begin(); it != parallel.end(); ++ it) {
+			tbin_task& task = **it;
+			firsts.push_back(segments.size());
+			for (int at = 0; at < (int)task.deferred.files.size(); at ++) {
+				segments.push_back(tsegment_task(task, at));
+			}
+		}
+		firsts.push_back(segments.size());
+		const int grain = std::max<int>(1, segments.size() / (threading::hardware_concurrency() * 4));
+		threading::parallel_for(segments.size(), grain, boost::bind(&teditor_::parse_segments, this, boost::ref(segments), _1, _2));
+
+		for (int at = 0; at < (int)parallel.size(); at ++) {
+			tbin_task& task = *parallel[at];
+			if (cancelled()) {
+				// deferred files may be skipped, don't parse whole tree again as merge_bin would.
+				task.cancelled = true;
+			}
+			if (task.ok() && task.system()) {
+				merge_bin(task, segments, firsts[at], firsts[at + 1]);
+			}
+		}
+
+		// checks as cfgs_2_cfg does before it writes bin.
+		for (std::vector<tbin_task*>::const_iterator it = parallel.begin(); it != parallel.end(); ++ it) {
+			tbin_task& task = **it;
+			if (!task.ok()) {
+				continue;
+			}
+			if (task.desc.first == MAIN_DATA) {
+				std::string err_str = check_data_bin(task.cfg);
+				if (!err_str.empty()) {
+					task.error = std::string("<") + BASENAME_DATA + std::string(">") + err_str;
+				}
+			} else if (task.desc.first == SCENARIO_DATA) {
+				BOOST_FOREACH (const config& scenario, task.cfg.child(task.scenario_child).child_range("scenario")) {
+					std::string err_str = check_scenario_cfg(scenario);
+					if (!err_str.empty()) {
+						task.error = std::string("<") + task.desc.second.bin_name + std::string(">") + err_str;
+						break;
+					}
+				}
+			}
+		}
+
+		threading::parallel_for(parallel.size(), 1, boost::bind(&teditor_::write_bins, this, boost::ref(parallel), boost::cref(app_domains), _1, _2));
+	}
+
+	bool ret = true;
+	boost::shared_ptr<twml_exception> wml_error;
+	for (std::vector<tbin_task>::iterator it = tasks.begin(); it != tasks.end(); ++ it) {
+		tbin_task& task = *it;
+		const std::pair<BIN_TYPE, wml2bin_desc>& desc = task.desc;
+		bool ok = true;
+		if (task.paths.empty() && cancelled()) {
+			task.cancelled = true;
+		}
+		if (task.cancelled) {
+			ok = false;
+
+		} else if (task.paths.empty()) {
+			const uint32_t start2 = SDL_GetTicks();
+			try {
+				ok = cfgs_2_cfg(desc.first, desc.second.bin_name, desc.second.app, true, desc.second.wml_nfiles, desc.second.wml_sum_size, (uint32_t)desc.second.wml_modified, app_domains);
+			} catch (twml_exception& e) {
+				task.wml_error.reset(new twml_exception(e));
+			}
+			task.timing.parse = SDL_GetTicks() - start2;
+			task.timing.done = SDL_GetTicks();
+
+		} else if (!task.error.empty()) {
+			display* disp = display::get_singleton();
+			gui2::show_error_message(disp->video(), _("Error loading game configuration files: '") + task.error + _("' (The game will now exit)"));
+			ok = false;
+
+		} else if (task.ok() && task.desc.first == MAIN_DATA) {
+			// in order to safe, require sync with main-thread in ther future.
+			tres_path_lock lock(*this);
+			reload_data_bin(task.cfg);
+		}
+		if (task.wml_error.get()) {
+			if (!wml_error.get()) {
+				wml_error = task.wml_error;
+			}
+			ok = false;
+		}
+		if (!ok) {
+			ret = false;
+		}
+		if (!task.timing.done) {
+			task.timing.done = SDL_GetTicks();
+		}
+		task.timing.done -= start;
+		build_timings_.push_back(task.timing);
+		if (did_build) {
+			did_build(task.at, ok);
+		}
+	}
+
+	uint32_t critical = 0;
+	std::string critical_bin;
+	for (std::vector<tbuild_timing>::const_iterator it = build_timings_.begin(); it != build_timings_.end(); ++ it) {
+		const tbuild_timing& timing = *it;
+		posix_print("cfgs_2_cfgs, %s: parse %u ms%s, %i deferred files %u ms, merge %u ms%s, write %u ms, done at %u ms\n",
+			timing.bin_name.c_str(), timing.parse, timing.incremental? " (incremental)": "", timing.deferred, timing.segments,
+			timing.merge, timing.fallback? " (parsed again)": "", timing.write, timing.done);
+		if (timing.done >= critical) {
+			critical = timing.done;
+			critical_bin = timing.bin_name;
+		}
+	}
+	posix_print("cfgs_2_cfgs, %i bins in %u ms on %i threads, critical path: %s\n", (int)build_timings_.size(), SDL_GetTicks() - start, threading::hardware_concurrency(), critical_bin.c_str());
+	const tpreproc_cache_stats cache_stats = preproc_cache_stats();
+	posix_print("cfgs_2_cfgs, macro cache: %i hits of %i calls, %i stored (%i KB), %i uncacheable, %i mismatches\n",
+		cache_stats.hits, cache_stats.calls, cache_stats.stores, (int)(cache_stats.bytes / 1024), cache_stats.uncacheable, cache_stats.mismatches);
+
+	cancel_ = NULL;
+	if (wml_error.get()) {
+		throw *wml_error;
+	}
+	return ret;
+}
+
 void teditor_::reload_extendable_cfg()
 {
 	cfgs_2_cfg(EXTENDABLE, null_str, null_str, false);
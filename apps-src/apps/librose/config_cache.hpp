@@ -25,6 +25,7 @@
 #include <boost/utility.hpp>
 #include <boost/scoped_ptr.hpp>
 #include <boost/shared_ptr.hpp>
+#include <boost/function.hpp>
 
 #include "serialization/preprocessor.hpp"
 #include "config.hpp"
@@ -224,6 +225,37 @@ public:
 		bool valid() const { return !bin_name.empty(); }
 		void refresh_checksum(const std::string& working_dir);
 	};
+	// ms of one bin in cfgs_2_cfgs.
+	struct tbuild_timing {
+		tbuild_timing()
+			: type(BIN_MIN)
+			, bin_name()
+			, parse(0)
+			, segments(0)
+			, merge(0)
+			, write(0)
+			, done(0)
+			, deferred(0)
+			, incremental(false)
+			, fallback(false)
+		{}
+
+		BIN_TYPE type;
+		std::string bin_name;
+		// preprocess and parse on one thread. files that are deferred aren't in it.
+		uint32_t parse;
+		// deferred files, summed over threads that parse them.
+		uint32_t segments;
+		// put children of deferred files in, and parse again when it fails.
+		uint32_t merge;
+		uint32_t write;
+		// since cfgs_2_cfgs started, when bin is written. the largest is critical path.
+		uint32_t done;
+		int deferred;
+		bool incremental;
+		bool fallback;
+	};
+
 	struct tapp_bin {
 		tapp_bin(const std::string& id, const std::string& app, const std::string& path, const std::string& macros)
 			: id(id)
@@ -245,6 +277,14 @@ public:
 	bool make_system_bins_exist();
 
 	bool cfgs_2_cfg(const BIN_TYPE type, const std::string& name, const std::string& app, bool write_file, uint32_t nfiles = 0, uint32_t sum_size = 0, uint32_t modified = 0, const std::map<std::string, std::string>& app_domains = std::map<std::string, std::string>());
+	// build bins of wml2bin_descs at @ats, output is same as cfgs_2_cfg one after another.
+	// system and scenario bins are preprocessed, parsed and written on threading::parallel_for pool,
+	// so are files in them that can be parsed apart. checks, terrain builder and reload of
+	// data bin run on calling thread in @ats order. did_build is called on calling thread.
+	// when *@cancel becomes true, no more file is parsed and no more bin is written, bins that
+	// aren't written are reported as failed.
+	bool cfgs_2_cfgs(const std::vector<int>& ats, const std::map<std::string, std::string>& app_domains, const boost::function<void (int at, bool ret)>& did_build = NULL, const bool* cancel = NULL);
+	const std::vector<tbuild_timing>& build_timings() const { return build_timings_; }
 	void get_wml2bin_desc_from_wml(const std::vector<BIN_TYPE>& system_bin_types);
 	void reload_extendable_cfg();
 	std::string check_scenario_cfg(const config& scenario_cfg);
@@ -261,12 +301,28 @@ private:
 	void generate_app_bin_config();
 	virtual void reload_data_bin(const config& data_cfg);
 
+	// system bin keeps a record of its last build, so changed files can be reparsed alone.
+	std::string preproc_record_file(const std::string& bin) const;
+	void get_system_config(const std::string& path, const std::string& bin, const preproc_map& defines, config& cfg, tpreproc_record& record);
+	bool incremental_config(const std::string& path, const std::string& bin, const preproc_map& defines, config& cfg, tpreproc_record& record);
+	void write_system_bin(const std::string& path, const std::string& bin, const preproc_map& defines, const config& cfg, const tpreproc_record& record, uint32_t nfiles, uint32_t sum_size, uint32_t modified, const std::map<std::string, std::string>& app_domains);
+
+	struct tbin_task;
+	struct tsegment_task;
+	bool cancelled() const { return cancel_ && *cancel_; }
+	void parse_bins(std::vector<tbin_task*>& tasks, int begin, int end);
+	void parse_segments(std::vector<tsegment_task>& tasks, int begin, int end);
+	void merge_bin(tbin_task& task, std::vector<tsegment_task>& segments, int begin, int end);
+	void write_bins(std::vector<tbin_task*>& tasks, const std::map<std::string, std::string>& app_domains, int begin, int end);
+
 protected:
 	std::string working_dir_;
 	config campaigns_config_;
 	config tbs_config_;
 	game_config::config_cache& cache_;
 	std::vector<std::pair<BIN_TYPE, wml2bin_desc> > wml2bin_descs_;
+	std::vector<tbuild_timing> build_timings_;
+	const bool* cancel_;
 };
 
 #endif
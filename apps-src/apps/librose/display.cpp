@@ -965,7 +965,7 @@ void display::drawing_buffer_add(const tdrawing_layer layer,
 	}
 
 	tdrawing_buffer& drawing_buffer = to_canvas_? canvas_drawing_buffer_: drawing_buffer_;
-	drawing_buffer.push_back(tblit2(layer, loc, 0, 0, image::tblit(surf, x, y, width, height, clip)));
+	drawing_buffer.add(drawing_buffer_key(loc, layer).key(), 0, 0, image::tblit(surf, x, y, width, height, clip));
 }
 
 image::tblit& display::drawing_buffer_add(const tdrawing_layer layer,
@@ -978,8 +978,7 @@ image::tblit& display::drawing_buffer_add(const tdrawing_layer layer,
 	// VALIDATE(!loc2.is_void(), null_str);
 
 	tdrawing_buffer& drawing_buffer = to_canvas_? canvas_drawing_buffer_: drawing_buffer_;
-	drawing_buffer.push_back(tblit2(layer, loc, 0, 0, image::tblit(loc2, loc2_type, x, y, width, height, clip)));
-	return drawing_buffer.back().surf().back();
+	return drawing_buffer.add(drawing_buffer_key(loc, layer).key(), 0, 0, image::tblit(loc2, loc2_type, x, y, width, height, clip));
 }
 
 image::tblit& display::drawing_buffer_add(const tdrawing_layer layer,
@@ -987,8 +986,7 @@ image::tblit& display::drawing_buffer_add(const tdrawing_layer layer,
 {
 	VALIDATE(type == image::BLITM_RECT || image::BLITM_FRAME || type == image::BLITM_LINE, null_str);
 	tdrawing_buffer& drawing_buffer = to_canvas_? canvas_drawing_buffer_: drawing_buffer_;
-	drawing_buffer.push_back(tblit2(layer, loc, 0, 0, image::tblit(type, x, y, width, height, color)));
-	return drawing_buffer.back().surf().back();
+	return drawing_buffer.add(drawing_buffer_key(loc, layer).key(), 0, 0, image::tblit(type, x, y, width, height, color));
 }
 
 void display::drawing_buffer_add(const tdrawing_layer layer,
@@ -996,7 +994,7 @@ void display::drawing_buffer_add(const tdrawing_layer layer,
 		const std::vector<image::tblit>& blits)
 {
 	tdrawing_buffer& drawing_buffer = to_canvas_? canvas_drawing_buffer_: drawing_buffer_;
-	drawing_buffer.push_back(tblit2(layer, loc, x, y, blits));
+	drawing_buffer.add(drawing_buffer_key(loc, layer).key(), x, y, blits);
 }
 
 // FIXME: temporary method. Group splitting should be made
@@ -1083,32 +1081,7 @@ void display::drawing_buffer_commit(texture& screen, const SDL_Rect& clip_rect)
 	texture_clip_rect_setter clip(&clip_rect);
 
 	tdrawing_buffer& drawing_buffer = to_canvas_? canvas_drawing_buffer_: drawing_buffer_;
-	// std::list::sort() is a stable sort
-	uint32_t start = SDL_GetTicks();
-	drawing_buffer.sort();
-	uint32_t ticks1 = SDL_GetTicks();
-
-	/*
-	 * Info regarding the rendering algorithm.
-	 *
-	 * In order to render a hex properly it needs to be rendered per row. On
-	 * this row several layers need to be drawn at the same time. Mainly the
-	 * unit and the background terrain. This is needed since both can spill
-	 * in the next hex. The foreground terrain needs to be drawn before to
-	 * avoid decapitation a unit.
-	 *
-	 * This ended in the following priority order:
-	 * layergroup > location > layer > 'tblit' > surface
-	 */
-
-	BOOST_FOREACH (const tblit2 &blit3, drawing_buffer) {
-		const std::vector<image::tblit>& blits = blit3.surf();
-		BOOST_FOREACH (const image::tblit& blit, blits) {
-			image::render_blit(renderer, blit, blit3.x(), blit3.y());
-		}
-	}
-	// posix_print("drawing_buffer_commit, lists: %u, sort: %u\n", drawing_buffer.size(), ticks1 - start);
-	drawing_buffer.clear();
+	drawing_buffer.commit(renderer);
 }
 
 void display::sunset(const size_t delay)
@@ -19,6 +19,7 @@ class base_unit;
 #include "gui/widgets/control.hpp"
 #include "gui/dialogs/dialog.hpp"
 #include "generic_event.hpp"
+#include "drawing_buffer.hpp"
 
 #include <list>
 
@@ -834,45 +835,9 @@ protected:
 	public:
 		drawing_buffer_key(const map_location &loc, tdrawing_layer layer);
 
-		bool operator<(const drawing_buffer_key &rhs) const { return key_ < rhs.key_; }
+		unsigned int key() const { return key_; }
 	};
 
-	/** Helper structure for rendering the terrains. */
-	class tblit2
-	{
-	public:
-		tblit2(const tdrawing_layer layer, const map_location& loc,
-				const int x, const int y, const image::tblit& sloc)
-			: x_(x), y_(y),
-			key_(loc, layer)
-		{
-			surf_.push_back(sloc);
-		}
-
-		tblit2(const tdrawing_layer layer, const map_location& loc,
-				const int x, const int y, const std::vector<image::tblit>& sloc)
-			: x_(x)
-			, y_(y)
-			, surf_(sloc)
-			, key_(loc, layer)
-		{
-		}
-
-		int x() const { return x_; }
-		int y() const { return y_; }
-		const std::vector<image::tblit>& surf() const { return surf_; }
-		std::vector<image::tblit>& surf() { return surf_; }
-
-		bool operator<(const tblit2 &rhs) const { return key_ < rhs.key_; }
-
-	private:
-		int x_;                      /**< x screen coordinate to render at. */
-		int y_;                      /**< y screen coordinate to render at. */
-		std::vector<image::tblit> surf_;		/**< surface(s) to render. */
-		drawing_buffer_key key_;
-	};
-
-	typedef std::list<tblit2> tdrawing_buffer;
 	tdrawing_buffer drawing_buffer_;
 	tdrawing_buffer canvas_drawing_buffer_;
 	bool to_canvas_;
@@ -886,6 +851,8 @@ public:
 	 * @param loc                The hex the image belongs to, needed for the
 	 *                           drawing order.
 	 * @param blit               The structure to blit.
+	 *
+	 * Returned tblit is valid until next drawing_buffer_add.
 	 */
 	void drawing_buffer_add(const tdrawing_layer layer,
 			const map_location& loc, const surface& surf, const int x, const int y, const int width, const int height,
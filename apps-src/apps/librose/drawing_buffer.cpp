@@ -0,0 +1,122 @@
+#define GETTEXT_DOMAIN "rose-lib"
+
+#include "global.hpp"
+#include "drawing_buffer.hpp"
+
+#include <string.h>
+
+tdrawing_buffer::tdrawing_buffer()
+	: items_()
+	, sorted_()
+	, blits_()
+	, run_()
+{
+}
+
+void tdrawing_buffer::add_item(uint32_t order, int x, int y, uint32_t count)
+{
+	titem item;
+	item.key = (static_cast<uint64_t>(order) << 32) | static_cast<uint32_t>(items_.size());
+	item.x = x;
+	item.y = y;
+	item.first = blits_.size() - count;
+	item.count = count;
+	items_.push_back(item);
+}
+
+image::tblit& tdrawing_buffer::add(uint32_t order, int x, int y, const image::tblit& blit)
+{
+	blits_.push_back(blit);
+	add_item(order, x, y, 1);
+	return blits_.back();
+}
+
+void tdrawing_buffer::add(uint32_t order, int x, int y, const std::vector<image::tblit>& blits)
+{
+	if (blits.empty()) {
+		return;
+	}
+	blits_.insert(blits_.end(), blits.begin(), blits.end());
+	add_item(order, x, y, blits.size());
+}
+
+void tdrawing_buffer::sort()
+{
+	const size_t count = items_.size();
+	if (count < 2) {
+		return;
+	}
+
+	// lsd radix sort on the 4 bytes of order. low 32 bits is adding sequence,
+	// items are already in that order, and every pass is stable.
+	uint32_t histogram[4][256];
+	memset(histogram, 0, sizeof(histogram));
+	for (size_t at = 0; at < count; at ++) {
+		const uint32_t order = items_[at].key >> 32;
+		histogram[0][order & 0xff] ++;
+		histogram[1][(order >> 8) & 0xff] ++;
+		histogram[2][(order >> 16) & 0xff] ++;
+		histogram[3][order >> 24] ++;
+	}
+
+	sorted_.resize(count);
+	for (int pass = 0; pass < 4; pass ++) {
+		uint32_t* buckets = histogram[pass];
+		const int shift = 32 + pass * 8;
+		// every item has same digit, this pass wouldn't move anything.
+		if (buckets[(items_[0].key >> shift) & 0xff] == count) {
+			continue;
+		}
+		uint32_t offset = 0;
+		for (int digit = 0; digit < 256; digit ++) {
+			const uint32_t n = buckets[digit];
+			buckets[digit] = offset;
+			offset += n;
+		}
+		for (size_t at = 0; at < count; at ++) {
+			const titem& item = items_[at];
+			sorted_[buckets[(item.key >> shift) & 0xff] ++] = item;
+		}
+		items_.swap(sorted_);
+	}
+}
+
+void tdrawing_buffer::clear()
+{
+	items_.clear();
+	blits_.clear();
+	run_.clear();
+}
+
+void tdrawing_buffer::commit(SDL_Renderer* renderer)
+{
+	sort();
+
+	/*
+	 * Info regarding the rendering algorithm.
+	 *
+	 * In order to render a hex properly it needs to be rendered per row. On
+	 * this row several layers need to be drawn at the same time. Mainly the
+	 * unit and the background terrain. This is needed since both can spill
+	 * in the next hex. The foreground terrain needs to be drawn before to
+	 * avoid decapitation a unit.
+	 *
+	 * This ended in the following priority order:
+	 * layergroup > location > layer > 'tblit' > surface
+	 */
+	run_.resize(blits_.size());
+	size_t next = 0;
+	for (std::vector<titem>::const_iterator it = items_.begin(); it != items_.end(); ++ it) {
+		const titem& item = *it;
+		for (uint32_t at = item.first; at < item.first + item.count; at ++) {
+			image::tblit_run_item& run = run_[next ++];
+			run.blit = &blits_[at];
+			run.x = item.x;
+			run.y = item.y;
+		}
+	}
+	if (next) {
+		image::render_blits(renderer, &run_[0], next);
+	}
+	clear();
+}
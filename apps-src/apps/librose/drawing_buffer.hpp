@@ -0,0 +1,54 @@
+#ifndef LIBROSE_DRAWING_BUFFER_HPP_INCLUDED
+#define LIBROSE_DRAWING_BUFFER_HPP_INCLUDED
+
+#include "image.hpp"
+
+#include <vector>
+
+//
+// render queue of display. blits are appended to one flat vector, items refer to them
+// by index, so adding doesn't allocate once vectors reached their size of a frame.
+// commit sorts items by 64-bit key with radix sort, high 32 bits is order from caller,
+// low 32 bits is adding sequence, so sort is stable. then blits are rendered in order,
+// adjacent blits of same texture and state are submitted as one run.
+// memory is kept across frames.
+//
+class tdrawing_buffer
+{
+public:
+	tdrawing_buffer();
+
+	// returned reference is valid until next add.
+	image::tblit& add(uint32_t order, int x, int y, const image::tblit& blit);
+	void add(uint32_t order, int x, int y, const std::vector<image::tblit>& blits);
+
+	// sort, render and clear.
+	void commit(SDL_Renderer* renderer);
+
+	// commit is sort + render + clear, they are exported for benchmark.
+	void sort();
+	void clear();
+
+	bool empty() const { return items_.empty(); }
+	size_t size() const { return blits_.size(); }
+
+private:
+	struct titem
+	{
+		uint64_t key;
+		int x;
+		int y;
+		uint32_t first;
+		uint32_t count;
+	};
+
+	void add_item(uint32_t order, int x, int y, uint32_t count);
+
+private:
+	std::vector<titem> items_;
+	std::vector<titem> sorted_;
+	std::vector<image::tblit> blits_;
+	std::vector<image::tblit_run_item> run_;
+};
+
+#endif
@@ -37,7 +37,7 @@
 #include <unistd.h>
 #include <dirent.h>
 #include <libgen.h>
-#ifndef ANDROID
+#if !defined(ANDROID) && !defined(__linux__)
 #include <sys/param.h> // statfs 
 #include <sys/mount.h> // statfs
 #else
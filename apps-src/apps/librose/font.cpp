@@ -38,6 +38,7 @@
 #include "gettext.hpp"
 
 #include <boost/foreach.hpp>
+#include <boost/unordered_map.hpp>
 #include <list>
 #include <set>
 #include <stack>
@@ -158,6 +159,53 @@ typedef std::map<std::string,SDL_Rect> line_size_cache_map;
 //map of styles -> sizes -> cache
 static std::map<int,std::map<int,line_size_cache_map> > line_size_cache;
 
+// sizes that get_rendered_text_size returned. they depend on fonts, so it is cleared with line_size_cache.
+struct trendered_size_key
+{
+	trendered_size_key(const std::string& text, int maximum_width, int font_size, bool editable)
+		: text(text)
+		, maximum_width(maximum_width)
+		, font_size(font_size)
+		, editable(editable)
+		, hdpi_scale(gui2::twidget::hdpi_scale)
+	{}
+
+	bool operator==(const trendered_size_key& that) const
+	{
+		return maximum_width == that.maximum_width && font_size == that.font_size && editable == that.editable
+			&& hdpi_scale == that.hdpi_scale && text == that.text;
+	}
+
+	std::string text;
+	int maximum_width;
+	int font_size;
+	bool editable;
+	int hdpi_scale;
+};
+
+struct trendered_size_hash
+{
+	size_t operator()(const trendered_size_key& key) const
+	{
+		size_t seed = boost::hash_value(key.text);
+		boost::hash_combine(seed, key.maximum_width);
+		boost::hash_combine(seed, key.font_size);
+		boost::hash_combine(seed, key.editable);
+		boost::hash_combine(seed, key.hdpi_scale);
+		return seed;
+	}
+};
+
+typedef boost::unordered_map<trendered_size_key, tpoint, trendered_size_hash> trendered_size_map;
+static trendered_size_map rendered_size_cache;
+// labels come and go with windows, start over instead of tracking use.
+static const size_t max_rendered_size_cache = 8192;
+
+static void clear_rendered_size_cache()
+{
+	rendered_size_cache.clear();
+}
+
 //Splits the UTF-8 text into text_chunks using the same font.
 static std::vector<text_chunk> split_text(std::string const & utf8_text) 
 {
@@ -262,6 +310,7 @@ static void clear_fonts()
 	font_names.clear();
 	char_blocks.cbmap.clear();
 	line_size_cache.clear();
+	clear_rendered_size_cache();
 }
 
 struct font_style_setter
@@ -420,6 +469,10 @@ public:
 	size_t height() const;
 	std::vector<surface> const & get_surfaces() const;
 
+	size_t hash_value() const { return hash_; }
+	// bytes that rendered surfaces hold.
+	size_t bytes() const;
+
 	bool operator==(text_surface const &t) const {
 		return hash_ == t.hash_ && font_size_ == t.font_size_
 			&& color_ == t.color_ && style_ == t.style_ && str_ == t.str_;
@@ -430,7 +483,7 @@ private:
 	void hash();
 
 private:
-	int hash_;
+	size_t hash_;
 	int font_size_;
 	SDL_Color color_;
 	int style_;
@@ -459,11 +512,26 @@ text_surface::text_surface(std::string const &str, int size,
 
 void text_surface::hash()
 {
-	int h = 0;
+	// 64-bit FNV-1a over text and every other field of key.
+	uint64_t h = 14695981039346656037ULL;
 	for (std::string::const_iterator it = str_.begin(), it_end = str_.end(); it != it_end; ++it) {
-		h = ((h << 9) | (h >> (sizeof(int) * 8 - 9))) ^ (*it);
+		h = (h ^ static_cast<unsigned char>(*it)) * 1099511628211ULL;
+	}
+	const uint32_t fields[] = {static_cast<uint32_t>(font_size_), static_cast<uint32_t>(style_),
+		static_cast<uint32_t>(color_.r | (color_.g << 8) | (color_.b << 16) | (color_.a << 24))};
+	for (int n = 0; n < 3; n ++) {
+		h = (h ^ fields[n]) * 1099511628211ULL;
+	}
+	hash_ = static_cast<size_t>(h ^ (h >> 32));
+}
+
+size_t text_surface::bytes() const
+{
+	size_t ret = sizeof(text_surface) + str_.size();
+	for (std::vector<surface>::const_iterator it = surfs_.begin(); it != surfs_.end(); ++ it) {
+		ret += (*it)->h * (*it)->pitch;
 	}
-	hash_ = h;
+	return ret;
 }
 
 void text_surface::measure() const
@@ -540,46 +608,84 @@ std::vector<surface> const &text_surface::get_surfaces() const
 
 namespace font {
 
+// rendered text lines. lookup is by hash of text, size, color and style,
+// list keeps recently used at front, least recently used are dropped when bytes exceed limit.
 class text_cache
 {
 public:
+	// returned text_surface has been rendered.
 	static text_surface &find(text_surface const &t);
-	static void resize(unsigned int size);
+	static void resize(size_t bytes);
+
 private:
-	typedef std::list< text_surface > text_list;
+	struct thash
+	{
+		size_t operator()(const text_surface* t) const { return t->hash_value(); }
+	};
+	struct tequal
+	{
+		bool operator()(const text_surface* a, const text_surface* b) const { return *a == *b; }
+	};
+
+	typedef std::list<text_surface> text_list;
+	// key points to element of cache_, std::list doesn't move elements.
+	typedef boost::unordered_map<const text_surface*, text_list::iterator, thash, tequal> text_map;
+
+	static void shrink(size_t bytes);
+
 	static text_list cache_;
-	static unsigned int max_size_;
+	static text_map map_;
+	static size_t bytes_;
+	static size_t max_bytes_;
 };
 
 text_cache::text_list text_cache::cache_;
-unsigned int text_cache::max_size_ = 50;
+text_cache::text_map text_cache::map_;
+size_t text_cache::bytes_ = 0;
+size_t text_cache::max_bytes_ = 4 * 1024 * 1024;
 
-void text_cache::resize(unsigned int size)
+void text_cache::resize(size_t bytes)
 {
-	DBG_FT << "Text cache: resize from: " << max_size_ << " to: "
-		<< size << " items in cache: " << cache_.size() << '\n';
+	DBG_FT << "Text cache: resize from: " << max_bytes_ << " to: "
+		<< bytes << " bytes in cache: " << bytes_ << '\n';
+
+	shrink(bytes);
+	max_bytes_ = bytes;
+}
 
-	while(size < cache_.size()) {
+void text_cache::shrink(size_t bytes)
+{
+	// keep front, it is what caller is using.
+	while (bytes_ > bytes && cache_.size() > 1) {
+		const text_surface& back = cache_.back();
+		bytes_ -= back.bytes();
+		map_.erase(&back);
 		cache_.pop_back();
 	}
-	max_size_ = size;
 }
 
-
 text_surface &text_cache::find(text_surface const &t)
 {
-	text_list::iterator it_bgn = cache_.begin(), it_end = cache_.end();
-	text_list::iterator it = std::find(it_bgn, it_end, t);
-	if (it != it_end) {
-		cache_.splice(it_bgn, cache_, it);
-	} else {
-		if (cache_.size() >= max_size_) {
-			cache_.pop_back();
-		}
-		cache_.push_front(t);
+	text_map::iterator it = map_.find(&t);
+	if (it != map_.end()) {
+		cache_.splice(cache_.begin(), cache_, it->second);
+		return cache_.front();
 	}
 
-	return cache_.front();
+	cache_.push_front(t);
+	text_surface& ret = cache_.front();
+	try {
+		ret.get_surfaces();
+	} catch (...) {
+		// i.e. invalid utf-8, don't keep it.
+		cache_.pop_front();
+		throw;
+	}
+	map_.insert(std::make_pair(&ret, cache_.begin()));
+	bytes_ += ret.bytes();
+	shrink(max_bytes_);
+
+	return ret;
 }
 
 surface get_rendered_text2(const std::string& text, int maximum_width, int font_size, const SDL_Color& color, bool editable)
@@ -603,12 +709,24 @@ tpoint get_rendered_text_size(const std::string& text, int maximum_width, int fo
 	if (text.empty() || maximum_width <= 0 || !font_size) {
 		return tpoint(0, 0);
 	}
+
+	// color doesn't change layout.
+	const trendered_size_key key(text, maximum_width, font_size, editable);
+	trendered_size_map::const_iterator it = rendered_size_cache.find(key);
+	if (it != rendered_size_cache.end()) {
+		return it->second;
+	}
+
 	try {
-		tintegrate integrate(text, maximum_width, -1, font_size, color, editable);
+		tintegrate integrate(text, maximum_width, -1, font_size, color, editable, true);
 		tpoint size = integrate.get_size();
 
 		VALIDATE(size.x <= maximum_width, null_str);
 
+		if (rendered_size_cache.size() >= max_rendered_size_cache) {
+			rendered_size_cache.clear();
+		}
+		rendered_size_cache.insert(std::make_pair(key, size));
 		return size;
 	}
 	catch (utils::invalid_utf8_exception&) {
@@ -677,6 +795,26 @@ surface get_rendered_text(const std::string& text, int font_size, const SDL_Colo
 	}
 }
 
+SDL_Rect get_rendered_text_rect(const std::string& text, int font_size, int style)
+{
+	if (!font_size || text.empty()) {
+		return empty_rect;
+	}
+	VALIDATE(!strchr(text.c_str(), '\n'), null_str);
+
+	try {
+		// same as text_surface::get_surfaces, a line is rendered to surface of its measured size.
+		const SDL_Rect ret = line_size(text, font_size, style);
+		if (!ret.w || ret.w > (int)max_text_line_width) {
+			return empty_rect;
+		}
+		return ret;
+	}
+	catch (utils::invalid_utf8_exception&) {
+		return empty_rect;
+	}
+}
+
 int get_max_height(int size)
 {
 	// Only returns the maximal size of the first font
@@ -1144,9 +1282,9 @@ bool load_font_config()
 void cache_mode(CACHE mode)
 {
 	if(mode == CACHE_LOBBY) {
-		text_cache::resize(1000);
+		text_cache::resize(16 * 1024 * 1024);
 	} else {
-		text_cache::resize(50);
+		text_cache::resize(4 * 1024 * 1024);
 	}
 }
 
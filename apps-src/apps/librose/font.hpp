@@ -73,6 +73,8 @@ tpoint get_rendered_text_size(const std::string& text, int maximum_width = -1, i
 
 // Returns a SDL surface containing the text rendered in a given color.
 surface get_rendered_text(const std::string& text, int size, const SDL_Color& color, int style);
+// size of surface that get_rendered_text returns, without rendering. w is 0 if it returns null.
+SDL_Rect get_rendered_text_rect(const std::string& text, int size, int style);
 
 // Returns the maximum height of a font, in pixels
 int get_max_height(int size);
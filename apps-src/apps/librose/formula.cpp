@@ -32,6 +32,47 @@ void formula_callable::set_value(const std::string& key, const variant& /*value*
 }
 
 
+namespace {
+
+struct tformula_slots
+{
+	std::map<std::string, int> slots;
+	std::vector<std::string> names;
+};
+
+tformula_slots& formula_slots()
+{
+	static tformula_slots slots;
+	return slots;
+}
+
+}
+
+int formula_slot(const std::string& name)
+{
+	tformula_slots& slots = formula_slots();
+	std::map<std::string, int>::const_iterator it = slots.slots.find(name);
+	if (it != slots.slots.end()) {
+		return it->second;
+	}
+	const int slot = slots.names.size();
+	slots.slots.insert(std::make_pair(name, slot));
+	slots.names.push_back(name);
+	return slot;
+}
+
+int find_formula_slot(const std::string& name)
+{
+	const tformula_slots& slots = formula_slots();
+	std::map<std::string, int>::const_iterator it = slots.slots.find(name);
+	return it != slots.slots.end()? it->second: -1;
+}
+
+const std::string& formula_slot_name(int slot)
+{
+	return formula_slots().names[slot];
+}
+
 map_formula_callable::map_formula_callable(
     	const formula_callable* fallback) :
 	formula_callable(false),
@@ -42,14 +83,48 @@ map_formula_callable::map_formula_callable(
 map_formula_callable& map_formula_callable::add(const std::string& key,
                                                 const variant& value)
 {
-	values_[key] = value;
+	return add(formula_slot(key), value);
+}
+
+map_formula_callable& map_formula_callable::add(int slot, const variant& value)
+{
+	for (std::vector<std::pair<int, variant> >::iterator it = values_.begin(); it != values_.end(); ++ it) {
+		if (it->first == slot) {
+			it->second = value;
+			return *this;
+		}
+	}
+	values_.push_back(std::make_pair(slot, value));
 	return *this;
 }
 
+const variant* map_formula_callable::find(int slot) const
+{
+	for (std::vector<std::pair<int, variant> >::const_iterator it = values_.begin(); it != values_.end(); ++ it) {
+		if (it->first == slot) {
+			return &it->second;
+		}
+	}
+	return NULL;
+}
+
 variant map_formula_callable::get_value(const std::string& key) const
 {
-	return map_get_value_default(values_, key,
-	        fallback_ ? fallback_->query_value(key) : variant());
+	const int slot = find_formula_slot(key);
+	const variant* value = slot != -1? find(slot): NULL;
+	if (value) {
+		return *value;
+	}
+	return fallback_ ? fallback_->query_value(key) : variant();
+}
+
+variant map_formula_callable::get_slot_value(int slot, const std::string& key) const
+{
+	const variant* value = find(slot);
+	if (value) {
+		return *value;
+	}
+	return fallback_ ? fallback_->query_slot(slot, key) : variant();
 }
 
 void map_formula_callable::get_inputs(std::vector<formula_input>* inputs) const
@@ -57,14 +132,14 @@ void map_formula_callable::get_inputs(std::vector<formula_input>* inputs) const
 	if(fallback_) {
 		fallback_->get_inputs(inputs);
 	}
-	for(std::map<std::string,variant>::const_iterator i = values_.begin(); i != values_.end(); ++i) {
-		inputs->push_back(formula_input(i->first, FORMULA_READ_WRITE));
+	for(std::vector<std::pair<int, variant> >::const_iterator i = values_.begin(); i != values_.end(); ++i) {
+		inputs->push_back(formula_input(formula_slot_name(i->first), FORMULA_READ_WRITE));
 	}
 }
 
 void map_formula_callable::set_value(const std::string& key, const variant& value)
 {
-	values_[key] = value;
+	add(key, value);
 }
 
 namespace {
@@ -489,7 +564,9 @@ private:
 
 class identifier_expression : public formula_expression {
 public:
-	explicit identifier_expression(const std::string& id) : id_(id)
+	explicit identifier_expression(const std::string& id)
+		: id_(id)
+		, slot_(formula_slot(id))
 	{}
 	std::string str() const
 	{
@@ -497,9 +574,10 @@ public:
 	}
 private:
 	variant execute(const formula_callable& variables, formula_debugger * /*fdb*/) const {
-		return variables.query_value(id_);
+		return variables.query_slot(slot_, id_);
 	}
 	std::string id_;
+	int slot_;
 };
 
 class null_expression : public formula_expression {
@@ -1010,6 +1088,18 @@ formula_ptr formula::create_optional_formula(const std::string& str, function_sy
 	return formula_ptr(new formula(str, symbols));
 }
 
+const_formula_ptr formula::intern(const std::string& str)
+{
+	static std::map<std::string, const_formula_ptr> interned;
+	std::map<std::string, const_formula_ptr>::const_iterator it = interned.find(str);
+	if (it != interned.end()) {
+		return it->second;
+	}
+	const_formula_ptr ret(new formula(str));
+	interned.insert(std::make_pair(str, ret));
+	return ret;
+}
+
 formula::formula(const std::string& str, function_symbol_table* symbols) :
 	expr_(),
 	str_(str)
@@ -57,6 +57,8 @@ public:
 	}
 
 	static formula_ptr create_optional_formula(const std::string& str, function_symbol_table* symbols=NULL);
+	// parsed formula of str with default functions, shared by every caller of same str.
+	static const_formula_ptr intern(const std::string& str);
 	explicit formula(const std::string& str, function_symbol_table* symbols=NULL);
 	explicit formula(const formula_tokenizer::token* i1, const formula_tokenizer::token* i2, function_symbol_table* symbols=NULL);
 	const std::string& str() const { return str_; }
@@ -30,6 +30,13 @@ struct formula_input {
 	{}
 };
 
+// process-wide index of variable names. formula resolves its identifiers to slots once
+// when it is parsed, so evaluating them against map_formula_callable compares ints, not strings.
+int formula_slot(const std::string& name);
+// -1 if no formula nor map_formula_callable used name.
+int find_formula_slot(const std::string& name);
+const std::string& formula_slot_name(int slot);
+
 //interface for objects that can have formulae run on them
 class formula_callable : public reference_counted_object {
 public:
@@ -43,6 +50,11 @@ public:
 		return get_value(key);
 	}
 
+	// slot is formula_slot(key).
+	variant query_slot(int slot, const std::string& key) const {
+		return get_slot_value(slot, key);
+	}
+
 	void mutate_value(const std::string& key, const variant& value) {
 		set_value(key, value);
 	}
@@ -75,6 +87,9 @@ protected:
 	virtual ~formula_callable() {}
 
 	virtual void set_value(const std::string& key, const variant& value);
+	virtual variant get_slot_value(int /*slot*/, const std::string& key) const {
+		return query_value(key);
+	}
 	virtual int do_compare(const formula_callable* callable) const {
 		if( type_ < callable->type_ )
 			return -1;
@@ -156,20 +171,20 @@ class map_formula_callable : public formula_callable {
 public:
 	explicit map_formula_callable(const formula_callable* fallback=NULL);
 	map_formula_callable& add(const std::string& key, const variant& value);
+	map_formula_callable& add(int slot, const variant& value);
 	void set_fallback(const formula_callable* fallback) { fallback_ = fallback; }
 	bool empty() const { return values_.empty(); }
 	void clear() { values_.clear(); }
 
-	typedef std::map<std::string,variant>::const_iterator const_iterator;
-
-	const_iterator begin() const { return values_.begin(); }
-	const_iterator end() const { return values_.end(); }
-
 private:
 	variant get_value(const std::string& key) const;
+	variant get_slot_value(int slot, const std::string& key) const;
 	void get_inputs(std::vector<formula_input>* inputs) const;
 	void set_value(const std::string& key, const variant& value);
-	std::map<std::string,variant> values_;
+	const variant* find(int slot) const;
+
+	// (slot, value) in adding order. a callable holds a few variables, so scan is faster than map.
+	std::vector<std::pair<int, variant> > values_;
 	const formula_callable* fallback_;
 };
 
@@ -14,6 +14,7 @@
 #include "display.hpp"
 #include "integrate.hpp"
 #include "filesystem.hpp"
+#include "render_target_pool.hpp"
 #include "theme.hpp"
 
 #include "rose_config.hpp"
@@ -1509,13 +1510,20 @@ void tcanvas::draw(const tcontrol& widget, const SDL_Rect& canvas_clip_rect, boo
 	}
 
 	if (dirty_) {
+		static const int width_slot = game_logic::formula_slot("width");
+		static const int height_slot = game_logic::formula_slot("height");
+		static const int dwidth_slot = game_logic::formula_slot("dwidth");
+		static const int dheight_slot = game_logic::formula_slot("dheight");
+		static const int extra_width_slot = game_logic::formula_slot("extra_width");
+		static const int extra_height_slot = game_logic::formula_slot("extra_height");
+
 		get_screen_size_variables(variables_);
-		variables_.add("width", variant(w_ / twidget::hdpi_scale));
-		variables_.add("height", variant(h_ / twidget::hdpi_scale));
-		variables_.add("dwidth", variant(w_));
-		variables_.add("dheight", variant(h_));
-		variables_.add("extra_width", variant(widget.config()->text_extra_width / twidget::hdpi_scale));
-		variables_.add("extra_height", variant(widget.config()->text_extra_height / twidget::hdpi_scale));
+		variables_.add(width_slot, variant(w_ / twidget::hdpi_scale));
+		variables_.add(height_slot, variant(h_ / twidget::hdpi_scale));
+		variables_.add(dwidth_slot, variant(w_));
+		variables_.add(dheight_slot, variant(h_));
+		variables_.add(extra_width_slot, variant(widget.config()->text_extra_width / twidget::hdpi_scale));
+		variables_.add(extra_height_slot, variant(widget.config()->text_extra_height / twidget::hdpi_scale));
 	}
 
 	SDL_Renderer* renderer = get_renderer();
@@ -1525,8 +1533,10 @@ void tcanvas::draw(const tcontrol& widget, const SDL_Rect& canvas_clip_rect, boo
 	texture_clip_rect_setter clip(NULL);
 
 	if (dirty_ || force || !animated || mixed_) {
-		// create surface
-		canvas_ = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, w_, h_);
+		// lease target. drop current one first, so pool can give it back when no one else holds it.
+		// leased texture maybe larger than w_ x h_, draw and copy always use rect of canvas.
+		canvas_ = NULL;
+		canvas_ = trender_target_pool::singleton().lease(renderer, SDL_PIXELFORMAT_ARGB8888, w_, h_);
 		SDL_SetTextureBlendMode(canvas_.get(), SDL_BLENDMODE_BLEND);
 		trender_target_lock lock(renderer, canvas_);
 		SDL_RenderClear(renderer);
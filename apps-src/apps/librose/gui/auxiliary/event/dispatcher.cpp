@@ -17,6 +17,8 @@
 
 #include "gui/auxiliary/event/dispatcher_private.hpp"
 
+#include <cstring>
+
 namespace gui2 {
 
 namespace event {
@@ -33,6 +35,9 @@ tdispatcher::tdispatcher()
 	, connected_(false)
 	, hotkeys_()
 {
+	static_assert(event_count <= 32, "masks_ has one bit per event");
+	memset(slots_, no_slot, sizeof(slots_));
+	memset(masks_, 0, sizeof(masks_));
 }
 
 tdispatcher::~tdispatcher()
@@ -40,25 +45,6 @@ tdispatcher::~tdispatcher()
 	VALIDATE(!connected_, null_str);
 }
 
-bool tdispatcher::has_event(const tevent event
-		, const tevent_type event_type
-		)
-{
-	return find<tset_event>(event, tdispatcher_implementation
-					::thas_handler(event_type, *this))
-			|| find<tset_event_mouse>(event, tdispatcher_implementation
-					::thas_handler(event_type, *this))
-			|| find<tset_event_keyboard>(event, tdispatcher_implementation
-					::thas_handler(event_type, *this))
-			|| find<tset_event_textinput>(event, tdispatcher_implementation
-					::thas_handler(event_type, *this))
-			|| find<tset_event_notification>(event, tdispatcher_implementation
-					::thas_handler(event_type, *this))
-			|| find<tset_event_message>(event, tdispatcher_implementation
-					::thas_handler(event_type, *this))
-			;
-}
-
 /**
  * Helper class to do a runtime test whether an event is in a set.
  *
@@ -100,7 +86,7 @@ public:
 		: val_(val)
 	{}
 
-	void operator()(tsignal_function functor
+	void operator()(const tsignal_function& functor
 			, tdispatcher& dispatcher
 			, const tevent event
 			, bool& handled
@@ -169,7 +155,7 @@ public:
 
 	}
 
-	void operator()(tsignal_mouse_function functor
+	void operator()(const tsignal_mouse_function& functor
 			, tdispatcher& dispatcher
 			, const tevent event
 			, bool& handled
@@ -208,7 +194,7 @@ public:
 	{
 	}
 
-	void operator()(tsignal_keyboard_function functor
+	void operator()(const tsignal_keyboard_function& functor
 			, tdispatcher& dispatcher
 			, const tevent event
 			, bool& handled
@@ -245,7 +231,7 @@ public:
 	{
 	}
 
-	void operator()(tsignal_textinput_function functor
+	void operator()(const tsignal_textinput_function& functor
 			, tdispatcher& dispatcher
 			, const tevent event
 			, bool& handled
@@ -275,7 +261,7 @@ class ttrigger_notification
 {
 public:
 
-	void operator()(tsignal_notification_function functor
+	void operator()(const tsignal_notification_function& functor
 			, tdispatcher& dispatcher
 			, const tevent event
 			, bool& handled
@@ -303,7 +289,7 @@ public:
 	{
 	}
 
-	void operator()(tsignal_message_function functor
+	void operator()(const tsignal_message_function& functor
 			, tdispatcher& dispatcher
 			, const tevent event
 			, bool& handled
@@ -25,6 +25,7 @@
 #include <boost/utility/enable_if.hpp>
 
 #include <map>
+#include <memory>
 
 namespace gui2 {
 
@@ -189,7 +190,13 @@ public:
 		, post  = 4
 	};
 
-	bool has_event(const tevent event, const tevent_type event_type);
+	bool has_event(const tevent event, const tevent_type event_type) const
+	{
+		const Uint32 bit = 1 << event;
+		return ((event_type & pre) && (masks_[0] & bit))
+				|| ((event_type & child) && (masks_[1] & bit))
+				|| ((event_type & post) && (masks_[2] & bit));
+	}
 
 	/** Fires an event which has no extra parameters. */
 	bool fire(const tevent event, twidget& target, const int val = 0);
@@ -322,7 +329,7 @@ public:
 	connect_signal(const tsignal_function& signal
 			, const tposition position = back_child)
 	{
-		signal_queue_.connect_signal(E, position, signal);
+		connect_queue_signal(signal_queue_, E, position, signal);
 	}
 
 	/**
@@ -341,7 +348,7 @@ public:
 	disconnect_signal(const tsignal_function& signal
 			, const tposition position = back_child)
 	{
-		signal_queue_.disconnect_signal(E, position, signal);
+		disconnect_queue_signal(signal_queue_, E, position, signal);
 	}
 
 	/**
@@ -357,7 +364,7 @@ public:
 	connect_signal(const tsignal_mouse_function& signal
 			, const tposition position = back_child)
 	{
-		signal_mouse_queue_.connect_signal(E, position, signal);
+		connect_queue_signal(signal_mouse_queue_, E, position, signal);
 	}
 
 	/**
@@ -376,7 +383,7 @@ public:
 	disconnect_signal(const tsignal_mouse_function& signal
 			, const tposition position = back_child)
 	{
-		signal_mouse_queue_.disconnect_signal(E, position, signal);
+		disconnect_queue_signal(signal_mouse_queue_, E, position, signal);
 	}
 
 	/**
@@ -392,7 +399,7 @@ public:
 	connect_signal(const tsignal_keyboard_function& signal
 			, const tposition position = back_child)
 	{
-		signal_keyboard_queue_.connect_signal(E, position, signal);
+		connect_queue_signal(signal_keyboard_queue_, E, position, signal);
 	}
 
 	/**
@@ -411,7 +418,7 @@ public:
 	disconnect_signal(const tsignal_keyboard_function& signal
 			, const tposition position = back_child)
 	{
-		signal_keyboard_queue_.disconnect_signal(E, position, signal);
+		disconnect_queue_signal(signal_keyboard_queue_, E, position, signal);
 	}
 
 	/**
@@ -427,7 +434,7 @@ public:
 	connect_signal(const tsignal_textinput_function& signal
 			, const tposition position = back_child)
 	{
-		signal_textinput_queue_.connect_signal(E, position, signal);
+		connect_queue_signal(signal_textinput_queue_, E, position, signal);
 	}
 
 	/**
@@ -446,7 +453,7 @@ public:
 	disconnect_signal(const tsignal_textinput_function& signal
 			, const tposition position = back_child)
 	{
-		signal_textinput_queue_.disconnect_signal(E, position, signal);
+		disconnect_queue_signal(signal_textinput_queue_, E, position, signal);
 	}
 
 	/**
@@ -465,7 +472,7 @@ public:
 	connect_signal(const tsignal_notification_function& signal
 			, const tposition position = back_child)
 	{
-		signal_notification_queue_.connect_signal(E, position, signal);
+		connect_queue_signal(signal_notification_queue_, E, position, signal);
 	}
 
 	/**
@@ -489,7 +496,7 @@ public:
 	disconnect_signal(const tsignal_notification_function& signal
 			, const tposition position = back_child)
 	{
-		signal_notification_queue_.disconnect_signal(E, position, signal);
+		disconnect_queue_signal(signal_notification_queue_, E, position, signal);
 	}
 
 	/**
@@ -508,7 +515,7 @@ public:
 	connect_signal(const tsignal_message_function& signal
 			, const tposition position = back_child)
 	{
-		signal_message_queue_.connect_signal(E, position, signal);
+		connect_queue_signal(signal_message_queue_, E, position, signal);
 	}
 
 	/**
@@ -532,7 +539,7 @@ public:
 	disconnect_signal(const tsignal_message_function& signal
 			, const tposition position = back_child)
 	{
-		signal_message_queue_.disconnect_signal(E, position, signal);
+		disconnect_queue_signal(signal_message_queue_, E, position, signal);
 	}
 
 	/**
@@ -581,109 +588,28 @@ public:
 		std::vector<T> post_child;
 	};
 
-	/** Helper struct to generate the various event queues. */
+	/**
+	 * Helper struct to generate the various event queues.
+	 *
+	 * Only events that have been connected get a signal. slots_ of the
+	 * dispatcher maps an event to its index in signals, signals are allocated
+	 * one by one so a reference stays valid when a callback connects another
+	 * event during firing.
+	 */
 	template<class T>
 	struct tsignal_queue
 	{
 		tsignal_queue()
-			: queue()
-		{
-		}
-
-		std::map<tevent, tsignal<T> > queue;
-
-		void connect_signal(const tevent event
-				, const tposition position
-				, const T& signal)
+			: signals()
 		{
-			switch(position) {
-				case front_pre_child :
-					queue[event].pre_child.insert(
-							queue[event].pre_child.begin(), signal);
-					break;
-				case back_pre_child :
-					queue[event].pre_child.push_back(signal);
-					break;
-
-				case front_child :
-					queue[event].child.insert(
-							queue[event].child.begin(), signal);
-					break;
-				case back_child :
-					queue[event].child.push_back(signal);
-					break;
-
-				case front_post_child :
-					queue[event].post_child.insert(
-							queue[event].post_child.begin(), signal);
-					break;
-				case back_post_child :
-					queue[event].post_child.push_back(signal);
-					break;
-			}
-
 		}
 
-		void disconnect_signal(const tevent event
-				, const tposition position
-				, const T& signal)
-		{
-			/*
-			 * The function doesn't differentiate between front and back
-			 * position so fall down from front to back.
-			 */
-			switch(position) {
-				case front_pre_child :
-				case back_pre_child : {
-						tsignal<T>& signal_queue = queue[event];
-						for(typename std::vector<T>::iterator itor =
-									signal_queue.child.begin()
-								; itor != signal_queue.child.end()
-								; ++itor) {
-
-							if(signal.target_type() == itor->target_type()) {
-								signal_queue.child.erase(itor);
-								return;
-							}
-						}
-					}
-					break;
-
-				case front_child :
-				case back_child : {
-						tsignal<T>& signal_queue = queue[event];
-						for(typename std::vector<T>::iterator itor =
-									signal_queue.child.begin()
-								; itor != signal_queue.child.end()
-								; ++itor) {
-
-							if(signal.target_type() == itor->target_type()) {
-								signal_queue.child.erase(itor);
-								return;
-							}
-						}
-					}
-					break;
-
-				case front_post_child :
-				case back_post_child : {
-						tsignal<T>& signal_queue = queue[event];
-						for(typename std::vector<T>::iterator itor =
-									signal_queue.child.begin()
-								; itor != signal_queue.child.end()
-								; ++itor) {
-
-							if(signal.target_type() == itor->target_type()) {
-								signal_queue.child.erase(itor);
-								return;
-							}
-						}
-					}
-					break;
-			}
-		}
+		std::vector<std::unique_ptr<tsignal<T> > > signals;
 	};
 
+	/** Number of events, every event has a slot and a bit in the masks. */
+	static const int event_count = MESSAGE_SHOW_TOOLTIP + 1;
+
 	/**
 	 * Registers a hotkey.
 	 *
@@ -744,6 +670,101 @@ private:
 
 	/** The registered hotkeys for this dispatcher. */
 	std::map<int, thotkey_function> hotkeys_;
+
+	/**
+	 * Index of the signal of an event in its queue, no_slot if the event was
+	 * never connected. Every event belongs to one queue only.
+	 */
+	enum { no_slot = 0xff };
+	unsigned char slots_[event_count];
+
+	/**
+	 * Bit (1 << event) is set when the pre, child or post callbacks of the
+	 * event aren't empty. has_event only tests them, so widgets without
+	 * handlers are skipped without looking at the queues.
+	 */
+	Uint32 masks_[3];
+
+	template<class T>
+	tsignal<T>& queue_signal(tsignal_queue<T>& queue, const tevent event)
+	{
+		if (slots_[event] == no_slot) {
+			slots_[event] = queue.signals.size();
+			queue.signals.push_back(std::unique_ptr<tsignal<T> >(new tsignal<T>));
+		}
+		return *queue.signals[slots_[event]];
+	}
+
+	template<class T>
+	void update_masks(const tevent event, const tsignal<T>& signal)
+	{
+		const Uint32 bit = 1 << event;
+		masks_[0] = signal.pre_child.empty()? masks_[0] & ~bit: masks_[0] | bit;
+		masks_[1] = signal.child.empty()? masks_[1] & ~bit: masks_[1] | bit;
+		masks_[2] = signal.post_child.empty()? masks_[2] & ~bit: masks_[2] | bit;
+	}
+
+	template<class T>
+	void connect_queue_signal(tsignal_queue<T>& queue
+			, const tevent event
+			, const tposition position
+			, const T& signal)
+	{
+		tsignal<T>& signal_queue = queue_signal(queue, event);
+		switch(position) {
+			case front_pre_child :
+				signal_queue.pre_child.insert(signal_queue.pre_child.begin(), signal);
+				break;
+			case back_pre_child :
+				signal_queue.pre_child.push_back(signal);
+				break;
+
+			case front_child :
+				signal_queue.child.insert(signal_queue.child.begin(), signal);
+				break;
+			case back_child :
+				signal_queue.child.push_back(signal);
+				break;
+
+			case front_post_child :
+				signal_queue.post_child.insert(signal_queue.post_child.begin(), signal);
+				break;
+			case back_post_child :
+				signal_queue.post_child.push_back(signal);
+				break;
+		}
+		update_masks(event, signal_queue);
+	}
+
+	template<class T>
+	void disconnect_queue_signal(tsignal_queue<T>& queue
+			, const tevent event
+			, const tposition position
+			, const T& signal)
+	{
+		if (slots_[event] == no_slot) {
+			return;
+		}
+		tsignal<T>& signal_queue = *queue.signals[slots_[event]];
+
+		/*
+		 * The function doesn't differentiate between front and back
+		 * position so fall down from front to back.
+		 */
+		std::vector<T>* callbacks = &signal_queue.child;
+		if (position == front_pre_child || position == back_pre_child) {
+			callbacks = &signal_queue.pre_child;
+		} else if (position == front_post_child || position == back_post_child) {
+			callbacks = &signal_queue.post_child;
+		}
+		for (typename std::vector<T>::iterator itor = callbacks->begin(); itor != callbacks->end(); ++ itor) {
+			if (signal.target_type() == itor->target_type()) {
+				callbacks->erase(itor);
+				break;
+			}
+		}
+		update_masks(event, signal_queue);
+	}
 };
 
 /***** ***** ***** ***** ***** Common helpers  ***** ***** ***** ***** *****/
@@ -22,6 +22,8 @@
 
 #include <boost/mpl/for_each.hpp>
 
+#include <algorithm>
+
 namespace gui2 {
 
 namespace event {
@@ -54,7 +56,8 @@ struct tdispatcher_implementation
 	 * @param event               The event to get the signal for.            \
 	 *                                                                        \
 	 * @returns                   The signal of the type                      \
-	 *                            tdispatcher::tsignal<FUNCTION>              \
+	 *                            tdispatcher::tsignal<FUNCTION>, an empty    \
+	 *                            one if the event was never connected.       \
 	 */                                                                       \
 	template<class F>                                                         \
 	static typename boost::enable_if<                                         \
@@ -63,7 +66,11 @@ struct tdispatcher_implementation
 			>::type&                                                          \
 	event_signal(tdispatcher& dispatcher, const tevent event)                 \
 	{                                                                         \
-		return dispatcher.QUEUE.queue[event];                                 \
+		if (dispatcher.slots_[event] == tdispatcher::no_slot) {               \
+			static tdispatcher::tsignal<FUNCTION> empty;                      \
+			return empty;                                                     \
+		}                                                                     \
+		return *dispatcher.QUEUE.signals[dispatcher.slots_[event]];           \
 	}                                                                         \
                                                                               \
 	/**                                                                       \
@@ -86,7 +93,7 @@ struct tdispatcher_implementation
 			>::type&                                                          \
 	event_signal(tdispatcher& dispatcher, const tevent event)                 \
 	{                                                                         \
-		return dispatcher.QUEUE.queue[event];                                 \
+		return event_signal<FUNCTION>(dispatcher, event);                     \
 	}                                                                         \
 
 
@@ -114,61 +121,6 @@ struct tdispatcher_implementation
 
 #undef IMPLEMENT_EVENT_SIGNAL_WRAPPER
 #undef IMPLEMENT_EVENT_SIGNAL
-
-	/**
-	 * A helper class to find out whether dispatcher has an handler for a
-	 * certain event.
-	 */
-	class thas_handler
-	{
-	public:
-		/**
-		 * Constructor.
-		 *
-		 * @param event_type      The type of event to look for.
-		* @param dispatcher      The dispatcher whose signal queue is used.
-		 */
-		thas_handler(const tdispatcher::tevent_type event_type
-				, tdispatcher& dispatcher)
-			: event_type_(event_type)
-			, dispatcher_(dispatcher)
-		{}
-
-		/**
-		 * Tests whether a handler for an event is available.
-		 *
-		 * It tests for both the event and the event_type send in the
-		 * constructor.
-		 *
-		 * @tparam T              A key from an event set used to instanciate
-		 *                        the proper @p event_signal function.
-		* @param event           The event to get the signal for.
-		 *
-		 * @returns               Whether or not the handler is found.
-		 */
-		// not called operator() to work around a problem in MSVC 2008.
-		template<class T>
-		bool oper(tevent event)
-		{
-			if((event_type_ & tdispatcher::pre)
-					&& !event_signal<T>(dispatcher_, event).pre_child.empty()) {
-				return true;
-			}
-			if((event_type_ & tdispatcher::child)
-					&& !event_signal<T>(dispatcher_, event).child.empty()) {
-				return true;
-			}
-			if((event_type_ & tdispatcher::post)
-					&& !event_signal<T>(dispatcher_, event).post_child.empty()){
-				return true;
-			}
-			return false;
-		}
-
-	private:
-		tdispatcher::tevent_type event_type_;
-		tdispatcher& dispatcher_;
-	};
 };
 
 /** Contains the implementation details of the find function. */
@@ -273,6 +225,59 @@ inline bool find(E event, F functor)
 
 namespace implementation {
 
+/**
+ * The widgets of an event chain with the event to send to them.
+ *
+ * A chain is at most as long as the widget tree is deep, it's built on every
+ * fire so the items are kept inline and only very deep trees allocate.
+ */
+class tevent_chain
+{
+public:
+	typedef std::pair<twidget*, tevent> value_type;
+
+	tevent_chain()
+		: data_(inline_)
+		, size_(0)
+		, capacity_(inline_size)
+		, heap_()
+	{
+	}
+
+	void push_back(const value_type& item)
+	{
+		if (size_ == capacity_) {
+			// resize keeps items already in heap_, only the first spill copies inline ones.
+			const bool spill = data_ == inline_;
+			heap_.resize(capacity_ * 2);
+			if (spill) {
+				std::copy(inline_, inline_ + size_, heap_.begin());
+			}
+			data_ = &heap_[0];
+			capacity_ *= 2;
+		}
+		data_[size_ ++] = item;
+	}
+
+	void reverse() { std::reverse(data_, data_ + size_); }
+
+	int size() const { return size_; }
+	bool empty() const { return !size_; }
+	value_type& operator[](const int at) { return data_[at]; }
+
+private:
+	tevent_chain(const tevent_chain&);
+	void operator=(const tevent_chain&);
+
+	enum { inline_size = 16 };
+
+	value_type inline_[inline_size];
+	value_type* data_;
+	int size_;
+	int capacity_;
+	std::vector<value_type> heap_;
+};
+
 /*
  * Small sample to illustrate the effects of the various build_event_chain
  * functions. Assume the widgets are in an window with the following widgets:
@@ -313,8 +318,7 @@ namespace implementation {
  * @param dispatcher              The final widget to test, this is also the
  *                                dispatcher the sends the event.
  * @param widget                  The widget should parent(s) to check.
- *
- * @returns                       The list of widgets with a handler.
+ * @param result                  The list of widgets with a handler.
  *                                The order will be (assuming all have a
  *                                handler):
  *                                * container 2
@@ -322,16 +326,15 @@ namespace implementation {
  *                                * dispatcher
  */
 template<class T>
-inline std::vector<std::pair<twidget*, tevent> > build_event_chain(
+inline void build_event_chain(
 		  const tevent event
 		, twidget* dispatcher
-		, twidget* widget)
+		, twidget* widget
+		, tevent_chain& result)
 {
 	VALIDATE(dispatcher, null_str);
 	VALIDATE(widget, null_str);
 
-	std::vector<std::pair<twidget*, tevent> > result;
-
 	while(widget != dispatcher) {
 		widget = widget->parent();
 		VALIDATE(widget, null_str);
@@ -342,25 +345,22 @@ inline std::vector<std::pair<twidget*, tevent> > build_event_chain(
 			result.push_back(std::make_pair(widget, event));
 		}
 	}
-
-	return result;
 }
 
 /**
  * Build the event chain for tsignal_notification_function.
  *
- * The notification is only send to the receiver it returns an empty chain.
+ * The notification is only send to the receiver it leaves the chain empty.
  * Since the pre and post queues are unused, it validates whether they are
  * empty (using asserts).
- *
- * @returns                       An empty vector.
  */
 template<>
-inline std::vector<std::pair<twidget*, tevent> >
+inline void
 build_event_chain<tsignal_notification_function>(
 		  const tevent event
 		, twidget* dispatcher
-		, twidget* widget)
+		, twidget* widget
+		, tevent_chain&)
 {
 	assert(dispatcher);
 	assert(widget);
@@ -370,8 +370,6 @@ build_event_chain<tsignal_notification_function>(
 			, tdispatcher::tevent_type(
 					  tdispatcher::pre
 					| tdispatcher::post)));
-
-	return std::vector<std::pair<twidget*, tevent> >();
 }
 
 #ifdef _MSC_VER
@@ -388,7 +386,7 @@ build_event_chain<tsignal_notification_function>(
  *
  * @pre                           dispatcher == widget
  *
- * @returns                       The list of widgets with a handler.
+ * @param result                  The list of widgets with a handler.
  *                                The order will be (assuming all have a
  *                                handler):
  *                                * window
@@ -396,18 +394,17 @@ build_event_chain<tsignal_notification_function>(
  *                                * container 2
  */
 template<>
-inline std::vector<std::pair<twidget*, tevent> >
+inline void
 build_event_chain<tsignal_message_function>(
 		  const tevent event
 		, twidget* dispatcher
-		, twidget* widget)
+		, twidget* widget
+		, tevent_chain& result)
 {
 	assert(dispatcher);
 	assert(widget);
 	assert(widget == dispatcher);
 
-	std::vector<std::pair<twidget*, tevent> > result;
-
 	/* We only should add the parents of the widget to the chain. */
 	while((widget = widget->parent())) {
 		assert(widget);
@@ -415,11 +412,10 @@ build_event_chain<tsignal_message_function>(
 		if(widget->has_event(event, tdispatcher::tevent_type(
 				tdispatcher::pre | tdispatcher::post))) {
 
-			result.insert(result.begin(), std::make_pair(widget, event));
+			result.push_back(std::make_pair(widget, event));
 		}
 	}
-
-	return result;
+	result.reverse();
 }
 #ifdef _MSC_VER
 #pragma warning (pop)
@@ -433,7 +429,7 @@ build_event_chain<tsignal_message_function>(
  */
 template<class T, class F>
 inline bool fire_event(const tevent event
-		, std::vector<std::pair<twidget*, tevent> >& event_chain
+		, tevent_chain& event_chain
 		, twidget* dispatcher
 		, twidget* widget
 		, F functor)
@@ -444,19 +440,17 @@ inline bool fire_event(const tevent event
 	bool halt = false;
 
 	/***** ***** ***** Pre ***** ***** *****/
-	for (std::vector<std::pair<twidget*, tevent> >
-				::reverse_iterator ritor_widget = event_chain.rbegin();
-			ritor_widget != event_chain.rend();
-			++ritor_widget) {
+	for (int at = event_chain.size() - 1; at >= 0; at --) {
+		const tevent_chain::value_type& item = event_chain[at];
 
 		tdispatcher::tsignal<T>& signal = tdispatcher_implementation
-				::event_signal<T>(*ritor_widget->first, ritor_widget->second);
+				::event_signal<T>(*item.first, item.second);
 
 		for (typename std::vector<T>::iterator itor = signal.pre_child.begin();
 				itor != signal.pre_child.end();
 				++itor) {
 
-			functor(*itor, *dispatcher, ritor_widget->second, handled, halt);
+			functor(*itor, *dispatcher, item.second, handled, halt);
 			if (halt || !twidget::fire_event) {
 				handled = true;
 				return true;
@@ -492,19 +486,17 @@ inline bool fire_event(const tevent event
 	}
 
 	/***** ***** ***** Post ***** ***** *****/
-	for (std::vector<std::pair<twidget*, tevent> >
-				::iterator itor_widget = event_chain.begin();
-			itor_widget != event_chain.end();
-			++itor_widget) {
+	for (int at = 0; at < event_chain.size(); at ++) {
+		const tevent_chain::value_type& item = event_chain[at];
 
 		tdispatcher::tsignal<T>& signal = tdispatcher_implementation
-				::event_signal<T>(*itor_widget->first, itor_widget->second);
+				::event_signal<T>(*item.first, item.second);
 
 		for (typename std::vector<T>::iterator itor = signal.post_child.begin();
 				itor != signal.post_child.end();
 				++itor) {
 
-			functor(*itor, *dispatcher, itor_widget->second, handled, halt);
+			functor(*itor, *dispatcher, item.second, handled, halt);
 			if (halt || !twidget::fire_event) {
 				handled = true;
 				return true;
@@ -554,8 +546,8 @@ inline bool fire_event(const tevent event
 	assert(dispatcher);
 	assert(widget);
 
-	std::vector<std::pair<twidget*, tevent> > event_chain =
-			implementation::build_event_chain<T>(event, dispatcher, widget);
+	implementation::tevent_chain event_chain;
+	implementation::build_event_chain<T>(event, dispatcher, widget, event_chain);
 
 	return implementation::fire_event<T>(event
 			, event_chain
@@ -579,7 +571,7 @@ inline bool fire_event_double_click(
 	assert(dispatcher);
 	assert(widget);
 
-	std::vector<std::pair<twidget*, tevent> > event_chain;
+	implementation::tevent_chain event_chain;
 	twidget* w = widget;
 	while(w!= dispatcher) {
 		w = w->parent();
@@ -26,7 +26,9 @@
 #include "hotkeys.hpp"
 #include "video.hpp"
 #include "display.hpp"
+#include "base_instance.hpp"
 #include "gui/widgets/settings.hpp"
+#include "gui/auxiliary/window_builder.hpp"
 #include "preferences.hpp"
 #include "wml_exception.hpp"
 #include "posix2.h"
@@ -223,6 +225,14 @@ private:
 	 */
 	tdispatcher* keyboard_focus_;
 	friend void capture_keyboard(tdispatcher*);
+
+	/**
+	 * The presented frame may be stale, next draw must present.
+	 *
+	 * Set by input events (cursor, expose, focus) and window changes. Without
+	 * it draw presents only when window reports damage.
+	 */
+	bool present_required_;
 };
 
 static thandler* handler = NULL;
@@ -231,6 +241,7 @@ thandler::thandler()
 	: tevent_handler(false, false)
 	, dispatchers_()
 	, keyboard_focus_(nullptr)
+	, present_required_(true)
 {
 	if (SDL_WasInit(SDL_INIT_TIMER) == 0) {
 		if (SDL_InitSubSystem(SDL_INIT_TIMER) == -1) {
@@ -331,6 +342,10 @@ void thandler::mini_handle_event(const SDL_Event& event)
 {
 	int x = 0, y = 0;
 
+	if (event.type != TIMER_EVENT) {
+		present_required_ = true;
+	}
+
 	switch(event.type) {
 	case TIMER_EVENT:
 		if (!dispatchers_.empty()) {
@@ -427,6 +442,7 @@ void thandler::connect(twindow* window)
 	}
 
 	dispatchers_.push_back(window);
+	present_required_ = true;
 }
 
 void thandler::disconnect(twindow* window)
@@ -437,6 +453,7 @@ void thandler::disconnect(twindow* window)
 
 	/***** Remove dispatcher. *****/
 	dispatchers_.erase(itor);
+	present_required_ = true;
 
 	if (window == keyboard_focus_) {
 		keyboard_focus_ = NULL;
@@ -472,7 +489,16 @@ void thandler::draw()
 	disp->draw_window_anim();
 	cursor::draw();
 
-	video.flip();
+	// idle window: nothing was redrawn, presented frame is still valid.
+	if (present_required_ || window->frame_damaged() || !disp->area_anims().empty()) {
+		video.flip();
+		// flip does nothing in background.
+		present_required_ = !instance->foreground();
+
+	} else {
+		// spare time of idle frame, resolve one of queued dialogs.
+		prewarm_next();
+	}
 
 	cursor::undraw();
 	disp->undraw_window_anim();
@@ -35,6 +35,10 @@ namespace gui2{
  * A string is a formula when it starts with a right paren, no other validation
  * is done by this function, leading whitespace is significant.
  *
+ * A formula is parsed once, when the object is constructed, and the parsed
+ * expression is interned process-wide, so every object with the same string,
+ * i.e. same shape of a canvas in many widgets, shares it.
+ *
  * Upon getting the value of the formula a variable map is send. The variables
  * in the map can be used in the formula. The 'owners' of the class need to
  * document the variables available.
@@ -114,6 +118,9 @@ private:
 	 */
 	std::string formula_;
 
+	/** Parsed formula_, interned by game_logic::formula::intern. */
+	game_logic::const_formula_ptr compiled_;
+
 	/**
 	 * Contains the formuale or value for the variable.
 	 *
@@ -128,6 +135,7 @@ private:
 template<class T>
 tformula<T>::tformula(const std::string& str, const T value)
 	: formula_()
+	, compiled_()
 	, formula2_(false)
 	, value_(value)
 {
@@ -139,6 +147,7 @@ tformula<T>::tformula(const std::string& str, const T value)
 
 	if (str[0] == '(') {
 		formula_ = str;
+		compiled_ = game_logic::formula::intern(str);
 	} else {
 		convert(str);
 	}
@@ -161,35 +170,35 @@ template<>
 inline bool tformula<bool>::execute(
 		const game_logic::map_formula_callable& variables) const
 {
-	return game_logic::formula(formula_).evaluate(variables).as_bool();
+	return compiled_->evaluate(variables).as_bool();
 }
 
 template<>
 inline int tformula<int>::execute(
 		const game_logic::map_formula_callable& variables) const
 {
-	return game_logic::formula(formula_).evaluate(variables).as_int();
+	return compiled_->evaluate(variables).as_int();
 }
 
 template<>
 inline unsigned tformula<unsigned>::execute(
 		const game_logic::map_formula_callable& variables) const
 {
-	return game_logic::formula(formula_).evaluate(variables).as_int();
+	return compiled_->evaluate(variables).as_int();
 }
 
 template<>
 inline std::string tformula<std::string>::execute(
 		const game_logic::map_formula_callable& variables) const
 {
-	return game_logic::formula(formula_).evaluate(variables).as_string();
+	return compiled_->evaluate(variables).as_string();
 }
 
 template<>
 inline t_string tformula<t_string>::execute(
 		const game_logic::map_formula_callable& variables) const
 {
-	return game_logic::formula(formula_).evaluate(variables).as_string();
+	return compiled_->evaluate(variables).as_string();
 }
 
 template<class T>
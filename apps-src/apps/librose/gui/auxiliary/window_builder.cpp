@@ -45,6 +45,8 @@
 #include <boost/bind.hpp>
 #include <boost/foreach.hpp>
 
+#include <algorithm>
+
 namespace gui2 {
 
 static std::map<std::string, boost::function<tbuilder_widget_ptr(config)> >&
@@ -134,6 +136,47 @@ twindow *build(CVideo &video, const std::string &type, const unsigned explicit_x
 	return window;
 }
 
+void prewarm(const std::string& type)
+{
+	std::vector<twindow_builder::tresolution>::const_iterator
+		definition = get_window_builder(type);
+
+	for (std::vector<twindow_builder::tfloat_widget>::const_iterator it = definition->float_widgets.begin(); it != definition->float_widgets.end(); ++ it) {
+		it->widget->prewarm();
+	}
+	definition->grid->prewarm();
+}
+
+static std::vector<std::string>& prewarm_queue()
+{
+	static std::vector<std::string> result;
+	return result;
+}
+
+void queue_prewarm(const std::string& type)
+{
+	std::vector<std::string>& queue = prewarm_queue();
+	if (std::find(queue.begin(), queue.end(), type) == queue.end()) {
+		queue.push_back(type);
+	}
+}
+
+bool prewarm_next()
+{
+	std::vector<std::string>& queue = prewarm_queue();
+	if (queue.empty()) {
+		return false;
+	}
+	const std::string type = queue.front();
+	queue.erase(queue.begin());
+	try {
+		prewarm(type);
+	} catch (twindow_builder_invalid_id&) {
+		// not registered, or gui isn't loaded yet. build will report it.
+	}
+	return true;
+}
+
 tbuilder_widget::tbuilder_widget(const config& cfg)
 	: id(cfg["id"])
 	, linked_group(cfg["linked_group"])
@@ -162,7 +205,9 @@ tbuilder_widget_ptr create_builder_widget(const config& cfg)
 			continue;
 		}
 		if (const config& c = cfg.child(item.first)) {
-			return item.second(c);
+			tbuilder_widget_ptr result = item.second(c);
+			result->set_control_type(item.first);
+			return result;
 		}
 	}
 
@@ -218,7 +263,9 @@ tbuilder_widget_ptr create_builder_widget2(const std::string& type, const config
 	std::map<std::string, boost::function<tbuilder_widget_ptr(config)> >::const_iterator it =
 		builder_widget_lookup().find(type);
 	VALIDATE(it != builder_widget_lookup().end(), "Unknown widget!");
-	return it->second(cfg);
+	tbuilder_widget_ptr result = it->second(cfg);
+	result->set_control_type(type);
+	return result;
 }
 
 tfloat_widget_builder::tfloat_widget_builder()
@@ -634,6 +681,7 @@ tbuilder_grid::tbuilder_grid(const config& cfg) :
 			}
 
 			widgets.push_back(create_builder_widget(c));
+			tpl_widgets.push_back(twidget::is_tpl_widget_id(widgets.back()->id));
 
 			++col;
 		}
@@ -662,6 +710,7 @@ tgrid* tbuilder_grid::build(tgrid* grid) const
 	grid->set_linked_group(linked_group);
 	grid->set_rows_cols(rows, cols);
 
+	const bool orientation_effect = twidget::orientation_effect_resolution(settings::screen_width, settings::screen_height);
 	for (unsigned x = 0; x < rows; ++x) {
 		grid->set_row_grow_factor(x, row_grow_factor[x]);
 		for (unsigned y = 0; y < cols; ++y) {
@@ -672,7 +721,7 @@ tgrid* tbuilder_grid::build(tgrid* grid) const
 
 			tbuilder_widget_ptr ptr = widgets[x * cols + y];
 			twidget* widget = NULL;
-			if (twidget::is_tpl_widget_id(ptr->id) && twidget::orientation_effect_resolution(settings::screen_width, settings::screen_height)) {
+			if (orientation_effect && tpl_widgets[x * cols + y]) {
 				std::map<std::string, tbuilder_widget_ptr>::const_iterator it = settings::portraits.find(ptr->id);
 				if (it != settings::portraits.end()) {
 					widget = it->second->build();
@@ -688,6 +737,21 @@ tgrid* tbuilder_grid::build(tgrid* grid) const
 	return grid;
 }
 
+void tbuilder_grid::prewarm() const
+{
+	const bool orientation_effect = twidget::orientation_effect_resolution(settings::screen_width, settings::screen_height);
+	for (size_t at = 0; at < widgets.size(); at ++) {
+		if (orientation_effect && tpl_widgets[at]) {
+			std::map<std::string, tbuilder_widget_ptr>::const_iterator it = settings::portraits.find(widgets[at]->id);
+			if (it != settings::portraits.end()) {
+				it->second->prewarm();
+				continue;
+			}
+		}
+		widgets[at]->prewarm();
+	}
+}
+
 } // namespace gui2
 /*WIKI
  * @page = GUIToolkitWML
@@ -42,6 +42,21 @@ class twindow;
  */
 twindow* build(CVideo& video, const std::string& type, const unsigned explicit_x, const unsigned explicit_y);
 
+/**
+ * Resolves the widget definitions that building the window needs for current
+ * screen size, without creating widgets. Next build of the window reuses them.
+ *
+ * @param type                    The type id string of the window.
+ */
+void prewarm(const std::string& type);
+
+/**
+ * Queues a window to prewarm when gui is idle, for dialogs opened often.
+ * Call prewarm_next from idle time, it prewarms one queued window.
+ */
+void queue_prewarm(const std::string& type);
+bool prewarm_next();
+
 /** Contains the info needed to instantiate a widget. */
 struct tbuilder_widget
 	: public reference_counted_object
@@ -54,6 +69,12 @@ public:
 
 	virtual twidget* build() const = 0;
 
+	/** Resolves what build needs for current screen size. */
+	virtual void prewarm() const {}
+
+	/** Type of the widget that is built, the id it was registered with. */
+	virtual void set_control_type(const std::string& /*type*/) {}
+
 	/** Parameters for the widget. */
 	std::string id;
 	std::string linked_group;
@@ -129,8 +150,13 @@ public:
 	/** The widgets per grid cell. */
 	std::vector<tbuilder_widget_ptr> widgets;
 
+	/** Cells whose widget may be replaced by a portrait one. */
+	std::vector<bool> tpl_widgets;
+
 	tgrid* build() const;
 
+	void prewarm() const;
+
 
 	tgrid* build(tgrid* grid) const;
 };
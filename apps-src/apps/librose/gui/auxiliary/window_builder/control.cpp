@@ -42,6 +42,13 @@ tbuilder_control::tbuilder_control(const config& cfg)
 	, size_is_max(cfg["size_is_max"].to_bool())
 	, text_font_size(cfg["text_font_size"].to_int())
 	, text_color_tpl(cfg["text_color_tpl"].to_int())
+	, control_type()
+	, best_width_(width)
+	, best_height_(height)
+	, resolved_()
+	, resolved_type_()
+	, resolved_definition_()
+	, resolved_size_(0, 0)
 {
 	if (definition.empty()) {
 		definition = "default";
@@ -62,7 +69,7 @@ void tbuilder_control::init_control(tcontrol* control) const
 	VALIDATE(control, null_str);
 
 	control->set_id(id);
-	control->set_definition(definition);
+	control->set_definition(resolve_definition(control->get_control_type()));
 	control->set_linked_group(linked_group);
 	control->set_label(label);
 	control->set_tooltip(tooltip);
@@ -79,7 +86,27 @@ void tbuilder_control::init_control(tcontrol* control) const
 		control->set_text_color_tpl(text_color_tpl);
 	}
 	control->set_drag(drag);
-	control->set_best_size(width, height);
+	control->set_best_size(best_width_, best_height_);
+}
+
+void tbuilder_control::prewarm() const
+{
+	if (!control_type.empty()) {
+		resolve_definition(control_type);
+	}
+}
+
+tresolution_definition_ptr tbuilder_control::resolve_definition(const std::string& type) const
+{
+	const tpoint landscape_size = twidget::orientation_swap_size(settings::screen_width, settings::screen_height);
+	// text_box2 may change definition after creating.
+	if (!resolved_ || landscape_size != resolved_size_ || type != resolved_type_ || definition != resolved_definition_) {
+		resolved_ = get_control(type, definition);
+		resolved_type_ = type;
+		resolved_definition_ = definition;
+		resolved_size_ = landscape_size;
+	}
+	return resolved_;
 }
 
 } // namespace implementation
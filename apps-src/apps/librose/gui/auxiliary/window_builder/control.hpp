@@ -17,6 +17,7 @@
 #define GUI_AUXILIARY_WINDOW_BUILDER_CONTROL_HPP_INCLUDED
 
 #include "gui/auxiliary/window_builder.hpp"
+#include "gui/auxiliary/widget_definition.hpp"
 
 namespace gui2 {
 
@@ -36,6 +37,9 @@ public:
 	/** @deprecated The control can initalise itself. */
 	void init_control(tcontrol* control) const;
 
+	void prewarm() const;
+	void set_control_type(const std::string& type) { control_type = type; }
+
 	/** Parameters for the control. */
 	std::string definition;
 	t_string label;
@@ -48,6 +52,25 @@ public:
 	bool size_is_max;
 	int text_font_size;
 	int text_color_tpl;
+
+	/** Type of the built control, empty when builder isn't created by type. */
+	std::string control_type;
+
+private:
+	tresolution_definition_ptr resolve_definition(const std::string& type) const;
+
+	/** width and height, parsed once. */
+	tformula<unsigned> best_width_;
+	tformula<unsigned> best_height_;
+
+	/**
+	 * Definition that get_control returned for resolved_type_ and resolved_definition_
+	 * at resolved_size_. It depends only on screen size, so later builds reuse it.
+	 */
+	mutable tresolution_definition_ptr resolved_;
+	mutable std::string resolved_type_;
+	mutable std::string resolved_definition_;
+	mutable tpoint resolved_size_;
 };
 
 } // namespace implementation
@@ -123,6 +123,18 @@ twidget* tbuilder_listbox::build() const
 	return widget;
 }
 
+void tbuilder_listbox::prewarm() const
+{
+	tbuilder_control::prewarm();
+	if (header) {
+		header->prewarm();
+	}
+	if (footer) {
+		footer->prewarm();
+	}
+	list_builder->prewarm();
+}
+
 } // namespace implementation
 
 } // namespace gui2
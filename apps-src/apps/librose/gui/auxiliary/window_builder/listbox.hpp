@@ -31,6 +31,8 @@ struct tbuilder_listbox
 
 	twidget* build () const;
 
+	void prewarm() const;
+
 	std::vector<tlinked_group> linked_groups;
 	tscroll_container::tscrollbar_mode vertical_scrollbar_mode;
 	tscroll_container::tscrollbar_mode horizontal_scrollbar_mode;
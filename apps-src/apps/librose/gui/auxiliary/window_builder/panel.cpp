@@ -49,6 +49,12 @@ twidget* tbuilder_panel::build() const
 	return widget;
 }
 
+void tbuilder_panel::prewarm() const
+{
+	tbuilder_control::prewarm();
+	grid->prewarm();
+}
+
 } // namespace implementation
 
 } // namespace gui2
@@ -29,6 +29,8 @@ struct tbuilder_panel
 
 	twidget* build () const;
 
+	void prewarm() const;
+
 	tbuilder_grid_ptr grid;
 };
 
@@ -95,6 +95,12 @@ twidget* tbuilder_scroll_panel::build() const
 	return widget;
 }
 
+void tbuilder_scroll_panel::prewarm() const
+{
+	tbuilder_control::prewarm();
+	grid->prewarm();
+}
+
 } // namespace implementation
 
 } // namespace gui2
@@ -30,6 +30,8 @@ struct tbuilder_scroll_panel	: public tbuilder_control
 
 	twidget* build () const;
 
+	void prewarm() const;
+
 	tscroll_container::tscrollbar_mode vertical_scrollbar_mode;
 	tscroll_container::tscrollbar_mode horizontal_scrollbar_mode;
 
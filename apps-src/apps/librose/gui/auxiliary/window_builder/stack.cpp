@@ -64,6 +64,14 @@ twidget* tbuilder_stack::build() const
 	return widget;
 }
 
+void tbuilder_stack::prewarm() const
+{
+	tbuilder_control::prewarm();
+	for (std::vector<std::pair<tbuilder_grid_const_ptr, unsigned> >::const_iterator it = stack.begin(); it != stack.end(); ++ it) {
+		it->first->prewarm();
+	}
+}
+
 } // namespace implementation
 
 } // namespace gui2
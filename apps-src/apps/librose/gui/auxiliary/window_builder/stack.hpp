@@ -32,6 +32,8 @@ struct tbuilder_stack
 
 	twidget* build () const;
 
+	void prewarm() const;
+
 	/** The builders for all layers of the stack .*/
 	std::vector<std::pair<tbuilder_grid_const_ptr, unsigned> > stack;
 
@@ -54,6 +54,12 @@ twidget* tbuilder_toggle_panel::build() const
 	return widget;
 }
 
+void tbuilder_toggle_panel::prewarm() const
+{
+	tbuilder_control::prewarm();
+	grid->prewarm();
+}
+
 void tbuilder_toggle_panel::build2(ttoggle_panel& widget) const
 {
 	// ttoggle_panel* widget = new ttoggle_panel();
@@ -30,6 +30,8 @@ struct tbuilder_toggle_panel
 	explicit tbuilder_toggle_panel(const config& cfg);
 
 	twidget* build () const;
+
+	void prewarm() const;
 	void build2(ttoggle_panel& widget) const;
 
 	tbuilder_grid_ptr grid;
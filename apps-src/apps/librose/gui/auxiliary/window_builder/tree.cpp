@@ -74,6 +74,14 @@ twidget* tbuilder_tree::build() const
 	return widget;
 }
 
+void tbuilder_tree::prewarm() const
+{
+	tbuilder_control::prewarm();
+	for (std::vector<tnode>::const_iterator it = nodes.begin(); it != nodes.end(); ++ it) {
+		it->builder->prewarm();
+	}
+}
+
 tbuilder_tree::tnode::tnode(const config& cfg)
 	: id(cfg["id"])
 	, builder(NULL)
@@ -88,6 +96,7 @@ tbuilder_tree::tnode::tnode(const config& cfg)
 	VALIDATE(node_definition, _("No node defined."));
 
 	builder = new tbuilder_toggle_panel(node_definition);
+	builder->set_control_type("toggle_panel");
 }
 
 } // namespace implementation
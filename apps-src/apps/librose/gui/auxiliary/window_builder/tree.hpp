@@ -31,6 +31,8 @@ struct tbuilder_tree
 
 	twidget* build () const;
 
+	void prewarm() const;
+
 	tscroll_container::tscrollbar_mode vertical_scrollbar_mode;
 	tscroll_container::tscrollbar_mode horizontal_scrollbar_mode;
 
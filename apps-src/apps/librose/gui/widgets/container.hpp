@@ -122,6 +122,15 @@ public:
 		return result ? result : grid_->find(id, must_be_active);
 	}
 
+	/** Inherited from tcontrol.*/
+	void index_ids(tid_index& index) override
+	{
+		tcontrol::index_ids(index);
+		if (grid_) {
+			grid_->index_ids(index);
+		}
+	}
+
 	/** Inherited from tcontrol. */
 	void set_active(const bool active);
 
@@ -296,9 +296,14 @@ void tcontrol::place(const tpoint& origin, const tpoint& size)
 
 void tcontrol::set_definition(const std::string& definition)
 {
-	VALIDATE(!config(), null_str);
+	set_definition(get_control(get_control_type(), definition));
+}
+
+void tcontrol::set_definition(tresolution_definition_ptr definition)
+{
+	VALIDATE(!config() && definition, null_str);
 
-	set_config(get_control(get_control_type(), definition));
+	set_config(definition);
 
 	VALIDATE(canvas().size() == config()->state.size(), null_str);
 	for (size_t i = 0; i < canvas().size(); ++i) {
@@ -323,6 +328,12 @@ void tcontrol::set_best_size(const std::string& width, const std::string& height
 	best_height_ = tformula<unsigned>(height);
 }
 
+void tcontrol::set_best_size(const tformula<unsigned>& width, const tformula<unsigned>& height)
+{
+	best_width_ = width;
+	best_height_ = height;
+}
+
 void tcontrol::set_label(const std::string& label)
 {
 	if (label == label_) {
@@ -262,6 +262,9 @@ public:
 	 */
 	void set_definition(const std::string& definition);
 
+	/** As above, with the definition that get_control returned. */
+	void set_definition(tresolution_definition_ptr definition);
+
 	/***** ***** ***** setters / getters for members ***** ****** *****/
 	const std::string& label() const { return label_; }
 	virtual void set_label(const std::string& label);
@@ -292,6 +295,7 @@ public:
 	void set_text_maximum_width(int maximum);
 
 	void set_best_size(const std::string& width, const std::string& height);
+	void set_best_size(const tformula<unsigned>& width, const tformula<unsigned>& height);
 
 protected:
 	void set_config(tresolution_definition_ptr config) { config_ = config; }
@@ -617,6 +617,18 @@ const twidget* tgrid::find(const std::string& id,
 	return nullptr;
 }
 
+void tgrid::index_ids(tid_index& index)
+{
+	twidget::index_ids(index);
+
+	for (int n = 0; n < children_vsize_; n ++) {
+		tchild& child = children_[n];
+		if (child.widget_) {
+			child.widget_->index_ids(index);
+		}
+	}
+}
+
 bool tgrid::has_widget(const twidget* widget) const
 {
 	if(twidget::has_widget(widget)) {
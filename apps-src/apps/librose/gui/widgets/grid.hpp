@@ -222,6 +222,9 @@ public:
 	const twidget* find(const std::string& id,
 			const bool must_be_active) const;
 
+	/** Inherited from twidget.*/
+	void index_ids(tid_index& index) override;
+
 	/** Inherited from twidget.*/
 	bool has_widget(const twidget* widget) const;
 
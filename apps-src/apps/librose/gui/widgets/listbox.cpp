@@ -53,6 +53,9 @@ tlistbox::tlistbox(const std::vector<tlinked_group>& linked_groups)
 	, explicit_select_(false)
 	, linked_max_size_changed_(false)
 	, row_layout_size_changed_(false)
+	, model_rows_(0)
+	, model_heights_()
+	, model_pool_()
 {
 	// require_capture_ = false;
 
@@ -77,19 +80,32 @@ tlistbox::~tlistbox()
 	if (drag_spacer_) {
 		delete drag_spacer_;
 	}
+	if (cursel_ && row_model() && !model_row_in_window(cursel_->at_)) {
+		delete cursel_;
+	}
+	for (std::vector<ttoggle_panel*>::const_iterator it = model_pool_.begin(); it != model_pool_.end(); ++ it) {
+		delete *it;
+	}
 }
 
-ttoggle_panel& tlistbox::insert_row(const std::map<std::string, std::string>& data, int at)
+ttoggle_panel* tlistbox::create_row()
 {
-	if (at != twidget::npos) {
-		const int rows = list_grid_->children_vsize();
-		VALIDATE(at >= 0 && at < rows, null_str);
-	}
 	ttoggle_panel* widget = dynamic_cast<ttoggle_panel*>(list_builder_->widgets[0]->build());
 	widget->set_did_mouse_enter_leave(boost::bind(&tlistbox::did_focus_changed, this, _1, _2));
 	widget->set_did_state_pre_change(boost::bind(&tlistbox::did_pre_change, this, _1));
 	widget->set_did_state_changed(boost::bind(&tlistbox::did_changed, this, _1));
 	widget->set_did_double_click(boost::bind(&tlistbox::did_double_click, this, _1));
+	return widget;
+}
+
+ttoggle_panel& tlistbox::insert_row(const std::map<std::string, std::string>& data, int at)
+{
+	VALIDATE(!row_model(), null_str);
+	if (at != twidget::npos) {
+		const int rows = list_grid_->children_vsize();
+		VALIDATE(at >= 0 && at < rows, null_str);
+	}
+	ttoggle_panel* widget = create_row();
 
 	widget->set_child_members(data);
 	widget->at_ = list_grid_->listbox_insert_child(*widget, at);
@@ -310,6 +326,7 @@ void tlistbox::gc_insert_or_erase_row(const int row, const bool insert)
 
 void tlistbox::erase_row(int at)
 {
+	VALIDATE(!row_model(), null_str);
 	const int rows = list_grid_->children_vsize();
 	if (!rows) {
 		return;
@@ -355,6 +372,10 @@ void tlistbox::erase_row(int at)
 
 void tlistbox::clear()
 {
+	if (row_model()) {
+		set_model_rows(0, 0);
+		return;
+	}
 	const int rows = list_grid_->children_vsize();
 	if (!rows) {
 		return;
@@ -369,6 +390,282 @@ void tlistbox::clear()
 	invalidate();
 }
 
+void tlistbox::set_row_model(const boost::function<void (tlistbox& list, ttoggle_panel& widget, const int at)>& did_fill_row, const int rows)
+{
+	VALIDATE(!row_model() && !list_grid_->children_vsize(), null_str);
+	VALIDATE(!did_fill_row.empty() && rows >= 0, null_str);
+
+	did_fill_row_ = did_fill_row;
+	model_rows_ = rows;
+	invalidate();
+}
+
+void tlistbox::set_model_rows(const int rows, int changed_at)
+{
+	VALIDATE(row_model() && rows >= 0, null_str);
+
+	if (changed_at == twidget::npos) {
+		changed_at = model_rows_;
+	}
+	VALIDATE(changed_at >= 0, null_str);
+	if (changed_at > rows) {
+		changed_at = rows;
+	}
+
+	if (cursel_ && cursel_->at_ >= rows) {
+		texplicit_select_lock lock(*this);
+		select_internal(nullptr);
+	}
+	// rows in window from changed_at require fill again.
+	model_release_window(changed_at);
+
+	model_rows_ = rows;
+	if (model_heights_.valid()) {
+		model_heights_.resize(rows, changed_at);
+	}
+	invalidate();
+}
+
+int tlistbox::mini_handle_gc(const int x_offset, const int y_offset)
+{
+	if (!row_model()) {
+		return tscroll_container::mini_handle_gc(x_offset, y_offset);
+	}
+	return model_handle_gc(y_offset);
+}
+
+// children of list_grid_ are panels of rows [first, last] only. gc_first_at_/gc_last_at_ is index in them,
+// so tgrid3 and layout_init2 work as normal mode. distance of panel comes from model_heights_, it is precise.
+int tlistbox::model_handle_gc(const int y_offset)
+{
+	if (!model_rows_) {
+		return y_offset;
+	}
+
+	const SDL_Rect content_rect = content_->get_rect();
+	if (!gc_calculate_best_size_) {
+		VALIDATE(content_rect.h > 0, null_str);
+	}
+	const int half_content_height = content_rect.h / 2;
+	// at tgrid3::calculate_best_size, only calculate first least_height's rows.
+	const int least_height = gc_calculate_best_size_? (int)settings::screen_height: content_rect.h * 2;
+
+	const int locked_at = gc_calculate_best_size_? twidget::npos: gc_locked_at_;
+	if (locked_at != twidget::npos) {
+		VALIDATE(locked_at >= 0 && locked_at < model_rows_, null_str);
+		gc_locked_at_ = twidget::npos;
+	}
+
+	// rows that are still in window keep their panels.
+	std::map<int, ttoggle_panel*> previous;
+	const tgrid::tchild* children = list_grid_->children();
+	const int childs = list_grid_->children_vsize();
+	for (int n = 0; n < childs; n ++) {
+		ttoggle_panel* panel = dynamic_cast<ttoggle_panel*>(children[n].widget_);
+		previous.insert(std::make_pair(panel->at_, panel));
+	}
+
+	if (!model_heights_.valid()) {
+		// rows that haven't been measured use first row's height.
+		ttoggle_panel* panel = model_bind_row(0, previous);
+		const int height = model_measure_row(*panel, content_rect.w);
+		model_heights_.reset(model_rows_, height > 0? height: 1);
+		model_heights_.set_height(0, height);
+		previous.insert(std::make_pair(0, panel));
+	}
+
+	int first, valid_height;
+	if (locked_at != twidget::npos) {
+		first = locked_at;
+		valid_height = 0;
+	} else {
+		const int start_distance = y_offset >= half_content_height? y_offset - half_content_height: 0;
+		first = model_heights_.which_row(start_distance);
+		valid_height = model_heights_.distance(first) - start_distance;
+	}
+
+	// 1) from first to bottom. measure doesn't change distance of first.
+	std::map<int, ttoggle_panel*> window;
+	int last = first - 1;
+	while (valid_height < least_height && last + 1 < model_rows_) {
+		last ++;
+		ttoggle_panel* panel = model_bind_row(last, previous);
+		if (panel->gc_height_ == twidget::npos) {
+			model_heights_.set_height(last, model_measure_row(*panel, content_rect.w));
+		}
+		window.insert(std::make_pair(last, panel));
+		valid_height += panel->gc_height_;
+	}
+
+	// 2) at end, or locked row, require rows above.
+	const int above_height = locked_at != twidget::npos? content_rect.h: 0;
+	int upward_height = 0;
+	while (first > 0 && (valid_height < least_height || upward_height < above_height)) {
+		first --;
+		ttoggle_panel* panel = model_bind_row(first, previous);
+		if (panel->gc_height_ == twidget::npos) {
+			model_heights_.set_height(first, model_measure_row(*panel, content_rect.w));
+		}
+		window.insert(std::make_pair(first, panel));
+		valid_height += panel->gc_height_;
+		upward_height += panel->gc_height_;
+	}
+
+	// 3) rows out of window give back panel.
+	for (std::map<int, ttoggle_panel*>::const_iterator it = previous.begin(); it != previous.end(); ++ it) {
+		model_release_row(*it->second);
+	}
+
+	std::vector<ttoggle_panel*> panels;
+	for (std::map<int, ttoggle_panel*>::const_iterator it = window.begin(); it != window.end(); ++ it) {
+		panels.push_back(it->second);
+	}
+	list_grid_->model_set_children(panels);
+	gc_first_at_ = 0;
+	gc_last_at_ = panels.size() - 1;
+	gc_next_precise_at_ = panels.size();
+
+	layout_init2();
+
+	// 4) linked group maybe change height, from top to bottom fill distance.
+	int next_distance = model_heights_.distance(first);
+	for (std::vector<ttoggle_panel*>::const_iterator it = panels.begin(); it != panels.end(); ++ it) {
+		ttoggle_panel* panel = *it;
+		model_heights_.set_height(panel->at_, panel->gc_height_);
+		panel->gc_distance_ = next_distance;
+		next_distance += panel->gc_height_;
+	}
+
+	gc_current_content_width_ = gc_calculate_best_size_? 0: content_rect.w;
+	if (gc_calculate_best_size_) {
+		return y_offset;
+	}
+
+	const int diff = gc_handle_update_height(model_heights_.total());
+	if (diff != 0) {
+		set_scrollbar_mode(*vertical_scrollbar_,
+			vertical_scrollbar_mode_,
+			content_grid_->get_height(),
+			content_->get_height());
+
+		if (vertical_scrollbar_ != dummy_vertical_scrollbar_) {
+			set_scrollbar_mode(*dummy_vertical_scrollbar_,
+				vertical_scrollbar_mode_,
+				content_grid_->get_height(),
+				content_->get_height());
+		}
+	}
+
+	if (locked_at != twidget::npos) {
+		const ttoggle_panel* panel = window.find(locked_at)->second;
+		tgrid* header = find_widget<tgrid>(content_grid_, "_header_grid", true, false);
+		SDL_Rect rect{0, panel->gc_distance_, 0, panel->gc_height_ + header->get_best_size().y};
+		show_content_rect(rect);
+	}
+	return vertical_scrollbar_->get_item_position();
+}
+
+ttoggle_panel* tlistbox::model_bind_row(const int at, std::map<int, ttoggle_panel*>& previous)
+{
+	std::map<int, ttoggle_panel*>::iterator it = previous.find(at);
+	if (it != previous.end()) {
+		// still in window, use it as it is.
+		ttoggle_panel* panel = it->second;
+		previous.erase(it);
+		return panel;
+	}
+
+	ttoggle_panel* panel;
+	if (cursel_ && cursel_->at_ == at) {
+		panel = cursel_;
+	} else if (!model_pool_.empty()) {
+		panel = model_pool_.back();
+		model_pool_.pop_back();
+	} else {
+		panel = create_row();
+		panel->set_parent(list_grid_);
+	}
+	panel->at_ = at;
+	panel->gc_distance_ = panel->gc_height_ = panel->gc_width_ = twidget::npos;
+	did_fill_row_(*this, *panel, at);
+	return panel;
+}
+
+int tlistbox::model_measure_row(ttoggle_panel& panel, const int width)
+{
+	{
+		// panel maybe recycled from other row, layout size is that row's.
+		tlink_group_owner_lock lock(*this);
+		panel.layout_init(false);
+	}
+	const tpoint size = gc_handle_calculate_size(panel, width);
+	panel.gc_width_ = size.x;
+	panel.gc_height_ = size.y;
+	panel.twidget::set_size(tpoint(0, 0));
+	return size.y;
+}
+
+ttoggle_panel* tlistbox::model_row_in_window(const int at) const
+{
+	const int childs = list_grid_->children_vsize();
+	if (!childs) {
+		return nullptr;
+	}
+	// rows in window are continuous.
+	const tgrid::tchild* children = list_grid_->children();
+	const int n = at - dynamic_cast<ttoggle_panel*>(children[0].widget_)->at_;
+	if (n < 0 || n >= childs) {
+		return nullptr;
+	}
+	return dynamic_cast<ttoggle_panel*>(children[n].widget_);
+}
+
+void tlistbox::model_release_row(ttoggle_panel& panel)
+{
+	garbage_collection(panel);
+	panel.gc_distance_ = panel.gc_height_ = panel.gc_width_ = twidget::npos;
+	if (&panel != cursel_) {
+		model_pool_.push_back(&panel);
+	}
+}
+
+void tlistbox::model_release_window(const int from)
+{
+	const tgrid::tchild* children = list_grid_->children();
+	const int childs = list_grid_->children_vsize();
+	if (!childs || dynamic_cast<ttoggle_panel*>(children[childs - 1].widget_)->at_ < from) {
+		return;
+	}
+	cancel_drag();
+
+	std::vector<ttoggle_panel*> panels;
+	for (int n = 0; n < childs; n ++) {
+		ttoggle_panel* panel = dynamic_cast<ttoggle_panel*>(children[n].widget_);
+		if (panel->at_ < from) {
+			panels.push_back(panel);
+		} else {
+			model_release_row(*panel);
+		}
+	}
+	list_grid_->model_set_children(panels);
+	if (panels.empty()) {
+		gc_first_at_ = gc_last_at_ = twidget::npos;
+		gc_next_precise_at_ = 0;
+	} else {
+		gc_last_at_ = panels.size() - 1;
+		gc_next_precise_at_ = panels.size();
+	}
+}
+
+void tlistbox::model_recycle(ttoggle_panel* panel)
+{
+	// panel that is neither in window nor cursel_, for example previous cursel_ that has scrolled out.
+	if (!row_model() || !panel || panel == cursel_ || model_row_in_window(panel->at_) == panel) {
+		return;
+	}
+	model_release_row(*panel);
+}
+
 class tsort_func
 {
 public:
@@ -387,6 +684,7 @@ private:
 
 void tlistbox::sort(const boost::function<bool (const ttoggle_panel& widget, const ttoggle_panel&)>& did_compare)
 {
+	VALIDATE(!row_model(), null_str);
 	tgrid::tchild* children = list_grid_->children();
 	const int rows = list_grid_->children_vsize();
 
@@ -456,6 +754,9 @@ void tlistbox::sort(const boost::function<bool (const ttoggle_panel& widget, con
 
 int tlistbox::rows() const
 {
+	if (row_model()) {
+		return model_rows_;
+	}
 	return list_grid_->children_vsize();
 }
 
@@ -467,6 +768,7 @@ void tlistbox::set_row_active(const unsigned row, const bool active)
 
 void tlistbox::set_row_child_visible(int at, const std::string& id, const bool visible)
 {
+	VALIDATE(!row_model(), null_str);
 	const int rows = list_grid_->children_vsize();
 	if (at == twidget::npos) {
 		at = rows - 1;
@@ -495,6 +797,7 @@ void tlistbox::set_row_child_visible(int at, const std::string& id, const bool v
 
 void tlistbox::set_row_child_label(int at, const std::string& id, const std::string& label)
 {
+	VALIDATE(!row_model(), null_str);
 	const int rows = list_grid_->children_vsize();
 	if (at == twidget::npos) {
 		at = rows - 1;
@@ -586,6 +889,12 @@ void tlistbox::show_row_rect(const int at)
 
 ttoggle_panel& tlistbox::row_panel(const int at) const
 {
+	if (row_model()) {
+		// only rows that have panel.
+		ttoggle_panel* panel = cursel_ && cursel_->at_ == at? cursel_: model_row_in_window(at);
+		VALIDATE(panel, null_str);
+		return *panel;
+	}
 	const tgrid::tchild* children = list_grid_->children();
 	const int childs = list_grid_->children_vsize();
 	VALIDATE(at >= 0 && at < childs, null_str);
@@ -595,6 +904,29 @@ ttoggle_panel& tlistbox::row_panel(const int at) const
 
 bool tlistbox::select_row(const int at)
 {
+	if (row_model()) {
+		ttoggle_panel* desire_widget = nullptr;
+		if (at != twidget::npos) {
+			VALIDATE(at >= 0 && at < model_rows_, null_str);
+			if (cursel_ && cursel_->at_ == at) {
+				return true;
+			}
+			desire_widget = model_row_in_window(at);
+			if (!desire_widget) {
+				// row isn't in window, selected panel is kept out of window until row scrolls in.
+				std::map<int, ttoggle_panel*> previous;
+				desire_widget = model_bind_row(at, previous);
+			}
+		}
+		bool changed;
+		{
+			texplicit_select_lock lock(*this);
+			changed = select_internal(desire_widget);
+		}
+		model_recycle(desire_widget);
+		return changed;
+	}
+
 	ttoggle_panel* desire_widget = nullptr;
 	if (at != twidget::npos) {
 		const tgrid::tchild* children = list_grid_->children();
@@ -674,6 +1006,7 @@ bool tlistbox::select_internal(twidget* widget, const bool selected)
 	if (!selectable_) {
 		VALIDATE(!cursel_, null_str);
 	}
+	model_recycle(original_cursel);
 	return changed;
 }
 
@@ -811,7 +1144,7 @@ void tlistbox::popup_new_window()
 
 void tlistbox::scroll_to_row(int at)
 {
-	const int rows = list_grid_->children_vsize();
+	const int rows = this->rows();
 	if (!rows) {
 		return;
 	}
@@ -819,6 +1152,13 @@ void tlistbox::scroll_to_row(int at)
 		at = rows - 1;
 	}
 	gc_locked_at_ = at;
+	if (row_model()) {
+		VALIDATE(at >= 0 && at < rows, null_str);
+		if (gc_current_content_width_ > 0) {
+			scrollbar_moved();
+		}
+		return;
+	}
 	mini_handle_gc(horizontal_scrollbar_->get_item_position(), vertical_scrollbar_->get_item_position());
 }
 
@@ -1081,6 +1421,9 @@ bool tlistbox::list_grid_handle_key_up_arrow()
 	if (!cursel_->at_) {
 		return false;
 	}
+	if (row_model()) {
+		return select_row(cursel_->at_ - 1);
+	}
 	const tgrid::tchild* children = list_grid_->children();
 	const int childs = list_grid_->children_vsize();
 
@@ -1142,6 +1485,9 @@ bool tlistbox::list_grid_handle_key_down_arrow()
 	if (cursel_ == NULL) {
 		return false;
 	}
+	if (row_model()) {
+		return cursel_->at_ + 1 < model_rows_ && select_row(cursel_->at_ + 1);
+	}
 
 	tgrid::tchild* children = list_grid_->children();
 	const int childs = list_grid_->children_vsize();
@@ -1253,6 +1599,27 @@ void tlistbox::tgrid3::listbox_erase_child(int at)
 	}
 }
 
+void tlistbox::tgrid3::model_set_children(const std::vector<ttoggle_panel*>& panels)
+{
+	const int size = panels.size();
+	rows_ = size;
+	row_height_.resize(size, 0);
+	row_grow_factor_.resize(size, 0);
+	resize_children((rows_ * cols_) + 1);
+
+	// panels that leave window are owned by listbox, don't delete them.
+	for (int at = 0; at < size; at ++) {
+		ttoggle_panel* widget = panels[at];
+		widget->set_parent(this);
+		children_[at].widget_ = widget;
+		children_[at].flags_ = VERTICAL_ALIGN_TOP | HORIZONTAL_GROW_SEND_TO_CLIENT;
+	}
+	for (int at = size; at < children_vsize_; at ++) {
+		children_[at].widget_ = NULL;
+	}
+	children_vsize_ = size;
+}
+
 void tlistbox::tgrid3::validate_children_continuous() const
 {
 	if (listbox_.gc_first_at_ == twidget::npos) {
@@ -1327,7 +1694,7 @@ tpoint tlistbox::tgrid3::calculate_best_size() const
 	VALIDATE(row_grow_factor_.size() == rows_, null_str);
 	VALIDATE(col_grow_factor_.size() == cols_, null_str);
 
-	if (!children_vsize_) {
+	if (!listbox_.rows()) {
 		return tpoint(0, 0);
 	}
 
@@ -1351,7 +1718,8 @@ tpoint tlistbox::tgrid3::calculate_best_size() const
 	}
 	col_width_[0] = max_width;
 
-	return tpoint(col_width_[0], listbox_.gc_calculate_total_height());
+	const int height = listbox_.row_model()? listbox_.model_heights_.total(): listbox_.gc_calculate_total_height();
+	return tpoint(col_width_[0], height);
 }
 
 tpoint tlistbox::tgrid3::fill_placeable_width(const int width)
@@ -1610,6 +1978,12 @@ void tlistbox::reset()
 	tgrid* header = find_widget<tgrid>(content_grid_, "_header_grid", true, false);
 	header->layout_init(false);
 
+	if (row_model()) {
+		// height of row depends on content width.
+		model_release_window(0);
+		model_heights_ = theight_index();
+	}
+
 	gc_first_at_ = gc_last_at_ = twidget::npos;
 	gc_next_precise_at_ = 0;
 	tgrid::tchild* children = list_grid_->children();
@@ -1628,7 +2002,7 @@ void tlistbox::reset()
 
 tpoint tlistbox::mini_calculate_content_grid_size(const tpoint& content_origin, const tpoint& content_size)
 {
-	const int rows = list_grid_->children_vsize();
+	const int rows = this->rows();
 	if (rows) {
 		if (left_drag_grid_ && drag_at_ != twidget::npos) {
 			// hope don't enter it.
@@ -1747,8 +2121,10 @@ bool tlistbox::mini_mouse_motion(const tpoint& first, const tpoint& last)
 			left_drag_grid_size_ = left_drag_grid_->get_best_size();
 			VALIDATE(left_drag_grid_size_.y <= (int)widget->get_height(), null_str);
 
-			if (selectable_ && cursel_ && cursel_->at_ != drag_at_) {
-				select_row(drag_at_);
+			// in row model, drag_at_ is index in window.
+			const int drag_row = dynamic_cast<ttoggle_panel*>(widget)->at_;
+			if (selectable_ && cursel_ && cursel_->at_ != drag_row) {
+				select_row(drag_row);
 			}
 
 			left_drag_grid_->place(tpoint(content_->get_x() + content_->get_width() - left_drag_grid_size_.x, widget->get_y()),
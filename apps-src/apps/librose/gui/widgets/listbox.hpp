@@ -42,6 +42,8 @@ public:
 		int listbox_insert_child(twidget& widget, int at);
 		void listbox_erase_child(int at);
 		void validate_children_continuous() const;
+		// row model mode, children are panels of rows in window only.
+		void model_set_children(const std::vector<ttoggle_panel*>& panels);
 
 	private:
 		void layout_init(bool linked_group_only) override;
@@ -62,6 +64,9 @@ public:
 		/** Inherited from tcontrol.*/
 		const twidget* find(const std::string& id, const bool must_be_active) const { return nullptr; }
 
+		/** Inherited from tcontainer_. */
+		void index_ids(tid_index& index) override {}
+
 	private:
 		tlistbox& listbox_;
 	};
@@ -115,6 +120,32 @@ public:
 	/** Removes all the rows in the listbox, clearing it. */
 	void clear();
 
+	/***** ***** ***** ***** Row model. ***** ***** ****** *****/
+	/**
+	 * Lets listbox show rows of a data model instead of rows inserted by insert_row.
+	 *
+	 * Only rows near visible area have toggle panel, panels are built from list
+	 * builder on demand and recycled when their rows scroll out. Panel's at_ is
+	 * row in model, did_fill_row fills panel with data of this row. Heights of rows
+	 * are kept in prefix-sum index, so scrolling to any row is exact.
+	 * insert_row, erase_row and sort can not be used in this mode.
+	 *
+	 * @param did_fill_row        Fills panel with data of row at.
+	 * @param rows                Number of rows in model.
+	 */
+	void set_row_model(const boost::function<void (tlistbox& list, ttoggle_panel& widget, const int at)>& did_fill_row, const int rows);
+
+	/**
+	 * Rows of model changed.
+	 *
+	 * @param rows                New number of rows in model.
+	 * @param changed_at          Rows from it require fill again, twidget::npos
+	 *                            means only rows are appended.
+	 */
+	void set_model_rows(const int rows, int changed_at = twidget::npos);
+
+	bool row_model() const { return !did_fill_row_.empty(); }
+
 	/**
 	 * Makes a row active or inactive.
 	 *
@@ -307,6 +338,16 @@ private:
 
 	void reset();
 
+	ttoggle_panel* create_row();
+	int mini_handle_gc(const int x_offset, const int y_offset) override;
+	int model_handle_gc(const int y_offset);
+	ttoggle_panel* model_bind_row(const int at, std::map<int, ttoggle_panel*>& previous);
+	int model_measure_row(ttoggle_panel& panel, const int width);
+	ttoggle_panel* model_row_in_window(const int at) const;
+	void model_release_row(ttoggle_panel& panel);
+	void model_release_window(const int from);
+	void model_recycle(ttoggle_panel* panel);
+
 private:
 	/**
 	 * Contains a pointer to the generator.
@@ -389,6 +430,13 @@ private:
 	boost::function<void (tlistbox& list, ttoggle_panel& widget)> did_allocated_gc_;
 	boost::function<void (tlistbox& list)> did_more_rows_gc_;
 
+	// row model.
+	boost::function<void (tlistbox& list, ttoggle_panel& widget, const int at)> did_fill_row_;
+	int model_rows_;
+	theight_index model_heights_;
+	// panels that aren't in window. when cursel_ scrolls out, it isn't in window nor here.
+	std::vector<ttoggle_panel*> model_pool_;
+
 	/** Inherited from tcontrol. */
 	const std::string& get_control_type() const;
 };
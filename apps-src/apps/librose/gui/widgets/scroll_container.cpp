@@ -370,6 +370,15 @@ const twidget* tscroll_container::find(const std::string& id, const bool must_be
 	return result;
 }
 
+void tscroll_container::index_ids(tid_index& index)
+{
+	tcontainer_::index_ids(index);
+
+	if (content_grid_) {
+		content_grid_->index_ids(index);
+	}
+}
+
 SDL_Rect tscroll_container::get_float_widget_ref_rect() const
 {
 	SDL_Rect ret{x_, y_, (int)w_, (int)h_};
@@ -474,6 +483,95 @@ int tscroll_container::gc_which_children_row(const int distance) const
 	return twidget::npos;
 }
 
+void tscroll_container::theight_index::reset(const int rows, const int estimated)
+{
+	VALIDATE(rows >= 0 && estimated > 0, null_str);
+
+	estimated_ = estimated;
+	heights_.assign(rows, estimated);
+	build();
+}
+
+void tscroll_container::theight_index::resize(const int rows, const int keep)
+{
+	VALIDATE(valid() && rows >= 0 && keep >= 0, null_str);
+
+	if (keep < (int)heights_.size()) {
+		heights_.resize(keep);
+	}
+	heights_.resize(rows, estimated_);
+	build();
+}
+
+void tscroll_container::theight_index::build()
+{
+	// tree_ is 1-based, tree_[i] is sum of heights in (i - lowbit(i), i].
+	const int rows = heights_.size();
+	tree_.resize(rows + 1);
+	tree_[0] = 0;
+	total_ = 0;
+	for (int i = 1; i <= rows; i ++) {
+		tree_[i] = heights_[i - 1];
+		total_ += heights_[i - 1];
+	}
+	for (int i = 1; i <= rows; i ++) {
+		const int parent = i + (i & -i);
+		if (parent <= rows) {
+			tree_[parent] += tree_[i];
+		}
+	}
+}
+
+void tscroll_container::theight_index::set_height(const int row, const int height)
+{
+	VALIDATE(row >= 0 && row < (int)heights_.size() && height >= 0, null_str);
+
+	const int diff = height - heights_[row];
+	if (!diff) {
+		return;
+	}
+	heights_[row] = height;
+	const int rows = heights_.size();
+	for (int i = row + 1; i <= rows; i += i & -i) {
+		tree_[i] += diff;
+	}
+	total_ += diff;
+}
+
+int tscroll_container::theight_index::distance(const int row) const
+{
+	VALIDATE(row >= 0 && row <= (int)heights_.size(), null_str);
+
+	int ret = 0;
+	for (int i = row; i > 0; i -= i & -i) {
+		ret += tree_[i];
+	}
+	return ret;
+}
+
+int tscroll_container::theight_index::which_row(const int distance) const
+{
+	const int rows = heights_.size();
+	VALIDATE(rows > 0, null_str);
+
+	if (distance >= total_) {
+		return rows - 1;
+	}
+	// descend the tree, pos is the most rows whose heights sum <= distance.
+	int mask = 1;
+	while (mask * 2 <= rows) {
+		mask *= 2;
+	}
+	int pos = 0, remain = distance;
+	for (; mask; mask /= 2) {
+		if (pos + mask <= rows && tree_[pos + mask] <= remain) {
+			pos += mask;
+			remain -= tree_[pos];
+		}
+	}
+	return pos < rows? pos: rows - 1;
+}
+
 int tscroll_container::mini_handle_gc(const int x_offset, const int y_offset)
 {
 	const int rows = gc_handle_rows();
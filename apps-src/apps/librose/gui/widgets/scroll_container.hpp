@@ -61,6 +61,46 @@ class tscroll_container: public tcontainer_
 	friend class tscroll_panel;
 
 public:
+	/**
+	 * Heights of rows in a virtualized list, kept as a fenwick tree, so distance of
+	 * a row and the row at a distance are O(log n) even with 100k rows. Rows that
+	 * haven't been measured use estimated height, measure then set_height to make
+	 * their distance exact.
+	 */
+	class theight_index
+	{
+	public:
+		theight_index()
+			: estimated_(0)
+			, total_(0)
+		{}
+
+		// all rows use estimated height.
+		void reset(const int rows, const int estimated);
+		// rows before keep hold their heights, others use estimated height.
+		void resize(const int rows, const int keep);
+
+		bool valid() const { return estimated_ > 0; }
+		int rows() const { return heights_.size(); }
+		int height(const int row) const { return heights_[row]; }
+		void set_height(const int row, const int height);
+
+		// sum of heights of rows before row.
+		int distance(const int row) const;
+		// row that contains distance.
+		int which_row(const int distance) const;
+		int total() const { return total_; }
+
+	private:
+		void build();
+
+	private:
+		std::vector<int> heights_;
+		std::vector<int> tree_;
+		int estimated_;
+		int total_;
+	};
+
 	static tscroll_container& container_from_content_grid(const twidget& widget);
 
 	explicit tscroll_container(const unsigned canvas_count, bool listbox = false);
@@ -120,6 +160,9 @@ public:
 	/** Inherited from tcontrol.*/
 	const twidget* find(const std::string& id, const bool must_be_active) const;
 
+	/** Inherited from tcontainer_. */
+	void index_ids(tid_index& index) override;
+
 protected:
 	/** Inherited from tcontainer_. */
 	void layout_init(bool linked_group_only) override;
@@ -31,6 +31,7 @@
 #include "rose_config.hpp"
 #include "loadscreen.hpp"
 #include "font.hpp"
+#include "xwml.hpp"
 
 #include <boost/foreach.hpp>
 
@@ -81,7 +82,7 @@ static tregistered_widget_type& registred_widget_type()
 	return result;
 }
 
-const std::string& tgui_definition::read(const config& cfg)
+const std::string& tgui_definition::read(const config& cfg, const boost::shared_ptr<txwml_archive>& archive)
 {
 /*WIKI
  * @page = GUIToolkitWML
@@ -218,6 +219,8 @@ const std::string& tgui_definition::read(const config& cfg)
 		child.first = child.second.read(w);
 		window_types.insert(child);
 	}
+	archive_ = archive;
+	gui_block_ = archive_? archive_->find("gui", id): -1;
 
 	if (id == "default") {
 		// The default gui needs to define all window types since we're the
@@ -231,7 +234,7 @@ const std::string& tgui_definition::read(const config& cfg)
                                          *itor +
                                          "'. Perhaps a mismatch between data and source versions."
                                          " Try --data-dir <trunk-dir>" );
-			VALIDATE(window_types.find(*itor) != window_types.end(), error_msg );
+			VALIDATE(window_types.find(*itor) != window_types.end() || window_in_archive(*itor), error_msg );
 		}
 	}
 
@@ -316,6 +319,62 @@ const std::string& tgui_definition::read(const config& cfg)
 	return id;
 }
 
+bool tgui_definition::window_in_archive(const std::string& type) const
+{
+	if (gui_block_ == -1) {
+		return false;
+	}
+	const std::vector<int> blocks = archive_->find_all("window", utils::split_app_prefix_id(type).second);
+	for (std::vector<int>::const_iterator it = blocks.begin(); it != blocks.end(); ++ it) {
+		if (archive_->blocks()[*it].parent == gui_block_) {
+			return true;
+		}
+	}
+	return false;
+}
+
+const twindow_builder* tgui_definition::window_builder(const std::string& type)
+{
+	std::map<std::string, twindow_builder>::const_iterator window = window_types.find(type);
+	if (window != window_types.end()) {
+		return &window->second;
+	}
+	if (gui_block_ == -1) {
+		return NULL;
+	}
+
+	const std::pair<std::string, std::string> app_id = utils::split_app_prefix_id(type);
+	for (int retry = 0; retry < 2; retry ++) {
+		const std::vector<int> blocks = archive_->find_all("window", app_id.second);
+		bool changed = false;
+		for (std::vector<int>::const_iterator it = blocks.begin(); it != blocks.end(); ++ it) {
+			if (archive_->blocks()[*it].parent != gui_block_) {
+				continue;
+			}
+			config cfg;
+			if (!archive_->child(*it, cfg)) {
+				changed = true;
+				break;
+			}
+			if (cfg["app"].str() == app_id.first) {
+				std::pair<std::string, twindow_builder> child;
+				child.first = child.second.read(cfg);
+				return &window_types.insert(child).first->second;
+			}
+		}
+		if (!changed) {
+			break;
+		}
+		// gui.bin is written again, for example studio builds it. window is read from new one.
+		archive_.reset(new txwml_archive(archive_->fname()));
+		gui_block_ = archive_->find("gui", id);
+		if (gui_block_ == -1) {
+			break;
+		}
+	}
+	return NULL;
+}
+
 void tgui_definition::activate() const
 {
 	settings::double_click_time = double_click_time_;
@@ -383,9 +442,17 @@ void load_settings()
 	twindow::update_screen_size();
 
 	// Read file.
+	const std::string fname = game_config::path + "/xwml/" + "gui.bin";
 	config cfg;
+	boost::shared_ptr<txwml_archive> archive(new txwml_archive(fname));
 	try {
-		wml_config_from_file(game_config::path + "/xwml/" + "gui.bin", cfg);
+		if (archive->valid()) {
+			// [window]s are most of gui.bin, but an app builds only some of them.
+			archive->to_config(cfg, "window");
+		} else {
+			archive.reset();
+			wml_config_from_file(fname, cfg);
+		}
 
 	} catch(config::error&) {
 		VALIDATE(false, "Setting: could not read file 'data/gui/default.cfg'");
@@ -395,7 +462,7 @@ void load_settings()
 	const config& gui_cfg = cfg.child("gui");
 	VALIDATE(gui_cfg, _("No gui defined."));
 
-	gui.read(gui_cfg);
+	gui.read(gui_cfg, archive);
 	gui.activate();
 }
 
@@ -485,15 +552,13 @@ std::vector<twindow_builder::tresolution>::const_iterator get_window_builder(con
 {
 	twindow::update_screen_size();
 
-	std::map<std::string, twindow_builder>::const_iterator
-		window = gui.window_types.find(type);
-
-	if (window == gui.window_types.end()) {
+	const twindow_builder* window = gui.window_builder(type);
+	if (!window) {
 		throw twindow_builder_invalid_id();
 	}
 
-	VALIDATE(window->second.resolutions.size() == 1, null_str);
-	return window->second.resolutions.begin();
+	VALIDATE(window->resolutions.size() == 1, null_str);
+	return window->resolutions.begin();
 }
 
 bool valid_control_definition(const std::string& type, const std::string& definition)
@@ -25,10 +25,13 @@
 
 #include <boost/function.hpp>
 #include <boost/foreach.hpp>
+#include <boost/shared_ptr.hpp>
 
 #include <string>
 #include <vector>
 
+class txwml_archive;
+
 namespace gui2 {
 
 
@@ -198,6 +201,8 @@ struct tgui_definition
 		, control_definition()
 		, windows()
 		, window_types()
+		, archive_()
+		, gui_block_(-1)
 		, double_click_time_(0)
 		, sound_button_click_()
 		, sound_toggle_button_click_()
@@ -209,7 +214,14 @@ struct tgui_definition
 	std::string id;
 	t_string description;
 
-	const std::string& read(const config& cfg);
+	/**
+	 * @a cfg is [gui]. if @a archive is there, [window]s that are blocks of it, children of
+	 * block of [gui], aren't in @a cfg, they are read by window_builder when they are built first.
+	 */
+	const std::string& read(const config& cfg, const boost::shared_ptr<txwml_archive>& archive = boost::shared_ptr<txwml_archive>());
+
+	/** Builder of window @a type, NULL if there is none. */
+	const twindow_builder* window_builder(const std::string& type);
 
 	/** Activates a gui. */
 	void activate() const;
@@ -228,6 +240,11 @@ struct tgui_definition
 			  const std::string& definition_type
 			, const std::vector<tcontrol_definition_ptr>& definitions);
 private:
+	/** There is [window] block of @a type, app of it isn't checked. */
+	bool window_in_archive(const std::string& type) const;
+
+	boost::shared_ptr<txwml_archive> archive_;
+	int gui_block_;
 
 	unsigned double_click_time_;
 
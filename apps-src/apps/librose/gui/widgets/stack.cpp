@@ -407,6 +407,15 @@ const twidget* tstack::tgrid2::find(const std::string& id, const bool must_be_ac
 	return NULL;
 }
 
+void tstack::tgrid2::index_ids(tid_index& index)
+{
+	int childs = children_vsize_;
+
+	for (int i = 0; i < childs; ++ i) {
+		children_[i].widget_->index_ids(index);
+	}
+}
+
 void tstack::tgrid2::set_visible_area(const SDL_Rect& area)
 {
 	twidget::set_visible_area(area);
@@ -62,6 +62,7 @@ public:
 
 		twidget* find(const std::string& id, const bool must_be_active) override;
 		const twidget* find(const std::string& id, const bool must_be_active) const override;
+		void index_ids(tid_index& index) override;
 
 	private:
 		void stacked_init();
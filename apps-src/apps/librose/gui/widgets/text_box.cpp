@@ -159,11 +159,12 @@ void ttext_box::set_label(const std::string& text)
 		// so don't call tcontrol::set_label directly.
 		// tcontrol::set_label(result_text);
 		
+		const bool relayout = !label_.empty() && !result_text.empty();
 		label_ = result_text;
 		label_size_.second.x = 0;
 		// update_canvas();
 		// set_dirty();
-		calculate_integrate(get_text_maximum_width());
+		calculate_integrate(get_text_maximum_width(), relayout);
 
 		if (did_text_changed_) {
 			did_text_changed_(*this);
@@ -498,11 +499,19 @@ void ttext_box::insert_str(const std::string& str)
 	}
 
 	SDL_Rect new_start;
-	const std::string& text = integrate_->insert_str(true, selection_start_.x, selection_start_.y, str2, new_start);
+	int new_src_pos;
+	const std::string& text = integrate_->insert_str(true, selection_start_.x, selection_start_.y, str2, new_start, &new_src_pos);
 	if (!cipher_) {
 		new_text = text;
 	}
-	if (!multi_line_ && selection_end_.y == twidget::npos && selection_start_.x != new_start.x) {
+	const int original_x = selection_start_.x;
+	set_label(new_text);
+	if (!integrate_) {
+		return;
+	}
+
+	new_start = integrate_->calculate_cursor(new_src_pos);
+	if (!multi_line_ && selection_end_.y == twidget::npos && original_x != new_start.x) {
 		const int text_maximum_width = tcontrol::get_text_maximum_width();
 		if (new_start.x + xpos_ > text_maximum_width) {
 			xpos_ = -1 * (new_start.x - text_maximum_width);
@@ -511,8 +520,6 @@ void ttext_box::insert_str(const std::string& str)
 	// after delete, start maybe in end outer.
 	selection_start_ = new_start;
 
-	set_label(new_text);
-
 	set_cursor(selection_start_, false);
 }
 
@@ -534,11 +541,14 @@ void ttext_box::insert_img(const std::string& str)
 	
 	std::string str2 = tintegrate::generate_img(str);
 	SDL_Rect new_start;
-	const std::string& text = integrate_->insert_str(false, selection_start_.x, selection_start_.y, str2, new_start);
-	// after delete, start maybe in end outer.
-	selection_start_ = new_start;
-
+	int new_src_pos;
+	const std::string& text = integrate_->insert_str(false, selection_start_.x, selection_start_.y, str2, new_start, &new_src_pos);
 	set_label(text);
+	if (!integrate_) {
+		return;
+	}
+	// after delete, start maybe in end outer.
+	selection_start_ = integrate_->calculate_cursor(new_src_pos);
 
 	set_cursor(selection_start_, false);
 }
@@ -616,14 +626,18 @@ void ttext_box::normalize_start_end(SDL_Rect& start, SDL_Rect& end) const
 	end = normal? selection_end_: selection_start_;
 }
 
-void ttext_box::calculate_integrate(const int maximum_width)
+void ttext_box::calculate_integrate(const int maximum_width, const bool relayout)
 {
-	if (integrate_) {
+	if (relayout && !cipher_ && locator_.empty() && integrate_ && !integrate_->exist_anim() && integrate_->original_maximum_width() == maximum_width) {
+		// typing in large text shouldn't lay out all of it again.
+		integrate_->set_src(label_);
+
+	} else if (integrate_) {
 		delete integrate_;
 		integrate_ = nullptr;
 	}
 	// const int maximum_width = get_text_maximum_width();
-	if (maximum_width > 0) {
+	if (!integrate_ && maximum_width > 0) {
 		uint32_t color = integrate_default_color_;
 		if (!color) {
 			color = theme::text_color_from_index(text_color_tpl_, theme::normal);
@@ -1382,15 +1396,20 @@ void ttext_box::delete_char(const bool backspace)
 	normalize_start_end(start, end);
 
 	SDL_Rect new_start;
-	const std::string& text = integrate_->handle_char(true, start.x, start.y, backspace, new_start);
+	int new_src_pos;
+	const std::string& text = integrate_->handle_char(true, start.x, start.y, backspace, new_start, &new_src_pos);
 	if (!cipher_) {
 		new_text = text;
 	}
 	if (new_text != label()) {
+		set_label(new_text);
+		if (!integrate_) {
+			return;
+		}
+		new_start = integrate_->calculate_cursor(new_src_pos);
 		adjust_xpos_when_delete(new_start);
 
 		selection_start_ = new_start;
-		set_label(new_text);
 		// repoint
 		set_cursor(selection_start_, false);
 	}
@@ -1414,14 +1433,19 @@ void ttext_box::delete_selection()
 	}
 
 	SDL_Rect new_start;
-	const std::string& text = integrate_->handle_selection(start.x, start.y, end.x, end.y, &new_start);
+	int new_src_pos;
+	const std::string& text = integrate_->handle_selection(start.x, start.y, end.x, end.y, &new_start, &new_src_pos);
 	if (!cipher_) {
 		new_text = text;
 	}
-	// after delete, start maybe in end outer.
-	selection_start_ = new_start;
 	clear_selection();
 	set_label(new_text);
+	if (!integrate_) {
+		return;
+	}
+	// after delete, start maybe in end outer.
+	new_start = integrate_->calculate_cursor(new_src_pos);
+	selection_start_ = new_start;
 
 	adjust_xpos_when_delete(new_start);
 	set_cursor(selection_start_, false);
@@ -222,7 +222,8 @@ private:
 	void did_edit_click(twindow& window, const int);
 	uint32_t calculate_cursor_color() const;
 
-	void calculate_integrate(const int maximum_width);
+	// relayout: label_ is edited from non-empty text, integrate_ can lay out only changed paragraphs.
+	void calculate_integrate(const int maximum_width, const bool relayout = false);
 	tpoint get_integrate_size() const;
 	std::string to_password_str(const int chars) const;
 
@@ -19,6 +19,7 @@
 
 #include "gui/auxiliary/widget_definition/tree.hpp"
 #include "gui/auxiliary/window_builder/tree.hpp"
+#include "gui/widgets/listbox.hpp"
 #include "gui/widgets/settings.hpp"
 #include "gui/widgets/tree_node.hpp"
 #include "gui/widgets/window.hpp"
@@ -28,6 +29,7 @@
 #include "posix2.h"
 
 #include <boost/bind.hpp>
+#include <algorithm>
 
 namespace gui2 {
 
@@ -1015,5 +1017,195 @@ void ttree::signal_handler_left_button_down(const event::tevent event)
 	get_window()->keyboard_capture(this);
 }
 
-} // namespace gui2
+ttree_model::ttree_model(tlistbox& list, const boost::function<void (tlistbox& list, ttoggle_panel& widget, const tnode& node)>& did_fill_node)
+	: list_(list)
+	, did_fill_node_(did_fill_node)
+	, root_(nullptr, 0, true)
+	, rows_()
+{
+	VALIDATE(!did_fill_node_.empty(), null_str);
+	// list keeps this fill callback, so model must not be destroyed before list.
+	list_.set_row_model(boost::bind(&ttree_model::fill_row, this, _1, _2, _3), 0);
+}
+
+ttree_model::~ttree_model()
+{
+	erase_children(root_);
+}
+
+void ttree_model::fill_row(tlistbox& list, ttoggle_panel& widget, const int at)
+{
+	did_fill_node_(list, widget, *rows_[at]);
+}
+
+bool ttree_model::visible(const tnode& node) const
+{
+	for (const tnode* parent = node.parent; parent; parent = parent->parent) {
+		if (parent->folded) {
+			return false;
+		}
+	}
+	return true;
+}
+
+void ttree_model::flatten(const tnode& node, std::vector<tnode*>& rows) const
+{
+	rows.push_back(const_cast<tnode*>(&node));
+	if (!node.folded) {
+		for (std::vector<tnode*>::const_iterator it = node.children.begin(); it != node.children.end(); ++ it) {
+			flatten(**it, rows);
+		}
+	}
+}
+
+void ttree_model::erase_children(tnode& node)
+{
+	for (std::vector<tnode*>::const_iterator it = node.children.begin(); it != node.children.end(); ++ it) {
+		erase_children(**it);
+		delete *it;
+	}
+	node.children.clear();
+}
+
+ttree_model::tnode& ttree_model::row_node(const int at) const
+{
+	VALIDATE(at >= 0 && at < (int)rows_.size(), null_str);
+	return *rows_[at];
+}
+
+int ttree_model::node_row(const tnode& node) const
+{
+	if (&node == &root_ || !visible(node)) {
+		return twidget::npos;
+	}
+	std::vector<tnode*>::const_iterator it = std::find(rows_.begin(), rows_.end(), &node);
+	VALIDATE(it != rows_.end(), null_str);
+	return it - rows_.begin();
+}
+
+ttree_model::tnode* ttree_model::cursel() const
+{
+	const ttoggle_panel* cursel = list_.cursel();
+	return cursel && cursel->at() < (int)rows_.size()? rows_[cursel->at()]: nullptr;
+}
+
+void ttree_model::select_node(tnode* node)
+{
+	const int at = node? node_row(*node): twidget::npos;
+	VALIDATE(!node || at != twidget::npos, null_str);
+	list_.select_row(at);
+}
+
+// @selected is node that was selected before rows_ changed.
+void ttree_model::rows_changed(const int changed_at, const tnode* selected)
+{
+	const ttoggle_panel* cursel = list_.cursel();
+	const int selected_at = cursel? cursel->at(): twidget::npos;
+	list_.set_model_rows(rows_.size(), changed_at);
+	if (!selected || selected_at < changed_at) {
+		return;
+	}
+	// row of selected node moved or is folded, panel of cursel must follow node.
+	const int at = node_row(*selected);
+	if (at != selected_at) {
+		list_.select_row(at);
+	}
+}
+
+ttree_model::tnode& ttree_model::insert_node(tnode& parent, const size_t cookie, const bool branch, int at)
+{
+	VALIDATE(parent.branch, null_str);
+	if (at == twidget::npos || at > (int)parent.children.size()) {
+		at = parent.children.size();
+	}
+	const tnode* selected = cursel();
+
+	tnode* node = new tnode(&parent, cookie, branch);
+	int row = twidget::npos;
+	if (visible(*node)) {
+		// next to last row of previous sibling's subtree, or parent's row when it is first child.
+		const tnode* prev = &parent;
+		if (at) {
+			prev = parent.children[at - 1];
+			while (!prev->folded && !prev->children.empty()) {
+				prev = prev->children.back();
+			}
+		}
+		row = prev == &root_? 0: node_row(*prev) + 1;
+	}
+	parent.children.insert(parent.children.begin() + at, node);
+
+	if (row != twidget::npos) {
+		rows_.insert(rows_.begin() + row, node);
+		rows_changed(row, selected);
+	}
+	return *node;
+}
+
+void ttree_model::erase_node(tnode& node)
+{
+	VALIDATE(&node != &root_, null_str);
+	const tnode* selected = cursel();
+	for (const tnode* it = selected; it; it = it->parent) {
+		if (it == &node) {
+			list_.select_row(twidget::npos);
+			selected = nullptr;
+			break;
+		}
+	}
 
+	const int row = node_row(node);
+	if (row != twidget::npos) {
+		std::vector<tnode*> rows;
+		flatten(node, rows);
+		rows_.erase(rows_.begin() + row, rows_.begin() + row + rows.size());
+	}
+	std::vector<tnode*>& siblings = node.parent->children;
+	siblings.erase(std::find(siblings.begin(), siblings.end(), &node));
+	erase_children(node);
+	delete &node;
+
+	if (row != twidget::npos) {
+		rows_changed(row, selected);
+	}
+}
+
+void ttree_model::clear()
+{
+	if (list_.cursel()) {
+		list_.select_row(twidget::npos);
+	}
+	erase_children(root_);
+	rows_.clear();
+	list_.set_model_rows(0, 0);
+}
+
+void ttree_model::set_folded(tnode& node, const bool folded)
+{
+	VALIDATE(node.branch && &node != &root_, null_str);
+	if (node.folded == folded) {
+		return;
+	}
+	const tnode* selected = cursel();
+
+	node.folded = false;
+	std::vector<tnode*> children;
+	for (std::vector<tnode*>::const_iterator it = node.children.begin(); it != node.children.end(); ++ it) {
+		flatten(**it, children);
+	}
+	node.folded = folded;
+
+	// node under folded branch has no row, only its state changes.
+	const int row = node_row(node);
+	if (row == twidget::npos || children.empty()) {
+		return;
+	}
+	if (folded) {
+		rows_.erase(rows_.begin() + row + 1, rows_.begin() + row + 1 + children.size());
+	} else {
+		rows_.insert(rows_.begin() + row + 1, children.begin(), children.end());
+	}
+	rows_changed(row + 1, selected);
+}
+
+} // namespace gui2
@@ -22,6 +22,8 @@
 
 namespace gui2 {
 
+class tlistbox;
+
 class ttree: public tscroll_container
 {
 	friend struct implementation::tbuilder_tree;
@@ -51,6 +53,7 @@ public:
 
 		twidget* find(const std::string& id, const bool must_be_active) { return nullptr; }
 		const twidget* find(const std::string& id, const bool must_be_active) const { return nullptr; }
+		void index_ids(tid_index& index) override {}
 
 	private:
 		ttree& tree_;
@@ -239,7 +242,75 @@ private:
 	const std::string& get_control_type() const;
 };
 
+/**
+ * Tree mode of a row model listbox.
+ *
+ * Nodes are data only, no widget. Nodes that aren't under a folded branch are
+ * flattened in display order, and they are rows of listbox's row model, so only
+ * nodes in window have panel. Fold, insert and erase change rows from first row
+ * they touch, selected node keeps selected while it has row.
+ */
+class ttree_model
+{
+public:
+	struct tnode
+	{
+		tnode(tnode* parent, const size_t cookie, const bool branch)
+			: parent(parent)
+			, children()
+			, cookie(cookie)
+			, depth(parent? parent->depth + 1: -1)
+			, branch(branch)
+			, folded(false)
+		{}
+
+		tnode* parent;
+		std::vector<tnode*> children;
+		size_t cookie;
+		// root is -1, so top level node is 0.
+		int depth;
+		bool branch;
+		bool folded;
+	};
+
+	/**
+	 * @param list                Listbox that isn't in row model mode.
+	 * @param did_fill_node       Fills panel with data of node.
+	 */
+	ttree_model(tlistbox& list, const boost::function<void (tlistbox& list, ttoggle_panel& widget, const tnode& node)>& did_fill_node);
+	~ttree_model();
+
+	tnode& root() { return root_; }
+
+	tnode& insert_node(tnode& parent, const size_t cookie, const bool branch, int at = twidget::npos);
+	void erase_node(tnode& node);
+	void clear();
+
+	void set_folded(tnode& node, const bool folded);
+
+	int rows() const { return rows_.size(); }
+	tnode& row_node(const int at) const;
+	// twidget::npos if node is under folded branch.
+	int node_row(const tnode& node) const;
+
+	tnode* cursel() const;
+	void select_node(tnode* node);
+
+private:
+	void fill_row(tlistbox& list, ttoggle_panel& widget, const int at);
+	bool visible(const tnode& node) const;
+	void flatten(const tnode& node, std::vector<tnode*>& rows) const;
+	void rows_changed(const int changed_at, const tnode* selected);
+	void erase_children(tnode& node);
+
+private:
+	tlistbox& list_;
+	boost::function<void (tlistbox& list, ttoggle_panel& widget, const tnode& node)> did_fill_node_;
+	tnode root_;
+	// nodes that have row, rows_[n] is node of row n.
+	std::vector<tnode*> rows_;
+};
+
 } // namespace gui2
 
 #endif
-
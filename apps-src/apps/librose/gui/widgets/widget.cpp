@@ -34,6 +34,8 @@ int cfg_2_os_size(const int cfg_size)
 
 const int twidget::npos = -1;
 
+int twidget::tree_generation = 0;
+
 const std::string twidget::tpl_widget_id_prefix = "_tpl_";
 
 bool twidget::is_tpl_widget_id(const std::string& id)
@@ -100,6 +102,8 @@ twidget::twidget()
 
 twidget::~twidget()
 {
+	tree_changed();
+
 	twidget* p = parent();
 	while (p) {
 		fire2(event::NOTIFY_REMOVAL, *p);
@@ -127,6 +131,7 @@ twidget::~twidget()
 void twidget::set_id(const std::string& id)
 {
 	id_ = id;
+	tree_changed();
 }
 
 void twidget::layout_init(bool linked_group_only)
@@ -29,6 +29,7 @@
 
 #include <string>
 #include <cassert>
+#include <unordered_map>
 
 namespace gui2 {
 
@@ -126,6 +127,16 @@ public:
 	static int hdpi_scale;
 	static const int max_effectable_point;
 
+	/**
+	 * Bumped when any widget tree changes: a widget is destroyed, or gets a
+	 * new parent or id. Caches of find results, as id index of twindow, are
+	 * valid while it is the same.
+	 */
+	static int tree_generation;
+	static void tree_changed() { tree_generation ++; }
+
+	typedef std::unordered_map<std::string, twidget*> tid_index;
+
 	enum tdrag_direction { drag_none, drag_left = 0x1, drag_right = 0x2, drag_up = 0x4, drag_down = 0x8, drag_track = 0x10};
 	enum tmouse_event {mouse_down, mouse_leave, mouse_motion};
 
@@ -322,6 +333,22 @@ public:
 			const bool /*must_be_active*/) const
 		{ return id_ == id ? this : 0; }
 
+	/**
+	 * Adds the widgets that find visits to the index.
+	 *
+	 * Classes that override find override this too and visit in the same
+	 * order. An id that is already in the index keeps its widget, as find
+	 * returns the first one, so the index gives what find(id, false) gives.
+	 *
+	 * @param index               The index to add to, empty ids are skipped.
+	 */
+	virtual void index_ids(tid_index& index)
+	{
+		if (!id_.empty()) {
+			index.insert(std::make_pair(id_, this));
+		}
+	}
+
 	/**
 	 * Does the widget contain the widget.
 	 *
@@ -372,7 +399,11 @@ public:
 	/***** ***** ***** setters / getters for members ***** ****** *****/
 
 	twidget* parent() const { return parent_; }
-	void set_parent(twidget* parent) { parent_ = parent; }
+	void set_parent(twidget* parent)
+	{
+		parent_ = parent;
+		tree_changed();
+	}
 
 	const std::string& id() const { return id_; }
 	void set_id(const std::string& id);
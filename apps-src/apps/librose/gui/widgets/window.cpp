@@ -34,6 +34,7 @@
 #include <preferences.hpp>
 #include "preferences_display.hpp"
 #include "video.hpp"
+#include "render_target_pool.hpp"
 #include "formula_string_utils.hpp"
 #include "hotkeys.hpp"
 
@@ -113,6 +114,86 @@ static void delay_event(const SDL_Event& event, const Uint32 delay)
 	SDL_AddTimer(delay, delay_event_callback, new SDL_Event(event));
 }
 
+/**
+ * Merges a rectangle with damage rectangles.
+ *
+ * Two rectangles are merged only when their union is exactly a rectangle,
+ * so damage doesn't count pixels that no widget redraws.
+ *
+ * @param rects                   The damage rectangles.
+ * @param rect                    The rectangle to merge, must not be empty.
+ */
+static void merge_damage_rect(std::vector<SDL_Rect>& rects, SDL_Rect rect)
+{
+	for (std::vector<SDL_Rect>::iterator it = rects.begin(); it != rects.end(); ) {
+		const SDL_Rect& r = *it;
+		SDL_Rect result;
+		SDL_UnionRect(&r, &rect, &result);
+		if (result == r) {
+			return;
+		}
+		const bool merge = result == rect
+			|| (r.x == rect.x && r.w == rect.w && r.y <= rect.y + rect.h && rect.y <= r.y + r.h)
+			|| (r.y == rect.y && r.h == rect.h && r.x <= rect.x + rect.w && rect.x <= r.x + r.w);
+		if (merge) {
+			// bigger one maybe merge with previous rectangles.
+			rect = result;
+			rects.erase(it);
+			it = rects.begin();
+		} else {
+			++ it;
+		}
+	}
+	rects.push_back(rect);
+}
+
+// pieces of @rect that are out of @cut, at most four.
+static void subtract_rect(const SDL_Rect& rect, const SDL_Rect& cut, std::vector<SDL_Rect>& pieces)
+{
+	SDL_Rect inter;
+	if (!SDL_IntersectRect(&rect, &cut, &inter)) {
+		pieces.push_back(rect);
+		return;
+	}
+	if (inter.y > rect.y) {
+		pieces.push_back(::create_rect(rect.x, rect.y, rect.w, inter.y - rect.y));
+	}
+	if (inter.y + inter.h < rect.y + rect.h) {
+		pieces.push_back(::create_rect(rect.x, inter.y + inter.h, rect.w, rect.y + rect.h - inter.y - inter.h));
+	}
+	if (inter.x > rect.x) {
+		pieces.push_back(::create_rect(rect.x, inter.y, inter.x - rect.x, inter.h));
+	}
+	if (inter.x + inter.w < rect.x + rect.w) {
+		pieces.push_back(::create_rect(inter.x + inter.w, inter.y, rect.x + rect.w - inter.x - inter.w, inter.h));
+	}
+}
+
+/**
+ * Adds a rectangle to damage.
+ *
+ * Damage rectangles never overlap. Part of rect that is damaged already is
+ * cut off, the rest is merged by merge_damage_rect. So every damaged pixel is
+ * restored, redrawn and counted once.
+ *
+ * @param rects                   The damage rectangles.
+ * @param rect                    The rectangle to add, must not be empty.
+ */
+static void add_damage_rect(std::vector<SDL_Rect>& rects, const SDL_Rect& rect)
+{
+	std::vector<SDL_Rect> pieces(1, rect), next;
+	for (std::vector<SDL_Rect>::const_iterator it = rects.begin(); it != rects.end() && !pieces.empty(); ++ it) {
+		next.clear();
+		for (std::vector<SDL_Rect>::const_iterator it2 = pieces.begin(); it2 != pieces.end(); ++ it2) {
+			subtract_rect(*it2, *it, next);
+		}
+		pieces.swap(next);
+	}
+	for (std::vector<SDL_Rect>::const_iterator it = pieces.begin(); it != pieces.end(); ++ it) {
+		merge_damage_rect(rects, *it);
+	}
+}
+
 } // namespace
 
 bool twindow::set_orientation_resolution()
@@ -175,6 +256,14 @@ twindow::twindow(CVideo& video,
 	, invalidate_layout_blocked_(false)
 	, suspend_drawing_(true)
 	, restorer_()
+	, restorer_rect_(empty_rect)
+	, id_index_()
+	, id_index_generation_(-1)
+	, id_index_pending_generation_(-1)
+	, damage_rects_()
+	, damage_stats_()
+	, float_changed_(false)
+	, float_drawn_rects_()
 	, automatic_placement_(automatic_placement)
 	, horizontal_placement_(horizontal_placement)
 	, vertical_placement_(vertical_placement)
@@ -380,8 +469,7 @@ int twindow::show(const bool restore)
 
 		// restore area
 		if (restore) {
-			SDL_Rect rect = get_rect();
-			render_surface(get_renderer(), restorer_, NULL, &rect);
+			restore_rect(restorer_rect_);
 			font::undraw_floating_labels();
 		}
 		throw;
@@ -393,8 +481,7 @@ int twindow::show(const bool restore)
 
 	// restore area
 	if (restore) {
-		SDL_Rect rect = get_rect();
-		render_surface(get_renderer(), restorer_, NULL, &rect);
+		restore_rect(restorer_rect_);
 		font::undraw_floating_labels();
 	}
 
@@ -426,20 +513,14 @@ void twindow::draw()
 		// since all will be redrawn when needed with dirty rects. Since that
 		// doesn't work yet we need to undraw the window.
 		// new rect maybe less than old's.
-		if (restorer_) {
-			SDL_Rect rect = get_rect();
-			render_surface(get_renderer(), restorer_, NULL, &rect);
-			// Since the old area might be bigger as the new one, invalidate it.
-		}
+		restore_rect(restorer_rect_);
 
 		layout();
 
-		// Get new surface for restoring
-		SDL_Rect rect = get_rect();
 		// We want the labels underneath the window so draw them and use them
 		// as restore point.
 		font::draw_floating_labels();
-		restorer_ = get_surface_portion(frame_buffer, rect);
+		save_restorer(frame_buffer, get_rect());
 
 		// Need full redraw so only set ourselves dirty.
 		add_to_dirty_list(std::vector<twidget*>(1, this));
@@ -484,15 +565,25 @@ void twindow::draw()
 */
 	int xsrc = 0, ysrc = 0;
 
-	if (dirty_list_.size() > 5) {
-		int ii = 0;
-	}
-
+	// damage is merged rectangles of dirty widgets, it is what this frame changes.
+	damage_rects_.clear();
+	std::vector<SDL_Rect> dirty_rects;
+	std::vector<twidget*> terminals;
 	BOOST_FOREACH(std::vector<twidget*>& item, dirty_list_) {
 
 		twidget* terminal = item.back();
 
 		const SDL_Rect dirty_rect = terminal->get_dirty_rect();
+		if (SDL_RectEmpty(&dirty_rect)) {
+			// empty rect means no clip to texture_clip_rect_setter, nothing to draw.
+			for (std::vector<twidget*>::iterator itor = item.begin(); itor != item.end(); ++ itor) {
+				(**itor).clear_dirty();
+			}
+			item.clear();
+			dirty_rects.push_back(dirty_rect);
+			terminals.push_back(terminal);
+			continue;
+		}
 
 		for (std::vector<std::unique_ptr<tfloat_widget> >::const_iterator it = float_widgets_.begin(); it != float_widgets_.end(); ++it) {
 			tfloat_widget& item = *(it->get());
@@ -515,28 +606,13 @@ void twindow::draw()
 			
 		}
 
-		texture_clip_rect_setter clip(&dirty_rect);
 		/*
-		 * The actual update routine does the following:
-		 * - Restore the background.
-		 *
-		 * - draw [begin, end) the back ground of all widgets.
-		 *
-		 * - draw the children of the last item in the list, if this item is
-		 *   a container it's children get a full redraw. If it's not a
-		 *   container nothing happens.
-		 *
-		 * - draw [rbegin, rend) the fore ground of all widgets. For items
-		 *   which have two layers eg window or panel it draws the foreground
-		 *   layer. For other widgets it's a nop.
-		 *
 		 * Before drawing there needs to be determined whether a dirty widget
 		 * really needs to be redrawn. If the widget doesn't need to be
 		 * redrawing either being not VISIBLE or has status NOT_DRAWN. If
 		 * it's not drawn it's still set not dirty to avoid it keep getting
 		 * on the dirty list.
 		 */
-
 		for (std::vector<twidget*>::iterator itor = item.begin(); itor != item.end(); ++itor) {
 			if ((**itor).get_visible() != twidget::VISIBLE || (**itor).get_drawing_action() == twidget::NOT_DRAWN) {
 
@@ -549,35 +625,73 @@ void twindow::draw()
 				break;
 			}
 		}
+		dirty_rects.push_back(dirty_rect);
+		terminals.push_back(terminal);
+
+		SDL_Rect rect;
+		if (SDL_IntersectRect(&dirty_rect, &window_rect, &rect)) {
+			add_damage_rect(damage_rects_, rect);
+		}
+	}
+
+	damage_stats_.frames ++;
+	damage_stats_.rects = damage_rects_.size();
+	damage_stats_.pixels = 0;
+	damage_stats_.window_pixels = window_rect.w * window_rect.h;
+	for (std::vector<SDL_Rect>::const_iterator it = damage_rects_.begin(); it != damage_rects_.end(); ++ it) {
+		damage_stats_.pixels += it->w * it->h;
+	}
+	damage_stats_.total_pixels += damage_stats_.pixels;
+	if (damage_rects_.empty()) {
+		damage_stats_.idle_frames ++;
+	}
 
+	/*
+	 * The actual update routine does the following, for every damage rect:
+	 * - Restore the background of this rect, once.
+	 *
+	 * For every dirty widget that intersects this rect, clipped to the
+	 * intersection:
+	 * - draw [begin, end) the back ground of all widgets.
+	 *
+	 * - draw the children of the last item in the list, if this item is
+	 *   a container it's children get a full redraw. If it's not a
+	 *   container nothing happens.
+	 *
+	 * Widget whose rect spans several damage rects is drawn in every one
+	 * of them, its canvas is rendered at the first and copied after, so
+	 * dirty flags are cleared only when all damage rects are drawn.
+	 */
+	for (std::vector<SDL_Rect>::const_iterator damage = damage_rects_.begin(); damage != damage_rects_.end(); ++ damage) {
+		texture_clip_rect_setter damage_clip(&*damage);
 		if (!is_scene()) {
-			// Restore.
-			render_surface(get_renderer(), restorer_, NULL, &window_rect);
+			restore_rect(*damage);
 		}
 
-		/**
-		 * @todo Remove the if an always use the true branch.
-		 *
-		 * When removing that code the draw functions with only a frame_buffer
-		 * as parameter should also be removed since they will be unused from
-		 * that moment.
-		 */
+		for (size_t at = 0; at < dirty_list_.size(); at ++) {
+			std::vector<twidget*>& item = dirty_list_[at];
+			SDL_Rect clip_rect;
+			if (item.empty() || !SDL_IntersectRect(&dirty_rects[at], &*damage, &clip_rect)) {
+				continue;
+			}
+			texture_clip_rect_setter clip(&clip_rect);
 
-		// Background.
-		for (std::vector<twidget*>::iterator itor = item.begin(); itor != item.end(); ++ itor) {
-			twidget* widget = *itor;
+			// Background.
+			for (std::vector<twidget*>::iterator itor = item.begin(); itor != item.end(); ++ itor) {
+				twidget* widget = *itor;
 
-			widget->draw_background(frame_buffer, xsrc, ysrc);
+				widget->draw_background(frame_buffer, xsrc, ysrc);
 
-			if (widget == terminal) {
-				widget->draw_children(frame_buffer, xsrc, ysrc);
+				if (widget == terminals[at]) {
+					widget->draw_children(frame_buffer, xsrc, ysrc);
+				}
 			}
 		}
+	}
 
-		// Foreground.
-		for (std::vector<twidget*>::reverse_iterator ritor = item.rbegin(); ritor != item.rend(); ++ritor) {
-			twidget& widget = **ritor;
-			widget.clear_dirty();
+	BOOST_FOREACH(std::vector<twidget*>& item, dirty_list_) {
+		for (std::vector<twidget*>::iterator itor = item.begin(); itor != item.end(); ++ itor) {
+			(**itor).clear_dirty();
 		}
 	}
 
@@ -692,12 +806,50 @@ std::vector<std::vector<twidget*> >& twindow::dirty_list()
 
 void twindow::undraw()
 {
-	if(restorer_) {
-		SDL_Rect rect = get_rect();
-		render_surface(get_renderer(), restorer_, NULL, &rect);
-		// Since the old area might be bigger as the new one, invalidate
-		// it.
+	restore_rect(restorer_rect_);
+}
+
+void twindow::save_restorer(const texture& frame_buffer, const SDL_Rect& rect)
+{
+	// give back previous first, same size one can be reused.
+	restorer_ = nullptr;
+	restorer_rect_ = empty_rect;
+
+	uint32_t format;
+	int frame_buffer_width, frame_buffer_height;
+	SDL_QueryTexture(frame_buffer.get(), &format, NULL, &frame_buffer_width, &frame_buffer_height);
+	const SDL_Rect frame_buffer_rect = ::create_rect(0, 0, frame_buffer_width, frame_buffer_height);
+	SDL_Rect clip;
+	if (!SDL_IntersectRect(&rect, &frame_buffer_rect, &clip)) {
+		return;
 	}
+
+	SDL_Renderer* renderer = get_renderer();
+	restorer_ = trender_target_pool::singleton().lease(renderer, format, clip.w, clip.h);
+	if (!restorer_.get()) {
+		return;
+	}
+	SDL_SetTextureBlendMode(restorer_.get(), SDL_BLENDMODE_NONE);
+
+	// copy on GPU, no read back.
+	texture_clip_rect_setter clip_setter(NULL);
+	{
+		trender_target_lock lock(renderer, restorer_);
+		ttexture_blend_none_lock lock2(frame_buffer);
+		const SDL_Rect dst = ::create_rect(0, 0, clip.w, clip.h);
+		SDL_RenderCopy(renderer, frame_buffer.get(), &clip, &dst);
+	}
+	restorer_rect_ = clip;
+}
+
+void twindow::restore_rect(const SDL_Rect& rect)
+{
+	SDL_Rect clip;
+	if (!restorer_.get() || !SDL_IntersectRect(&rect, &restorer_rect_, &clip)) {
+		return;
+	}
+	const SDL_Rect src = ::create_rect(clip.x - restorer_rect_.x, clip.y - restorer_rect_.y, clip.w, clip.h);
+	SDL_RenderCopy(get_renderer(), restorer_.get(), &src, &clip);
 }
 
 twindow::tinvalidate_layout_blocker::tinvalidate_layout_blocker(twindow& window)
@@ -789,6 +941,9 @@ twidget* twindow::find_at(const tpoint& coordinate, const bool must_be_active)
 
 twidget* twindow::find(const std::string& id, const bool must_be_active)
 { 
+	if (!must_be_active && !id.empty()) {
+		return find_indexed(id);
+	}
 	twidget* result = float_widget_find(id, must_be_active);
 	if (result) {
 		return result;
@@ -805,6 +960,31 @@ const twidget* twindow::find(const std::string& id, const bool must_be_active) c
 	return tcontainer_::find(id, must_be_active); 
 }
 
+void twindow::index_ids(tid_index& index)
+{
+	for (std::vector<std::unique_ptr<tfloat_widget> >::const_iterator it = float_widgets_.begin(); it != float_widgets_.end(); ++it) {
+		(*it)->widget->index_ids(index);
+	}
+	tcontainer_::index_ids(index);
+}
+
+twidget* twindow::find_indexed(const std::string& id)
+{
+	if (id_index_generation_ != tree_generation) {
+		if (id_index_pending_generation_ != tree_generation) {
+			id_index_pending_generation_ = tree_generation;
+			twidget* result = float_widget_find(id, false);
+			return result? result: tcontainer_::find(id, false);
+		}
+		id_index_.clear();
+		index_ids(id_index_);
+		id_index_generation_ = tree_generation;
+	}
+
+	tid_index::const_iterator it = id_index_.find(id);
+	return it != id_index_.end()? it->second: nullptr;
+}
+
 // @ true: in widget and not on float_widget.
 bool twindow::point_in_normal_widget(const int x, const int y, const twidget& widget) const
 {
@@ -1201,6 +1381,9 @@ void twindow::draw_float_widgets()
 
 	bool volitile_maybe_dirty = false;
 	int at = 0;
+	// when nothing changed and same rects are drawn, screen is same as last presented.
+	bool changed = false;
+	std::vector<SDL_Rect> drawn_rects;
 
 	for (std::vector<std::unique_ptr<tfloat_widget> >::const_iterator it = float_widgets_.begin(); it != float_widgets_.end(); ++it, at ++) {
 		tfloat_widget& item = *(it->get());
@@ -1315,6 +1498,7 @@ void twindow::draw_float_widgets()
 			if (SDL_RectEmpty(&clip)) {
 				// reason same as size.x <= 0/size.y <= 0.
 				buf = nullptr;
+				float_changed_ = true;
 				return;
 			}
             
@@ -1340,6 +1524,7 @@ void twindow::draw_float_widgets()
 
 			ref->associate_float_widget(item, true);
 			item.need_layout = false;
+			changed = true;
 			if (at != tooltip_at_) {
 				volitile_maybe_dirty = true;
 			}
@@ -1348,6 +1533,7 @@ void twindow::draw_float_widgets()
 		if (widget.get_dirty() || widget.get_redraw()) {
 			canvas = widget.get_canvas_tex();
 			widget.clear_dirty();
+			changed = true;
 		}
 
 		if (!rects.empty()) {
@@ -1382,8 +1568,12 @@ void twindow::draw_float_widgets()
 			srcrect.h = dstrect.h;
 		}
 		SDL_RenderCopy(renderer, canvas.get(), &srcrect, &dstrect);
+		drawn_rects.push_back(dstrect);
 	}
 
+	float_changed_ = changed || drawn_rects != float_drawn_rects_;
+	float_drawn_rects_.swap(drawn_rects);
+
 	if (volitile_maybe_dirty && scene_) {
 		set_main_map_volatiles();
 	}
@@ -1478,6 +1668,8 @@ void twindow::clear_texture()
 		item.buf = nullptr;
 		item.canvas = nullptr;
 	}
+	restorer_ = nullptr;
+	restorer_rect_ = empty_rect;
 	tpanel::clear_texture();
 }
 
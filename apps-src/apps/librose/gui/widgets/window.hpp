@@ -216,6 +216,36 @@ public:
 	 */
 	void undraw();
 
+	/**
+	 * Damage of draw calls.
+	 *
+	 * draw merges rectangles of dirty widgets to damage rects that don't
+	 * overlap. every damage rect is restored once, and dirty widgets that
+	 * intersect it are redrawn clipped to it. pixels counts every pixel once.
+	 */
+	struct tdamage_stats
+	{
+		tdamage_stats()
+			: frames(0)
+			, idle_frames(0)
+			, rects(0)
+			, pixels(0)
+			, window_pixels(0)
+			, total_pixels(0)
+		{}
+
+		int frames;
+		int idle_frames; // frames that redrew nothing.
+		int rects; // of last frame.
+		int pixels; // of last frame.
+		int window_pixels;
+		int64_t total_pixels;
+	};
+	const tdamage_stats& damage_stats() const { return damage_stats_; }
+
+	// last draw or draw_float_widgets changed screen. if false, the presented frame is still valid.
+	bool frame_damaged() const { return scene_ || damage_stats_.rects || float_changed_; }
+
 	/**
 	 * Adds an item to the dirty_list_.
 	 *
@@ -288,12 +318,30 @@ public:
 	/** Inherited from tevent_handler. */
 	twidget* find_at(const tpoint& coordinate, const bool must_be_active) override;
 
-	/** Inherited from tcontainer_. */
+	/**
+	 * Inherited from tcontainer_.
+	 *
+	 * When must_be_active is false, the widget comes from the id index.
+	 */
 	twidget* find(const std::string& id, const bool must_be_active) override;
 
 	/** Inherited from tcontainer_. */
 	const twidget* find(const std::string& id, const bool must_be_active) const override;
 
+	/** Inherited from tcontainer_. */
+	void index_ids(tid_index& index) override;
+
+	/**
+	 * Gets the widget that find(id, false) returns, through the id index.
+	 *
+	 * The index maps every id in the window to its widget, it is rebuilt
+	 * in one walk of the tree when twidget::tree_generation has changed.
+	 * While the tree keeps changing, e.g. rows are being added, lookups
+	 * walk the tree as before, the index is built on the second lookup
+	 * without a change between.
+	 */
+	twidget* find_indexed(const std::string& id);
+
 	/**
 	 * Does the window close easily?
 	 *
@@ -484,6 +532,9 @@ public:
 
 private:
 	void layout_init(bool linked_group_only) override;
+
+	void save_restorer(const texture& frame_buffer, const SDL_Rect& rect);
+	void restore_rect(const SDL_Rect& rect);
 	void dirty_under_rect(const SDL_Rect& clip) override;
 
 	void click_edit_button(const int id);
@@ -519,8 +570,23 @@ private:
 	/** Avoid drawing the window.  */
 	bool suspend_drawing_;
 
-	/** When the window closes this surface is used to undraw the window. */
-	surface restorer_;
+	/**
+	 * When the window closes this texture is used to undraw the window.
+	 *
+	 * It is copied from screen texture at restorer_rect_, leased from
+	 * trender_target_pool.
+	 */
+	texture restorer_;
+	SDL_Rect restorer_rect_;
+
+	tid_index id_index_;
+	int id_index_generation_;
+	int id_index_pending_generation_;
+
+	std::vector<SDL_Rect> damage_rects_;
+	tdamage_stats damage_stats_;
+	bool float_changed_;
+	std::vector<SDL_Rect> float_drawn_rects_;
 
 	/** Do we wish to place the widget automatically? */
 	const bool automatic_placement_;
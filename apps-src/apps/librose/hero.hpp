@@ -805,6 +805,68 @@ private:
 	uint16_t map_vsize_;
 };
 
+//
+// heros file mapped to memory. records are accessed in place as hero_fields_t, no hero is constructed.
+// file is mapped copy-on-write, only pages that update writes take private memory. update marks
+// pages of record dirty, and flush writes dirty pages back to file.
+// number is index of record in file, same as hero_map's when file is written by map_to_file.
+//
+class thero_store
+{
+public:
+	enum {COLUMN_SIDE, COLUMN_CITY, COLUMN_FEATURE, COLUMN_LEADERSHIP, COLUMN_FORCE, COLUMN_INTELLECT,
+		COLUMN_SPIRIT, COLUMN_CHARM, COLUMN_COUNT};
+	static const int page_size = 4096;
+
+	explicit thero_store(const std::string& fname);
+	~thero_store();
+
+	bool valid() const { return data_ != NULL; }
+	// records in file, include invalid ones.
+	int size() const { return size_; }
+	bool mapped() const { return mapped_; }
+
+	const hero_fields_t& fields(int number) const;
+	// for code that needs hero.
+	hero to_hero(int number) const;
+
+	// write @fields to record in place, columns that are built are updated.
+	void update(int number, const hero_fields_t& fields);
+	// write dirty pages to file. false if file cannot be written.
+	bool flush();
+	int dirty_pages() const;
+
+	// numbers of valid records whose value of @column is in [min, max]. result is ascending, so results
+	// of columns can be intersected by std::set_intersection.
+	// stat columns keep fixed-point value, min/max of them are integers, as fxptoi9 returns.
+	// column is built at first select that uses it.
+	void select(int column, int min, int max, std::vector<int>& result) const;
+
+private:
+	thero_store(const thero_store&);
+	void operator=(const thero_store&);
+
+	static int column_value(const hero_fields_t& fields, int column);
+	const std::vector<uint32_t>& column(int column) const;
+	void map_file();
+	void unmap_file();
+
+private:
+	std::string fname_;
+	uint8_t* data_;
+	uint32_t file_size_;
+	bool mapped_;
+#ifdef _WIN32
+	void* map_handle_;
+#endif
+	int size_;
+	std::vector<bool> dirty_;
+
+	// (value << 16) | number of valid records, sorted.
+	mutable std::vector<uint32_t> columns_[COLUMN_COUNT];
+	mutable bool built_[COLUMN_COUNT];
+};
+
 //
 // group section
 //
@@ -7,6 +7,15 @@
 #include "rose_config.hpp"
 #include "integrate.hpp"
 
+#include <algorithm>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
 hero hero_invalid = hero(HEROS_INVALID_NUMBER);
 
 hero_map::iterator hero_map_iter_invalid = hero_map::iterator(HEROS_INVALID_NUMBER, NULL);
@@ -1601,56 +1610,31 @@ void hero_map::erase(const uint16_t number)
 
 bool hero_map::map_from_file(const std::string& fname)
 {
-	posix_file_t fp = INVALID_FILE;
-	int64_t fsize, rdpos;
-	uint8_t* fdata = NULL;
-	uint32_t data_size;
-	bool fok = false;
-
-	posix_fopen(fname.c_str(), GENERIC_READ, OPEN_EXISTING, fp);
-	if (fp == INVALID_FILE) {
-		goto exit;
-	}
-	fsize = posix_fsize(fp);
-	if (fsize < HEROS_FILE_PREFIX_BYTES) {
-		goto exit;
-	}
-	fdata = (uint8_t*)malloc(fsize);
-	if (!fdata) {
-		goto exit;
+	// records are read from mapped file, no copy of whole file.
+	thero_store store(fname);
+	if (!store.valid()) {
+		return false;
 	}
-	posix_fseek(fp, HEROS_FILE_PREFIX_BYTES);
-	data_size = posix_fread(fp, fdata, fsize - HEROS_FILE_PREFIX_BYTES);
 
-	rdpos = 0;
 	// realloc map memory in hero_map
 	realloc_hero_map(HEROS_MAX_HEROS);
-	while (rdpos + HEROS_BYTES_PER_HERO <= data_size) {
-		hero h(fdata + rdpos);
+	for (int number = 0; number < store.size(); number ++) {
+		// invalid record is skipped in place, only valid ones are constructed.
+		const hero_fields_t& fields = store.fields(number);
+		if (fields.number_ == HEROS_INVALID_NUMBER) {
+			continue;
+		}
+		hero h((const uint8_t*)&fields);
 
 		if (!h.check_valid()) {
 			std::stringstream strstr;
 			strstr << h.name() << "'s set is invalid!";
 			posix_print_mb(utf8_2_ansi(strstr.str().c_str()));
 		}
-		
-		if (h.valid()) {
-			add(h);
-		}
-		rdpos += HEROS_BYTES_PER_HERO;
+		add(h);
 	}
 
-	fok = true;
-
-exit:
-	if (fp != INVALID_FILE) {
-		posix_fclose(fp);
-	}
-	if (fdata) {
-		free(fdata);
-	}
-
-	return fok;
+	return true;
 }
 
 bool hero_map::map_from_file_fp(posix_file_t fp, uint32_t file_offset, uint32_t valid_bytes)
@@ -1859,6 +1843,258 @@ void hero_map::change_language()
 	}
 }
 
+static_assert(sizeof(hero_fields_t) <= HEROS_BYTES_PER_HERO, "record of hero_fields_t is in place");
+
+thero_store::thero_store(const std::string& fname)
+	: fname_(fname)
+	, data_(NULL)
+	, file_size_(0)
+	, mapped_(false)
+#ifdef _WIN32
+	, map_handle_(NULL)
+#endif
+	, size_(0)
+	, dirty_()
+{
+	for (int at = 0; at < COLUMN_COUNT; at ++) {
+		built_[at] = false;
+	}
+	map_file();
+	if (file_size_ < HEROS_FILE_PREFIX_BYTES) {
+		unmap_file();
+		return;
+	}
+	// number is uint16_t, HEROS_INVALID_NUMBER is reserved.
+	size_ = posix_min((file_size_ - HEROS_FILE_PREFIX_BYTES) / HEROS_BYTES_PER_HERO, HEROS_INVALID_NUMBER);
+	dirty_.resize((file_size_ + page_size - 1) / page_size, false);
+}
+
+thero_store::~thero_store()
+{
+	unmap_file();
+}
+
+void thero_store::map_file()
+{
+#ifdef _WIN32
+	int wlen = MultiByteToWideChar(CP_UTF8, 0, fname_.c_str(), -1, NULL, 0);
+	WCHAR *wc = new WCHAR[wlen];
+	MultiByteToWideChar(CP_UTF8, 0, fname_.c_str(), -1, wc, wlen);
+	HANDLE file = CreateFileW(wc, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	delete [] wc;
+
+	if (file != INVALID_HANDLE_VALUE) {
+		LARGE_INTEGER size;
+		if (GetFileSizeEx(file, &size) && size.QuadPart && !size.HighPart) {
+			map_handle_ = CreateFileMapping(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+			if (map_handle_) {
+				data_ = (uint8_t*)MapViewOfFile(map_handle_, FILE_MAP_COPY, 0, 0, 0);
+				if (data_) {
+					file_size_ = size.LowPart;
+					mapped_ = true;
+				} else {
+					CloseHandle(map_handle_);
+					map_handle_ = NULL;
+				}
+			}
+		}
+		CloseHandle(file);
+	}
+#else
+	int fd = open(fname_.c_str(), O_RDONLY);
+	if (fd != -1) {
+		struct stat st;
+		if (!fstat(fd, &st) && st.st_size > 0 && st.st_size <= 0xffffffff) {
+			// private and writable, update doesn't write file until flush.
+			void* addr = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+			if (addr != MAP_FAILED) {
+				data_ = (uint8_t*)addr;
+				file_size_ = st.st_size;
+				mapped_ = true;
+			}
+		}
+		close(fd);
+	}
+#endif
+	if (mapped_) {
+		return;
+	}
+
+	// ex: file is in android's apk. read it to memory by SDL_RWops.
+	tfile lock(fname_, GENERIC_READ, OPEN_EXISTING);
+	if (!lock.valid()) {
+		return;
+	}
+	int64_t fsize = posix_fsize(lock.fp);
+	if (fsize <= 0 || fsize > 0xffffffff) {
+		return;
+	}
+	data_ = (uint8_t*)malloc(fsize);
+	posix_fseek(lock.fp, 0);
+	file_size_ = posix_fread(lock.fp, data_, fsize);
+}
+
+void thero_store::unmap_file()
+{
+	if (!data_) {
+		return;
+	}
+	if (mapped_) {
+#ifdef _WIN32
+		UnmapViewOfFile(data_);
+		CloseHandle(map_handle_);
+		map_handle_ = NULL;
+#else
+		munmap(data_, file_size_);
+#endif
+	} else {
+		free(data_);
+	}
+	data_ = NULL;
+	file_size_ = 0;
+	mapped_ = false;
+	size_ = 0;
+}
+
+const hero_fields_t& thero_store::fields(int number) const
+{
+	VALIDATE(number >= 0 && number < size_, null_str);
+	return *(const hero_fields_t*)(data_ + HEROS_FILE_PREFIX_BYTES + number * HEROS_BYTES_PER_HERO);
+}
+
+hero thero_store::to_hero(int number) const
+{
+	return hero((const uint8_t*)&fields(number));
+}
+
+int thero_store::column_value(const hero_fields_t& fields, int column)
+{
+	switch (column) {
+	case COLUMN_SIDE:
+		return fields.side_;
+	case COLUMN_CITY:
+		return fields.city_;
+	case COLUMN_FEATURE:
+		return fields.feature_;
+	case COLUMN_LEADERSHIP:
+		return fields.leadership_;
+	case COLUMN_FORCE:
+		return fields.force_;
+	case COLUMN_INTELLECT:
+		return fields.intellect_;
+	case COLUMN_SPIRIT:
+		return fields.spirit_;
+	case COLUMN_CHARM:
+		return fields.charm_;
+	}
+	VALIDATE(false, null_str);
+	return 0;
+}
+
+const std::vector<uint32_t>& thero_store::column(int column) const
+{
+	VALIDATE(column >= 0 && column < COLUMN_COUNT, null_str);
+	std::vector<uint32_t>& keys = columns_[column];
+	if (!built_[column]) {
+		keys.clear();
+		keys.reserve(size_);
+		for (int number = 0; number < size_; number ++) {
+			const hero_fields_t& f = fields(number);
+			if (f.number_ != HEROS_INVALID_NUMBER) {
+				keys.push_back(((uint32_t)column_value(f, column) << 16) | number);
+			}
+		}
+		std::sort(keys.begin(), keys.end());
+		built_[column] = true;
+	}
+	return keys;
+}
+
+void thero_store::select(int column, int min, int max, std::vector<int>& result) const
+{
+	result.clear();
+	if (column >= COLUMN_LEADERSHIP) {
+		min = min > 0? posix_min(min, 0xffff) << fxp9_shift: 0;
+		max = max >= 0? ((posix_min(max, 0xffff >> fxp9_shift) + 1) << fxp9_shift) - 1: -1;
+	}
+	min = posix_max(min, 0);
+	max = posix_min(max, 0xffff);
+	if (min > max) {
+		return;
+	}
+	const std::vector<uint32_t>& keys = thero_store::column(column);
+	std::vector<uint32_t>::const_iterator first = std::lower_bound(keys.begin(), keys.end(), (uint32_t)min << 16);
+	std::vector<uint32_t>::const_iterator last = std::upper_bound(first, keys.end(), ((uint32_t)max << 16) | 0xffff);
+	result.reserve(last - first);
+	for (std::vector<uint32_t>::const_iterator it = first; it != last; ++ it) {
+		result.push_back(*it & 0xffff);
+	}
+	std::sort(result.begin(), result.end());
+}
+
+void thero_store::update(int number, const hero_fields_t& fields)
+{
+	const hero_fields_t& old = thero_store::fields(number);
+	for (int column = 0; column < COLUMN_COUNT; column ++) {
+		if (!built_[column]) {
+			continue;
+		}
+		std::vector<uint32_t>& keys = columns_[column];
+		if (old.number_ != HEROS_INVALID_NUMBER) {
+			const uint32_t key = ((uint32_t)column_value(old, column) << 16) | number;
+			std::vector<uint32_t>::iterator it = std::lower_bound(keys.begin(), keys.end(), key);
+			if (it != keys.end() && *it == key) {
+				keys.erase(it);
+			}
+		}
+		if (fields.number_ != HEROS_INVALID_NUMBER) {
+			const uint32_t key = ((uint32_t)column_value(fields, column) << 16) | number;
+			keys.insert(std::lower_bound(keys.begin(), keys.end(), key), key);
+		}
+	}
+
+	const uint32_t offset = HEROS_FILE_PREFIX_BYTES + number * HEROS_BYTES_PER_HERO;
+	memcpy(data_ + offset, &fields, sizeof(hero_fields_t));
+	for (uint32_t page = offset / page_size; page <= (offset + sizeof(hero_fields_t) - 1) / page_size; page ++) {
+		dirty_[page] = true;
+	}
+}
+
+int thero_store::dirty_pages() const
+{
+	return std::count(dirty_.begin(), dirty_.end(), true);
+}
+
+bool thero_store::flush()
+{
+	if (!dirty_pages()) {
+		return true;
+	}
+	tfile lock(fname_, GENERIC_WRITE, OPEN_EXISTING);
+	if (!lock.valid()) {
+		return false;
+	}
+	// write every run of dirty pages by one write.
+	const uint32_t pages = dirty_.size();
+	for (uint32_t page = 0; page < pages; page ++) {
+		if (!dirty_[page]) {
+			continue;
+		}
+		uint32_t end = page;
+		while (end < pages && dirty_[end]) {
+			dirty_[end ++] = false;
+		}
+		const uint32_t offset = page * page_size;
+		const uint32_t len = posix_min(end * page_size, file_size_) - offset;
+		posix_fseek(lock.fp, offset);
+		if (posix_fwrite(lock.fp, data_ + offset, len) != len) {
+			return false;
+		}
+		page = end;
+	}
+	return true;
+}
+
 namespace upgrade {
 
 std::vector<trequire> require_member, require_noble;
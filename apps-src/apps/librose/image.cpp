@@ -38,173 +38,360 @@
 #include <boost/foreach.hpp>
 #include <boost/functional/hash.hpp>
 
-#include <list>
 #include <set>
 
 static lg::log_domain log_display("display");
 #define ERR_DP LOG_STREAM(err, log_display)
 
-std::list<int> dummy_list;
-
+//
+// byte budgets of every cache. cost of one item is bytes of its pixels plus bookkeeping,
+// so one huge texture costs what it really costs, not same as an icon.
+//
 #if (defined(__APPLE__) && TARGET_OS_IPHONE) || defined(ANDROID)
-const size_t hash_table_size = 6000;
+const size_t images_budget = 32 * 1024 * 1024;
+const size_t unscaled_textures_budget = 64 * 1024 * 1024;
+const size_t masked_textures_budget = 16 * 1024 * 1024;
+const size_t bool_cache_budget = 256 * 1024;
 #else
-const size_t hash_table_size = 30000;
-// const size_t hash_table_size = 6000;
+const size_t images_budget = 128 * 1024 * 1024;
+const size_t unscaled_textures_budget = 256 * 1024 * 1024;
+const size_t masked_textures_budget = 64 * 1024 * 1024;
+const size_t bool_cache_budget = 1024 * 1024;
 #endif
 
-struct hash_node {
-	size_t hash;
-	size_t hash1;
-	int index;
-};
-
 template<typename T>
 struct cache_item
 {
-	cache_item(): 
-		item(), 
-		pos_in_hash_table(-1),
-		position(dummy_list.end())
+	cache_item()
+		: item()
+		, hash(0)
+		, hash1(0)
+		, bytes(0)
+		, used(false)
+		, referenced(false)
 	{}
 
 	T item;
-	int pos_in_hash_table;
-	std::list<int>::iterator position;
+	size_t hash;
+	size_t hash1;
+	size_t bytes;
+	bool used;
+	// CLOCK reference bit. hit only sets it, so there is no list to splice on every access.
+	bool referenced;
 };
 
+static size_t cache_item_bytes(const surface& surf)
+{
+	return surf? sizeof(SDL_Surface) + surf->pitch * surf->h: 0;
+}
+
+static size_t cache_item_bytes(const texture& tex)
+{
+	if (!tex.get()) {
+		return 0;
+	}
+	Uint32 format;
+	int w, h;
+	SDL_QueryTexture(tex.get(), &format, NULL, &w, &h);
+	int bpp = SDL_BYTESPERPIXEL(format);
+	return w * h * (bpp? bpp: 4);
+}
+
+static size_t cache_item_bytes(bool)
+{
+	return 0;
+}
+
 namespace image {
 
+//
+// every cache is split into shards by locator's hash. every shard has its own
+// open-addressing index, item slots and CLOCK hand. index never gives up probing,
+// it deletes by backward shift, so there is no tombstone.
+//
 template<typename T>
 class cache_type
 {
 public:
-	cache_type(bool clear_cookie = true) :
-			cache_max_size_(hash_table_size / 4),
-			lru_list_(),
-			content_(),
-			clear_cookie_(clear_cookie)
-	{
-		// content_.resize(cache_max_size_);
-		content_ = new cache_item<T>[cache_max_size_];
+	enum {shard_bits = 4, shards = 1 << shard_bits};
+
+	cache_type(const char* name, size_t budget, bool clear_cookie = true)
+		: name_(name)
+		, budget_(budget)
+		, clear_cookie_(clear_cookie)
+		, bytes_(0)
+		, items_(0)
+		, evict_shard_(0)
+		, hits_(0)
+		, misses_(0)
+		, evictions_(0)
+	{}
 
-		for (int index = cache_max_size_ - 1; index >= 0; index --) {
-			lru_list_.push_front(index);
-			content_[index].position = lru_list_.begin();
-		}
-		for (int index = 0; index < hash_table_size; index ++) {
-			hash_table_[index].index = -1;
-		}
-	}
-	~cache_type() 
+	void flush(bool force = false)
 	{
-		delete []content_;
-	}
-
-	void flush(bool force = false) 
-	{ 
 		if (force || clear_cookie_) {
-			for (int index = cache_max_size_ - 1; index >= 0; index --) {
-				cache_item<T>& elt = content_[index];
-				if (elt.pos_in_hash_table != -1) {
-					hash_table_[elt.pos_in_hash_table].index = -1;
-					elt.item = NULL;
-				}
-				elt.pos_in_hash_table = -1;
+			for (int at = 0; at < shards; at ++) {
+				tshard empty;
+				std::swap(shards_[at], empty);
 			}
+			bytes_ = 0;
+			items_ = 0;
 		}
 	}
+
+	// return index of item, or -1 if it isn't in cache.
+	int find(size_t hash, size_t hash1);
+	T& at(int index);
 	int add(const T& item, size_t hash, size_t hash1);
 
-	bool verify_pos();
-public:
-	
-	int cache_max_size_;
+	tcache_stats stats() const;
+
+private:
+	struct tshard
+	{
+		tshard()
+			: slots()
+			, free_slots()
+			, table()
+			, items(0)
+			, hand(0)
+		{}
+
+		std::vector<cache_item<T> > slots;
+		std::vector<int> free_slots;
+		// slot index, or -1 if empty. size is power of 2.
+		std::vector<int> table;
+		int items;
+		int hand;
+	};
+
+	// low bits select shard, rest of bits select position in shard's table.
+	static int shard_of(size_t hash) { return hash & (shards - 1); }
+	static size_t home_of(size_t hash) { return hash >> shard_bits; }
+	static size_t entry_overhead() { return sizeof(cache_item<T>) + 2 * sizeof(int); }
+
+	int table_find(const tshard& shard, size_t hash, size_t hash1) const;
+	void table_insert(tshard& shard, int slot);
+	void table_erase(tshard& shard, size_t hash, size_t hash1);
+	void rehash(tshard& shard, size_t size);
+	bool evict_one();
+	void erase_slot(tshard& shard, int slot);
+
+private:
+	const char* name_;
+	size_t budget_;
 	bool clear_cookie_;
-    std::list<int> lru_list_;
-	// std::vector<cache_item<T> > content_;
-	cache_item<T>* content_;
-	hash_node hash_table_[hash_table_size];
+	size_t bytes_;
+	int items_;
+	int evict_shard_;
+	uint64_t hits_;
+	uint64_t misses_;
+	uint64_t evictions_;
+	tshard shards_[shards];
 };
 
 template<typename T>
-bool cache_type<T>::verify_pos()
+int cache_type<T>::table_find(const tshard& shard, size_t hash, size_t hash1) const
+{
+	if (shard.table.empty()) {
+		return -1;
+	}
+	const size_t mask = shard.table.size() - 1;
+	for (size_t pos = home_of(hash) & mask; shard.table[pos] != -1; pos = (pos + 1) & mask) {
+		const cache_item<T>& elt = shard.slots[shard.table[pos]];
+		if (elt.hash == hash && elt.hash1 == hash1) {
+			return shard.table[pos];
+		}
+	}
+	return -1;
+}
+
+template<typename T>
+void cache_type<T>::table_insert(tshard& shard, int slot)
 {
-	size_t valid_in_locator_table, valid_in_content;
+	const size_t mask = shard.table.size() - 1;
+	size_t pos = home_of(shard.slots[slot].hash) & mask;
+	while (shard.table[pos] != -1) {
+		pos = (pos + 1) & mask;
+	}
+	shard.table[pos] = slot;
+}
 
-	valid_in_locator_table = 0;
-	for (int index = 0; index < hash_table_size; index ++) {
-		if (hash_table_[index].index != -1) {
-			valid_in_locator_table ++;
+template<typename T>
+void cache_type<T>::table_erase(tshard& shard, size_t hash, size_t hash1)
+{
+	const size_t mask = shard.table.size() - 1;
+	size_t pos = home_of(hash) & mask;
+	while (true) {
+		const cache_item<T>& elt = shard.slots[shard.table[pos]];
+		if (elt.hash == hash && elt.hash1 == hash1) {
+			break;
 		}
+		pos = (pos + 1) & mask;
 	}
+	// backward shift: move following entries of this cluster into the hole when their home allows.
+	size_t hole = pos;
+	for (size_t next = (hole + 1) & mask; shard.table[next] != -1; next = (next + 1) & mask) {
+		const size_t home = home_of(shard.slots[shard.table[next]].hash) & mask;
+		if (((next - home) & mask) >= ((next - hole) & mask)) {
+			shard.table[hole] = shard.table[next];
+			hole = next;
+		}
+	}
+	shard.table[hole] = -1;
+}
 
-	valid_in_content = 0;
-	for (int index = cache_max_size_ - 1; index >= 0; index --) {
-		cache_item<T>& elt = content_[index];
-		if (elt.pos_in_hash_table != -1) {
-			valid_in_content ++;
+template<typename T>
+void cache_type<T>::rehash(tshard& shard, size_t size)
+{
+	shard.table.assign(size, -1);
+	const size_t mask = size - 1;
+	for (int slot = 0; slot < (int)shard.slots.size(); slot ++) {
+		if (!shard.slots[slot].used) {
+			continue;
+		}
+		size_t pos = home_of(shard.slots[slot].hash) & mask;
+		while (shard.table[pos] != -1) {
+			pos = (pos + 1) & mask;
 		}
+		shard.table[pos] = slot;
 	}
-	return valid_in_locator_table == valid_in_content;
 }
 
 template<typename T>
-int cache_type<T>::add(const T& item, size_t hash, size_t hash1)
+void cache_type<T>::erase_slot(tshard& shard, int slot)
+{
+	cache_item<T>& elt = shard.slots[slot];
+	table_erase(shard, elt.hash, elt.hash1);
+	bytes_ -= elt.bytes;
+	items_ --;
+	shard.items --;
+
+	elt.item = T();
+	elt.used = false;
+	elt.referenced = false;
+	shard.free_slots.push_back(slot);
+}
+
+template<typename T>
+bool cache_type<T>::evict_one()
 {
-	// in hash_table, find a empty position.
-	size_t pos = hash % hash_table_size;
-	while (hash_table_[pos].index != -1) {
-		if (++ pos == hash_table_size) {
-			pos = 0;
+	if (!items_) {
+		return false;
+	}
+	// shards take turns, so pressure spreads over whole cache.
+	while (!shards_[evict_shard_].items) {
+		evict_shard_ = (evict_shard_ + 1) & (shards - 1);
+	}
+	tshard& shard = shards_[evict_shard_];
+	evict_shard_ = (evict_shard_ + 1) & (shards - 1);
+
+	const int size = shard.slots.size();
+	while (true) {
+		if (shard.hand >= size) {
+			shard.hand = 0;
+		}
+		cache_item<T>& elt = shard.slots[shard.hand];
+		if (elt.used) {
+			if (!elt.referenced) {
+				erase_slot(shard, shard.hand ++);
+				evictions_ ++;
+				return true;
+			}
+			elt.referenced = false;
 		}
+		shard.hand ++;
+	}
+}
+
+template<typename T>
+int cache_type<T>::find(size_t hash, size_t hash1)
+{
+	const int shard = shard_of(hash);
+	const int slot = table_find(shards_[shard], hash, hash1);
+	if (slot == -1) {
+		misses_ ++;
+		return -1;
+	}
+	hits_ ++;
+	return (slot << shard_bits) | shard;
+}
+
+template<typename T>
+T& cache_type<T>::at(int index)
+{
+	cache_item<T>& elt = shards_[index & (shards - 1)].slots[index >> shard_bits];
+	elt.referenced = true;
+	return elt.item;
+}
+
+template<typename T>
+int cache_type<T>::add(const T& item, size_t hash, size_t hash1)
+{
+	const int shard_index = shard_of(hash);
+	tshard& shard = shards_[shard_index];
+	const size_t bytes = cache_item_bytes(item) + entry_overhead();
+
+	int slot = table_find(shard, hash, hash1);
+	if (slot != -1) {
+		// i.e. is_empty_hex is re-added when a surface is reloaded.
+		cache_item<T>& elt = shard.slots[slot];
+		bytes_ += bytes - elt.bytes;
+		elt.item = item;
+		elt.bytes = bytes;
+		elt.referenced = true;
+		return (slot << shard_bits) | shard_index;
 	}
 
-	// calcuate index of content_
-	int index = lru_list_.back();
+	// item larger than whole budget is still cached, but alone.
+	while (bytes_ + bytes > budget_ && evict_one());
 
-	cache_item<T>& elt = content_[index];
-	if (elt.pos_in_hash_table != -1) {
-		hash_table_[elt.pos_in_hash_table].index = -1;
+	// keep load factor <= 1/2. must be done before new slot is marked used.
+	if ((shard.items + 1) * 2 > (int)shard.table.size()) {
+		rehash(shard, shard.table.empty()? 64: shard.table.size() * 2);
+	}
+	if (!shard.free_slots.empty()) {
+		slot = shard.free_slots.back();
+		shard.free_slots.pop_back();
+	} else {
+		slot = shard.slots.size();
+		shard.slots.push_back(cache_item<T>());
 	}
+	cache_item<T>& elt = shard.slots[slot];
 	elt.item = item;
-	elt.pos_in_hash_table = pos;
+	elt.hash = hash;
+	elt.hash1 = hash1;
+	elt.bytes = bytes;
+	elt.used = true;
+	// new item has to survive one sweep before it can be evicted.
+	elt.referenced = true;
 
-	lru_list_.erase(elt.position);
-	lru_list_.push_front(index);
-	elt.position = lru_list_.begin();
+	table_insert(shard, slot);
+	shard.items ++;
+	items_ ++;
+	bytes_ += bytes;
 
-	// fill (hash,hash1,index)
-	hash_table_[pos].hash = hash;
-	hash_table_[pos].hash1 = hash1;
-	hash_table_[pos].index = index;
+	return (slot << shard_bits) | shard_index;
+}
 
-	return index;
+template<typename T>
+tcache_stats cache_type<T>::stats() const
+{
+	tcache_stats ret;
+	ret.name = name_;
+	ret.items = items_;
+	ret.bytes = bytes_;
+	ret.budget = budget_;
+	ret.hits = hits_;
+	ret.misses = misses_;
+	ret.evictions = evictions_;
+	return ret;
 }
 
 template <typename T>
 int locator::in_cache(cache_type<T>& cache) const
 {
-	int stop_after_invalids = 4;
-
-	hash_node* hash_table = cache.hash_table_;
-
-	size_t pos = hash_ % hash_table_size;
-	do {
-		while (hash_table[pos].index != -1) {
-			hash_node* node = hash_table + pos;
-			if (node->hash == hash_ && node->hash1 == hash1_) {
-				return node->index;
-			}
-			if (++ pos == hash_table_size) {
-				pos = 0;
-			}
-		}
-		if (++ pos == hash_table_size) {
-			pos = 0;
-		}
-	} while (-- stop_after_invalids);
-	return -1;
+	return cache.find(hash_, hash1_);
 }
 
 template <typename T>
@@ -214,14 +401,7 @@ const T& locator::locate_in_cache(cache_type<T>& cache, int index) const
 	if (index < 0) {
 		return dummy;
 	}
-	std::list<int>& lru_list = cache.lru_list_;
-	cache_item<T>& elt = cache.content_[index];
-	if (index != lru_list.front()) {
-		lru_list.erase(elt.position);
-		lru_list.push_front(index);
-		elt.position = lru_list.begin();
-	}
-	return elt.item;
+	return cache.at(index);
 }
 
 template <typename T>
@@ -307,15 +487,15 @@ ttile_switch_lock::~ttile_switch_lock()
 namespace {
 
 /** Definition of all image maps */
-static image::image_cache images(false);
-static image::texture_cache unscaled_textures;
-static image::texture_cache masked_textures;
+static image::image_cache images("images", images_budget, false);
+static image::texture_cache unscaled_textures("unscaled_textures", unscaled_textures_budget);
+static image::texture_cache masked_textures("masked_textures", masked_textures_budget);
 
 // cache storing if each image fit in a hex
-image::bool_cache in_hex_info_;
+image::bool_cache in_hex_info_("in_hex_info", bool_cache_budget);
 
 // cache storing if this is an empty hex
-image::bool_cache is_empty_hex_;
+image::bool_cache is_empty_hex_("is_empty_hex", bool_cache_budget);
 
 std::map<std::string, bool> image_existence_map;
 
@@ -329,17 +509,18 @@ int red_adjust = 0, green_adjust = 0, blue_adjust = 0;
 /** List of colors used by the TC image modification */
 std::vector<std::string> team_colors;
 
+// compiled image-path modifications, keyed by modification string.
+typedef std::map<std::string, boost::shared_ptr<const image::tmodification_pipeline> > tpipeline_map;
+tpipeline_map pipelines;
+const size_t max_pipelines = 4096;
+image::tpipeline_stats pipeline_stats = {0, 0, 0};
+
 int zoom = image::tile_size;
 
 int cached_zoom = 0;
 
 } // end anon namespace
 
-void image_verify_pos()
-{
-	images.verify_pos();
-}
-
 namespace image {
 /*
 void tblits::clear(bool free_buf)
@@ -419,6 +600,24 @@ void flush_cache(bool force)
 	mini_fogged_terrain_cache.clear();
 	image_existence_map.clear();
 	precached_dirs.clear();
+	// palettes of ~TC/~RC are resolved when compiling, rebuild pipelines with caches.
+	pipelines.clear();
+}
+
+void get_cache_stats(std::vector<tcache_stats>& stats)
+{
+	stats.clear();
+	stats.push_back(images.stats());
+	stats.push_back(unscaled_textures.stats());
+	stats.push_back(masked_textures.stats());
+	stats.push_back(in_hex_info_.stats());
+	stats.push_back(is_empty_hex_.stats());
+}
+
+void get_pipeline_stats(tpipeline_stats& stats, size_t& pipelines_count)
+{
+	stats = pipeline_stats;
+	pipelines_count = pipelines.size();
 }
 
 bool locator::operator==(const locator& a) const 
@@ -721,394 +920,404 @@ surface locator::load_image_file() const
 	return res;
 }
 
-surface locator::load_image_sub_file() const
-{
-	surface surf = get_image(val_.filename_);
-	if (surf == NULL) {
-		return NULL;
-	}
-
-	if (val_.loc_.valid()) {
-		SDL_Rect srcrect = create_rect(
-				((tile_size*3) / 4) * val_.loc_.x
-				, tile_size * val_.loc_.y + (tile_size / 2) * (val_.loc_.x % 2)
-				, tile_size
-				, tile_size);
-
-		if (val_.center_x_ >= 0 && val_.center_y_>= 0){
-			srcrect.x += surf->w/2 - val_.center_x_;
-			srcrect.y += surf->h/2 - val_.center_y_;
-		}
-
-		if ((srcrect.x + tile_size <= 0) || (srcrect.y + tile_size <= 0)) {
-			add_to_cache(is_empty_hex_, true);
-			return NULL;
-		}
-
-		surface cut(cut_surface(surf, srcrect));
-		bool is_empty = false;
-		surf = mask_surface(cut, get_hexmask(), &is_empty);
-		add_to_cache(is_empty_hex_, is_empty);
-	}
+// parse modifications to functions, then fuse them to pipeline.
+static image::tmodification_pipeline* compile_modifications(const std::string& modifications)
+{
+	// The RC functor is very special; it must be applied
+	// before anything else, and it is not accumulative.
+	rc_function rc;
+	// The FL functor is delayed until the end of the sequence.
+	// This allows us to ignore things like ~FL(horiz)~FL(horiz)
+	fl_function fl;
+	// Regular functors
+	std::vector< image::function_base* > functor_queue;
+
+	const std::vector<std::string> modlist = utils::parenthetical_split(modifications,'~');
+
+	BOOST_FOREACH (const std::string& s, modlist) {
+		const std::vector<std::string> tmpmod = utils::parenthetical_split(s);
+		std::vector<std::string>::const_iterator j = tmpmod.begin();
+		while(j!= tmpmod.end()){
+			const std::string function = *j++;
+			if(j == tmpmod.end()){
+				if(function.size()){
+					ERR_DP << "error parsing image modifications: "
+						<< modifications<< "\n";
+				}
+				break;
+			}
+			const std::string field = *j++;
+			typedef std::pair<Uint32,Uint32> rc_entry_type;
+
+			// Team color (TC), a subset of RC's functionality
+			if("TC" == function) {
+				std::vector<std::string> param = utils::split(field,',');
+				if(param.size() < 2) {
+					ERR_DP << "too few arguments passed to the ~TC() function\n";
+					break;
+				}
 
-	if (val_.modifications_.size()){
-		// The RC functor is very special; it must be applied
-		// before anything else, and it is not accumulative.
-		rc_function rc;
-		// The FL functor is delayed until the end of the sequence.
-		// This allows us to ignore things like ~FL(horiz)~FL(horiz)
-		fl_function fl;
-		// Regular functors
-		std::vector< image::function_base* > functor_queue;
-
-		const std::vector<std::string> modlist = utils::parenthetical_split(val_.modifications_,'~');
-
-		BOOST_FOREACH (const std::string& s, modlist) {
-			const std::vector<std::string> tmpmod = utils::parenthetical_split(s);
-			std::vector<std::string>::const_iterator j = tmpmod.begin();
-			while(j!= tmpmod.end()){
-				const std::string function = *j++;
-				if(j == tmpmod.end()){
-					if(function.size()){
-						ERR_DP << "error parsing image modifications: "
-							<< val_.modifications_<< "\n";
-					}
+				int side_n = lexical_cast_default<int>(param[0], -1);
+				std::string team_color;
+				if (side_n < 1) {
+					ERR_DP << "invalid team (" << side_n << ") passed to the ~TC() function\n";
 					break;
 				}
-				const std::string field = *j++;
-				typedef std::pair<Uint32,Uint32> rc_entry_type;
-
-				// Team color (TC), a subset of RC's functionality
-				if("TC" == function) {
-					std::vector<std::string> param = utils::split(field,',');
-					if(param.size() < 2) {
-						ERR_DP << "too few arguments passed to the ~TC() function\n";
-						break;
+				else if (side_n < static_cast<int>(team_colors.size())) {
+					team_color = team_colors[side_n - 1];
+				}
+				else {
+					// This side is not initialized; use default "n"
+					try {
+						team_color = lexical_cast<std::string>(side_n);
+					} catch(bad_lexical_cast const&) {
+						ERR_DP << "bad things happen\n";
 					}
+				}
 
-					int side_n = lexical_cast_default<int>(param[0], -1);
-					std::string team_color;
-					if (side_n < 1) {
-						ERR_DP << "invalid team (" << side_n << ") passed to the ~TC() function\n";
-						break;
+				//
+				// Pass parameters for RC functor
+				//
+				if(game_config::tc_info(param[1]).size()){
+					std::map<Uint32, Uint32> tmp_map;
+					try {
+						color_range const& new_color =
+							game_config::color_info(team_color);
+						std::vector<Uint32> const& old_color =
+							game_config::tc_info(param[1]);
+
+						tmp_map = recolor_range(new_color,old_color);
 					}
-					else if (side_n < static_cast<int>(team_colors.size())) {
-						team_color = team_colors[side_n - 1];
+					catch(config::error const& e) {
+						ERR_DP
+							<< "caught config::error while processing TC: "
+							<< e.message
+							<< '\n';
+						ERR_DP
+							<< "bailing out from TC\n";
+						tmp_map.clear();
 					}
-					else {
-						// This side is not initialized; use default "n"
-						try {
-							team_color = lexical_cast<std::string>(side_n);
-						} catch(bad_lexical_cast const&) {
-							ERR_DP << "bad things happen\n";
-						}
+
+					BOOST_FOREACH (const rc_entry_type& rc_entry, tmp_map) {
+						rc.map()[rc_entry.first] = rc_entry.second;
 					}
+				}
+				else {
+					ERR_DP
+						<< "could not load TC info for '" << param[1] << "' palette\n";
+					ERR_DP
+						<< "bailing out from TC\n";
+				}
 
+			}
+			// Palette recolor (RC)
+			else if("RC" == function) {
+				const std::vector<std::string> recolor_params = utils::split(field,'>');
+				if(recolor_params.size()>1){
 					//
-					// Pass parameters for RC functor
+					// recolor source palette to color range
 					//
-					if(game_config::tc_info(param[1]).size()){
-						std::map<Uint32, Uint32> tmp_map;
-						try {
-							color_range const& new_color =
-								game_config::color_info(team_color);
-							std::vector<Uint32> const& old_color =
-								game_config::tc_info(param[1]);
-
-							tmp_map = recolor_range(new_color,old_color);
-						}
-						catch(config::error const& e) {
-							ERR_DP
-								<< "caught config::error while processing TC: "
-								<< e.message
-								<< '\n';
-							ERR_DP
-								<< "bailing out from TC\n";
-							tmp_map.clear();
-						}
+					std::map<Uint32, Uint32> tmp_map;
+					try {
+						color_range const& new_color =
+							game_config::color_info(recolor_params[1]);
 
-						BOOST_FOREACH (const rc_entry_type& rc_entry, tmp_map) {
-							rc.map()[rc_entry.first] = rc_entry.second;
-						}
+						std::vector<Uint32> const& old_color =
+							game_config::tc_info(recolor_params[0]);
+
+						tmp_map = recolor_range(new_color,old_color);
 					}
-					else {
+					catch (config::error& e) {
 						ERR_DP
-							<< "could not load TC info for '" << param[1] << "' palette\n";
+							<< "caught config::error while processing color-range RC: "
+							<< e.message
+							<< '\n';
 						ERR_DP
-							<< "bailing out from TC\n";
+							<< "bailing out from RC\n";
+						tmp_map.clear();
 					}
 
-				}
-				// Palette recolor (RC)
-				else if("RC" == function) {
-					const std::vector<std::string> recolor_params = utils::split(field,'>');
-					if(recolor_params.size()>1){
-						//
-						// recolor source palette to color range
-						//
-						std::map<Uint32, Uint32> tmp_map;
-						try {
-							color_range const& new_color =
-								game_config::color_info(recolor_params[1]);
-
-							std::vector<Uint32> const& old_color =
-								game_config::tc_info(recolor_params[0]);
-
-							tmp_map = recolor_range(new_color,old_color);
-						}
-						catch (config::error& e) {
-							ERR_DP
-								<< "caught config::error while processing color-range RC: "
-								<< e.message
-								<< '\n';
-							ERR_DP
-								<< "bailing out from RC\n";
-							tmp_map.clear();
-						}
-
-						BOOST_FOREACH (const rc_entry_type& rc_entry, tmp_map) {
-							rc.map()[rc_entry.first] = rc_entry.second;
-						}
+					BOOST_FOREACH (const rc_entry_type& rc_entry, tmp_map) {
+						rc.map()[rc_entry.first] = rc_entry.second;
 					}
-					else {
-						///@Deprecated 1.6 palette switch syntax
-						if(field.find('=') != std::string::npos) {
-							lg::wml_error << "the ~RC() image function cannot be used for palette switch (A=B) in 1.7.x; use ~PAL(A>B) instead\n";
-						}
+				}
+				else {
+					///@Deprecated 1.6 palette switch syntax
+					if(field.find('=') != std::string::npos) {
+						lg::wml_error << "the ~RC() image function cannot be used for palette switch (A=B) in 1.7.x; use ~PAL(A>B) instead\n";
 					}
 				}
-				// Palette switch (PAL)
-				else if("PAL" == function) {
-					const std::vector<std::string> remap_params = utils::split(field,'>');
-					if(remap_params.size() > 1) {
-						std::map<Uint32, Uint32> tmp_map;
-						try {
-							std::vector<Uint32> const& old_palette =
-								game_config::tc_info(remap_params[0]);
-							std::vector<Uint32> const& new_palette =
-								game_config::tc_info(remap_params[1]);
-
-							for(size_t i = 0; i < old_palette.size() && i < new_palette.size(); ++i) {
-								tmp_map[old_palette[i]] = new_palette[i];
-							}
-						}
-						catch(config::error& e) {
-							ERR_DP
-								<< "caught config::error while processing PAL function: "
-								<< e.message
-								<< '\n';
-							ERR_DP
-								<< "bailing out from PAL\n";
-							tmp_map.clear();
-						}
-
-						BOOST_FOREACH (const rc_entry_type& rc_entry, tmp_map) {
-							rc.map()[rc_entry.first] = rc_entry.second;
+			}
+			// Palette switch (PAL)
+			else if("PAL" == function) {
+				const std::vector<std::string> remap_params = utils::split(field,'>');
+				if(remap_params.size() > 1) {
+					std::map<Uint32, Uint32> tmp_map;
+					try {
+						std::vector<Uint32> const& old_palette =
+							game_config::tc_info(remap_params[0]);
+						std::vector<Uint32> const& new_palette =
+							game_config::tc_info(remap_params[1]);
+
+						for(size_t i = 0; i < old_palette.size() && i < new_palette.size(); ++i) {
+							tmp_map[old_palette[i]] = new_palette[i];
 						}
 					}
-				}
-				// Flip-flop (FL)
-				else if("FL" == function) {
-					if(field.empty() || field.find("horiz") != std::string::npos) {
-						fl.toggle_horiz();
+					catch(config::error& e) {
+						ERR_DP
+							<< "caught config::error while processing PAL function: "
+							<< e.message
+							<< '\n';
+						ERR_DP
+							<< "bailing out from PAL\n";
+						tmp_map.clear();
 					}
-					if(field.find("vert") != std::string::npos) {
-						fl.toggle_vert();
+
+					BOOST_FOREACH (const rc_entry_type& rc_entry, tmp_map) {
+						rc.map()[rc_entry.first] = rc_entry.second;
 					}
 				}
-				// Grayscale (GS)
-				else if("GS" == function) {
-					functor_queue.push_back(new gs_function());
+			}
+			// Flip-flop (FL)
+			else if("FL" == function) {
+				if(field.empty() || field.find("horiz") != std::string::npos) {
+					fl.toggle_horiz();
 				}
-				// Color-shift (CS)
-				else if("CS" == function) {
-					std::vector<std::string> const factors = utils::split(field, ',');
-					const size_t s = factors.size();
-					if (s) {
-						int r = 0, g = 0, b = 0;
-
-						r = lexical_cast_default<int>(factors[0]);
-						if( s > 1 ) {
-							g = lexical_cast_default<int>(factors[1]);
-						}
-						if( s > 2 ) {
-							b = lexical_cast_default<int>(factors[2]);
-						}
-
-						functor_queue.push_back(new cs_function(r,g,b));
-					}
+				if(field.find("vert") != std::string::npos) {
+					fl.toggle_vert();
 				}
-				// Crop/slice (CROP)
-				else if("CROP" == function) {
-					std::vector<std::string> const& slice_params = utils::split(field, ',', utils::STRIP_SPACES);
-					const size_t s = slice_params.size();
-					if(s) {
-						SDL_Rect slice_rect = { 0, 0, 0, 0 };
-
-						slice_rect.x = lexical_cast_default<Sint16, const std::string&>(slice_params[0]);
-						if(s > 1) {
-							slice_rect.y = lexical_cast_default<Sint16, const std::string&>(slice_params[1]);
-						}
-						if(s > 2) {
-							slice_rect.w = lexical_cast_default<Uint16, const std::string&>(slice_params[2]);
-						}
-						if(s > 3) {
-							slice_rect.h = lexical_cast_default<Uint16, const std::string&>(slice_params[3]);
-						}
-
-						functor_queue.push_back(new crop_function(slice_rect));
+			}
+			// Grayscale (GS)
+			else if("GS" == function) {
+				functor_queue.push_back(new gs_function());
+			}
+			// Color-shift (CS)
+			else if("CS" == function) {
+				std::vector<std::string> const factors = utils::split(field, ',');
+				const size_t s = factors.size();
+				if (s) {
+					int r = 0, g = 0, b = 0;
+
+					r = lexical_cast_default<int>(factors[0]);
+					if( s > 1 ) {
+						g = lexical_cast_default<int>(factors[1]);
 					}
-					else {
-						ERR_DP << "no arguments passed to the ~CROP() function\n";
+					if( s > 2 ) {
+						b = lexical_cast_default<int>(factors[2]);
 					}
+
+					functor_queue.push_back(new cs_function(r,g,b));
 				}
-				// LOC function
-				else if("LOC" == function) {
-					//FIXME: WIP, don't use it yet
-					std::vector<std::string> const& params = utils::split(field);
-					int x = lexical_cast<int>(params[0]);
-					int y = lexical_cast<int>(params[1]);
-					int cx = lexical_cast<int>(params[2]);
-					int cy = lexical_cast<int>(params[3]);
-					image::locator new_loc(val_.filename_, map_location(x,y), cx, cy, "");//TODO remove only ~LOC
-					// int ii = 0;
-					// surf = get_image(new_loc, TOD_COLORED);
-				}
-				// BLIT function
-				else if("BLIT" == function) {
-					std::vector<std::string> param = utils::parenthetical_split(field, ',');
-					const size_t s = param.size();
-					if(s > 0){
-						int x = 0, y = 0;
-						if(s == 3) {
-							x = lexical_cast_default<int>(param[1]);
-							y = lexical_cast_default<int>(param[2]);
-						}
-						if(x >= 0 && y >= 0) {
-							surface surf = get_image(param[0]);
-							functor_queue.push_back(new blit_function(surf, x, y));
-						} else {
-							ERR_DP << "negative position arguments in ~BLIT() function\n";
-						}
-					} else {
-						ERR_DP << "no arguments passed to the ~BLIT() function\n";
+			}
+			// Crop/slice (CROP)
+			else if("CROP" == function) {
+				std::vector<std::string> const& slice_params = utils::split(field, ',', utils::STRIP_SPACES);
+				const size_t s = slice_params.size();
+				if(s) {
+					SDL_Rect slice_rect = { 0, 0, 0, 0 };
+
+					slice_rect.x = lexical_cast_default<Sint16, const std::string&>(slice_params[0]);
+					if(s > 1) {
+						slice_rect.y = lexical_cast_default<Sint16, const std::string&>(slice_params[1]);
 					}
-				}
-				else if("MASK" == function) {
-					std::vector<std::string> param = utils::parenthetical_split(field, ',');
-					const size_t s = param.size();
-					if(s > 0){
-						int x = 0, y = 0;
-						if(s == 3) {
-							x = lexical_cast_default<int>(param[1]);
-							y = lexical_cast_default<int>(param[2]);
-						}
-						if(x >= 0 && y >= 0) {
-							surface surf = get_image(param[0]);
-							functor_queue.push_back(new mask_function(surf, x, y));
-						} else {
-							ERR_DP << "negative position arguments in ~MASK() function\n";
-						}
-					} else {
-						ERR_DP << "no arguments passed to the ~MASK() function\n";
+					if(s > 2) {
+						slice_rect.w = lexical_cast_default<Uint16, const std::string&>(slice_params[2]);
+					}
+					if(s > 3) {
+						slice_rect.h = lexical_cast_default<Uint16, const std::string&>(slice_params[3]);
 					}
+
+					functor_queue.push_back(new crop_function(slice_rect));
+				}
+				else {
+					ERR_DP << "no arguments passed to the ~CROP() function\n";
 				}
-				else if("L" == function) {
-					if(!field.empty()){
-						surface surf = get_image(field);
-						functor_queue.push_back(new light_function(surf));
+			}
+			// LOC function
+			else if("LOC" == function) {
+				//FIXME: WIP, don't use it yet
+				std::vector<std::string> const& params = utils::split(field);
+				int x = lexical_cast<int>(params[0]);
+				int y = lexical_cast<int>(params[1]);
+				int cx = lexical_cast<int>(params[2]);
+				int cy = lexical_cast<int>(params[3]);
+				// image::locator new_loc(filename, map_location(x,y), cx, cy, "");//TODO remove only ~LOC
+				// surf = get_image(new_loc, TOD_COLORED);
+			}
+			// BLIT function
+			else if("BLIT" == function) {
+				std::vector<std::string> param = utils::parenthetical_split(field, ',');
+				const size_t s = param.size();
+				if(s > 0){
+					int x = 0, y = 0;
+					if(s == 3) {
+						x = lexical_cast_default<int>(param[1]);
+						y = lexical_cast_default<int>(param[2]);
+					}
+					if(x >= 0 && y >= 0) {
+						functor_queue.push_back(new blit_function(image::locator(param[0]), x, y));
 					} else {
-						ERR_DP << "no arguments passed to the ~L() function\n";
+						ERR_DP << "negative position arguments in ~BLIT() function\n";
 					}
+				} else {
+					ERR_DP << "no arguments passed to the ~BLIT() function\n";
 				}
-				// Scale (SCALE)
-				else if("SCALE" == function) {
-					std::vector<std::string> const& scale_params = utils::split(field, ',', utils::STRIP_SPACES);
-					const size_t s = scale_params.size();
-					if(s) {
-						int w = 0, h = 0;
-
-						w = lexical_cast_default<int, const std::string&>(scale_params[0]);
-						if(s > 1) {
-							h = lexical_cast_default<int, const std::string&>(scale_params[1]);
-						}
-
-						functor_queue.push_back(new scale_function(w, h));
+			}
+			else if("MASK" == function) {
+				std::vector<std::string> param = utils::parenthetical_split(field, ',');
+				const size_t s = param.size();
+				if(s > 0){
+					int x = 0, y = 0;
+					if(s == 3) {
+						x = lexical_cast_default<int>(param[1]);
+						y = lexical_cast_default<int>(param[2]);
 					}
-					else {
-						ERR_DP << "no arguments passed to the ~SCALE() function\n";
+					if(x >= 0 && y >= 0) {
+						functor_queue.push_back(new mask_function(image::locator(param[0]), x, y));
+					} else {
+						ERR_DP << "negative position arguments in ~MASK() function\n";
 					}
+				} else {
+					ERR_DP << "no arguments passed to the ~MASK() function\n";
 				}
-				// Gaussian-like blur (BL)
-				else if("BL" == function) {
-					const int depth = std::max<int>(0, lexical_cast_default<int>(field));
-					functor_queue.push_back(new bl_function(depth));
+			}
+			else if("L" == function) {
+				if(!field.empty()){
+					functor_queue.push_back(new light_function(image::locator(field)));
+				} else {
+					ERR_DP << "no arguments passed to the ~L() function\n";
 				}
-				// Opacity-shift (O)
-				else if("O" == function) {
-					const std::string::size_type p100_pos = field.find('%');
-					float num = 0.0f;
-					if(p100_pos == std::string::npos)
-						num = lexical_cast_default<float,const std::string&>(field);
-					else {
-						// make multiplier
-						const std::string parsed_field = field.substr(0, p100_pos);
-						num = lexical_cast_default<float,const std::string&>(parsed_field);
-						num /= 100.0f;
+			}
+			// Scale (SCALE)
+			else if("SCALE" == function) {
+				std::vector<std::string> const& scale_params = utils::split(field, ',', utils::STRIP_SPACES);
+				const size_t s = scale_params.size();
+				if(s) {
+					int w = 0, h = 0;
+
+					w = lexical_cast_default<int, const std::string&>(scale_params[0]);
+					if(s > 1) {
+						h = lexical_cast_default<int, const std::string&>(scale_params[1]);
 					}
-					functor_queue.push_back(new o_function(num));
-				}
-				//
-				// ~R(), ~G() and ~B() are the children of ~CS(). Merely syntatic sugar.
-				// Hence they are at the end of the evaluation.
-				//
-				// Red component color-shift (R)
-				else if("R" == function) {
-					const int r = lexical_cast_default<int>(field);
-					functor_queue.push_back(new cs_function(r,0,0));
-				}
-				// Green component color-shift (G)
-				else if("G" == function) {
-					const int g = lexical_cast_default<int>(field);
-					functor_queue.push_back(new cs_function(0,g,0));
-				}
-				// Blue component color-shift (B)
-				else if("B" == function) {
-					const int b = lexical_cast_default<int>(field);
-					functor_queue.push_back(new cs_function(0,0,b));
-				}
-				else if("NOP" == function) {
-				}
-				// Fake image function used by GUI2 portraits until
-				// Mordante gets rid of it. *tsk* *tsk*
-				else if("RIGHT" == function) {
-				}
-				// Add a bright overlay.
-				else if (function == "BRIGHTEN") {
-					functor_queue.push_back(new brighten_function());
+
+					functor_queue.push_back(new scale_function(w, h));
 				}
-				// Add a dark overlay.
-				else if (function == "DARKEN") {
-					functor_queue.push_back(new darken_function());
+				else {
+					ERR_DP << "no arguments passed to the ~SCALE() function\n";
 				}
+			}
+			// Gaussian-like blur (BL)
+			else if("BL" == function) {
+				const int depth = std::max<int>(0, lexical_cast_default<int>(field));
+				functor_queue.push_back(new bl_function(depth));
+			}
+			// Opacity-shift (O)
+			else if("O" == function) {
+				const std::string::size_type p100_pos = field.find('%');
+				float num = 0.0f;
+				if(p100_pos == std::string::npos)
+					num = lexical_cast_default<float,const std::string&>(field);
 				else {
-					ERR_DP << "unknown image function in path: " << function << '\n';
+					// make multiplier
+					const std::string parsed_field = field.substr(0, p100_pos);
+					num = lexical_cast_default<float,const std::string&>(parsed_field);
+					num /= 100.0f;
 				}
+				functor_queue.push_back(new o_function(num));
+			}
+			//
+			// ~R(), ~G() and ~B() are the children of ~CS(). Merely syntatic sugar.
+			// Hence they are at the end of the evaluation.
+			//
+			// Red component color-shift (R)
+			else if("R" == function) {
+				const int r = lexical_cast_default<int>(field);
+				functor_queue.push_back(new cs_function(r,0,0));
+			}
+			// Green component color-shift (G)
+			else if("G" == function) {
+				const int g = lexical_cast_default<int>(field);
+				functor_queue.push_back(new cs_function(0,g,0));
+			}
+			// Blue component color-shift (B)
+			else if("B" == function) {
+				const int b = lexical_cast_default<int>(field);
+				functor_queue.push_back(new cs_function(0,0,b));
+			}
+			else if("NOP" == function) {
+			}
+			// Fake image function used by GUI2 portraits until
+			// Mordante gets rid of it. *tsk* *tsk*
+			else if("RIGHT" == function) {
+			}
+			// Add a bright overlay.
+			else if (function == "BRIGHTEN") {
+				functor_queue.push_back(new brighten_function());
+			}
+			// Add a dark overlay.
+			else if (function == "DARKEN") {
+				functor_queue.push_back(new darken_function());
+			}
+			else {
+				ERR_DP << "unknown image function in path: " << function << '\n';
 			}
 		}
+	}
 
-		if(!rc.no_op()) {
-			surf = rc(surf);
-		}
+	return new tmodification_pipeline(rc, fl, functor_queue);
+}
+
+static boost::shared_ptr<const image::tmodification_pipeline> get_pipeline(const std::string& modifications)
+{
+	tpipeline_map::const_iterator it = pipelines.find(modifications);
+	if (it != pipelines.end()) {
+		pipeline_stats.hits ++;
+		return it->second;
+	}
+	pipeline_stats.misses ++;
+
+	boost::shared_ptr<const image::tmodification_pipeline> pipeline(compile_modifications(modifications));
+	if (pipelines.size() >= max_pipelines) {
+		// distinct modifications are few in practice, this only prevents unbounded growth.
+		pipelines.clear();
+	}
+	pipelines.insert(std::make_pair(modifications, pipeline));
+	return pipeline;
+}
 
-		if(!fl.no_op()) {
-			surf = fl(surf);
+surface locator::load_image_sub_file() const
+{
+	surface surf = get_image(val_.filename_);
+	if (surf == NULL) {
+		return NULL;
+	}
+
+	if (val_.loc_.valid()) {
+		SDL_Rect srcrect = create_rect(
+				((tile_size*3) / 4) * val_.loc_.x
+				, tile_size * val_.loc_.y + (tile_size / 2) * (val_.loc_.x % 2)
+				, tile_size
+				, tile_size);
+
+		if (val_.center_x_ >= 0 && val_.center_y_>= 0){
+			srcrect.x += surf->w/2 - val_.center_x_;
+			srcrect.y += surf->h/2 - val_.center_y_;
 		}
 
-		BOOST_FOREACH (function_base* f, functor_queue) {
-			surf = (*f)(surf);
-			delete f;
+		if ((srcrect.x + tile_size <= 0) || (srcrect.y + tile_size <= 0)) {
+			add_to_cache(is_empty_hex_, true);
+			return NULL;
 		}
+
+		surface cut(cut_surface(surf, srcrect));
+		bool is_empty = false;
+		surf = mask_surface(cut, get_hexmask(), &is_empty);
+		add_to_cache(is_empty_hex_, is_empty);
+	}
+
+	if (val_.modifications_.size()){
+		const boost::shared_ptr<const tmodification_pipeline> pipeline = get_pipeline(val_.modifications_);
+		surf = pipeline->apply(surf, pipeline_stats.avoided_surfaces);
 	}
 
 	return surf;
@@ -1186,6 +1395,8 @@ void set_team_colors(const std::vector<std::string>* colors)
 	else {
 		team_colors = *colors;
 	}
+	// ~TC is resolved when compiling.
+	pipelines.clear();
 }
 
 std::vector<std::string>& get_team_colors()
@@ -1385,19 +1596,41 @@ const locator& get_locator(const locator& locator)
 	return *res.first;
 }
 
-static void render_locator_texture(SDL_Renderer* renderer, const tblit& blit, int dstx, int dsty, const SDL_Rect* clip_rect)
+static const SDL_Rect* blit_clip_rect(const tblit& blit)
+{
+	return (blit.clip.x | blit.clip.y | blit.clip.w | blit.clip.h)? &blit.clip : nullptr;
+}
+
+// blits of one run have same locator, type, blend and modulation, so they use
+// same texture and same texture state. texture lookup and state change are done
+// once per run, then every blit is only a SDL_RenderCopy.
+static bool same_render_state(const tblit& a, const tblit& b)
+{
+	return a.type == BLITM_LOC && b.type == BLITM_LOC && a.loc == b.loc && a.loc_type == b.loc_type
+		&& a.modulation_alpha == b.modulation_alpha && a.blend_ratio == b.blend_ratio
+		&& (!a.blend_ratio || a.blend_color == b.blend_color);
+}
+
+static void render_hex_run(SDL_Renderer* renderer, const texture& tex, const tblit_run_item* items, const int count)
+{
+	for (int at = 0; at < count; at ++) {
+		const tblit& blit = *items[at].blit;
+		VALIDATE(!blit.width && !blit.height, null_str);
+		SDL_Rect dst_rect = create_rect(items[at].x + blit.x, items[at].y + blit.y, zoom, zoom);
+		SDL_RenderCopy(renderer, tex.get(), NULL, &dst_rect);
+	}
+}
+
+static void render_locator_texture(SDL_Renderer* renderer, const tblit_run_item* items, const int count)
 {
 	texture tex, tex2;
 	int tex_width, tex_height;
-	// uint8_t original_modulation_alpha;
-
-	const locator& i_locator = *blit.loc;
-	VALIDATE(blit.type == BLITM_LOC && !i_locator.is_void(), null_str);
 
-	SDL_Rect dst_rect = create_rect(dstx, dsty, 0, 0);
-	// type = simplify_type(i_locator, type);
+	const tblit& first = *items[0].blit;
+	const locator& i_locator = *first.loc;
+	VALIDATE(first.type == BLITM_LOC && !i_locator.is_void(), null_str);
 
-	switch(blit.loc_type) {
+	switch(first.loc_type) {
 	case UNSCALED:
 	case SCALED_TO_ZOOM:
 		tex = get_unscaled_texture(i_locator);
@@ -1405,63 +1638,57 @@ static void render_locator_texture(SDL_Renderer* renderer, const tblit& blit, in
 			return;
 		}
 
-		if (blit.blend_ratio) {
-			tex2 = clone_texture(tex, 255 - blit.blend_ratio, 255 - blit.blend_ratio, 255 - blit.blend_ratio);
-			SDL_Color color = uint32_to_color(blit.blend_color);
-			brighten_texture(tex2, 1 * color.r * blit.blend_ratio / 255, 1 * color.g * blit.blend_ratio / 255, 1 * color.b * blit.blend_ratio / 255);
+		if (first.blend_ratio) {
+			tex2 = clone_texture(tex, 255 - first.blend_ratio, 255 - first.blend_ratio, 255 - first.blend_ratio);
+			SDL_Color color = uint32_to_color(first.blend_color);
+			brighten_texture(tex2, 1 * color.r * first.blend_ratio / 255, 1 * color.g * first.blend_ratio / 255, 1 * color.b * first.blend_ratio / 255);
 		} else {
 			tex2 = tex;
 		}
 		
 		SDL_QueryTexture(tex2.get(), NULL, NULL, &tex_width, &tex_height);
-		if (blit.loc_type == UNSCALED) {
-			if (!blit.width) {
-				VALIDATE(!blit.height, null_str);
-				if (!clip_rect) {
-					dst_rect.w = tex_width;
-					dst_rect.h = tex_height;
-
-				} else {
-					VALIDATE(clip_rect->w && clip_rect->h, null_str);
-					dst_rect.w = clip_rect->w;
-					dst_rect.h = clip_rect->h;
-				}
+		{
+			ttexture_alpha_mod_lock lock2(tex2, first.modulation_alpha);
+			for (int at = 0; at < count; at ++) {
+				const tblit& blit = *items[at].blit;
+				const SDL_Rect* clip_rect = blit_clip_rect(blit);
+				SDL_Rect dst_rect = create_rect(items[at].x + blit.x, items[at].y + blit.y, 0, 0);
+
+				if (blit.loc_type == UNSCALED) {
+					if (!blit.width) {
+						VALIDATE(!blit.height, null_str);
+						if (!clip_rect) {
+							dst_rect.w = tex_width;
+							dst_rect.h = tex_height;
 
-			} else {
-				VALIDATE(blit.height, null_str);
-				dst_rect.w = blit.width;
-				dst_rect.h = blit.height;
-			}
+						} else {
+							VALIDATE(clip_rect->w && clip_rect->h, null_str);
+							dst_rect.w = clip_rect->w;
+							dst_rect.h = clip_rect->h;
+						}
 
-		} else {
-			if (!clip_rect) {
-				dst_rect.w = (tex_width * zoom) / tile_size;
-				dst_rect.h = (tex_height * zoom) / tile_size;
-			} else {
-				VALIDATE(clip_rect->w && clip_rect->h, null_str);
-				dst_rect.w = (clip_rect->w * zoom) / tile_size;
-				dst_rect.h = (clip_rect->h * zoom) / tile_size;
-			}
+					} else {
+						VALIDATE(blit.height, null_str);
+						dst_rect.w = blit.width;
+						dst_rect.h = blit.height;
+					}
 
-			VALIDATE(!blit.width || blit.width == dst_rect.w, null_str);
-			VALIDATE(!blit.height || blit.height == dst_rect.h, null_str);
-		}
+				} else {
+					if (!clip_rect) {
+						dst_rect.w = (tex_width * zoom) / tile_size;
+						dst_rect.h = (tex_height * zoom) / tile_size;
+					} else {
+						VALIDATE(clip_rect->w && clip_rect->h, null_str);
+						dst_rect.w = (clip_rect->w * zoom) / tile_size;
+						dst_rect.h = (clip_rect->h * zoom) / tile_size;
+					}
 
-/*
-		if (blit.modulation_alpha != NO_MODULATE_ALPHA) {
-			SDL_GetTextureAlphaMod(tex2.get(), &original_modulation_alpha);
-			SDL_SetTextureAlphaMod(tex2.get(), blit.modulation_alpha);
-		}
-*/
-		{
-			ttexture_alpha_mod_lock lock2(tex2, blit.modulation_alpha);
-			SDL_RenderCopyEx(renderer, tex2.get(), clip_rect, &dst_rect, 0, NULL, (SDL_RendererFlip)blit.flip);
-		}
-/*
-		if (blit.modulation_alpha != NO_MODULATE_ALPHA) {
-			SDL_SetTextureAlphaMod(tex2.get(), original_modulation_alpha);
+					VALIDATE(!blit.width || blit.width == dst_rect.w, null_str);
+					VALIDATE(!blit.height || blit.height == dst_rect.h, null_str);
+				}
+				SDL_RenderCopyEx(renderer, tex2.get(), clip_rect, &dst_rect, 0, NULL, (SDL_RendererFlip)blit.flip);
+			}
 		}
-*/
 		break;
 
 	case SCALED_TO_HEX:
@@ -1472,29 +1699,23 @@ static void render_locator_texture(SDL_Renderer* renderer, const tblit& blit, in
 			return;
 		}
 		SDL_QueryTexture(tex.get(), NULL, NULL, &tex_width, &tex_height);
-
-		VALIDATE(!blit.width && !blit.height, null_str);
 		VALIDATE(tile_size == tex_width && tile_size == tex_height, null_str);
-		dst_rect.w = zoom;
-		dst_rect.h = zoom;
 
-		if (blit.loc_type == SCALED_TO_HEX) {
-			SDL_RenderCopy(renderer, tex.get(), NULL, &dst_rect);
+		if (first.loc_type == BRIGHTENED) {
+			tex2 = clone_texture(tex);
+			// ftofxp(game_config::hex_brightening) is 4byte, brighten_texture requrie uint8_t!
+			brighten_texture(tex2, 20, 20, 20);
 
 		} else {
-			if (blit.loc_type == BRIGHTENED) {
-				tex2 = clone_texture(tex);
-				// ftofxp(game_config::hex_brightening) is 4byte, brighten_texture requrie uint8_t!
-				brighten_texture(tex2, 20, 20, 20);
+			tex2 = tex;
+		}
 
-			} else {
-				tex2 = tex;
-			}
+		if (first.loc_type == SCALED_TO_HEX) {
+			render_hex_run(renderer, tex2, items, count);
 
-			{
-				ttexture_color_mod_lock lock(tex2, color_adjustor_2_modulator(red_adjust), color_adjustor_2_modulator(green_adjust), color_adjustor_2_modulator(blue_adjust));
-				SDL_RenderCopy(renderer, tex2.get(), NULL, &dst_rect);
-			}
+		} else {
+			ttexture_color_mod_lock lock(tex2, color_adjustor_2_modulator(red_adjust), color_adjustor_2_modulator(green_adjust), color_adjustor_2_modulator(blue_adjust));
+			render_hex_run(renderer, tex2, items, count);
 		}
 		break;
 
@@ -1505,33 +1726,46 @@ static void render_locator_texture(SDL_Renderer* renderer, const tblit& blit, in
 
 void render_blit(SDL_Renderer* renderer, const image::tblit& blit, const int xpos, const int ypos)
 {
-	SDL_Rect dstrect = create_rect(xpos + blit.x, ypos + blit.y, 0, 0);
-	const SDL_Rect* clip_rect = (blit.clip.x | blit.clip.y | blit.clip.w | blit.clip.h)? &blit.clip : nullptr;
 	if (blit.type == image::BLITM_LOC) {
-		image::render_locator_texture(renderer, blit, dstrect.x, dstrect.y, clip_rect);
+		const tblit_run_item item = {&blit, xpos, ypos};
+		image::render_locator_texture(renderer, &item, 1);
+		return;
+	}
 
-	} else if (blit.type == image::BLITM_SURFACE) {
-		dstrect.w = blit.width;
-		dstrect.h = blit.height;
-		render_surface(renderer, blit.surf, clip_rect, &dstrect);
+	SDL_Rect dstrect = create_rect(xpos + blit.x, ypos + blit.y, blit.width, blit.height);
+	if (blit.type == image::BLITM_SURFACE) {
+		render_surface(renderer, blit.surf, blit_clip_rect(blit), &dstrect);
 
 	} else if (blit.type == image::BLITM_RECT) {
-		dstrect.w = blit.width;
-		dstrect.h = blit.height;
 		render_rect(renderer, dstrect, blit.blend_color);
 
 	} else if (blit.type == image::BLITM_FRAME) {
-		dstrect.w = blit.width;
-		dstrect.h = blit.height;
 		render_rect_frame(renderer, dstrect, blit.blend_color);
 
 	} else if (blit.type == image::BLITM_LINE) {
-		dstrect.w = blit.width;
-		dstrect.h = blit.height;
 		render_line(renderer, blit.blend_color, dstrect.x, dstrect.y, dstrect.x + dstrect.w - 1, dstrect.y + dstrect.h - 1);
 	}
 }
 
+void render_blits(SDL_Renderer* renderer, const tblit_run_item* items, const int count)
+{
+	int at = 0;
+	while (at < count) {
+		const tblit& blit = *items[at].blit;
+		if (blit.type != BLITM_LOC) {
+			render_blit(renderer, blit, items[at].x, items[at].y);
+			at ++;
+			continue;
+		}
+		int end = at + 1;
+		while (end < count && same_render_state(blit, *items[end].blit)) {
+			end ++;
+		}
+		render_locator_texture(renderer, items + at, end - at);
+		at = end;
+	}
+}
+
 surface get_hexmask()
 {
 	return mask_surf;
@@ -265,6 +265,28 @@ extern mini_terrain_cache_map mini_fogged_terrain_cache;
 
 void flush_cache(bool force = false);
 
+struct tcache_stats
+{
+	std::string name;
+	size_t items;
+	size_t bytes;
+	size_t budget;
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t evictions;
+};
+void get_cache_stats(std::vector<tcache_stats>& stats);
+
+// compiled image-path modification pipelines.
+struct tpipeline_stats
+{
+	uint64_t hits;
+	uint64_t misses;
+	// intermediate surfaces that fused and in-place functions didn't create.
+	uint64_t avoided_surfaces;
+};
+void get_pipeline_stats(tpipeline_stats& stats, size_t& pipelines);
+
 ///the image manager is responsible for setting up images, and destroying
 ///all images when the program exits. It should probably
 ///be created once for the life of the program
@@ -311,6 +333,15 @@ surface get_image(const locator& i_locator);
 
 void render_blit(SDL_Renderer* renderer, const image::tblit& blit, const int xpos, const int ypos);
 
+struct tblit_run_item
+{
+	const tblit* blit;
+	int x;
+	int y;
+};
+// render in order. adjacent blits of same texture and state share one texture lookup and state change.
+void render_blits(SDL_Renderer* renderer, const tblit_run_item* items, const int count);
+
 ///function to get the standard hex mask
 surface get_hexmask();
 
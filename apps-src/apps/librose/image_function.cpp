@@ -18,6 +18,7 @@
 #include "rose_config.hpp"
 #include "image.hpp"
 #include "log.hpp"
+#include "sdl_pixel.hpp"
 
 #define GETTEXT_DOMAIN "rose-lib"
 
@@ -32,6 +33,18 @@ surface rc_function::operator()(const surface& src) const
 	return recolor_image(src, rc_map_);
 }
 
+bool rc_function::apply(surface& surf) const
+{
+	recolor_image_inplace(surf, rc_map_);
+	return true;
+}
+
+bool rc_function::fuse(pointwise_function& fused) const
+{
+	fused.add_recolor(rc_map_);
+	return true;
+}
+
 surface fl_function::operator()(const surface& src) const
 {
 	surface ret = src;
@@ -47,11 +60,34 @@ surface fl_function::operator()(const surface& src) const
 	return ret;
 }
 
+bool fl_function::apply(surface& surf) const
+{
+	if (horiz_) {
+		flip_surface_inplace(surf);
+	}
+	if (vert_) {
+		flop_surface_inplace(surf);
+	}
+	return true;
+}
+
 surface gs_function::operator()(const surface& src) const
 {
 	return greyscale_image(src);
 }
 
+bool gs_function::apply(surface& surf) const
+{
+	greyscale_image_inplace(surf);
+	return true;
+}
+
+bool gs_function::fuse(pointwise_function& fused) const
+{
+	fused.add_greyscale();
+	return true;
+}
+
 surface crop_function::operator()(const surface& src) const
 {
 	SDL_Rect area = slice_;
@@ -75,7 +111,7 @@ surface crop_function::operator()(const surface& src) const
 surface blit_function::operator()(const surface& src) const
 {
 	surface nsrc = make_neutral_surface(src);
-	surface nsurf = make_neutral_surface(surf_);
+	surface nsurf = make_neutral_surface(get_image(loc_));
 	SDL_Rect r = create_rect(x_, y_, 0, 0);
 	sdl_blit(nsurf, NULL, nsrc, &r);
 	return nsrc;
@@ -83,17 +119,38 @@ surface blit_function::operator()(const surface& src) const
 
 surface mask_function::operator()(const surface& src) const
 {
-	if(src->w == mask_->w &&  src->h == mask_->h && x_ == 0 && y_ == 0)
-		return mask_surface(src, mask_);
+	surface mask = get_image(mask_);
+	if(src->w == mask->w &&  src->h == mask->h && x_ == 0 && y_ == 0)
+		return mask_surface(src, mask);
 	SDL_Rect r = create_rect(x_, y_, 0, 0);
 	surface new_mask = create_neutral_surface(src->w, src->h);
-	sdl_blit(mask_, NULL, new_mask, &r);
+	sdl_blit(mask, NULL, new_mask, &r);
 	return mask_surface(src, new_mask);
 }
 
+bool mask_function::apply(surface& surf) const
+{
+	surface mask = get_image(mask_);
+	if (surf->w != mask->w || surf->h != mask->h || x_ != 0 || y_ != 0 || !is_neutral_surface(mask)) {
+		return false;
+	}
+	mask_surface_inplace(surf, mask);
+	return true;
+}
+
 surface light_function::operator()(const surface& src) const
 {
-	return light_surface(src, surf_);;
+	return light_surface(src, get_image(loc_));
+}
+
+bool light_function::apply(surface& surf) const
+{
+	surface light = get_image(loc_);
+	if (!light || !is_neutral_surface(light)) {
+		return false;
+	}
+	light_surface_inplace(surf, light);
+	return true;
 }
 
 surface scale_function::operator()(const surface& src) const
@@ -128,6 +185,18 @@ surface o_function::operator()(const surface& src) const
 	return adjust_surface_alpha(src, ftofxp(opacity_));
 }
 
+bool o_function::apply(surface& surf) const
+{
+	adjust_surface_alpha_inplace(surf, ftofxp(opacity_));
+	return true;
+}
+
+bool o_function::fuse(pointwise_function& fused) const
+{
+	fused.add_opacity(ftofxp(opacity_));
+	return true;
+}
+
 surface cs_function::operator()(const surface& src) const
 {
 	return(
@@ -137,11 +206,31 @@ surface cs_function::operator()(const surface& src) const
 	);
 }
 
+bool cs_function::apply(surface& surf) const
+{
+	adjust_surface_color2(surf, r_, g_, b_);
+	return true;
+}
+
+bool cs_function::fuse(pointwise_function& fused) const
+{
+	if (r_ != 0 || g_ != 0 || b_ != 0) {
+		fused.add_color_shift(r_, g_, b_);
+	}
+	return true;
+}
+
 surface bl_function::operator()(const surface& src) const
 {
 	return blur_alpha_surface(src, depth_);
 }
 
+bool bl_function::apply(surface& surf) const
+{
+	blur_alpha_surface_inplace(surf, depth_);
+	return true;
+}
+
 surface brighten_function::operator()(const surface &src) const
 {
 	surface ret = make_neutral_surface(src);
@@ -160,4 +249,174 @@ surface darken_function::operator()(const surface &src) const
 	return ret;
 }
 
+surface pointwise_function::operator()(const surface& src) const
+{
+	surface nsurf = make_neutral_surface(src);
+	apply(nsurf);
+	return nsurf;
+}
+
+bool pointwise_function::apply(surface& surf) const
+{
+	// 16KB, fits in L1 together with recolor table.
+	const int block = 4096;
+
+	surface_lock lock(surf);
+	Uint32* pixels = lock.pixels();
+	const int count = surf->w * surf->h;
+	for (int at = 0; at < count; at += block) {
+		const int n = std::min(block, count - at);
+		for (std::vector<tstep>::const_iterator it = steps_.begin(); it != steps_.end(); ++ it) {
+			const tstep& step = *it;
+			if (step.type == RECOLOR) {
+				pixel_recolor(pixels + at, n, *step.lut);
+			} else if (step.type == GREYSCALE) {
+				pixel_greyscale(pixels + at, n);
+			} else if (step.type == COLOR_SHIFT) {
+				pixel_add(pixels + at, n, step.r, step.g, step.b, 0);
+			} else {
+				pixel_multiply(pixels + at, n, ftofxp(1), ftofxp(1), ftofxp(1), step.amount);
+			}
+		}
+	}
+	return true;
+}
+
+void pointwise_function::add_recolor(const std::map<Uint32, Uint32>& recolor_map)
+{
+	if (recolor_map.empty()) {
+		return;
+	}
+	steps_.push_back(tstep(RECOLOR));
+	steps_.back().lut.reset(new tcolor_lut(recolor_map));
+}
+
+void pointwise_function::add_greyscale()
+{
+	steps_.push_back(tstep(GREYSCALE));
+}
+
+void pointwise_function::add_color_shift(int r, int g, int b)
+{
+	steps_.push_back(tstep(COLOR_SHIFT, r, g, b));
+}
+
+void pointwise_function::add_opacity(fixed_t amount)
+{
+	steps_.push_back(tstep(OPACITY, 0, 0, 0, amount));
+}
+
+surface flip_crop_function::operator()(const surface& src) const
+{
+	// same area as crop_function, but in flipped coordinate.
+	SDL_Rect area = slice_;
+	if (area.w == 0) {
+		area.w = src->w;
+	}
+	if (area.h == 0) {
+		area.h = src->h;
+	}
+	if (area.x < 0) {
+		ERR_DP << "start X coordinate of SECTION function is negative - truncating to zero\n";
+		area.x = 0;
+	}
+	if (area.y < 0) {
+		ERR_DP << "start Y coordinate of SECTION function is negative - truncating to zero\n";
+		area.y = 0;
+	}
+	if (fl_.get_horiz()) {
+		area.x = src->w - area.x - area.w;
+	}
+	if (fl_.get_vert()) {
+		area.y = src->h - area.y - area.h;
+	}
+
+	// pixels out of src are transparent black. cut from neutral surface, so they are same as flip then crop.
+	surface result = cut_surface(is_neutral_surface(src)? src: make_neutral_surface(src), area);
+	if (result) {
+		fl_.apply(result);
+	}
+	return result;
+}
+
+// nobody else holds surf, so image function can modify it without copying.
+static bool modifiable_inplace(const surface& surf)
+{
+	return surf && surf->refcount == 1 && is_neutral_surface(surf);
+}
+
+tmodification_pipeline::tmodification_pipeline(const rc_function& rc, const fl_function& fl, std::vector<function_base*>& functors)
+	: stages_()
+{
+	size_t at = 0;
+	if (!fl.no_op()) {
+		const crop_function* crop = functors.empty()? NULL: dynamic_cast<const crop_function*>(functors.front());
+		if (crop) {
+			add_stage(new flip_crop_function(fl, crop->slice()), 2);
+			delete functors.front();
+			at ++;
+		} else {
+			add_stage(new fl_function(fl), 1);
+		}
+	}
+
+	pointwise_function* pointwise = new pointwise_function;
+	int pointwise_functions = 0;
+	if (!rc.no_op()) {
+		rc.fuse(*pointwise);
+		pointwise_functions ++;
+	}
+	for (; at < functors.size(); at ++) {
+		function_base* f = functors[at];
+		if (f->fuse(*pointwise)) {
+			pointwise_functions ++;
+			delete f;
+			continue;
+		}
+		if (!pointwise->no_op()) {
+			add_stage(pointwise, pointwise_functions);
+			pointwise = new pointwise_function;
+		}
+		pointwise_functions = 0;
+		add_stage(f, 1);
+	}
+	if (!pointwise->no_op()) {
+		add_stage(pointwise, pointwise_functions);
+	} else {
+		delete pointwise;
+	}
+	functors.clear();
+}
+
+tmodification_pipeline::~tmodification_pipeline()
+{
+	for (std::vector<tstage>::const_iterator it = stages_.begin(); it != stages_.end(); ++ it) {
+		delete it->function;
+	}
+}
+
+void tmodification_pipeline::add_stage(function_base* function, int functions)
+{
+	tstage stage;
+	stage.function = function;
+	stage.functions = functions;
+	stages_.push_back(stage);
+}
+
+surface tmodification_pipeline::apply(const surface& src, uint64_t& avoided_surfaces) const
+{
+	// every image-path function used to create one surface.
+	surface surf = src;
+	for (std::vector<tstage>::const_iterator it = stages_.begin(); it != stages_.end(); ++ it) {
+		const tstage& stage = *it;
+		if (modifiable_inplace(surf) && stage.function->apply(surf)) {
+			avoided_surfaces += stage.functions;
+		} else {
+			surf = (*stage.function)(surf);
+			avoided_surfaces += stage.functions - 1;
+		}
+	}
+	return surf;
+}
+
 } /* end namespace image */
@@ -18,9 +18,15 @@
 #ifndef IMAGE_FUNCTION_HPP_INCLUDED
 #define IMAGE_FUNCTION_HPP_INCLUDED
 
+#include "image.hpp"
 #include "sdl_utils.hpp"
 
+class tcolor_lut;
+
 namespace image {
+
+class pointwise_function;
+
 /**
  * Base abstract class for an image-path function.
  * It actually just enforces the operator()() protocol.
@@ -33,6 +39,18 @@ public:
 	 * Applies the image-path function on the specified surface.
 	 */
 	virtual surface operator()(const surface& src) const = 0;
+
+	/**
+	 * Applies the function on surf in place, surf is neutral and not shared.
+	 * @return false if the function can't work in place, caller should use operator().
+	 */
+	virtual bool apply(surface& surf) const { return false; }
+
+	/**
+	 * Appends this function to a fused per-pixel pass.
+	 * @return false if the function isn't per-pixel.
+	 */
+	virtual bool fuse(pointwise_function& fused) const { return false; }
 };
 
 /**
@@ -58,6 +76,8 @@ public:
 		: rc_map_(recolor_map)
 	{}
 	virtual surface operator()(const surface& src) const;
+	virtual bool apply(surface& surf) const;
+	virtual bool fuse(pointwise_function& fused) const;
 
 	bool no_op() const { return rc_map_.empty(); }
 
@@ -84,6 +104,7 @@ public:
 		, vert_(vert)
 	{}
 	virtual surface operator()(const surface& src) const;
+	virtual bool apply(surface& surf) const;
 
 	void set_horiz(bool val)  { horiz_ = val; }
 	void set_vert(bool val)   { vert_ = val; }
@@ -111,6 +132,8 @@ class gs_function : public function_base
 public:
 	gs_function() {}
 	virtual surface operator()(const surface& src) const;
+	virtual bool apply(surface& surf) const;
+	virtual bool fuse(pointwise_function& fused) const;
 };
 
 /**
@@ -124,6 +147,8 @@ public:
 	{}
 	virtual surface operator()(const surface& src) const;
 
+	const SDL_Rect& slice() const { return slice_; }
+
 private:
 	SDL_Rect slice_;
 };
@@ -135,13 +160,14 @@ private:
 class blit_function : public function_base
 {
 public:
-	blit_function(const surface& surf, int x, int y)
-		: surf_(surf), x_(x), y_(y)
+	blit_function(const locator& loc, int x, int y)
+		: loc_(loc), x_(x), y_(y)
 	{}
 	virtual surface operator()(const surface& src) const;
 
 private:
-	surface surf_;
+	// surface is got from image cache when applied, so it is charged to and evicted with that cache.
+	locator loc_;
 	int x_;
 	int y_;
 };
@@ -153,13 +179,14 @@ private:
 class mask_function : public function_base
 {
 public:
-	mask_function(const surface& mask, int x, int y)
+	mask_function(const locator& mask, int x, int y)
 		: mask_(mask), x_(x), y_(y)
 	{}
 	virtual surface operator()(const surface& src) const;
+	virtual bool apply(surface& surf) const;
 
 private:
-	surface mask_;
+	locator mask_;
 	int x_;
 	int y_;
 };
@@ -171,13 +198,14 @@ private:
 class light_function : public function_base
 {
 public:
-	light_function(const surface& surf)
-		: surf_(surf)
+	light_function(const locator& loc)
+		: loc_(loc)
 	{}
 	virtual surface operator()(const surface& src) const;
+	virtual bool apply(surface& surf) const;
 
 private:
-	surface surf_;
+	locator loc_;
 };
 
 /**
@@ -205,6 +233,8 @@ public:
 		: opacity_(opacity)
 	{}
 	virtual surface operator()(const surface& src) const;
+	virtual bool apply(surface& surf) const;
+	virtual bool fuse(pointwise_function& fused) const;
 
 private:
 	float opacity_;
@@ -220,6 +250,8 @@ public:
 		: r_(r), g_(g), b_(b)
 	{}
 	virtual surface operator()(const surface& src) const;
+	virtual bool apply(surface& surf) const;
+	virtual bool fuse(pointwise_function& fused) const;
 
 private:
 	int r_, g_, b_;
@@ -235,6 +267,7 @@ public:
 		: depth_(depth)
 	{}
 	virtual surface operator()(const surface& src) const;
+	virtual bool apply(surface& surf) const;
 
 private:
 	int depth_;
@@ -256,6 +289,98 @@ struct darken_function : function_base
 	virtual surface operator()(const surface &src) const;
 };
 
+/**
+ * Several per-pixel functions (RC, GS, CS, O) fused into one pass.
+ * Pixels are processed block by block, every step runs on a block while
+ * it is still in cache.
+ */
+class pointwise_function : public function_base
+{
+public:
+	pointwise_function()
+		: steps_()
+	{}
+	virtual surface operator()(const surface& src) const;
+	virtual bool apply(surface& surf) const;
+
+	void add_recolor(const std::map<Uint32, Uint32>& recolor_map);
+	void add_greyscale();
+	void add_color_shift(int r, int g, int b);
+	void add_opacity(fixed_t amount);
+
+	bool no_op() const { return steps_.empty(); }
+
+private:
+	enum {RECOLOR, GREYSCALE, COLOR_SHIFT, OPACITY};
+	struct tstep
+	{
+		tstep(int type, int r = 0, int g = 0, int b = 0, fixed_t amount = 0)
+			: type(type), r(r), g(g), b(b), amount(amount), lut()
+		{}
+
+		int type;
+		int r, g, b;
+		fixed_t amount;
+		boost::shared_ptr<const tcolor_lut> lut;
+	};
+	std::vector<tstep> steps_;
+};
+
+/**
+ * FL followed by CROP. Only the cropped part is copied, then flipped in place.
+ */
+class flip_crop_function : public function_base
+{
+public:
+	flip_crop_function(const fl_function& fl, const SDL_Rect& slice)
+		: fl_(fl), slice_(slice)
+	{}
+	virtual surface operator()(const surface& src) const;
+
+private:
+	fl_function fl_;
+	SDL_Rect slice_;
+};
+
+/**
+ * Image-path modifications compiled once. It is immutable, so one instance
+ * is shared by every locator with the same modification string.
+ *
+ * Compared with applying parsed functions one by one, adjacent functions
+ * are fused: FL+CROP, and RC with following per-pixel functions. RC is
+ * moved after FL/CROP, it's per-pixel and skips transparent pixels, so
+ * result is same.
+ */
+class tmodification_pipeline
+{
+public:
+	/**
+	 * Takes ownership of functors.
+	 */
+	tmodification_pipeline(const rc_function& rc, const fl_function& fl, std::vector<function_base*>& functors);
+	~tmodification_pipeline();
+
+	/**
+	 * @param avoided_surfaces  Increased by count of intermediate surfaces
+	 *                          that fusing and in-place functions avoided.
+	 */
+	surface apply(const surface& src, uint64_t& avoided_surfaces) const;
+
+	size_t stages() const { return stages_.size(); }
+
+private:
+	void add_stage(function_base* function, int functions);
+
+private:
+	struct tstage
+	{
+		function_base* function;
+		// count of image-path functions this stage replaces.
+		int functions;
+	};
+	std::vector<tstage> stages_;
+};
+
 } /* end namespace image */
 
 #endif /* !defined(IMAGE_FUNCTION_HPP_INCLUDED) */
@@ -224,9 +224,10 @@ std::string tintegrate::drop_escape(const std::string& str)
 
 tintegrate* share_canvas_integrate = NULL;
 
-tintegrate::tintegrate(const std::string& src, int maximum_width, int maximum_height, int default_font_size, const SDL_Color& default_font_color, bool editable)
+tintegrate::tintegrate(const std::string& src, int maximum_width, int maximum_height, int default_font_size, const SDL_Color& default_font_color, bool editable, bool measure_only)
 	: src_(editable? src: null_str)
 	, editable_(editable)
+	, measure_only_(measure_only)
 	, items_()
 	, last_row_()
 	, title_spacing_(16)
@@ -243,6 +244,8 @@ tintegrate::tintegrate(const std::string& src, int maximum_width, int maximum_he
 	, exist_anim_(false)
 	, anims_()
 	, bubble_anims_()
+	, plain_(true)
+	, floating_items_(0)
 {
 	VALIDATE(maximum_width_ > 0 && default_font_size_ > 0, null_str);
 	// in order to align with hdpi_scale, both width and height returned by tintegrate must always ceil align width hdpi_scale!
@@ -252,6 +255,11 @@ tintegrate::tintegrate(const std::string& src, int maximum_width, int maximum_he
 	// so first, make maximum_width_ floor align with hdpi_scale. 
 	maximum_width_ = posix_align_floor(maximum_width_, gui2::twidget::hdpi_scale);
 
+	layout(src);
+}
+
+void tintegrate::layout(const std::string& src)
+{
 	// Parse and add the text.
 	std::map<int, std::string> parsed_items;
 
@@ -259,6 +267,7 @@ tintegrate::tintegrate(const std::string& src, int maximum_width, int maximum_he
 		parsed_items = utils::to_cfgs(src);
 	} catch (twml_exception& /* e */) {
 		// [see remark#30] process character: '<' 
+		plain_ = false;
 		add_text_item(0, 0, src, default_font_color_);
 	}
 
@@ -267,6 +276,7 @@ tintegrate::tintegrate(const std::string& src, int maximum_width, int maximum_he
 		std::string name;
 		if (utils::is_single_cfg(it->second, &name)) {
 			// Should be parsed as WML.
+			plain_ = false;
 			config cfg;
 /*
 			if (it->second == "[format]text=\"37.0\"[/format]") {
@@ -497,12 +507,20 @@ void tintegrate::add_text_item(int tag_start, int start, const std::string& text
 		else
 			color = font::YELLOW_COLOR;
 
-		surface surf(font::get_rendered_text(first_part, font_size, color, state));
+		surface surf;
+		SDL_Rect measured = empty_rect;
+		if (measure_only_) {
+			measured = font::get_rendered_text_rect(first_part, font_size, state);
+		} else {
+			surf = font::get_rendered_text(first_part, font_size, color, state);
+		}
 
-		if (!surf.null()) {
-			// [See remark#22]
-			SDL_SetSurfaceBlendMode(surf, SDL_BLENDMODE_NONE); // direct blit without alpha blending
-			SDL_SetSurfaceRLE(surf, 0);
+		if (!surf.null() || measured.w) {
+			if (!surf.null()) {
+				// [See remark#22]
+				SDL_SetSurfaceBlendMode(surf, SDL_BLENDMODE_NONE); // direct blit without alpha blending
+				SDL_SetSurfaceRLE(surf, 0);
+			}
 			int src_text_size = get_src_text_size(start, first_part);
 			if (editable_) {
 				std::string text = first_part;
@@ -512,7 +530,12 @@ void tintegrate::add_text_item(int tag_start, int start, const std::string& text
 				validate_str(start, src_text_size, text);
 			}
 
-			add_item(titem(surf, tag_start, start, curr_loc_.first, curr_loc_.second, first_part, ref_dst, font_size, state, src_text_size));
+			titem item(surf, tag_start, start, curr_loc_.first, curr_loc_.second, first_part, ref_dst, font_size, state, src_text_size);
+			if (measure_only_) {
+				item.rect.w = measured.w;
+				item.rect.h = measured.h;
+			}
+			add_item(item);
 			start += src_text_size;
 			if (editable_) {
 				start -= items_.back().src_end_is_lf(src_);
@@ -655,6 +678,9 @@ void tintegrate::add_img_item(int start, const std::string& path, const std::str
 int tintegrate::get_y_for_floating_img(const int width, const int x, const int desired_y)
 {
 	int min_y = desired_y;
+	if (!floating_items_) {
+		return min_y;
+	}
 	for (std::list<titem>::const_iterator it = items_.begin(); it != items_.end(); ++it) {
 		const titem& itm = *it;
 		if (itm.floating) {
@@ -670,6 +696,9 @@ int tintegrate::get_y_for_floating_img(const int width, const int x, const int d
 int tintegrate::get_min_x(const int y, const int height)
 {
 	int min_x = 0;
+	if (!floating_items_) {
+		return min_x;
+	}
 	for (std::list<titem>::const_iterator it = items_.begin(); it != items_.end(); ++it) {
 		const titem& itm = *it;
 		if (itm.floating) {
@@ -685,6 +714,9 @@ int tintegrate::get_max_x(const int y, const int height)
 {
 	int text_width = maximum_width_;
 	int max_x = text_width;
+	if (!floating_items_) {
+		return max_x;
+	}
 	for (std::list<titem>::const_iterator it = items_.begin(); it != items_.end(); ++it) {
 		const titem& itm = *it;
 		if (itm.floating) {
@@ -710,6 +742,7 @@ void tintegrate::add_item(const titem &itm)
 		last_row_.push_back(&items_.back());
 	}
 	else {
+		floating_items_ ++;
 		if (itm.align == LEFT) {
 			curr_loc_.first = itm.rect.w + 5;
 		}
@@ -804,6 +837,7 @@ tpoint tintegrate::get_size() const
 
 surface tintegrate::get_surface()
 {
+	VALIDATE(!measure_only_, null_str);
 	const tpoint size = get_size();
 	surface screen = create_neutral_surface(size.x, size.y);
 
@@ -1440,7 +1474,7 @@ int escape_count(const std::string& str)
 	return escapes;
 }
 
-std::string tintegrate::handle_selection(int startx, int starty, int endx, int endy, SDL_Rect* new_pt) const
+std::string tintegrate::handle_selection(int startx, int starty, int endx, int endy, SDL_Rect* new_pt, int* new_src_pos) const
 {
 	std::string ret;
 	if (new_pt) {
@@ -1505,8 +1539,12 @@ std::string tintegrate::handle_selection(int startx, int starty, int endx, int e
 		} else {
 			start_tmp_pos = start_loc.it->pos;
 		}
-		tintegrate integrate(ret, maximum_width_, maximum_height_, default_font_size_, default_font_color_, true);
-		*new_pt = integrate.calculate_cursor(start_tmp_pos);
+		if (new_src_pos) {
+			*new_src_pos = start_tmp_pos;
+		} else {
+			tintegrate integrate(ret, maximum_width_, maximum_height_, default_font_size_, default_font_color_, true);
+			*new_pt = integrate.calculate_cursor(start_tmp_pos);
+		}
 
 	} else {
 		const titem& start_item = *start_loc.it;
@@ -1547,7 +1585,7 @@ std::string tintegrate::handle_selection(int startx, int starty, int endx, int e
 	return ret;
 }
 
-std::string tintegrate::handle_char(bool del, int x, int y, const bool backspace, SDL_Rect& new_pt) const
+std::string tintegrate::handle_char(bool del, int x, int y, const bool backspace, SDL_Rect& new_pt, int* new_src_pos) const
 {
 	std::string ret;
 
@@ -1647,8 +1685,12 @@ std::string tintegrate::handle_char(bool del, int x, int y, const bool backspace
 				src_tmp_pos = tmp_pos;
 			}
 
-			tintegrate integrate(ret, maximum_width_, maximum_height_, default_font_size_, default_font_color_, true);
-			new_pt = integrate.calculate_cursor(src_tmp_pos);
+			if (new_src_pos) {
+				*new_src_pos = src_tmp_pos;
+			} else {
+				tintegrate integrate(ret, maximum_width_, maximum_height_, default_font_size_, default_font_color_, true);
+				new_pt = integrate.calculate_cursor(src_tmp_pos);
+			}
 
 		} else if (before_loc.it->text_type()) {
 			if (loc.it->rect.y >= before_loc.it->rect.y + before_loc.it->rect.h) {
@@ -1710,8 +1752,12 @@ std::string tintegrate::handle_char(bool del, int x, int y, const bool backspace
 			} else {
 				tmp_pos = loc.it->pos;
 			}
-			tintegrate integrate(ret, maximum_width_, maximum_height_, default_font_size_, default_font_color_, true);
-			new_pt = integrate.calculate_cursor(tmp_pos);
+			if (new_src_pos) {
+				*new_src_pos = tmp_pos;
+			} else {
+				tintegrate integrate(ret, maximum_width_, maximum_height_, default_font_size_, default_font_color_, true);
+				new_pt = integrate.calculate_cursor(tmp_pos);
+			}
 
 		} else {
 			if (loc.it->text_type()) {
@@ -1807,8 +1853,12 @@ std::string tintegrate::handle_char(bool del, int x, int y, const bool backspace
 		} else {
 			tmp_pos = loc.it->pos;
 		}
-		tintegrate integrate(ret, maximum_width_, maximum_height_, default_font_size_, default_font_color_, true);
-		new_pt = integrate.calculate_cursor(tmp_pos);
+		if (new_src_pos) {
+			*new_src_pos = tmp_pos;
+		} else {
+			tintegrate integrate(ret, maximum_width_, maximum_height_, default_font_size_, default_font_color_, true);
+			new_pt = integrate.calculate_cursor(tmp_pos);
+		}
 
 	} else if (!new_pt_cacluated) {
 		std::string::const_iterator it = loc.it->text.begin();
@@ -1928,7 +1978,7 @@ int tintegrate::calculate_src_pos(int x, int y) const
 	return src_pos;
 }
 
-std::string tintegrate::insert_str(bool text, int x, int y, const std::string& str, SDL_Rect& new_pt) const
+std::string tintegrate::insert_str(bool text, int x, int y, const std::string& str, SDL_Rect& new_pt, int* new_src_pos) const
 {
 	std::string ret;
 
@@ -1938,6 +1988,10 @@ std::string tintegrate::insert_str(bool text, int x, int y, const std::string& s
 	}
 
 	if (src_.empty()) {
+		if (new_src_pos) {
+			*new_src_pos = str.size();
+			return str;
+		}
 		tintegrate integrate(str, maximum_width_, maximum_height_, default_font_size_, default_font_color_, true);
 		// goto end
 		new_pt = integrate.editable_at2(str.size());
@@ -1982,8 +2036,12 @@ std::string tintegrate::insert_str(bool text, int x, int y, const std::string& s
 			tmp_pos += loc.it->src_size;
 		}
 	}
-	tintegrate integrate(ret, maximum_width_, maximum_height_, default_font_size_, default_font_color_, true);
-	new_pt = integrate.calculate_cursor(tmp_pos);
+	if (new_src_pos) {
+		*new_src_pos = tmp_pos;
+	} else {
+		tintegrate integrate(ret, maximum_width_, maximum_height_, default_font_size_, default_font_color_, true);
+		new_pt = integrate.calculate_cursor(tmp_pos);
+	}
 
 	return ret;
 }
@@ -2033,3 +2091,126 @@ void tintegrate::clear()
 	src_.clear();
 	items_.clear();
 }
+
+namespace {
+
+// '\n' at this position ends a paragraph unless it is escaped.
+bool paragraph_lf(const std::string& src, int at)
+{
+	return src[at] == '\n' && (!at || src[at - 1] != '\\');
+}
+
+}
+
+void tintegrate::set_src(const std::string& src)
+{
+	VALIDATE(!exist_anim_ && bubble_anims_.empty(), null_str);
+
+	if (relayout(src)) {
+		return;
+	}
+	src_ = editable_? src: null_str;
+	items_.clear();
+	last_row_.clear();
+	curr_loc_ = std::make_pair(0, 0);
+	curr_row_height_ = min_row_height_;
+	contents_height_ = 0;
+	maximum_width_ = posix_align_floor(original_maximum_width_, gui2::twidget::hdpi_scale);
+	plain_ = true;
+	floating_items_ = 0;
+
+	layout(src);
+}
+
+bool tintegrate::relayout(const std::string& src)
+{
+	const int original_width = posix_align_floor(original_maximum_width_, gui2::twidget::hdpi_scale);
+	// with floating image or widened row, a paragraph's layout depends on ones before it.
+	if (!editable_ || !plain_ || floating_items_ || maximum_width_ != original_width || items_.empty()) {
+		return false;
+	}
+
+	const int old_size = src_.size();
+	const int new_size = src.size();
+	const int common = std::min(old_size, new_size);
+	int prefix = std::mismatch(src_.begin(), src_.begin() + common, src.begin()).first - src_.begin();
+	int suffix = std::mismatch(src_.rbegin(), src_.rbegin() + (common - prefix), src.rbegin()).first - src_.rbegin();
+	const int delta = new_size - old_size;
+
+	// widen edit to whole paragraphs: [from, old_to) in old src, [from, new_to) in new src.
+	int from = prefix;
+	while (from && !paragraph_lf(src_, from - 1)) {
+		from --;
+	}
+	int old_to = old_size - suffix;
+	while (old_to < old_size && !(paragraph_lf(src_, old_to) && paragraph_lf(src, old_to + delta))) {
+		old_to ++;
+	}
+	if (old_to < old_size) {
+		old_to ++;
+	}
+	const int new_to = old_to + delta;
+
+	// new paragraphs must be plain text too.
+	for (int at = from; at < new_to; at ++) {
+		if (src[at] == '\\') {
+			if (++ at == new_to) {
+				return false;
+			}
+		} else if (src[at] == '<') {
+			return false;
+		}
+	}
+
+	std::list<titem>::iterator first = items_.end(), last = items_.end();
+	const titem* before = NULL;
+	for (std::list<titem>::iterator it = items_.begin(); it != items_.end(); ++ it) {
+		const titem& item = *it;
+		if (first == items_.end()) {
+			if (item.pos < from) {
+				before = &item;
+				continue;
+			}
+			first = it;
+		}
+		if (item.pos >= old_to) {
+			last = it;
+			break;
+		}
+	}
+	if (before && before->pos + before->src_size > from) {
+		return false;
+	}
+	const int top = before? before->holden_rect.y + before->holden_rect.h: 0;
+	const int old_bottom = last != items_.end()? last->holden_rect.y: 0;
+
+	std::list<titem> tail;
+	tail.splice(tail.begin(), items_, last, items_.end());
+	items_.erase(first, items_.end());
+
+	// paragraph starts at a fresh row, same state as down_one_line leaves.
+	src_ = src;
+	last_row_.clear();
+	curr_loc_ = std::make_pair(0, top);
+	curr_row_height_ = min_row_height_;
+	contents_height_ = top;
+	add_text_item(from, from, drop_escape(src_.substr(from, new_to - from)), default_font_color_);
+	if (new_to == new_size) {
+		down_one_line(); // End the last line.
+	}
+	if (maximum_width_ != original_width) {
+		return false;
+	}
+
+	const int dy = curr_loc_.second - old_bottom;
+	for (std::list<titem>::iterator it = tail.begin(); it != tail.end(); ++ it) {
+		titem& item = *it;
+		item.tag_pos += delta;
+		item.pos += delta;
+		item.rect.y += dy;
+		item.holden_rect.y += dy;
+		contents_height_ = std::max<int>(contents_height_, item.holden_rect.y + item.holden_rect.h);
+	}
+	items_.splice(items_.end(), tail);
+	return true;
+}
@@ -46,7 +46,8 @@ public:
 	static std::string stuff_escape(const std::string& str);
 	static std::string drop_escape(const std::string& str);
 
-	tintegrate(const std::string& src, int maximum_width, int maximum_height, int default_font_size, const SDL_Color& default_font_color, bool editable = false);
+	// measure_only: lay out with sizes of text, don't render it. only get_size is valid, get_surface isn't.
+	tintegrate(const std::string& src, int maximum_width, int maximum_height, int default_font_size, const SDL_Color& default_font_color, bool editable = false, bool measure_only = false);
 	~tintegrate();
 
 	int get_src_text_size(int pos, const std::string& text) const;
@@ -66,9 +67,11 @@ public:
 	int calculate_src_pos(int x, int y) const;
 	bool at_end(int x, int y) const;
 	std::string before_str(int x, int y) const;
-	std::string handle_selection(int startx, int starty, int endx, int endy, SDL_Rect* new_pt) const;
-	std::string handle_char(bool del, int startx, int starty, const bool backspace, SDL_Rect& new_pt) const;
-	std::string insert_str(bool text, int x, int y, const std::string& str, SDL_Rect& new_pt) const;
+	// @new_src_pos: if not NULL, receive cursor as position in returned src, and new_pt isn't calculated.
+	// caller calls calculate_cursor after it has laid out returned src, so edit doesn't lay out whole text twice.
+	std::string handle_selection(int startx, int starty, int endx, int endy, SDL_Rect* new_pt, int* new_src_pos = NULL) const;
+	std::string handle_char(bool del, int startx, int starty, const bool backspace, SDL_Rect& new_pt, int* new_src_pos = NULL) const;
+	std::string insert_str(bool text, int x, int y, const std::string& str, SDL_Rect& new_pt, int* new_src_pos = NULL) const;
 	SDL_Rect key_arrow(int x, int y, bool up) const;
 	surface magnifier_surf(const SDL_Rect& cursor_rect, int& cursor_x_offset) const;
 	
@@ -167,7 +170,15 @@ public:
 	bool empty() const { return items_.empty(); }
 	void clear();
 
+	// lay out src again with same width and font. when both old and new src are plain text,
+	// only paragraphs that edit touched are laid out, items after them are moved.
+	// require no anim and no bubble.
+	void set_src(const std::string& src);
+
 private:
+	void layout(const std::string& src);
+	bool relayout(const std::string& src);
+
 	/// Convert a string to an alignment. Throw parse_error if
 	/// unsuccessful.
 	ALIGNMENT str_to_align(const std::string &s);
@@ -251,6 +262,7 @@ private:
 private:
 	std::string src_;
 	bool editable_;
+	const bool measure_only_;
 	std::list<titem> items_;
 	std::list<titem *> last_row_;
 	const int title_spacing_;
@@ -270,6 +282,9 @@ private:
 	bool exist_anim_;
 	std::map<int, int> anims_;
 	std::vector<tlocator> bubble_anims_;
+	// src has no markup. paragraphs of plain text can be laid out independently.
+	bool plain_;
+	int floating_items_;
 	SDL_Point layout_offset_;
 };
 
@@ -23,6 +23,7 @@
 #include "serialization/parser.hpp"
 #include "serialization/preprocessor.hpp"
 #include "loadscreen.hpp"
+#include "xwml.hpp"
 
 #include <stdexcept>
 #include <clocale>
@@ -85,25 +86,44 @@ const t_string& symbol_table::operator[](const char* key) const
 	return (*this)[std::string(key)];
 }
 
+// @lang is config or tconfig_view.
+template<typename T>
+static void add_known_language(const T& lang)
+{
+	known_languages.push_back(
+		language_def(lang["locale"], lang["name"], lang["dir"],
+		             lang["alternates"], lang["sort_name"]));
+}
+
 bool load_language_list()
 {
+	const std::string fname = game_config::path + "/xwml/" + "language.bin";
+	// only attributes of [locale] are decoded.
+	txwml_view view(fname);
 	config cfg;
-	try {
-		wml_config_from_file(game_config::path + "/xwml/" + "language.bin", cfg);
-		
-	} catch(config::error &) {
-		return false;
+	if (!view.valid()) {
+		try {
+			wml_config_from_file(fname, cfg);
+			
+		} catch(config::error &) {
+			return false;
+		}
 	}
 
 	known_languages.clear();
 	known_languages.push_back(
 		language_def("", _("System default language"), "ltr", "", "A"));
 
-	BOOST_FOREACH (const config &lang, cfg.child_range("locale"))
-	{
-		known_languages.push_back(
-			language_def(lang["locale"], lang["name"], lang["dir"],
-			             lang["alternates"], lang["sort_name"]));
+	if (view.valid()) {
+		for (tconfig_view lang = view.root().child("locale"); lang.valid(); lang = lang.next_sibling()) {
+			if (lang.key() == "locale") {
+				add_known_language(lang);
+			}
+		}
+	} else {
+		BOOST_FOREACH (const config &lang, cfg.child_range("locale")) {
+			add_known_language(lang);
+		}
 	}
 
 	return true;
@@ -30,6 +30,7 @@
 #include "image.hpp"
 #include "wml_exception.hpp"
 #include "rose_config.hpp"
+#include "thread.hpp"
 
 #include <SDL_events.h>
 #include <SDL_image.h>
@@ -347,21 +348,31 @@ void loadscreen::dump_counters() const
 
 set_increment_progress::fn_increment_progress set_increment_progress::increment_progress = NULL;
 void* set_increment_progress::ctx = NULL;
+// bins may be preprocessed on several threads. callback is run under mutex, so it needn't be
+// thread safe itself, and set_increment_progress can't change it while it runs.
+static threading::mutex& progress_mutex()
+{
+	static threading::mutex mutex;
+	return mutex;
+}
 
 set_increment_progress::set_increment_progress(fn_increment_progress fn, void* ctx) :
 	old_(increment_progress)
 {
+	threading::lock lock(progress_mutex());
 	set_increment_progress::increment_progress = fn;
 	set_increment_progress::ctx = ctx;
 }
 
 set_increment_progress::~set_increment_progress()
 {
+	threading::lock lock(progress_mutex());
 	set_increment_progress::increment_progress = old_;
 }
 
 void increment_preprocessor_progress(std::string const &name, bool is_file)
 {
+	threading::lock lock(progress_mutex());
 	if (set_increment_progress::increment_progress) {
 		set_increment_progress::increment_progress(name, is_file, set_increment_progress::ctx);
 	}
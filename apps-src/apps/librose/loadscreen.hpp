@@ -100,7 +100,8 @@ private:
 
 void increment_preprocessor_progress(std::string const &name, bool is_file);
 
-void wml_config_to_file(const std::string &fname, const config &cfg, uint32_t nfiles = 0, uint32_t sum_size = 0, uint32_t modified = 0, const std::map<std::string, std::string>& app_domains = std::map<std::string, std::string>());
+// @index_section: append index section that txwml_view reads, see xwml.hpp.
+void wml_config_to_file(const std::string &fname, const config &cfg, uint32_t nfiles = 0, uint32_t sum_size = 0, uint32_t modified = 0, const std::map<std::string, std::string>& app_domains = std::map<std::string, std::string>(), bool index_section = false);
 void wml_config_from_file(const std::string &fname, config &cfg, uint32_t* nfiles = NULL, uint32_t* sum_size = NULL, uint32_t* modified = NULL);
 bool wml_checksum_from_file(const std::string &fname, uint32_t* nfiles = NULL, uint32_t* sum_size = NULL, uint32_t* modified = NULL);
 unsigned char calcuate_xor_from_file(const std::string &fname);
@@ -0,0 +1,153 @@
+#define GETTEXT_DOMAIN "rose-lib"
+
+#include "global.hpp"
+#include "render_target_pool.hpp"
+#include "wml_exception.hpp"
+
+trender_target_pool& trender_target_pool::singleton()
+{
+	// never destroyed, canvases may drop their textures during exit.
+	static trender_target_pool* pool = new trender_target_pool;
+	return *pool;
+}
+
+trender_target_pool::trender_target_pool()
+	: renderer_(NULL)
+	, generation_(0)
+	, stamp_(0)
+	, budget_(32 * 1024 * 1024)
+	, counters_()
+	, idle_()
+{
+}
+
+int trender_target_pool::round_size(int size)
+{
+	// coarser steps for larger textures keep waste under about 1/8.
+	const int step = size <= 128? 16: (size <= 512? 32: 64);
+	return (size + step - 1) / step * step;
+}
+
+uint64_t trender_target_pool::make_key(uint32_t format, int width, int height)
+{
+	return (static_cast<uint64_t>(format) << 32) | (static_cast<uint64_t>(width) << 16) | static_cast<uint64_t>(height);
+}
+
+texture trender_target_pool::lease(SDL_Renderer* renderer, uint32_t format, int width, int height)
+{
+	VALIDATE(renderer && width > 0 && height > 0, null_str);
+
+	if (renderer != renderer_) {
+		clear();
+		renderer_ = renderer;
+	}
+
+	int rounded_width = round_size(width);
+	int rounded_height = round_size(height);
+	SDL_RendererInfo info;
+	if (SDL_GetRendererInfo(renderer, &info) == 0) {
+		if (info.max_texture_width && rounded_width > info.max_texture_width) {
+			rounded_width = width;
+		}
+		if (info.max_texture_height && rounded_height > info.max_texture_height) {
+			rounded_height = height;
+		}
+	}
+	const uint64_t key = make_key(format, rounded_width, rounded_height);
+
+	SDL_Texture* tex = NULL;
+	std::map<uint64_t, std::vector<tidle> >::iterator it = idle_.find(key);
+	if (it != idle_.end() && !it->second.empty()) {
+		const tidle& idle = it->second.back();
+		tex = idle.tex;
+		counters_.idle_bytes -= idle.bytes;
+		it->second.pop_back();
+		counters_.reuses ++;
+
+		// previous user may leave modulation.
+		SDL_SetTextureColorMod(tex, 255, 255, 255);
+		SDL_SetTextureAlphaMod(tex, 255);
+	} else {
+		tex = SDL_CreateTexture(renderer, format, SDL_TEXTUREACCESS_TARGET, rounded_width, rounded_height);
+		if (!tex) {
+			// maybe out of video memory, release idle ones and retry.
+			clear();
+			renderer_ = renderer;
+			tex = SDL_CreateTexture(renderer, format, SDL_TEXTUREACCESS_TARGET, rounded_width, rounded_height);
+			if (!tex) {
+				return texture();
+			}
+		}
+		counters_.creations ++;
+	}
+
+	texture ret;
+	static_cast<boost::shared_ptr<SDL_Texture>&>(ret).reset(tex, treturner(*this, key, generation_));
+	return ret;
+}
+
+void trender_target_pool::give_back(SDL_Texture* tex, uint64_t key, int generation)
+{
+	if (generation != generation_) {
+		// created by a renderer that pool has been cleared for.
+		SDL_DestroyTexture(tex);
+		return;
+	}
+
+	const int width = static_cast<int>((key >> 16) & 0xffff);
+	const int height = static_cast<int>(key & 0xffff);
+	const size_t bytes = static_cast<size_t>(width) * height * SDL_BYTESPERPIXEL(static_cast<uint32_t>(key >> 32));
+	if (bytes > budget_) {
+		SDL_DestroyTexture(tex);
+		counters_.evictions ++;
+		return;
+	}
+	trim(budget_ - bytes);
+
+	tidle idle;
+	idle.tex = tex;
+	idle.bytes = bytes;
+	idle.stamp = stamp_ ++;
+	idle_[key].push_back(idle);
+	counters_.idle_bytes += bytes;
+}
+
+void trender_target_pool::trim(size_t bytes)
+{
+	// destroy least recently returned until idle ones fit in bytes. pool holds tens of textures, scan is cheap.
+	while (counters_.idle_bytes > bytes) {
+		std::map<uint64_t, std::vector<tidle> >::iterator oldest = idle_.end();
+		for (std::map<uint64_t, std::vector<tidle> >::iterator it = idle_.begin(); it != idle_.end(); ++ it) {
+			if (!it->second.empty() && (oldest == idle_.end() || it->second.front().stamp < oldest->second.front().stamp)) {
+				oldest = it;
+			}
+		}
+		if (oldest == idle_.end()) {
+			break;
+		}
+		const tidle& idle = oldest->second.front();
+		SDL_DestroyTexture(idle.tex);
+		counters_.idle_bytes -= idle.bytes;
+		counters_.evictions ++;
+		oldest->second.erase(oldest->second.begin());
+	}
+}
+
+void trender_target_pool::clear()
+{
+	for (std::map<uint64_t, std::vector<tidle> >::const_iterator it = idle_.begin(); it != idle_.end(); ++ it) {
+		for (std::vector<tidle>::const_iterator it2 = it->second.begin(); it2 != it->second.end(); ++ it2) {
+			SDL_DestroyTexture(it2->tex);
+		}
+	}
+	idle_.clear();
+	counters_.idle_bytes = 0;
+	renderer_ = NULL;
+	generation_ ++;
+}
+
+void trender_target_pool::set_budget(size_t bytes)
+{
+	budget_ = bytes;
+	trim(budget_);
+}
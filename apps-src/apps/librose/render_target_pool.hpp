@@ -0,0 +1,89 @@
+#ifndef LIBROSE_RENDER_TARGET_POOL_HPP_INCLUDED
+#define LIBROSE_RENDER_TARGET_POOL_HPP_INCLUDED
+
+#include "sdl_utils.hpp"
+
+#include <map>
+#include <vector>
+
+//
+// reusable SDL_TEXTUREACCESS_TARGET textures, so redrawing a canvas doesn't create a texture.
+// lease returns texture whose size is requested size rounded up, caller must draw and copy
+// with explicit rects. when last reference of leased texture is dropped, texture goes back
+// to pool instead of SDL_DestroyTexture. idle textures are kept up to budget bytes, least
+// recently returned ones are destroyed first.
+// textures belong to one renderer, video calls clear before it destroys renderer.
+//
+class trender_target_pool
+{
+public:
+	struct tcounters
+	{
+		tcounters()
+			: creations(0)
+			, reuses(0)
+			, evictions(0)
+			, idle_bytes(0)
+		{}
+
+		int creations;
+		int reuses;
+		int evictions;
+		size_t idle_bytes;
+	};
+
+	static trender_target_pool& singleton();
+
+	texture lease(SDL_Renderer* renderer, uint32_t format, int width, int height);
+
+	// destroy idle textures. textures that are leased now are destroyed when they are dropped.
+	void clear();
+
+	void set_budget(size_t bytes);
+	size_t budget() const { return budget_; }
+	const tcounters& counters() const { return counters_; }
+
+	// size that lease rounds width or height to.
+	static int round_size(int size);
+
+private:
+	trender_target_pool();
+
+	struct tidle
+	{
+		SDL_Texture* tex;
+		size_t bytes;
+		uint32_t stamp;
+	};
+
+	class treturner
+	{
+	public:
+		treturner(trender_target_pool& pool, uint64_t key, int generation)
+			: pool_(&pool)
+			, key_(key)
+			, generation_(generation)
+		{}
+
+		void operator()(SDL_Texture* tex) const { pool_->give_back(tex, key_, generation_); }
+
+	private:
+		trender_target_pool* pool_;
+		uint64_t key_;
+		int generation_;
+	};
+
+	static uint64_t make_key(uint32_t format, int width, int height);
+	void give_back(SDL_Texture* tex, uint64_t key, int generation);
+	void trim(size_t bytes);
+
+private:
+	SDL_Renderer* renderer_;
+	int generation_;
+	uint32_t stamp_;
+	size_t budget_;
+	tcounters counters_;
+	std::map<uint64_t, std::vector<tidle> > idle_;
+};
+
+#endif
@@ -0,0 +1,409 @@
+#define GETTEXT_DOMAIN "rose-lib"
+
+#include "global.hpp"
+#include "sdl_pixel.hpp"
+
+#include <algorithm>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PIXEL_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+inline uint32_t pack_bgra(int blue, int green, int red, int alpha)
+{
+	return (alpha << 24) | (red << 16) | (green << 8) | blue;
+}
+
+#if defined(PIXEL_SSE2)
+// keep pixel of src where alpha is 0, result elsewhere.
+inline __m128i keep_transparent(__m128i src, __m128i result)
+{
+	const __m128i transparent = _mm_cmpeq_epi32(_mm_and_si128(src, _mm_set1_epi32(0xff000000)), _mm_setzero_si128());
+	return _mm_or_si128(_mm_and_si128(transparent, src), _mm_andnot_si128(transparent, result));
+}
+
+// one pixel to {b, g, r, a} int32.
+inline __m128i unpack_pixel(uint32_t pixel)
+{
+	const __m128i zero = _mm_setzero_si128();
+	return _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(pixel), zero), zero);
+}
+
+inline uint32_t pack_pixel(__m128i v)
+{
+	const __m128i zero = _mm_setzero_si128();
+	return _mm_cvtsi128_si32(_mm_packus_epi16(_mm_packs_epi32(v, zero), zero));
+}
+#endif
+
+}
+
+void pixel_add(uint32_t* pixels, int count, int red, int green, int blue, int alpha)
+{
+	int at = 0;
+#if defined(PIXEL_SSE2)
+	{
+		// only one of add and sub is non-zero for every channel, so adds + subs is clamp(c + delta).
+		const uint32_t add = pack_bgra(std::min(255, std::max(0, blue)), std::min(255, std::max(0, green)), std::min(255, std::max(0, red)), std::min(255, std::max(0, alpha)));
+		const uint32_t sub = pack_bgra(std::min(255, std::max(0, -blue)), std::min(255, std::max(0, -green)), std::min(255, std::max(0, -red)), std::min(255, std::max(0, -alpha)));
+		const __m128i vadd = _mm_set1_epi32(add);
+		const __m128i vsub = _mm_set1_epi32(sub);
+		for (; at + 4 <= count; at += 4) {
+			const __m128i src = _mm_loadu_si128((const __m128i*)(pixels + at));
+			const __m128i result = _mm_subs_epu8(_mm_adds_epu8(src, vadd), vsub);
+			_mm_storeu_si128((__m128i*)(pixels + at), keep_transparent(src, result));
+		}
+	}
+#endif
+	for (; at < count; at ++) {
+		const uint32_t pixel = pixels[at];
+		if (!(pixel >> 24)) {
+			continue;
+		}
+		const int b = std::max(0, std::min(255, int(pixel & 0xff) + blue));
+		const int g = std::max(0, std::min(255, int((pixel >> 8) & 0xff) + green));
+		const int r = std::max(0, std::min(255, int((pixel >> 16) & 0xff) + red));
+		const int a = std::max(0, std::min(255, int(pixel >> 24) + alpha));
+		pixels[at] = pack_bgra(b, g, r, a);
+	}
+}
+
+void pixel_multiply(uint32_t* pixels, int count, int red, int green, int blue, int alpha)
+{
+	// channel * 65535 >> 8 is already saturated for every non-zero channel.
+	red = std::max(0, std::min(65535, red));
+	green = std::max(0, std::min(65535, green));
+	blue = std::max(0, std::min(65535, blue));
+	alpha = std::max(0, std::min(65535, alpha));
+
+	int at = 0;
+#if defined(PIXEL_SSE2)
+	{
+		// (c << 8) * f >> 16 == c * f >> 8, and c << 8 fits in uint16.
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i max = _mm_set1_epi16(255);
+		const __m128i factor = _mm_set_epi16(alpha, red, green, blue, alpha, red, green, blue);
+		for (; at + 4 <= count; at += 4) {
+			const __m128i src = _mm_loadu_si128((const __m128i*)(pixels + at));
+			__m128i lo = _mm_mulhi_epu16(_mm_slli_epi16(_mm_unpacklo_epi8(src, zero), 8), factor);
+			__m128i hi = _mm_mulhi_epu16(_mm_slli_epi16(_mm_unpackhi_epi8(src, zero), 8), factor);
+			// min(v, 255) by v - max(v - 255, 0).
+			lo = _mm_sub_epi16(lo, _mm_subs_epu16(lo, max));
+			hi = _mm_sub_epi16(hi, _mm_subs_epu16(hi, max));
+			_mm_storeu_si128((__m128i*)(pixels + at), keep_transparent(src, _mm_packus_epi16(lo, hi)));
+		}
+	}
+#endif
+	for (; at < count; at ++) {
+		const uint32_t pixel = pixels[at];
+		if (!(pixel >> 24)) {
+			continue;
+		}
+		const int b = std::min<unsigned>(((pixel & 0xff) * blue) >> 8, 255);
+		const int g = std::min<unsigned>((((pixel >> 8) & 0xff) * green) >> 8, 255);
+		const int r = std::min<unsigned>((((pixel >> 16) & 0xff) * red) >> 8, 255);
+		const int a = std::min<unsigned>(((pixel >> 24) * alpha) >> 8, 255);
+		pixels[at] = pack_bgra(b, g, r, a);
+	}
+}
+
+void pixel_greyscale(uint32_t* pixels, int count)
+{
+	int at = 0;
+#if defined(PIXEL_SSE2)
+	{
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i weights = _mm_set_epi16(0, 77, 150, 29, 0, 77, 150, 29);
+		const __m128i alpha_mask = _mm_set1_epi32(0xff000000);
+		for (; at + 4 <= count; at += 4) {
+			const __m128i src = _mm_loadu_si128((const __m128i*)(pixels + at));
+			// {29b + 150g, 77r} of every pixel, then add the pair.
+			__m128i lo = _mm_madd_epi16(_mm_unpacklo_epi8(src, zero), weights);
+			__m128i hi = _mm_madd_epi16(_mm_unpackhi_epi8(src, zero), weights);
+			lo = _mm_shuffle_epi32(_mm_add_epi32(lo, _mm_srli_epi64(lo, 32)), _MM_SHUFFLE(3, 1, 2, 0));
+			hi = _mm_shuffle_epi32(_mm_add_epi32(hi, _mm_srli_epi64(hi, 32)), _MM_SHUFFLE(3, 1, 2, 0));
+			const __m128i avg = _mm_srli_epi32(_mm_unpacklo_epi64(lo, hi), 8);
+			const __m128i grey = _mm_or_si128(_mm_or_si128(avg, _mm_slli_epi32(avg, 8)), _mm_slli_epi32(avg, 16));
+			_mm_storeu_si128((__m128i*)(pixels + at), keep_transparent(src, _mm_or_si128(_mm_and_si128(src, alpha_mask), grey)));
+		}
+	}
+#endif
+	for (; at < count; at ++) {
+		const uint32_t pixel = pixels[at];
+		if (!(pixel >> 24)) {
+			continue;
+		}
+		const uint32_t avg = (77 * ((pixel >> 16) & 0xff) + 150 * ((pixel >> 8) & 0xff) + 29 * (pixel & 0xff)) >> 8;
+		pixels[at] = (pixel & 0xff000000) | (avg << 16) | (avg << 8) | avg;
+	}
+}
+
+void pixel_light(uint32_t* pixels, const uint32_t* light, int count)
+{
+	int at = 0;
+#if defined(PIXEL_SSE2)
+	{
+		const __m128i half = _mm_set1_epi8((char)128);
+		const __m128i rgb_mask = _mm_set1_epi32(0x00ffffff);
+		for (; at + 4 <= count; at += 4) {
+			const __m128i src = _mm_loadu_si128((const __m128i*)(pixels + at));
+			const __m128i l = _mm_loadu_si128((const __m128i*)(light + at));
+			const __m128i add = _mm_and_si128(_mm_subs_epu8(l, half), rgb_mask);
+			const __m128i sub = _mm_and_si128(_mm_subs_epu8(half, l), rgb_mask);
+			const __m128i result = _mm_subs_epu8(_mm_adds_epu8(src, add), sub);
+			_mm_storeu_si128((__m128i*)(pixels + at), keep_transparent(src, result));
+		}
+	}
+#endif
+	for (; at < count; at ++) {
+		const uint32_t pixel = pixels[at];
+		if (!(pixel >> 24)) {
+			continue;
+		}
+		const uint32_t l = light[at];
+		const int b = std::max(0, std::min(255, int(pixel & 0xff) + int(l & 0xff) - 128));
+		const int g = std::max(0, std::min(255, int((pixel >> 8) & 0xff) + int((l >> 8) & 0xff) - 128));
+		const int r = std::max(0, std::min(255, int((pixel >> 16) & 0xff) + int((l >> 16) & 0xff) - 128));
+		pixels[at] = pack_bgra(b, g, r, pixel >> 24);
+	}
+}
+
+bool pixel_mask(uint32_t* pixels, const uint32_t* mask, int count)
+{
+	uint32_t alphas = 0;
+	int at = 0;
+#if defined(PIXEL_SSE2)
+	{
+		const __m128i rgb_mask = _mm_set1_epi32(0x00ffffff);
+		__m128i any = _mm_setzero_si128();
+		for (; at + 4 <= count; at += 4) {
+			const __m128i src = _mm_loadu_si128((const __m128i*)(pixels + at));
+			const __m128i m = _mm_or_si128(_mm_loadu_si128((const __m128i*)(mask + at)), rgb_mask);
+			// min of rgb and 0xff is rgb itself, so only alpha is changed.
+			const __m128i result = _mm_min_epu8(src, m);
+			any = _mm_or_si128(any, result);
+			_mm_storeu_si128((__m128i*)(pixels + at), result);
+		}
+		any = _mm_or_si128(any, _mm_srli_si128(any, 8));
+		any = _mm_or_si128(any, _mm_srli_si128(any, 4));
+		alphas = _mm_cvtsi128_si32(any) & 0xff000000;
+	}
+#endif
+	for (; at < count; at ++) {
+		const uint32_t pixel = pixels[at];
+		const uint32_t alpha = std::min(pixel >> 24, mask[at] >> 24);
+		pixels[at] = (alpha << 24) | (pixel & 0x00ffffff);
+		alphas |= alpha;
+	}
+	return !alphas;
+}
+
+void pixel_lut(uint32_t* pixels, int count, const uint8_t* red, const uint8_t* green, const uint8_t* blue)
+{
+	for (int at = 0; at < count; at ++) {
+		const uint32_t pixel = pixels[at];
+		pixels[at] = (pixel & 0xff000000) | (red[(pixel >> 16) & 0xff] << 16) | (green[(pixel >> 8) & 0xff] << 8) | blue[pixel & 0xff];
+	}
+}
+
+const uint32_t tcolor_lut::npos;
+
+tcolor_lut::tcolor_lut(const std::map<uint32_t, uint32_t>& map)
+	: keys_()
+	, values_()
+	, size_(map.size())
+	, mask_(0)
+	, shift_(0)
+{
+	// load factor <= 1/4, probe sequence is short.
+	int bits = 4;
+	while ((1 << bits) < size_ * 4) {
+		bits ++;
+	}
+	keys_.resize(1 << bits, npos);
+	values_.resize(1 << bits, 0);
+	mask_ = (1 << bits) - 1;
+	shift_ = 32 - bits;
+
+	for (std::map<uint32_t, uint32_t>::const_iterator it = map.begin(); it != map.end(); ++ it) {
+		uint32_t pos = hash(it->first);
+		while (keys_[pos] != npos) {
+			pos = (pos + 1) & mask_;
+		}
+		keys_[pos] = it->first;
+		values_[pos] = it->second;
+	}
+}
+
+void pixel_recolor(uint32_t* pixels, int count, const tcolor_lut& lut)
+{
+	if (lut.empty()) {
+		return;
+	}
+	// neighbour pixels usually have same color, remember the last one.
+	uint32_t last_rgb = 0xffffffff, last_result = 0;
+	bool last_found = false;
+	for (int at = 0; at < count; at ++) {
+		const uint32_t pixel = pixels[at];
+		if (!(pixel >> 24)) {
+			// don't recolor invisible pixels.
+			continue;
+		}
+		const uint32_t rgb = pixel & 0x00ffffff;
+		if (rgb != last_rgb) {
+			last_rgb = rgb;
+			last_found = lut.find(rgb, last_result);
+		}
+		if (last_found) {
+			pixels[at] = (pixel & 0xff000000) | last_result;
+		}
+	}
+}
+
+namespace {
+
+//
+// blur. running sum of window, every pixel adds entering one and subtracts leaving one.
+// horizontal pass runs on copy of row. vertical pass keeps a sum per column and walks down
+// row by row, so it reads memory contiguously. the last (depth + 1) source rows are kept,
+// they're subtracted after being overwritten.
+//
+struct tblur_sum
+{
+	int32_t c[4];
+};
+
+#if defined(PIXEL_SSE2)
+// sum / count, truncated. sum <= 255 * 513 is exact in float, and error of multiplying with
+// reciprocal is far below 1/1024, while fraction of a non-integer quotient is at least 1/513.
+inline __m128i blur_divide(__m128i sum, float reciprocal)
+{
+	const __m128 q = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(sum), _mm_set1_ps(reciprocal)), _mm_set1_ps(1.0f / 1024));
+	return _mm_cvttps_epi32(q);
+}
+#endif
+
+void blur_horizontal(uint32_t* row, uint32_t* copy, int w, int depth, uint32_t alpha_or, const std::vector<float>& reciprocals)
+{
+	memcpy(copy, row, w * 4);
+	int count = 0;
+
+#if defined(PIXEL_SSE2)
+	__m128i sum = _mm_setzero_si128();
+	for (int x = 0; x <= depth && x < w; x ++) {
+		sum = _mm_add_epi32(sum, unpack_pixel(copy[x]));
+		count ++;
+	}
+	for (int x = 0; x < w; x ++) {
+		row[x] = pack_pixel(blur_divide(sum, reciprocals[count])) | alpha_or;
+		if (x >= depth) {
+			sum = _mm_sub_epi32(sum, unpack_pixel(copy[x - depth]));
+			count --;
+		}
+		if (x + depth + 1 < w) {
+			sum = _mm_add_epi32(sum, unpack_pixel(copy[x + depth + 1]));
+			count ++;
+		}
+	}
+
+#else
+	uint32_t b = 0, g = 0, r = 0, a = 0;
+	for (int x = 0; x <= depth && x < w; x ++) {
+		const uint32_t pixel = copy[x];
+		b += pixel & 0xff; g += (pixel >> 8) & 0xff; r += (pixel >> 16) & 0xff; a += pixel >> 24;
+		count ++;
+	}
+	for (int x = 0; x < w; x ++) {
+		row[x] = pack_bgra(b / count, g / count, r / count, a / count) | alpha_or;
+		if (x >= depth) {
+			const uint32_t pixel = copy[x - depth];
+			b -= pixel & 0xff; g -= (pixel >> 8) & 0xff; r -= (pixel >> 16) & 0xff; a -= pixel >> 24;
+			count --;
+		}
+		if (x + depth + 1 < w) {
+			const uint32_t pixel = copy[x + depth + 1];
+			b += pixel & 0xff; g += (pixel >> 8) & 0xff; r += (pixel >> 16) & 0xff; a += pixel >> 24;
+			count ++;
+		}
+	}
+#endif
+}
+
+// sums += sign * row
+void blur_accumulate(tblur_sum* sums, const uint32_t* row, int w, bool add)
+{
+	for (int x = 0; x < w; x ++) {
+#if defined(PIXEL_SSE2)
+		__m128i sum = _mm_loadu_si128((const __m128i*)sums[x].c);
+		const __m128i pixel = unpack_pixel(row[x]);
+		sum = add? _mm_add_epi32(sum, pixel): _mm_sub_epi32(sum, pixel);
+		_mm_storeu_si128((__m128i*)sums[x].c, sum);
+#else
+		const uint32_t pixel = row[x];
+		const int sign = add? 1: -1;
+		sums[x].c[0] += sign * int(pixel & 0xff);
+		sums[x].c[1] += sign * int((pixel >> 8) & 0xff);
+		sums[x].c[2] += sign * int((pixel >> 16) & 0xff);
+		sums[x].c[3] += sign * int(pixel >> 24);
+#endif
+	}
+}
+
+void blur_output(uint32_t* row, const tblur_sum* sums, int w, int count, uint32_t alpha_or, const std::vector<float>& reciprocals)
+{
+	for (int x = 0; x < w; x ++) {
+#if defined(PIXEL_SSE2)
+		row[x] = pack_pixel(blur_divide(_mm_loadu_si128((const __m128i*)sums[x].c), reciprocals[count])) | alpha_or;
+#else
+		const int32_t* c = sums[x].c;
+		row[x] = pack_bgra(c[0] / count, c[1] / count, c[2] / count, c[3] / count) | alpha_or;
+#endif
+	}
+}
+
+}
+
+void pixel_blur(uint32_t* pixels, int w, int h, int stride, int depth, bool alpha)
+{
+	if (w <= 0 || h <= 0 || depth <= 0) {
+		return;
+	}
+	const uint32_t alpha_or = alpha? 0: 0xff000000;
+
+	std::vector<float> reciprocals(2 * depth + 2);
+	for (int n = 1; n < (int)reciprocals.size(); n ++) {
+		reciprocals[n] = 1.0f / n;
+	}
+
+	std::vector<uint32_t> copy(w);
+	for (int y = 0; y < h; y ++) {
+		blur_horizontal(pixels + y * stride, &copy[0], w, depth, alpha_or, reciprocals);
+	}
+
+	const int ring_rows = std::min(depth + 1, h);
+	std::vector<uint32_t> ring(ring_rows * w);
+	std::vector<tblur_sum> sums(w);
+	memset(&sums[0], 0, w * sizeof(tblur_sum));
+	int count = 0;
+	for (int y = 0; y <= depth && y < h; y ++) {
+		blur_accumulate(&sums[0], pixels + y * stride, w, true);
+		count ++;
+	}
+	for (int y = 0; y < h; y ++) {
+		uint32_t* row = pixels + y * stride;
+		memcpy(&ring[(y % ring_rows) * w], row, w * 4);
+		blur_output(row, &sums[0], w, count, alpha_or, reciprocals);
+		if (y >= depth) {
+			blur_accumulate(&sums[0], &ring[((y - depth) % ring_rows) * w], w, false);
+			count --;
+		}
+		if (y + depth + 1 < h) {
+			blur_accumulate(&sums[0], pixels + (y + depth + 1) * stride, w, true);
+			count ++;
+		}
+	}
+}
@@ -0,0 +1,74 @@
+#ifndef LIBROSE_SDL_PIXEL_HPP_INCLUDED
+#define LIBROSE_SDL_PIXEL_HPP_INCLUDED
+
+#include <map>
+#include <vector>
+#include <stdint.h>
+
+//
+// per-pixel kernels of 32-bit ARGB, image modification functions in sdl_utils are built on them.
+// every kernel works in place on count contiguous pixels, and leaves pixel whose alpha is 0 as is,
+// except pixel_lut and pixel_blur.
+// kernels use SSE2 when compiler targets it, otherwise portable c.
+//
+
+// channel += delta, saturated to [0, 255].
+void pixel_add(uint32_t* pixels, int count, int red, int green, int blue, int alpha);
+
+// channel = min(255, channel * factor >> 8). factor is fixed_t, 256 is 1.0, negative is 0.
+void pixel_multiply(uint32_t* pixels, int count, int red, int green, int blue, int alpha);
+
+// rgb = (77 * red + 150 * green + 29 * blue) / 256.
+void pixel_greyscale(uint32_t* pixels, int count);
+
+// rgb += light.rgb - 128, saturated.
+void pixel_light(uint32_t* pixels, const uint32_t* light, int count);
+
+// alpha = min(alpha, mask.alpha). return true if alpha of every result pixel is 0.
+bool pixel_mask(uint32_t* pixels, const uint32_t* mask, int count);
+
+// channel = table[channel], for every pixel. alpha isn't changed.
+void pixel_lut(uint32_t* pixels, int count, const uint8_t* red, const uint8_t* green, const uint8_t* blue);
+
+// flat replacement of std::map<Uint32, Uint32> that recolor_image uses. key and value are 0xRRGGBB.
+class tcolor_lut
+{
+public:
+	explicit tcolor_lut(const std::map<uint32_t, uint32_t>& map);
+
+	bool empty() const { return !size_; }
+
+	// return true and set result if rgb is in table.
+	bool find(uint32_t rgb, uint32_t& result) const
+	{
+		for (uint32_t pos = hash(rgb); keys_[pos] != npos; pos = (pos + 1) & mask_) {
+			if (keys_[pos] == rgb) {
+				result = values_[pos];
+				return true;
+			}
+		}
+		return false;
+	}
+
+private:
+	// rgb never has bits 24-31, so this is never a key.
+	static const uint32_t npos = 0xffffffff;
+
+	uint32_t hash(uint32_t rgb) const { return (rgb * 2654435761u) >> shift_; }
+
+private:
+	std::vector<uint32_t> keys_;
+	std::vector<uint32_t> values_;
+	int size_;
+	uint32_t mask_;
+	int shift_;
+};
+
+// rgb = lut[rgb] if rgb is in lut. alpha isn't changed.
+void pixel_recolor(uint32_t* pixels, int count, const tcolor_lut& lut);
+
+// box blur with (2 * depth + 1) window, horizontal pass then vertical pass. stride is in pixels.
+// if alpha is false, alpha isn't blurred and result is opaque.
+void pixel_blur(uint32_t* pixels, int w, int h, int stride, int depth, bool alpha);
+
+#endif
@@ -0,0 +1,421 @@
+#define GETTEXT_DOMAIN "rose-lib"
+
+#include "global.hpp"
+#include "sdl_scale.hpp"
+#include "serialization/string_utils.hpp"
+#include "wml_exception.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <string.h>
+#include <vector>
+
+#if defined(__AVX2__)
+#define SCALE_AVX2 1
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SCALE_SSE2 1
+#endif
+
+#if defined(SCALE_AVX2)
+#include <immintrin.h>
+#elif defined(SCALE_SSE2)
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+//
+// bilinear. vertical pass blends two source rows into one row(contiguous, so it is vectorized
+// easily), horizontal pass picks two neighbour pixels of that row for every destination pixel.
+// weights are 8-bit, 256 is 1.0. c0 * (256 - f) + c1 * f <= 255 * 256, so it fits in uint16.
+//
+struct tbilinear_column
+{
+	int x0;
+	// w0 x 4, w1 x 4. one 128-bit vector.
+	uint16_t weights[8];
+};
+
+// map center of destination pixel to source, 16.16 fixed.
+void bilinear_position(int src, int dst, int at, int& i0, int& f)
+{
+	int64_t pos = ((int64_t)(2 * at + 1) * src << 16) / (2 * dst) - 0x8000;
+	if (pos < 0) {
+		pos = 0;
+	}
+	i0 = (int)(pos >> 16);
+	f = (int)(pos >> 8) & 0xff;
+	if (i0 >= src - 1) {
+		i0 = src - 1;
+		f = 0;
+	}
+}
+
+void bilinear_columns(int src_w, int dst_w, std::vector<tbilinear_column>& columns)
+{
+	columns.resize(dst_w);
+	for (int x = 0; x < dst_w; x ++) {
+		tbilinear_column& column = columns[x];
+		int f;
+		bilinear_position(src_w, dst_w, x, column.x0, f);
+		for (int n = 0; n < 4; n ++) {
+			column.weights[n] = 256 - f;
+			column.weights[4 + n] = f;
+		}
+	}
+}
+
+void blend_rows_c(const uint32_t* row0, const uint32_t* row1, uint32_t* out, int w, int f)
+{
+	const uint8_t* a = (const uint8_t*)row0;
+	const uint8_t* b = (const uint8_t*)row1;
+	uint8_t* c = (uint8_t*)out;
+	const int f0 = 256 - f;
+	for (int n = 0; n < w * 4; n ++) {
+		c[n] = (a[n] * f0 + b[n] * f + 128) >> 8;
+	}
+}
+
+void horizontal_c(const uint32_t* row, const tbilinear_column* columns, uint32_t* dst, int dst_w)
+{
+	for (int x = 0; x < dst_w; x ++) {
+		const tbilinear_column& column = columns[x];
+		const uint8_t* p = (const uint8_t*)(row + column.x0);
+		const int f0 = column.weights[0];
+		const int f = column.weights[4];
+		uint8_t* c = (uint8_t*)(dst + x);
+		c[0] = (p[0] * f0 + p[4] * f + 128) >> 8;
+		c[1] = (p[1] * f0 + p[5] * f + 128) >> 8;
+		c[2] = (p[2] * f0 + p[6] * f + 128) >> 8;
+		c[3] = (p[3] * f0 + p[7] * f + 128) >> 8;
+	}
+}
+
+#if defined(SCALE_SSE2)
+void blend_rows_simd(const uint32_t* row0, const uint32_t* row1, uint32_t* out, int w, int f)
+{
+	const uint8_t* a = (const uint8_t*)row0;
+	const uint8_t* b = (const uint8_t*)row1;
+	uint8_t* c = (uint8_t*)out;
+	const int bytes = w * 4;
+	int n = 0;
+
+#if defined(SCALE_AVX2)
+	{
+		const __m256i zero = _mm256_setzero_si256();
+		const __m256i round = _mm256_set1_epi16(128);
+		const __m256i w0 = _mm256_set1_epi16(256 - f);
+		const __m256i w1 = _mm256_set1_epi16(f);
+		for (; n + 32 <= bytes; n += 32) {
+			const __m256i va = _mm256_loadu_si256((const __m256i*)(a + n));
+			const __m256i vb = _mm256_loadu_si256((const __m256i*)(b + n));
+			__m256i lo = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(va, zero), w0), _mm256_mullo_epi16(_mm256_unpacklo_epi8(vb, zero), w1));
+			__m256i hi = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(va, zero), w0), _mm256_mullo_epi16(_mm256_unpackhi_epi8(vb, zero), w1));
+			lo = _mm256_srli_epi16(_mm256_add_epi16(lo, round), 8);
+			hi = _mm256_srli_epi16(_mm256_add_epi16(hi, round), 8);
+			// unpack and pack are both in-lane, so order is kept.
+			_mm256_storeu_si256((__m256i*)(c + n), _mm256_packus_epi16(lo, hi));
+		}
+	}
+#endif
+
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i round = _mm_set1_epi16(128);
+	const __m128i w0 = _mm_set1_epi16(256 - f);
+	const __m128i w1 = _mm_set1_epi16(f);
+	for (; n + 16 <= bytes; n += 16) {
+		const __m128i va = _mm_loadu_si128((const __m128i*)(a + n));
+		const __m128i vb = _mm_loadu_si128((const __m128i*)(b + n));
+		__m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(va, zero), w0), _mm_mullo_epi16(_mm_unpacklo_epi8(vb, zero), w1));
+		__m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(va, zero), w0), _mm_mullo_epi16(_mm_unpackhi_epi8(vb, zero), w1));
+		lo = _mm_srli_epi16(_mm_add_epi16(lo, round), 8);
+		hi = _mm_srli_epi16(_mm_add_epi16(hi, round), 8);
+		_mm_storeu_si128((__m128i*)(c + n), _mm_packus_epi16(lo, hi));
+	}
+	if (n < bytes) {
+		blend_rows_c((const uint32_t*)(a + n), (const uint32_t*)(b + n), (uint32_t*)(c + n), (bytes - n) / 4, f);
+	}
+}
+
+void horizontal_simd(const uint32_t* row, const tbilinear_column* columns, uint32_t* dst, int dst_w)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i round = _mm_set1_epi16(128);
+	int x = 0;
+	// two destination pixels every loop. every one is {p0, p1} * {w0, w1}, then high half adds to low half.
+	for (; x + 2 <= dst_w; x += 2) {
+		const tbilinear_column& ca = columns[x];
+		const tbilinear_column& cb = columns[x + 1];
+		const __m128i pa = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(row + ca.x0)), zero);
+		const __m128i pb = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(row + cb.x0)), zero);
+		const __m128i ma = _mm_mullo_epi16(pa, _mm_loadu_si128((const __m128i*)ca.weights));
+		const __m128i mb = _mm_mullo_epi16(pb, _mm_loadu_si128((const __m128i*)cb.weights));
+		__m128i sum = _mm_add_epi16(_mm_unpacklo_epi64(ma, mb), _mm_unpackhi_epi64(ma, mb));
+		sum = _mm_srli_epi16(_mm_add_epi16(sum, round), 8);
+		_mm_storel_epi64((__m128i*)(dst + x), _mm_packus_epi16(sum, zero));
+	}
+	if (x < dst_w) {
+		horizontal_c(row, columns + x, dst + x, dst_w - x);
+	}
+}
+#endif
+
+typedef void (*tblend_rows)(const uint32_t* row0, const uint32_t* row1, uint32_t* out, int w, int f);
+typedef void (*thorizontal)(const uint32_t* row, const tbilinear_column* columns, uint32_t* dst, int dst_w);
+
+void bilinear(const uint32_t* src, int src_w, int src_h, int src_stride, uint32_t* dst, int dst_w, int dst_h, int dst_stride, tblend_rows blend_rows, thorizontal horizontal)
+{
+	VALIDATE(src_w > 0 && src_h > 0 && dst_w >= 0 && dst_h >= 0, null_str);
+	if (!dst_w || !dst_h) {
+		return;
+	}
+
+	std::vector<tbilinear_column> columns;
+	bilinear_columns(src_w, dst_w, columns);
+
+	// one extra pixel, so x0 + 1 of the last column is readable.
+	std::vector<uint32_t> blended(src_w + 1);
+	for (int y = 0; y < dst_h; y ++) {
+		int y0, f;
+		bilinear_position(src_h, dst_h, y, y0, f);
+		const uint32_t* row0 = src + y0 * src_stride;
+		if (f) {
+			blend_rows(row0, row0 + src_stride, &blended[0], src_w, f);
+		} else {
+			memcpy(&blended[0], row0, src_w * 4);
+		}
+		blended[src_w] = blended[src_w - 1];
+		horizontal(&blended[0], &columns[0], dst + y * dst_stride, dst_w);
+	}
+}
+
+//
+// box. every destination pixel covers (src / dst) source pixels, partial pixel on edge
+// has fraction weight. horizontal and vertical are separable. accumulates premultiplied
+// {b, g, r, a} in float, one pixel is one 128-bit vector.
+//
+struct tbox_span
+{
+	int first;
+	int count;
+	// offset of weights in tbox_spans.weights
+	int weight;
+	float sum;
+};
+
+struct tbox_spans
+{
+	std::vector<tbox_span> spans;
+	std::vector<float> weights;
+};
+
+void box_spans(int src, int dst, tbox_spans& result)
+{
+	const double ratio = (double)src / dst;
+	result.spans.resize(dst);
+	result.weights.clear();
+	for (int at = 0; at < dst; at ++) {
+		const double begin = at * ratio;
+		const double end = std::min((at + 1) * ratio, (double)src);
+		tbox_span& span = result.spans[at];
+		span.first = std::min((int)begin, src - 1);
+		span.count = 0;
+		span.weight = result.weights.size();
+		span.sum = 0;
+		for (int n = span.first; n < end && n < src; n ++) {
+			const float w = (float)(std::min<double>(end, n + 1) - std::max<double>(begin, n));
+			result.weights.push_back(w);
+			span.sum += w;
+			span.count ++;
+		}
+		if (!span.count) {
+			result.weights.push_back(1);
+			span.sum = 1;
+			span.count = 1;
+		}
+	}
+}
+
+class tbox_c
+{
+public:
+	static void horizontal(const uint32_t* row, const tbox_spans& columns, float* out)
+	{
+		const int dst_w = columns.spans.size();
+		for (int x = 0; x < dst_w; x ++) {
+			const tbox_span& span = columns.spans[x];
+			const float* weights = &columns.weights[span.weight];
+			float b = 0, g = 0, r = 0, a = 0;
+			for (int n = 0; n < span.count; n ++) {
+				const uint32_t pixel = row[span.first + n];
+				const float wa = weights[n] * (pixel >> 24);
+				b += wa * (pixel & 0xff);
+				g += wa * ((pixel >> 8) & 0xff);
+				r += wa * ((pixel >> 16) & 0xff);
+				a += wa;
+			}
+			float* dst = out + x * 4;
+			dst[0] = b;
+			dst[1] = g;
+			dst[2] = r;
+			dst[3] = a;
+		}
+	}
+
+	static void accumulate(float* acc, const float* row, float weight, int dst_w)
+	{
+		for (int n = 0; n < dst_w * 4; n ++) {
+			acc[n] += row[n] * weight;
+		}
+	}
+
+	static void finalize(const float* acc, const tbox_spans& columns, float row_sum, uint32_t* dst)
+	{
+		const int dst_w = columns.spans.size();
+		for (int x = 0; x < dst_w; x ++) {
+			const float* v = acc + x * 4;
+			if (v[3] <= 0) {
+				dst[x] = 0;
+				continue;
+			}
+			const float inv = 1.0f / v[3];
+			const uint32_t b = std::min(255, (int)(v[0] * inv + 0.5f));
+			const uint32_t g = std::min(255, (int)(v[1] * inv + 0.5f));
+			const uint32_t r = std::min(255, (int)(v[2] * inv + 0.5f));
+			const uint32_t a = std::min(255, (int)(v[3] / (columns.spans[x].sum * row_sum) + 0.5f));
+			dst[x] = (a << 24) | (r << 16) | (g << 8) | b;
+		}
+	}
+};
+
+#if defined(SCALE_SSE2)
+class tbox_simd
+{
+public:
+	static void horizontal(const uint32_t* row, const tbox_spans& columns, float* out)
+	{
+		const __m128i zero = _mm_setzero_si128();
+		const __m128 rgb_mask = _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1));
+		const __m128 alpha_one = _mm_set_ps(1, 0, 0, 0);
+		const int dst_w = columns.spans.size();
+		for (int x = 0; x < dst_w; x ++) {
+			const tbox_span& span = columns.spans[x];
+			const float* weights = &columns.weights[span.weight];
+			__m128 acc = _mm_setzero_ps();
+			for (int n = 0; n < span.count; n ++) {
+				__m128i v = _mm_cvtsi32_si128(row[span.first + n]);
+				v = _mm_unpacklo_epi16(_mm_unpacklo_epi8(v, zero), zero);
+				const __m128 bgra = _mm_cvtepi32_ps(v);
+				// {a, a, a, 1} * weight, so result is {b*a, g*a, r*a, a} * weight.
+				const __m128 alpha = _mm_shuffle_ps(bgra, bgra, _MM_SHUFFLE(3, 3, 3, 3));
+				const __m128 factor = _mm_mul_ps(_mm_or_ps(_mm_and_ps(alpha, rgb_mask), alpha_one), _mm_set1_ps(weights[n]));
+				acc = _mm_add_ps(acc, _mm_mul_ps(bgra, factor));
+			}
+			_mm_storeu_ps(out + x * 4, acc);
+		}
+	}
+
+	static void accumulate(float* acc, const float* row, float weight, int dst_w)
+	{
+		const __m128 w = _mm_set1_ps(weight);
+		const int n4 = dst_w * 4;
+		int n = 0;
+		for (; n + 8 <= n4; n += 8) {
+			_mm_storeu_ps(acc + n, _mm_add_ps(_mm_loadu_ps(acc + n), _mm_mul_ps(_mm_loadu_ps(row + n), w)));
+			_mm_storeu_ps(acc + n + 4, _mm_add_ps(_mm_loadu_ps(acc + n + 4), _mm_mul_ps(_mm_loadu_ps(row + n + 4), w)));
+		}
+		for (; n < n4; n += 4) {
+			_mm_storeu_ps(acc + n, _mm_add_ps(_mm_loadu_ps(acc + n), _mm_mul_ps(_mm_loadu_ps(row + n), w)));
+		}
+	}
+
+	static void finalize(const float* acc, const tbox_spans& columns, float row_sum, uint32_t* dst)
+	{
+		const __m128i zero = _mm_setzero_si128();
+		const int dst_w = columns.spans.size();
+		for (int x = 0; x < dst_w; x ++) {
+			const __m128 v = _mm_loadu_ps(acc + x * 4);
+			const float alpha = acc[x * 4 + 3];
+			if (alpha <= 0) {
+				dst[x] = 0;
+				continue;
+			}
+			const float inv = 1.0f / alpha;
+			const __m128 factor = _mm_set_ps(1.0f / (columns.spans[x].sum * row_sum), inv, inv, inv);
+			const __m128i v32 = _mm_cvtps_epi32(_mm_mul_ps(v, factor));
+			const __m128i v8 = _mm_packus_epi16(_mm_packs_epi32(v32, zero), zero);
+			dst[x] = _mm_cvtsi128_si32(v8);
+		}
+	}
+};
+#endif
+
+template<typename T>
+void box(const uint32_t* src, int src_w, int src_h, int src_stride, uint32_t* dst, int dst_w, int dst_h, int dst_stride)
+{
+	VALIDATE(src_w > 0 && src_h > 0 && dst_w >= 0 && dst_h >= 0, null_str);
+	if (!dst_w || !dst_h) {
+		return;
+	}
+
+	tbox_spans columns, rows;
+	box_spans(src_w, dst_w, columns);
+	box_spans(src_h, dst_h, rows);
+
+	// horizontal result of last source row of previous span is kept, next span usually starts with it.
+	std::vector<float> cached(dst_w * 4), scratch(dst_w * 4), acc(dst_w * 4);
+	int cached_row = -1;
+	for (int y = 0; y < dst_h; y ++) {
+		const tbox_span& span = rows.spans[y];
+		std::fill(acc.begin(), acc.end(), 0.0f);
+		for (int n = 0; n < span.count; n ++) {
+			const int row = span.first + n;
+			const float* hrow;
+			if (row == cached_row) {
+				hrow = &cached[0];
+			} else {
+				T::horizontal(src + row * src_stride, columns, &scratch[0]);
+				if (n == span.count - 1) {
+					cached.swap(scratch);
+					cached_row = row;
+					hrow = &cached[0];
+				} else {
+					hrow = &scratch[0];
+				}
+			}
+			T::accumulate(&acc[0], hrow, rows.weights[span.weight + n], dst_w);
+		}
+		T::finalize(&acc[0], columns, span.sum, dst + y * dst_stride);
+	}
+}
+
+}
+
+void scale_argb_bilinear(const uint32_t* src, int src_w, int src_h, int src_stride, uint32_t* dst, int dst_w, int dst_h, int dst_stride)
+{
+#if defined(SCALE_SSE2)
+	bilinear(src, src_w, src_h, src_stride, dst, dst_w, dst_h, dst_stride, blend_rows_simd, horizontal_simd);
+#else
+	bilinear(src, src_w, src_h, src_stride, dst, dst_w, dst_h, dst_stride, blend_rows_c, horizontal_c);
+#endif
+}
+
+void scale_argb_bilinear_c(const uint32_t* src, int src_w, int src_h, int src_stride, uint32_t* dst, int dst_w, int dst_h, int dst_stride)
+{
+	bilinear(src, src_w, src_h, src_stride, dst, dst_w, dst_h, dst_stride, blend_rows_c, horizontal_c);
+}
+
+void scale_argb_box(const uint32_t* src, int src_w, int src_h, int src_stride, uint32_t* dst, int dst_w, int dst_h, int dst_stride)
+{
+#if defined(SCALE_SSE2)
+	box<tbox_simd>(src, src_w, src_h, src_stride, dst, dst_w, dst_h, dst_stride);
+#else
+	box<tbox_c>(src, src_w, src_h, src_stride, dst, dst_w, dst_h, dst_stride);
+#endif
+}
+
+void scale_argb_box_c(const uint32_t* src, int src_w, int src_h, int src_stride, uint32_t* dst, int dst_w, int dst_h, int dst_stride)
+{
+	box<tbox_c>(src, src_w, src_h, src_stride, dst, dst_w, dst_h, dst_stride);
+}
@@ -0,0 +1,23 @@
+#ifndef LIBROSE_SDL_SCALE_HPP_INCLUDED
+#define LIBROSE_SDL_SCALE_HPP_INCLUDED
+
+#include <stdint.h>
+
+//
+// cpu scaling of 32-bit ARGB pixels. stride is in pixels, not bytes.
+// kernels use AVX2/SSE2 when compiler targets them, otherwise portable c.
+// *_c are the portable versions, they are exported so that benchmark and
+// verification can compare them with the vectorized ones.
+//
+
+// bilinear, pixel centers aligned, edge pixels clamped. channels are interpolated
+// independently, same result as renderer with SDL_HINT_RENDER_SCALE_QUALITY "linear".
+void scale_argb_bilinear(const uint32_t* src, int src_w, int src_h, int src_stride, uint32_t* dst, int dst_w, int dst_h, int dst_stride);
+void scale_argb_bilinear_c(const uint32_t* src, int src_w, int src_h, int src_stride, uint32_t* dst, int dst_w, int dst_h, int dst_stride);
+
+// box filter(area average), suitable for big downscale. color is weighted by alpha,
+// so color of transparent pixel doesn't bleed into result.
+void scale_argb_box(const uint32_t* src, int src_w, int src_h, int src_stride, uint32_t* dst, int dst_w, int dst_h, int dst_stride);
+void scale_argb_box_c(const uint32_t* src, int src_w, int src_h, int src_stride, uint32_t* dst, int dst_w, int dst_h, int dst_stride);
+
+#endif
@@ -22,6 +22,8 @@
 
 #include "sdl_image.h"
 #include "sdl_utils.hpp"
+#include "sdl_scale.hpp"
+#include "sdl_pixel.hpp"
 #include "video.hpp"
 #include "image.hpp"
 #include "wml_exception.hpp"
@@ -560,13 +562,9 @@ surface stretch_surface_vertical(const surface& surf, const unsigned h, int pixe
 	return dst;
 }
 
-extern surface render_scale_surface(const surface &surf, int w, int h);
-
 // NOTE: Don't pass this function 0 scaling arguments.
 surface scale_surface(const surface &surf, int w, int h, bool optimize)
 {
-	Uint32 start_soft, stop_soft, start_gpu, stop_gpu;
-
 	if (surf == NULL) {
 		return NULL;
 	}
@@ -576,154 +574,19 @@ surface scale_surface(const surface &surf, int w, int h, bool optimize)
 	}
 	VALIDATE(w >= 0 && h >= 0 && is_neutral_surface(surf), null_str);
 
-	start_soft = SDL_GetTicks();
-/*	surface dst(create_neutral_surface(w,h));
-
-	// Now both surfaces are always in the "neutral" pixel format
+	surface dst(create_neutral_surface(w, h));
 	if (dst == NULL) {
 		std::cerr << "Could not create surface to scale onto\n";
 		return NULL;
 	}
 
-	const fixed_t xratio = fxpdiv(surf->w,w);
-	const fixed_t yratio = fxpdiv(surf->h,h);
-
 	{
 		const_surface_lock src_lock(surf);
 		surface_lock dst_lock(dst);
 
-		const Uint32* const src_pixels = src_lock.pixels();
-		Uint32* const dst_pixels = dst_lock.pixels();
-
-		fixed_t ysrc = ftofxp(0.0);
-		for(int ydst = 0; ydst != h; ++ydst, ysrc += yratio) {
-			fixed_t xsrc = ftofxp(0.0);
-			for(int xdst = 0; xdst != w; ++xdst, xsrc += xratio) {
-				const int xsrcint = fxptoi(xsrc);
-				const int ysrcint = fxptoi(ysrc);
-
-				const Uint32* const src_word = src_pixels + ysrcint*surf->w + xsrcint;
-				Uint32* const dst_word = dst_pixels +    ydst*dst->w + xdst;
-				const int dx = (xsrcint + 1 < surf->w) ? 1 : 0;
-				const int dy = (ysrcint + 1 < surf->h) ? surf->w : 0;
-
-				Uint8 r,g,b,a;
-				Uint32 rr,gg,bb,aa;
-				Uint16 avg_r, avg_g, avg_b, avg_a;
-				Uint32 pix[4], bilin[4];
-
-				// This next part is the fixed point
-				// equivalent of "take everything to
-				// the right of the decimal point."
-				// These fundamental weights decide
-				// the contributions from various
-				// input pixels. The labels assume
-				// that the upper left corner of the
-				// screen ("northeast") is 0,0 but the
-				// code should still be consistant if
-				// the graphics origin is actually
-				// somewhere else.
-
-				const fixed_t e = 0x000000FF & xsrc;
-				const fixed_t s = 0x000000FF & ysrc;
-				const fixed_t n = 0xFF - s;
-				const fixed_t w = 0xFF - e;
-
-				pix[0] = *src_word;              // northwest
-				pix[1] = *(src_word + dx);       // northeast
-				pix[2] = *(src_word + dy);       // southwest
-				pix[3] = *(src_word + dx + dy);  // southeast
-
-				if (pix[0] == pix[1] && pix[0] == pix[2] && pix[0] == pix[3]) {
-					*dst_word = pix[0];
-					continue;
-				}
-
-				bilin[0] = n*w;
-				bilin[1] = n*e;
-				bilin[2] = s*w;
-				bilin[3] = s*e;
-
-				// Scope out the neighboorhood, see
-				// what the pixel values are like.
-
-				int count = 0;
-				avg_r = avg_g = avg_b = avg_a = 0;
-				int loc;
-				for (loc=0; loc<4; loc++) {
-				  a = pix[loc] >> 24;
-				  r = pix[loc] >> 16;
-				  g = pix[loc] >> 8;
-				  b = pix[loc] >> 0;
-				  if (a != 0) {
-				    avg_r += r;
-				    avg_g += g;
-				    avg_b += b;
-				    avg_a += a;
-				    count++;
-				  }
-				}
-				if (count>0) {
-				  avg_r /= count;
-				  avg_b /= count;
-				  avg_g /= count;
-				  avg_a /= count;
-				}
-
-				// Perform modified bilinear interpolation.
-				// Don't trust any color information from
-				// an RGBA sample when the alpha channel
-				// is set to fully transparent.
-				//
-				// Some of the input images are hex tiles,
-				// created using a hexagon shaped alpha channel
-				// that is either set to full-on or full-off.
-				//
-				// If intermediate alpha values are introduced
-				// along a hex edge, it produces a gametime artifact.
-				// Moving the mouse around will leave behind
-				// "hexagon halos" from the temporary highlighting.
-				// In other words, the Wesnoth rendering engine
-				// freaks out.
-				//
-				// The alpha thresholding step attempts
-				// to accommodates this limitation.
-				// There is a small loss of quality.
-				// For example, skeleton bowstrings
-				// are not as good as they could be.
-
-				rr = gg = bb = aa = 0;
-				for (loc=0; loc<4; loc++) {
-				  a = pix[loc] >> 24;
-				  r = pix[loc] >> 16;
-				  g = pix[loc] >> 8;
-				  b = pix[loc] >> 0;
-				  if (a == 0) {
-				    r = static_cast<Uint8>(avg_r);
-				    g = static_cast<Uint8>(avg_g);
-				    b = static_cast<Uint8>(avg_b);
-				  }
-				  rr += r * bilin[loc];
-				  gg += g * bilin[loc];
-				  bb += b * bilin[loc];
-				  aa += a * bilin[loc];
-				}
-				r = rr >> 16;
-				g = gg >> 16;
-				b = bb >> 16;
-				a = aa >> 16;
-				a = (a < avg_a/2) ? 0 : avg_a;
-				*dst_word = (a << 24) + (r << 16) + (g << 8) + b;
-			}
-		}
+		scale_argb_bilinear(src_lock.pixels(), surf->w, surf->h, surf->pitch / 4, dst_lock.pixels(), w, h, dst->pitch / 4);
 	}
-*/
-	start_gpu = stop_soft = SDL_GetTicks();
-
-	surface dst = render_scale_surface(surf, w, h);
-	stop_gpu = SDL_GetTicks();
 
-	posix_print("(%ix%i)==>(%ix%i), soft: %i, gup: %i\n", surf->w, surf->h, w, h, stop_soft - start_soft, stop_gpu - start_gpu);
 	return optimize ? create_optimized_surface(dst) : dst;
 }
 
@@ -743,60 +606,11 @@ surface scale_surface_blended(const surface &surf, int w, int h, bool optimize)
 		return NULL;
 	}
 
-	const double xratio = static_cast<double>(surf->w)/
-			              static_cast<double>(w);
-	const double yratio = static_cast<double>(surf->h)/
-			              static_cast<double>(h);
-
 	{
 		const_surface_lock src_lock(surf);
 		surface_lock dst_lock(dst);
 
-		const Uint32* const src_pixels = src_lock.pixels();
-		Uint32* const dst_pixels = dst_lock.pixels();
-
-		double ysrc = 0.0;
-		for(int ydst = 0; ydst != h; ++ydst, ysrc += yratio) {
-			double xsrc = 0.0;
-			for(int xdst = 0; xdst != w; ++xdst, xsrc += xratio) {
-				double red = 0.0, green = 0.0, blue = 0.0, alpha = 0.0;
-
-				double summation = 0.0;
-
-				// We now have a rectangle, (xsrc,ysrc,xratio,yratio)
-				// which we want to derive the pixel from
-				for(double xloc = xsrc; xloc < xsrc+xratio; xloc += 1.0) {
-					const double xsize = std::min<double>(std::floor(xloc+1.0)-xloc,xsrc+xratio-xloc);
-					for(double yloc = ysrc; yloc < ysrc+yratio; yloc += 1.0) {
-						const int xsrcint = std::max<int>(0,std::min<int>(surf->w-1,static_cast<int>(xsrc)));
-						const int ysrcint = std::max<int>(0,std::min<int>(surf->h-1,static_cast<int>(ysrc)));
-
-						const double ysize = std::min<double>(std::floor(yloc+1.0)-yloc,ysrc+yratio-yloc);
-
-						Uint8 r,g,b,a;
-
-						SDL_GetRGBA(src_pixels[ysrcint*surf->w + xsrcint],surf->format,&r,&g,&b,&a);
-						const double value = xsize*ysize*double(a)/255.0;
-						summation += value;
-
-						red += r*value;
-						green += g*value;
-						blue += b*value;
-						alpha += a*value;
-					}
-				}
-
-				if(summation == 0.0)
-					summation = 1.0;
-
-				red /= summation;
-				green /= summation;
-				blue /= summation;
-				alpha /= summation;
-
-				dst_pixels[ydst*dst->w + xdst] = SDL_MapRGBA(dst->format,Uint8(red),Uint8(green),Uint8(blue),Uint8(alpha));
-			}
-		}
+		scale_argb_box(src_lock.pixels(), surf->w, surf->h, surf->pitch / 4, dst_lock.pixels(), w, h, dst->pitch / 4);
 	}
 
 	return optimize ? create_optimized_surface(dst) : dst;
@@ -817,30 +631,7 @@ surface adjust_surface_color(const surface &surf, int red, int green, int blue,
 		return NULL;
 	}
 
-	{
-		surface_lock lock(nsurf);
-		Uint32* beg = lock.pixels();
-		Uint32* end = beg + nsurf->w*surf->h;
-
-		while(beg != end) {
-			Uint8 alpha = (*beg) >> 24;
-
-			if(alpha) {
-				Uint8 r, g, b;
-				r = (*beg) >> 16;
-				g = (*beg) >> 8;
-				b = (*beg) >> 0;
-
-				r = std::max<int>(0,std::min<int>(255,int(r)+red));
-				g = std::max<int>(0,std::min<int>(255,int(g)+green));
-				b = std::max<int>(0,std::min<int>(255,int(b)+blue));
-
-				*beg = (alpha << 24) + (r << 16) + (g << 8) + b;
-			}
-
-			++beg;
-		}
-	}
+	adjust_surface_color2(nsurf, red, green, blue);
 
 	return optimize ? create_optimized_surface(nsurf) : nsurf;
 }
@@ -851,30 +642,8 @@ void adjust_surface_color2(surface &surf, int red, int green, int blue)
 		return;
 	}
 
-	{
-		surface_lock lock(surf);
-		Uint32* beg = lock.pixels();
-		Uint32* end = beg + surf->w*surf->h;
-
-		while (beg != end) {
-			Uint8 alpha = (*beg) >> 24;
-
-			if (alpha) {
-				Uint8 r, g, b;
-				r = (*beg) >> 16;
-				g = (*beg) >> 8;
-				b = (*beg) >> 0;
-
-				r = std::max<int>(0,std::min<int>(255,int(r)+red));
-				g = std::max<int>(0,std::min<int>(255,int(g)+green));
-				b = std::max<int>(0,std::min<int>(255,int(b)+blue));
-
-				*beg = (alpha << 24) + (r << 16) + (g << 8) + b;
-			}
-
-			++ beg;
-		}
-	}
+	surface_lock lock(surf);
+	pixel_add(lock.pixels(), surf->w * surf->h, red, green, blue, 0);
 }
 
 surface greyscale_image(const surface &surf, bool optimize)
@@ -888,38 +657,20 @@ surface greyscale_image(const surface &surf, bool optimize)
 		return NULL;
 	}
 
-	{
-		surface_lock lock(nsurf);
-		Uint32* beg = lock.pixels();
-		Uint32* end = beg + nsurf->w*surf->h;
+	greyscale_image_inplace(nsurf);
 
-		while(beg != end) {
-			Uint8 alpha = (*beg) >> 24;
-
-			if(alpha) {
-				Uint8 r, g, b;
-				r = (*beg) >> 16;
-				g = (*beg) >> 8;
-				b = (*beg);
-				//const Uint8 avg = (red+green+blue)/3;
-
-				// Use the correct formula for RGB to grayscale conversion.
-				// Ok, this is no big deal :)
-				// The correct formula being:
-				// gray=0.299red+0.587green+0.114blue
-				const Uint8 avg = static_cast<Uint8>((
-					77  * static_cast<Uint16>(r) +
-					150 * static_cast<Uint16>(g) +
-					29  * static_cast<Uint16>(b)  ) / 256);
-
-				*beg = (alpha << 24) | (avg << 16) | (avg << 8) | avg;
-			}
+	return optimize ? create_optimized_surface(nsurf) : nsurf;
+}
 
-			++beg;
-		}
+void greyscale_image_inplace(surface& surf)
+{
+	if (surf == NULL) {
+		return;
 	}
 
-	return optimize ? create_optimized_surface(nsurf) : nsurf;
+	// the correct formula being: gray=0.299red+0.587green+0.114blue
+	surface_lock lock(surf);
+	pixel_greyscale(lock.pixels(), surf->w * surf->h);
 }
 
 surface shadow_image(const surface &surf, bool optimize)
@@ -971,31 +722,25 @@ surface recolor_image(surface surf, const std::map<Uint32, Uint32>& map_rgb, boo
 			return NULL;
 	     }
 
-		surface_lock lock(nsurf);
-		Uint32* beg = lock.pixels();
-		Uint32* end = beg + nsurf->w*surf->h;
-
-		std::map<Uint32, Uint32>::const_iterator map_rgb_end = map_rgb.end();
-
-		while(beg != end) {
-			Uint8 alpha = (*beg) >> 24;
-
-			if(alpha){	// don't recolor invisible pixels.
-				// palette use only RGB channels, so remove alpha
-				Uint32 oldrgb = (*beg) & 0x00FFFFFF;
-				std::map<Uint32, Uint32>::const_iterator i = map_rgb.find(oldrgb);
-				if(i != map_rgb.end()){
-					*beg = (alpha << 24) + i->second;
-				}
-			}
-		++beg;
-		}
+		recolor_image_inplace(nsurf, map_rgb);
 
 		return optimize ? create_optimized_surface(nsurf) : nsurf;
 	}
 	return surf;
 }
 
+void recolor_image_inplace(surface& surf, const std::map<Uint32, Uint32>& map_rgb)
+{
+	if (surf == NULL || map_rgb.empty()) {
+		return;
+	}
+
+	// palette use only RGB channels. flat table is much faster to probe than std::map.
+	const tcolor_lut lut(map_rgb);
+	surface_lock lock(surf);
+	pixel_recolor(lock.pixels(), surf->w * surf->h, lut);
+}
+
 surface brighten_image(const surface &surf, fixed_t amount, bool optimize)
 {
 	if(surf == NULL) {
@@ -1009,33 +754,19 @@ surface brighten_image(const surface &surf, fixed_t amount, bool optimize)
 		return NULL;
 	}
 
-	{
-		surface_lock lock(nsurf);
-		Uint32* beg = lock.pixels();
-		Uint32* end = beg + nsurf->w*surf->h;
-
-		if (amount < 0) amount = 0;
-		while(beg != end) {
-			Uint8 alpha = (*beg) >> 24;
+	brighten_image_inplace(nsurf, amount);
 
-			if(alpha) {
-				Uint8 r, g, b;
-				r = (*beg) >> 16;
-				g = (*beg) >> 8;
-				b = (*beg);
-
-				r = std::min<unsigned>(unsigned(fxpmult(r, amount)),255);
-				g = std::min<unsigned>(unsigned(fxpmult(g, amount)),255);
-				b = std::min<unsigned>(unsigned(fxpmult(b, amount)),255);
-
-				*beg = (alpha << 24) + (r << 16) + (g << 8) + b;
-			}
+	return optimize ? create_optimized_surface(nsurf) : nsurf;
+}
 
-			++beg;
-		}
+void brighten_image_inplace(surface& surf, fixed_t amount)
+{
+	if (surf == NULL) {
+		return;
 	}
 
-	return optimize ? create_optimized_surface(nsurf) : nsurf;
+	surface_lock lock(surf);
+	pixel_multiply(lock.pixels(), surf->w * surf->h, amount, amount, amount, ftofxp(1));
 }
 
 surface adjust_surface_alpha(const surface &surf, fixed_t amount, bool optimize)
@@ -1051,30 +782,19 @@ surface adjust_surface_alpha(const surface &surf, fixed_t amount, bool optimize)
 		return NULL;
 	}
 
-	{
-		surface_lock lock(nsurf);
-		Uint32* beg = lock.pixels();
-		Uint32* end = beg + nsurf->w*surf->h;
-
-		if (amount < 0) amount = 0;
-		while(beg != end) {
-			Uint8 alpha = (*beg) >> 24;
+	adjust_surface_alpha_inplace(nsurf, amount);
 
-			if(alpha) {
-				Uint8 r, g, b;
-				r = (*beg) >> 16;
-				g = (*beg) >> 8;
-				b = (*beg);
-
-				alpha = std::min<unsigned>(unsigned(fxpmult(alpha,amount)),255);
-				*beg = (alpha << 24) + (r << 16) + (g << 8) + b;
-			}
+	return optimize ? create_optimized_surface(nsurf) : nsurf;
+}
 
-			++beg;
-		}
+void adjust_surface_alpha_inplace(surface& surf, fixed_t amount)
+{
+	if (surf == NULL) {
+		return;
 	}
 
-	return optimize ? create_optimized_surface(nsurf) : nsurf;
+	surface_lock lock(surf);
+	pixel_multiply(lock.pixels(), surf->w * surf->h, ftofxp(1), ftofxp(1), ftofxp(1), amount);
 }
 
 surface adjust_surface_alpha_add(const surface &surf, int amount, bool optimize)
@@ -1090,29 +810,19 @@ surface adjust_surface_alpha_add(const surface &surf, int amount, bool optimize)
 		return NULL;
 	}
 
-	{
-		surface_lock lock(nsurf);
-		Uint32* beg = lock.pixels();
-		Uint32* end = beg + nsurf->w*surf->h;
-
-		while(beg != end) {
-			Uint8 alpha = (*beg) >> 24;
+	adjust_surface_alpha_add_inplace(nsurf, amount);
 
-			if(alpha) {
-				Uint8 r, g, b;
-				r = (*beg) >> 16;
-				g = (*beg) >> 8;
-				b = (*beg);
-
-				alpha = Uint8(std::max<int>(0,std::min<int>(255,int(alpha) + amount)));
-				*beg = (alpha << 24) + (r << 16) + (g << 8) + b;
-			}
+	return optimize ? create_optimized_surface(nsurf) : nsurf;
+}
 
-			++beg;
-		}
+void adjust_surface_alpha_add_inplace(surface& surf, int amount)
+{
+	if (surf == NULL) {
+		return;
 	}
 
-	return optimize ? create_optimized_surface(nsurf) : nsurf;
+	surface_lock lock(surf);
+	pixel_add(lock.pixels(), surf->w * surf->h, 0, 0, 0, amount);
 }
 
 surface mask_surface(const surface &surf, const surface &mask, bool* empty_result)
@@ -1131,54 +841,37 @@ surface mask_surface(const surface &surf, const surface &mask, bool* empty_resul
 		std::cerr << "could not make neutral surface...\n";
 		return NULL;
 	}
-	if (nsurf->w !=  mask->w) {
+	mask_surface_inplace(nsurf, mask, empty_result);
+
+	return nsurf;
+	//return create_optimized_surface(nsurf);
+}
+
+void mask_surface_inplace(surface& surf, const surface& mask, bool* empty_result)
+{
+	if (surf == NULL || mask == NULL) {
+		return;
+	}
+	VALIDATE(is_neutral_surface(mask), null_str);
+
+	if (surf->w != mask->w) {
 		// we don't support efficiently different width.
 		// (different height is not a real problem)
 		// This function is used on all hexes and usually only for that
 		// so better keep it simple and efficient for the normal case
-		std::cerr << "Detected an image with bad dimensions :" << nsurf->w << "x" << nsurf->h << "\n";
+		std::cerr << "Detected an image with bad dimensions :" << surf->w << "x" << surf->h << "\n";
 		std::cerr << "It will not be masked, please use :"<< mask->w << "x" << mask->h << "\n";
-		return nsurf;
+		return;
 	}
 
-	bool empty = true;
+	bool empty;
 	{
-		surface_lock lock(nsurf);
+		surface_lock lock(surf);
 		const_surface_lock mlock(mask);
-
-		Uint32* beg = lock.pixels();
-		Uint32* end = beg + nsurf->w*surf->h;
-		const Uint32* mbeg = mlock.pixels();
-		const Uint32* mend = mbeg + mask->w*mask->h;
-
-		while(beg != end && mbeg != mend) {
-			Uint8 alpha = (*beg) >> 24;
-
-			if(alpha) {
-				Uint8 r, g, b;
-				r = (*beg) >> 16;
-				g = (*beg) >> 8;
-				b = (*beg);
-
-				Uint8 malpha = (*mbeg) >> 24;
-				if (alpha > malpha) {
-					alpha = malpha;
-				}
-				if(alpha)
-					empty = false;
-
-				*beg = (alpha << 24) + (r << 16) + (g << 8) + b;
-			}
-
-			++beg;
-			++mbeg;
-		}
+		empty = pixel_mask(lock.pixels(), mlock.pixels(), surf->w * std::min(surf->h, mask->h));
 	}
 	if(empty_result)
 		*empty_result = empty;
-
-	return nsurf;
-	//return create_optimized_surface(nsurf);
 }
 
 bool in_mask_surface(const surface &surf, const surface &mask)
@@ -1265,59 +958,27 @@ surface submerge_alpha(const surface &surf, int depth, float alpha_base, float a
 
 	surface nsurf(make_neutral_surface(surf));
 
-	{
-		surface_lock lock(nsurf);
+	submerge_alpha_inplace(nsurf, depth, alpha_base, alpha_delta);
 
-		Uint32* beg = lock.pixels();
-		Uint32* limit = beg + (nsurf->h-depth) * nsurf->w ;
-		Uint32* end = beg + nsurf->w * nsurf->h;
-		beg = limit; // directlt jump to the bottom part
-
-		while(beg != end){
-			Uint8 alpha = (*beg) >> 24;
-
-			if(alpha) {
-				Uint8 r, g, b;
-				r = (*beg) >> 16;
-				g = (*beg) >> 8;
-				b = (*beg);
-				int d = (beg-limit)/nsurf->w;  // current depth in pixels
-				float a = alpha_base - d * alpha_delta;
-				fixed_t amount = ftofxp(a<0?0:a);
-				alpha = std::min<unsigned>(unsigned(fxpmult(alpha,amount)),255);
-				*beg = (alpha << 24) + (r << 16) + (g << 8) + b;
-			}
-
-			++beg;
-		}
-
-/*
-		for(int y = submerge_height; y < nsurf->h; ++y) {
-			Uint32* cur = beg + y * nsurf->w;
-			Uint32* row_end = beg + (y+1) * nsurf->w;
-			float d = y * 1.0 / depth;
-			double a = 0.2;//std::max<double>(0, (1-d)*0.3);
-			fixed_t amount = ftofxp(a);
-			while(cur != row_end) {
-				Uint8 alpha = (*cur) >> 24;
-
-				if(alpha) {
-					Uint8 r, g, b;
-					r = (*cur) >> 16;
-					g = (*cur) >> 8;
-					b = (*cur);
-					alpha = std::min<unsigned>(unsigned(fxpmult(alpha,amount)),255);
-					*cur = (alpha << 24) + (r << 16) + (g << 8) + b;
-				}
+	return optimize ? create_optimized_surface(nsurf) : nsurf;
 
-				++cur;
-			}
-		}*/
+}
 
+void submerge_alpha_inplace(surface& surf, int depth, float alpha_base, float alpha_delta)
+{
+	if (surf == NULL) {
+		return;
 	}
 
-	return optimize ? create_optimized_surface(nsurf) : nsurf;
+	surface_lock lock(surf);
 
+	// only the bottom part, factor is same in one row.
+	const int top = std::max(0, surf->h - depth);
+	for (int y = top; y < surf->h; y ++) {
+		const float a = alpha_base - (y - top) * alpha_delta;
+		const fixed_t amount = ftofxp(a < 0? 0: a);
+		pixel_multiply(lock.pixels() + y * surf->w, surf->w, ftofxp(1), ftofxp(1), ftofxp(1), amount);
+	}
 }
 
 surface light_surface(const surface &surf, const surface &lightmap, bool optimize)
@@ -1336,50 +997,31 @@ surface light_surface(const surface &surf, const surface &lightmap, bool optimiz
 		std::cerr << "could not make neutral surface...\n";
 		return NULL;
 	}
-	if (nsurf->w != lightmap->w) {
+	light_surface_inplace(nsurf, lightmap);
+
+	return optimize ? create_optimized_surface(nsurf) : nsurf;
+}
+
+void light_surface_inplace(surface& surf, const surface& lightmap)
+{
+	if (surf == NULL || lightmap == NULL) {
+		return;
+	}
+	VALIDATE(is_neutral_surface(lightmap), null_str);
+
+	if (surf->w != lightmap->w) {
 		// we don't support efficiently different width.
 		// (different height is not a real problem)
 		// This function is used on all hexes and usually only for that
 		// so better keep it simple and efficient for the normal case
-		std::cerr << "Detected an image with bad dimensions :" << nsurf->w << "x" << nsurf->h << "\n";
+		std::cerr << "Detected an image with bad dimensions :" << surf->w << "x" << surf->h << "\n";
 		std::cerr << "It will not be lighted, please use :"<< lightmap->w << "x" << lightmap->h << "\n";
-		return nsurf;
-	}
-	{
-		surface_lock lock(nsurf);
-		const_surface_lock llock(lightmap);
-
-		Uint32* beg = lock.pixels();
-		Uint32* end = beg + nsurf->w * nsurf->h;
-		const Uint32* lbeg = llock.pixels();
-		const Uint32* lend = lbeg + lightmap->w * lightmap->h;
-
-		while(beg != end && lbeg != lend) {
-			Uint8 alpha = (*beg) >> 24;
- 			if(alpha) {
-				Uint8 lr, lg, lb;
-
-				lr = (*lbeg) >> 16;
-				lg = (*lbeg) >> 8;
-				lb = (*lbeg);
-
-				Uint8 r, g, b;
-				r = (*beg) >> 16;
-				g = (*beg) >> 8;
-				b = (*beg);
-
-				r = std::max<int>(0,std::min<int>(255,int(r) + lr - 128));
-				g = std::max<int>(0,std::min<int>(255,int(g) + lg - 128));
-				b = std::max<int>(0,std::min<int>(255,int(b) + lb - 128));
-
-				*beg = (alpha << 24) + (r << 16) + (g << 8) + b;
-			}
-			++beg;
-			++lbeg;
-		}
+		return;
 	}
 
-	return optimize ? create_optimized_surface(nsurf) : nsurf;
+	surface_lock lock(surf);
+	const_surface_lock llock(lightmap);
+	pixel_light(lock.pixels(), llock.pixels(), surf->w * std::min(surf->h, lightmap->h));
 }
 
 
@@ -1408,114 +1050,13 @@ void blur_surface(surface& surf, SDL_Rect rect, int depth)
 		return;
 	}
 
-	const unsigned max_blur = 256;
+	const int max_blur = 256;
 	if(depth > max_blur) {
 		depth = max_blur;
 	}
 
-	Uint32 queue[max_blur];
-	const Uint32* end_queue = queue + max_blur;
-
-	const Uint32 ff = 0xff;
-
-	const unsigned pixel_offset = rect.y * surf->w + rect.x;
-
 	surface_lock lock(surf);
-	for(int y = 0; y < rect.h; ++y) {
-		const Uint32* front = &queue[0];
-		Uint32* back = &queue[0];
-		Uint32 red = 0, green = 0, blue = 0, avg = 0;
-		Uint32* p = lock.pixels() + pixel_offset + y * surf->w;
-		for(int x = 0; x <= depth && x < rect.w; ++x, ++p) {
-			red += ((*p) >> 16)&0xFF;
-			green += ((*p) >> 8)&0xFF;
-			blue += (*p)&0xFF;
-			++avg;
-			*back++ = *p;
-			if(back == end_queue) {
-				back = &queue[0];
-			}
-		}
-
-		p = lock.pixels() + pixel_offset + y * surf->w;
-		for(int x = 0; x < rect.w; ++x, ++p) {
-			*p = 0xFF000000
-					| (std::min(red/avg,ff) << 16)
-					| (std::min(green/avg,ff) << 8)
-					| std::min(blue/avg,ff);
-
-			if(x >= depth) {
-				red -= ((*front) >> 16)&0xFF;
-				green -= ((*front) >> 8)&0xFF;
-				blue -= *front&0xFF;
-				--avg;
-				++front;
-				if(front == end_queue) {
-					front = &queue[0];
-				}
-			}
-
-			if(x + depth+1 < rect.w) {
-				Uint32* q = p + depth+1;
-				red += ((*q) >> 16)&0xFF;
-				green += ((*q) >> 8)&0xFF;
-				blue += (*q)&0xFF;
-				++avg;
-				*back++ = *q;
-				if(back == end_queue) {
-					back = &queue[0];
-				}
-			}
-		}
-	}
-
-	for(int x = 0; x < rect.w; ++x) {
-		const Uint32* front = &queue[0];
-		Uint32* back = &queue[0];
-		Uint32 red = 0, green = 0, blue = 0, avg = 0;
-		Uint32* p = lock.pixels() + pixel_offset + x;
-		for(int y = 0; y <= depth && y < rect.h; ++y, p += surf->w) {
-			red += ((*p) >> 16)&0xFF;
-			green += ((*p) >> 8)&0xFF;
-			blue += *p&0xFF;
-			++avg;
-			*back++ = *p;
-			if(back == end_queue) {
-				back = &queue[0];
-			}
-		}
-
-		p = lock.pixels() + pixel_offset + x;
-		for(int y = 0; y < rect.h; ++y, p += surf->w) {
-			*p = 0xFF000000
-					| (std::min(red/avg,ff) << 16)
-					| (std::min(green/avg,ff) << 8)
-					| std::min(blue/avg,ff);
-
-			if(y >= depth) {
-				red -= ((*front) >> 16)&0xFF;
-				green -= ((*front) >> 8)&0xFF;
-				blue -= *front&0xFF;
-				--avg;
-				++front;
-				if(front == end_queue) {
-					front = &queue[0];
-				}
-			}
-
-			if(y + depth+1 < rect.h) {
-				Uint32* q = p + (depth+1)*surf->w;
-				red += ((*q) >> 16)&0xFF;
-				green += ((*q) >> 8)&0xFF;
-				blue += (*q)&0xFF;
-				++avg;
-				*back++ = *q;
-				if(back == end_queue) {
-					back = &queue[0];
-				}
-			}
-		}
-	}
+	pixel_blur(lock.pixels() + rect.y * surf->w + rect.x, rect.w, rect.h, surf->w, depth, false);
 }
 
 surface blur_alpha_surface(const surface &surf, int depth, bool optimize)
@@ -1531,113 +1072,24 @@ surface blur_alpha_surface(const surface &surf, int depth, bool optimize)
 		return NULL;
 	}
 
-	const int max_blur = 256;
-	if(depth > max_blur) {
-		depth = max_blur;
-	}
-
-	Uint32 queue[max_blur];
-	const Uint32* end_queue = queue + max_blur;
-
-	const Uint32 ff = 0xff;
-
-	surface_lock lock(res);
-	int x, y;
-	for(y = 0; y < res->h; ++y) {
-		const Uint32* front = &queue[0];
-		Uint32* back = &queue[0];
-		Uint32 alpha=0, red = 0, green = 0, blue = 0, avg = 0;
-		Uint32* p = lock.pixels() + y*res->w;
-		for(x = 0; x <= depth && x < res->w; ++x, ++p) {
-			alpha += ((*p) >> 24)&0xFF;
-			red += ((*p) >> 16)&0xFF;
-			green += ((*p) >> 8)&0xFF;
-			blue += (*p)&0xFF;
-			++avg;
-			*back++ = *p;
-			if(back == end_queue) {
-				back = &queue[0];
-			}
-		}
+	blur_alpha_surface_inplace(res, depth);
 
-		p = lock.pixels() + y*res->w;
-		for(x = 0; x < res->w; ++x, ++p) {
-			*p = (std::min(alpha/avg,ff) << 24) | (std::min(red/avg,ff) << 16) | (std::min(green/avg,ff) << 8) | std::min(blue/avg,ff);
-			if(x >= depth) {
-				alpha -= ((*front) >> 24)&0xFF;
-				red -= ((*front) >> 16)&0xFF;
-				green -= ((*front) >> 8)&0xFF;
-				blue -= *front&0xFF;
-				--avg;
-				++front;
-				if(front == end_queue) {
-					front = &queue[0];
-				}
-			}
+	return optimize ? create_optimized_surface(res) : res;
+}
 
-			if(x + depth+1 < res->w) {
-				Uint32* q = p + depth+1;
-				alpha += ((*q) >> 24)&0xFF;
-				red += ((*q) >> 16)&0xFF;
-				green += ((*q) >> 8)&0xFF;
-				blue += (*q)&0xFF;
-				++avg;
-				*back++ = *q;
-				if(back == end_queue) {
-					back = &queue[0];
-				}
-			}
-		}
+void blur_alpha_surface_inplace(surface& surf, int depth)
+{
+	if (surf == NULL) {
+		return;
 	}
 
-	for(x = 0; x < res->w; ++x) {
-		const Uint32* front = &queue[0];
-		Uint32* back = &queue[0];
-		Uint32 alpha=0, red = 0, green = 0, blue = 0, avg = 0;
-		Uint32* p = lock.pixels() + x;
-		for(y = 0; y <= depth && y < res->h; ++y, p += res->w) {
-			alpha += ((*p) >> 24)&0xFF;
-			red += ((*p) >> 16)&0xFF;
-			green += ((*p) >> 8)&0xFF;
-			blue += *p&0xFF;
-			++avg;
-			*back++ = *p;
-			if(back == end_queue) {
-				back = &queue[0];
-			}
-		}
-
-		p = lock.pixels() + x;
-		for(y = 0; y < res->h; ++y, p += res->w) {
-			*p = (std::min(alpha/avg,ff) << 24) | (std::min(red/avg,ff) << 16) | (std::min(green/avg,ff) << 8) | std::min(blue/avg,ff);
-			if(y >= depth) {
-				alpha -= ((*front) >> 24)&0xFF;
-				red -= ((*front) >> 16)&0xFF;
-				green -= ((*front) >> 8)&0xFF;
-				blue -= *front&0xFF;
-				--avg;
-				++front;
-				if(front == end_queue) {
-					front = &queue[0];
-				}
-			}
-
-			if(y + depth+1 < res->h) {
-				Uint32* q = p + (depth+1)*res->w;
-				alpha += ((*q) >> 24)&0xFF;
-				red += ((*q) >> 16)&0xFF;
-				green += ((*q) >> 8)&0xFF;
-				blue += (*q)&0xFF;
-				++avg;
-				*back++ = *q;
-				if(back == end_queue) {
-					back = &queue[0];
-				}
-			}
-		}
+	const int max_blur = 256;
+	if(depth > max_blur) {
+		depth = max_blur;
 	}
 
-	return optimize ? create_optimized_surface(res) : res;
+	surface_lock lock(surf);
+	pixel_blur(lock.pixels(), surf->w, surf->h, surf->w, depth, true);
 }
 
 surface cut_surface(const surface &surf, SDL_Rect const &r)
@@ -1711,38 +1163,37 @@ surface blend_surface(const surface &surf, double amount, Uint32 color, bool opt
 		return NULL;
 	}
 
-	{
-		surface_lock lock(nsurf);
-		Uint32* beg = lock.pixels();
-		Uint32* end = beg + nsurf->w*surf->h;
-
-		Uint8 red, green, blue, alpha;
-		SDL_GetRGBA(color,nsurf->format,&red,&green,&blue,&alpha);
+	blend_surface_inplace(nsurf, amount, color);
 
-		red   = Uint8(red   * amount);
-		green = Uint8(green * amount);
-		blue  = Uint8(blue  * amount);
+	return optimize ? create_optimized_surface(nsurf) : nsurf;
+}
 
-		amount = 1.0 - amount;
+void blend_surface_inplace(surface& surf, double amount, Uint32 color)
+{
+	if (surf == NULL) {
+		return;
+	}
 
-		while(beg != end) {
-			Uint8 r, g, b, a;
-			a = (*beg) >> 24;
-			r = (*beg) >> 16;
-			g = (*beg) >> 8;
-			b = (*beg);
+	Uint8 red, green, blue, alpha;
+	SDL_GetRGBA(color,surf->format,&red,&green,&blue,&alpha);
 
-			r = Uint8(r * amount) + red;
-			g = Uint8(g * amount) + green;
-			b = Uint8(b * amount) + blue;
+	red   = Uint8(red   * amount);
+	green = Uint8(green * amount);
+	blue  = Uint8(blue  * amount);
 
-			*beg = (a << 24) | (r << 16) | (g << 8) | b;
+	amount = 1.0 - amount;
 
-			++beg;
-		}
+	// result of channel depends only on channel itself, calculate all 256 once.
+	Uint8 red_lut[256], green_lut[256], blue_lut[256];
+	for (int c = 0; c < 256; c ++) {
+		const Uint8 faded = Uint8(c * amount);
+		red_lut[c] = faded + red;
+		green_lut[c] = faded + green;
+		blue_lut[c] = faded + blue;
 	}
 
-	return optimize ? create_optimized_surface(nsurf) : nsurf;
+	surface_lock lock(surf);
+	pixel_lut(lock.pixels(), surf->w * surf->h, red_lut, green_lut, blue_lut);
 }
 
 surface flip_surface(const surface &surf, bool optimize)
@@ -1758,20 +1209,23 @@ surface flip_surface(const surface &surf, bool optimize)
 		return NULL;
 	}
 
-	{
-		surface_lock lock(nsurf);
-		Uint32* const pixels = lock.pixels();
+	flip_surface_inplace(nsurf);
 
-		for(int y = 0; y != nsurf->h; ++y) {
-			for(int x = 0; x != nsurf->w/2; ++x) {
-				const int index1 = y*nsurf->w + x;
-				const int index2 = (y+1)*nsurf->w - x - 1;
-				std::swap(pixels[index1],pixels[index2]);
-			}
-		}
+	return optimize ? create_optimized_surface(nsurf) : nsurf;
+}
+
+void flip_surface_inplace(surface& surf)
+{
+	if (surf == NULL) {
+		return;
 	}
 
-	return optimize ? create_optimized_surface(nsurf) : nsurf;
+	surface_lock lock(surf);
+	Uint32* const pixels = lock.pixels();
+
+	for(int y = 0; y != surf->h; ++y) {
+		std::reverse(pixels + y * surf->w, pixels + (y + 1) * surf->w);
+	}
 }
 
 surface flop_surface(const surface &surf, bool optimize)
@@ -1787,20 +1241,24 @@ surface flop_surface(const surface &surf, bool optimize)
 		return NULL;
 	}
 
-	{
-		surface_lock lock(nsurf);
-		Uint32* const pixels = lock.pixels();
+	flop_surface_inplace(nsurf);
 
-		for(int x = 0; x != nsurf->w; ++x) {
-			for(int y = 0; y != nsurf->h/2; ++y) {
-				const int index1 = y*nsurf->w + x;
-				const int index2 = (nsurf->h-y-1)*surf->w + x;
-				std::swap(pixels[index1],pixels[index2]);
-			}
-		}
+	return optimize ? create_optimized_surface(nsurf) : nsurf;
+}
+
+void flop_surface_inplace(surface& surf)
+{
+	if (surf == NULL) {
+		return;
 	}
 
-	return optimize ? create_optimized_surface(nsurf) : nsurf;
+	surface_lock lock(surf);
+	Uint32* const pixels = lock.pixels();
+
+	// swap whole rows, memory is accessed contiguously.
+	for(int y = 0; y != surf->h/2; ++y) {
+		std::swap_ranges(pixels + y * surf->w, pixels + (y + 1) * surf->w, pixels + (surf->h - y - 1) * surf->w);
+	}
 }
 
 surface rotate_surface(const surface& surf, double angle)
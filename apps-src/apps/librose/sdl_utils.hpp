@@ -207,9 +207,14 @@ surface stretch_surface_vertical(const surface& surf, const unsigned h, int pixe
 surface scale_surface(const surface &surf, int w, int h, bool optimize=true);
 
 surface scale_surface_blended(const surface &surf, int w, int h, bool optimize=true);
+/**
+ * *_inplace variants modify surf directly, surf must be neutral and not shared.
+ * the copying version is make_neutral_surface + *_inplace.
+ */
 surface adjust_surface_color(const surface &surf, int r, int g, int b, bool optimize=true);
 void adjust_surface_color2(surface &surf, int red, int green, int blue);
 surface greyscale_image(const surface &surf, bool optimize=true);
+void greyscale_image_inplace(surface& surf);
 /** create an heavy shadow of the image, by blurring, increasing alpha and darkening */
 surface shadow_image(const surface &surf, bool optimize=true);
 
@@ -228,8 +233,10 @@ surface shadow_image(const surface &surf, bool optimize=true);
  */
 surface recolor_image(surface surf, const std::map<Uint32, Uint32>& map_rgb,
 	bool optimize=true);
+void recolor_image_inplace(surface& surf, const std::map<Uint32, Uint32>& map_rgb);
 
 surface brighten_image(const surface &surf, fixed_t amount, bool optimize=true);
+void brighten_image_inplace(surface& surf, fixed_t amount);
 
 /** Get a portion of the screen.
  *  Send NULL if the portion is outside of the screen.
@@ -247,9 +254,12 @@ surface get_surface_portion2(const surface& surf, SDL_Rect &rect);
 
 surface adjust_surface_alpha(const surface& surf, fixed_t amount, bool optimize=true);
 surface adjust_surface_alpha_add(const surface& surf, int amount, bool optimize=true);
+void adjust_surface_alpha_inplace(surface& surf, fixed_t amount);
+void adjust_surface_alpha_add_inplace(surface& surf, int amount);
 
 /** Applies a mask on a surface. */
 surface mask_surface(const surface &surf, const surface &mask, bool* empty_result = NULL);
+void mask_surface_inplace(surface& surf, const surface& mask, bool* empty_result = NULL);
 
 /** Check if a surface fit into a mask */
 bool in_mask_surface(const surface &surf, const surface &mask);
@@ -264,9 +274,11 @@ bool is_opaque(const surface& surf, bool approximate);
  *  @param optimize_format   Optimize by converting to result to display
 */
 surface submerge_alpha(const surface &surf, int depth, float alpha_base, float alpha_delta, bool optimize=true);
+void submerge_alpha_inplace(surface& surf, int depth, float alpha_base, float alpha_delta);
 
 /** Light surf using lightmap (RGB=128,128,128 means no change) */
 surface light_surface(const surface &surf, const surface &lightmap, bool optimize=true);
+void light_surface_inplace(surface& surf, const surface& lightmap);
 
 /** Cross-fades a surface. */
 surface blur_surface(const surface &surf, int depth = 1, bool optimize=true);
@@ -288,12 +300,16 @@ void blur_surface(surface& surf, SDL_Rect rect, int depth = 1);
  * of the normal blur but with blur alpha channel too
  */
 surface blur_alpha_surface(const surface &surf, int depth = 1, bool optimize=true);
+void blur_alpha_surface_inplace(surface& surf, int depth = 1);
 
 /** Cuts a rectangle from a surface. */
 surface cut_surface(const surface &surf, SDL_Rect const &r);
 surface blend_surface(const surface &surf, double amount, Uint32 color, bool optimize=true);
+void blend_surface_inplace(surface& surf, double amount, Uint32 color);
 surface flip_surface(const surface &surf, bool optimize=true);
 surface flop_surface(const surface &surf, bool optimize=true);
+void flip_surface_inplace(surface& surf);
+void flop_surface_inplace(surface& surf);
 surface rotate_surface(const surface& surf, double angle);
 surface rotate_surface2(const surface& surf, int srcx, int srcy, int degree, int offsetx, int offsety, int& dstx, int& dsty);
 surface create_compatible_surface(const surface &surf, int width = -1, int height = -1);
@@ -49,13 +49,15 @@ class parser
 	parser& operator=(const parser&);
 public:
 	parser(config& cfg, std::istream& in,
-		   abstract_validator * validator = NULL);
+		   abstract_validator * validator = NULL, tpreproc_record* record = NULL);
 	~parser();
 	void operator()();
 
 private:
 	void parse_element();
 	void parse_variable();
+	void segment_events(bool boundary);
+	void taint_segments(size_t depth);
 	std::string lineno_string(utils::string_map &map, std::string const &lineno,
 		const std::string &error_string,
 		const std::string &hint_string = "",
@@ -79,13 +81,31 @@ private:
 	};
 
 	std::stack<element> elements;
+
+	struct topen_segment {
+		topen_segment(int id, size_t depth, config* parent) :
+			id(id), depth(depth), parent(parent)
+		{}
+
+		int id;
+		size_t depth;
+		config* parent;
+	};
+
+	tpreproc_record* record_;
+	std::vector<topen_segment> open_segments_;
+	/** Ordered index of every element except root in its parent, kept only when record_ is set. */
+	std::vector<int> path_;
 };
 
-parser::parser(config &cfg, std::istream &in, abstract_validator * validator)
+parser::parser(config &cfg, std::istream &in, abstract_validator * validator, tpreproc_record* record)
 			   :cfg_(cfg),
 			   tok_(new tokenizer(in)),
 			   validator_(validator),
-			   elements()
+			   elements(),
+			   record_(record),
+			   open_segments_(),
+			   path_()
 {
 }
 
@@ -101,7 +121,14 @@ void parser::operator()()
 	elements.push(element(&cfg_, ""));
 
 	do {
+		// segment begins or ends at statement boundary only when its markers are read by this next_token.
+		if (record_) {
+			segment_events(false);
+		}
 		tok_->next_token();
+		if (record_) {
+			segment_events(true);
+		}
 
 		switch(tok_->current_token().type) {
 		case token::LF:
@@ -162,6 +189,9 @@ void parser::parse_element()
 			error(_("Unterminated [element] tag"));
 		// Add the element
 		current_element = &(elements.top().cfg->add_child(elname));
+		if (record_) {
+			path_.push_back(elements.top().cfg->all_children_count() - 1);
+		}
 		elements.push(element(current_element, elname, tok_->get_start_line(), tok_->get_file()));
 		if (validator_){
 			validator_->open_tag(elname,tok_->get_start_line(),
@@ -191,6 +221,14 @@ void parser::parse_element()
 									 tok_->get_file());
 			}
 		}
+		if (record_) {
+			taint_segments(elements.size());
+			int index = 0;
+			for (config::all_children_iterator it = elements.top().cfg->ordered_begin(); &it->cfg != current_element; ++ it) {
+				index ++;
+			}
+			path_.push_back(index);
+		}
 		elements.push(element(current_element, elname, tok_->get_start_line(), tok_->get_file()));
 		break;
 
@@ -217,6 +255,10 @@ void parser::parse_element()
 			validator_->validate(*el.cfg,el.name,el.start_line,el.file);
 			validator_->close_tag();
 		}
+		if (record_) {
+			taint_segments(elements.size());
+			path_.pop_back();
+		}
 		elements.pop();
 		break;
 	default:
@@ -226,6 +268,9 @@ void parser::parse_element()
 
 void parser::parse_variable()
 {
+	if (record_) {
+		taint_segments(elements.size());
+	}
 	config& cfg = *elements.top().cfg;
 	std::vector<std::string> variables;
 	variables.push_back("");
@@ -340,6 +385,45 @@ void parser::parse_variable()
 	}
 }
 
+void parser::segment_events(bool boundary)
+{
+	std::vector<int>& events = tok_->segment_events();
+	for (std::vector<int>::const_iterator it = events.begin(); it != events.end(); ++ it) {
+		if (*it > 0) {
+			tpreproc_record::tsegment& segment = record_->segments[*it - 1];
+			config& parent = *elements.top().cfg;
+			segment.parent = path_;
+			segment.first = parent.all_children_count();
+			segment.count = 0;
+			segment.clean = boundary;
+			open_segments_.push_back(topen_segment(*it - 1, elements.size(), &parent));
+		} else {
+			assert(!open_segments_.empty() && open_segments_.back().id == -*it - 1);
+			const topen_segment& open = open_segments_.back();
+			tpreproc_record::tsegment& segment = record_->segments[open.id];
+			if (!boundary || elements.size() != open.depth || elements.top().cfg != open.parent) {
+				segment.clean = false;
+			}
+			if (segment.clean) {
+				segment.count = open.parent->all_children_count() - segment.first;
+			}
+			open_segments_.pop_back();
+		}
+	}
+	events.clear();
+}
+
+void parser::taint_segments(size_t depth)
+{
+	// statement changes element at depth other than by adding a whole child,
+	// segments that add children to it can't be replaced by reparsing their file.
+	for (std::vector<topen_segment>::const_iterator it = open_segments_.begin(); it != open_segments_.end(); ++ it) {
+		if (it->depth == depth) {
+			record_->segments[it->id].clean = false;
+		}
+	}
+}
+
 /**
  * This function is crap. Don't use it on a string_map with prefixes.
  */
@@ -402,6 +486,11 @@ void read(config &cfg, std::istream &in, abstract_validator * validator)
 	parser(cfg, in, validator)();
 }
 
+void read(config &cfg, std::istream &in, tpreproc_record& record)
+{
+	parser(cfg, in, NULL, &record)();
+}
+
 void read(config &cfg, const std::string &in, abstract_validator * validator)
 {
 	std::istringstream ss(in);
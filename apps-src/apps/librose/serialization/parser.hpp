@@ -23,9 +23,12 @@
 
 
 class abstract_validator;
+struct tpreproc_record;
 // Read data in, clobbering existing data.
 void read(config &cfg, std::istream &in,
 		  abstract_validator * validator = NULL); 	// Throws config::error
+// Also fill position of every segment of @a record that preprocess_file marked in @a in.
+void read(config &cfg, std::istream &in, tpreproc_record& record);
 void read(config &cfg, const std::string &in,
 		  abstract_validator * validator = NULL); 	// Throws config::error
 void read_gz(config &cfg, std::istream &in,
@@ -28,12 +28,17 @@
 #include "serialization/binary_or_text.hpp"
 #include "serialization/string_utils.hpp"
 #include "serialization/parser.hpp"
+#include "serialization/tokenizer.hpp"
 #include "filesystem.hpp"
 #include "util.hpp"
 #include "wml_exception.hpp"
 
 #include <boost/foreach.hpp>
+#include <algorithm>
+#include <set>
 #include <stdexcept>
+#include <zlib.h>
+#include "SDL_atomic.h"
 
 static lg::log_domain log_config("config");
 #define ERR_CF LOG_STREAM(err, log_config)
@@ -48,6 +53,8 @@ using std::streambuf;
 // map associating each filename encountered to a number
 typedef std::map<std::string, int> t_file_number_map;
 static t_file_number_map file_number_map;
+// files may be preprocessed on several threads at same time.
+static SDL_SpinLock file_number_lock = 0;
 
 static bool encode_filename = true;
 
@@ -61,11 +68,16 @@ static std::string get_filename(const std::string& file_code){
 	int n = 0;
 	s >> std::hex >> n;
 
+	std::string ret = "<unknown>";
+	SDL_AtomicLock(&file_number_lock);
 	BOOST_FOREACH (const t_file_number_map::value_type& p, file_number_map){
-		if(p.second == n)
-			return p.first;
+		if(p.second == n) {
+			ret = p.first;
+			break;
+		}
 	}
-	return "<unknown>";
+	SDL_AtomicUnlock(&file_number_lock);
+	return ret;
 }
 
 // get code associated to this filename
@@ -76,12 +88,16 @@ static std::string get_file_code(const std::string& filename){
 	// current number of encountered filenames
 	static int current_file_number = 0;
 
-	int& fnum = file_number_map[utils::escape(filename, " \\")];
+	const std::string escaped = utils::escape(filename, " \\");
+	SDL_AtomicLock(&file_number_lock);
+	int& fnum = file_number_map[escaped];
 	if(fnum == 0)
 		fnum = ++current_file_number;
+	const int code = fnum;
+	SDL_AtomicUnlock(&file_number_lock);
 
 	std::ostringstream shex;
-	shex << std::hex << fnum;
+	shex << std::hex << code;
 	return shex.str();
 }
 
@@ -184,6 +200,261 @@ class preprocessor_data;
 class preprocessor_streambuf;
 struct preprocessor_deleter;
 
+static int expansion_cache_mode = PREPROC_CACHE_ON;
+static tpreproc_cache_stats expansion_cache_stats;
+static SDL_SpinLock expansion_cache_lock = 0;
+
+void set_preproc_cache_mode(int mode)
+{
+	expansion_cache_mode = mode;
+}
+
+int preproc_cache_mode()
+{
+	return expansion_cache_mode;
+}
+
+tpreproc_cache_stats preproc_cache_stats()
+{
+	SDL_AtomicLock(&expansion_cache_lock);
+	tpreproc_cache_stats ret = expansion_cache_stats;
+	SDL_AtomicUnlock(&expansion_cache_lock);
+	return ret;
+}
+
+void reset_preproc_cache_stats()
+{
+	SDL_AtomicLock(&expansion_cache_lock);
+	expansion_cache_stats = tpreproc_cache_stats();
+	SDL_AtomicUnlock(&expansion_cache_lock);
+}
+
+/**
+ * A line directive in expansion, it is either at caller's location, that is
+ * "<line> <location>" where location is caller's or ends with it, or a directive that is
+ * copied from an argument, with location of whoever passed that argument.
+ */
+struct tpreproc_mark
+{
+	tpreproc_mark(size_t begin, size_t end, int line, int arg)
+		: begin(begin)
+		, end(end)
+		, line(line)
+		, arg(arg)
+	{}
+
+	/** text that mark replaces. */
+	size_t begin;
+	size_t end;
+	/** line relative to caller's, when arg is -1. */
+	int line;
+	/** index of directive in argument directives of call. */
+	int arg;
+};
+
+/**
+ * Finds marks in @a text. Directives that aren't at caller's location are looked up
+ * in @a args, and when @a add, added if they aren't there.
+ * @return false if text has '\377', which key uses as separator.
+ */
+static bool relocate(const std::string& text, int line, const std::string& location, std::vector<std::string>& args, bool add,
+	std::vector<tpreproc_mark>& marks)
+{
+	if (text.find('\377') != std::string::npos) {
+		return false;
+	}
+	const size_t size = location.size();
+	size_t pos = 0;
+	while ((pos = text.find("\376line ", pos)) != std::string::npos) {
+		const size_t eol = text.find('\n', pos);
+		if (eol == std::string::npos) {
+			break;
+		}
+		if (eol - pos > size + 7 && text[eol - size - 1] == ' ' && !text.compare(eol - size, size, location)) {
+			const size_t end = eol - size - 1;
+			size_t begin = end;
+			while (begin > pos && isdigit(static_cast<unsigned char>(text[begin - 1]))) {
+				begin --;
+			}
+			if (begin < end && text[begin - 1] == ' ') {
+				marks.push_back(tpreproc_mark(begin, eol, atoi(text.c_str() + begin) - line, -1));
+			}
+		} else {
+			size_t at = 0;
+			for (; at < args.size(); at ++) {
+				if (args[at].size() == eol - pos && !text.compare(pos, eol - pos, args[at])) {
+					break;
+				}
+			}
+			if (at < args.size() || add) {
+				marks.push_back(tpreproc_mark(pos, eol, 0, at));
+				if (at == args.size()) {
+					args.push_back(text.substr(pos, eol - pos));
+				}
+			}
+		}
+		pos = eol + 1;
+	}
+	return true;
+}
+
+/**
+ * Expansions of one preprocessed stream, shared by buffers that macros are expanded to.
+ */
+class preproc_expansion_cache
+{
+public:
+	struct tentry
+	{
+		enum {NEW, SEEN, STORED, UNCACHEABLE};
+
+		tentry()
+			: state(NEW)
+			, pieces()
+			, marks()
+			, deps()
+			, bytes(0)
+		{}
+
+		int state;
+		/** text around marks, marks.size() + 1 of them. */
+		std::vector<std::string> pieces;
+		std::vector<tpreproc_mark> marks;
+		/** macros that expansion looked up, with their versions. */
+		std::vector<std::pair<std::string, int> > deps;
+		size_t bytes;
+	};
+
+	preproc_expansion_cache()
+		: mode(expansion_cache_mode)
+		, entries()
+		, repeats()
+		, side_effects(0)
+		, capturing(0)
+		, dep_log()
+		, bytes(0)
+		, stats()
+		, versions_()
+		, serial_(0)
+	{}
+
+	~preproc_expansion_cache()
+	{
+		SDL_AtomicLock(&expansion_cache_lock);
+		expansion_cache_stats.calls += stats.calls;
+		expansion_cache_stats.hits += stats.hits;
+		expansion_cache_stats.stores += stats.stores;
+		expansion_cache_stats.uncacheable += stats.uncacheable;
+		expansion_cache_stats.mismatches += stats.mismatches;
+		expansion_cache_stats.bytes += stats.bytes;
+		SDL_AtomicUnlock(&expansion_cache_lock);
+	}
+
+	void depend(const std::string& name)
+	{
+		if (capturing) {
+			dep_log.push_back(name);
+		}
+	}
+
+	void changed(const std::string& name)
+	{
+		versions_[name] = ++ serial_;
+		side_effects ++;
+	}
+
+	int version(const std::string& name) const
+	{
+		std::map<std::string, int>::const_iterator it = versions_.find(name);
+		return it != versions_.end()? it->second: 0;
+	}
+
+	bool valid(const tentry& entry) const
+	{
+		for (std::vector<std::pair<std::string, int> >::const_iterator it = entry.deps.begin(); it != entry.deps.end(); ++ it) {
+			if (version(it->first) != it->second) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	void store(tentry& entry, const std::string& text, int line, const std::string& location, std::vector<std::string>& args, size_t log)
+	{
+		bytes -= entry.bytes;
+		entry.pieces.clear();
+		entry.marks.clear();
+		entry.deps.clear();
+		if (!relocate(text, line, location, args, false, entry.marks)) {
+			entry.state = tentry::UNCACHEABLE;
+			entry.bytes = 0;
+			return;
+		}
+		size_t start = 0;
+		for (std::vector<tpreproc_mark>::const_iterator it = entry.marks.begin(); it != entry.marks.end(); ++ it) {
+			entry.pieces.push_back(text.substr(start, it->begin - start));
+			start = it->end;
+		}
+		entry.pieces.push_back(text.substr(start));
+		std::set<std::string> names(dep_log.begin() + log, dep_log.end());
+		for (std::set<std::string>::const_iterator it = names.begin(); it != names.end(); ++ it) {
+			entry.deps.push_back(std::make_pair(*it, version(*it)));
+		}
+		entry.state = tentry::STORED;
+		entry.bytes = text.size();
+		bytes += entry.bytes;
+		stats.bytes += entry.bytes;
+		stats.stores ++;
+	}
+
+	std::string replay(const tentry& entry, int line, const std::string& location, const std::vector<std::string>& args)
+	{
+		std::string text;
+		text.reserve(entry.bytes);
+		for (size_t at = 0; at < entry.marks.size(); at ++) {
+			text += entry.pieces[at];
+			const tpreproc_mark& mark = entry.marks[at];
+			if (mark.arg != -1) {
+				text += args[mark.arg];
+				continue;
+			}
+			char number[16];
+			snprintf(number, sizeof(number), "%i", mark.line + line);
+			text += number;
+			text += ' ';
+			text += location;
+		}
+		text += entry.pieces.back();
+		if (capturing) {
+			for (std::vector<std::pair<std::string, int> >::const_iterator it = entry.deps.begin(); it != entry.deps.end(); ++ it) {
+				dep_log.push_back(it->first);
+			}
+		}
+		return text;
+	}
+
+	const int mode;
+	std::map<std::string, tentry> entries;
+	/** calls of macro, and calls that are seen before. */
+	std::map<std::string, std::pair<int, int> > repeats;
+	/** defines, file reads and logs, they make expansion that does them uncacheable. */
+	int side_effects;
+	/** expansions being captured, macros looked up are logged while it isn't 0. */
+	int capturing;
+	std::vector<std::string> dep_log;
+	/** text of entries, they are dropped when it exceeds expansion_cache_bytes. */
+	size_t bytes;
+	tpreproc_cache_stats stats;
+
+private:
+	/** serial of last #define or #undef of macro, 0 if it is as in initial defines. */
+	std::map<std::string, int> versions_;
+	int serial_;
+};
+
+// stored expansions are dropped when they are larger than this.
+static const size_t expansion_cache_bytes = 32 * 1024 * 1024;
+
 /**
  * Base class for preprocessing an input.
  */
@@ -205,15 +476,47 @@ public:
 	virtual ~preprocessor();
 };
 
+/**
+ * Output of preprocessors, appended to a plain string instead of a stringstream,
+ * so filled text can be swapped out without a copy.
+ */
+struct tpreproc_buffer
+{
+	tpreproc_buffer& operator<<(char c)
+	{
+		text.push_back(c);
+		return *this;
+	}
+	tpreproc_buffer& operator<<(const char* s)
+	{
+		text.append(s);
+		return *this;
+	}
+	tpreproc_buffer& operator<<(const std::string& s)
+	{
+		text.append(s);
+		return *this;
+	}
+	tpreproc_buffer& operator<<(int i)
+	{
+		char buf[16];
+		text.append(buf, snprintf(buf, sizeof(buf), "%i", i));
+		return *this;
+	}
+
+	std::string text;
+};
+
 /**
  * Target for sending preprocessed output.
  * Objects of this class can be plugged into an STL stream.
+ * tokenizer reads it by next_chunk, that hands out filled text without copying it.
  */
-class preprocessor_streambuf: public streambuf
+class preprocessor_streambuf: public streambuf, public tchunk_source
 {
 	std::string out_buffer_;      /**< Buffer read by the STL stream. */
 	virtual int underflow();
-	std::stringstream buffer_;    /**< Buffer filled by the #current_ preprocessor. */
+	tpreproc_buffer buffer_;      /**< Buffer filled by the #current_ preprocessor. */
 	preprocessor *current_;       /**< Input preprocessor. */
 	preproc_map *defines_;
 	preproc_map default_defines_;
@@ -226,6 +529,11 @@ class preprocessor_streambuf: public streambuf
 	 * Deeper-nested preprocessors are then forbidden to.
 	 */
 	bool quoted_;
+	tpreproc_record* record_;
+	tpreproc_deferred* deferred_;
+	/** Non-zero when current input is from a macro, files included now aren't segments. */
+	int macro_depth_;
+	boost::shared_ptr<preproc_expansion_cache> expansions_;
 	friend class preprocessor;
 	friend class preprocessor_file;
 	friend class preprocessor_data;
@@ -234,8 +542,18 @@ class preprocessor_streambuf: public streambuf
 public:
 	preprocessor_streambuf(preproc_map *);
 	void error(const std::string &, int);
+	void set_record(tpreproc_record* record) { record_ = record; }
+	void set_deferred(tpreproc_deferred* deferred) { deferred_ = deferred; }
+	/** Output starts in @a textdomain, as if it is set by an outer file. */
+	void set_textdomain(const std::string& textdomain);
+	/** Reads all output, preprocessors that are left when it throws are deleted. */
+	std::string drain();
+	bool next_chunk(std::string& chunk);
 };
 
+// preprocessors are run until output buffer has at least this many characters.
+static const size_t preproc_chunk_size = 16 * 1024;
+
 preprocessor_streambuf::preprocessor_streambuf(preproc_map *def) :
 	streambuf(),
 	out_buffer_(""),
@@ -247,7 +565,11 @@ preprocessor_streambuf::preprocessor_streambuf(preproc_map *def) :
 	location_(""),
 	linenum_(0),
 	depth_(0),
-	quoted_(false)
+	quoted_(false),
+	record_(NULL),
+	deferred_(NULL),
+	macro_depth_(0),
+	expansions_(new preproc_expansion_cache)
 {
 }
 
@@ -262,8 +584,60 @@ preprocessor_streambuf::preprocessor_streambuf(preprocessor_streambuf const &t)
 	location_(""),
 	linenum_(0),
 	depth_(t.depth_),
-	quoted_(t.quoted_)
+	quoted_(t.quoted_),
+	record_(t.record_),
+	deferred_(t.deferred_),
+	macro_depth_(t.macro_depth_ + 1),
+	expansions_(t.expansions_)
+{
+	// output of this buffer is inserted into a string or macro argument, not at top level.
+}
+
+void preprocessor_streambuf::set_textdomain(const std::string& textdomain)
+{
+	textdomain_ = textdomain;
+	buffer_ << "\376textdomain " << textdomain << '\n';
+}
+
+std::string preprocessor_streambuf::drain()
+{
+	std::string res;
+	try {
+		while (underflow() != EOF) {
+			res.append(gptr(), egptr());
+			setg(eback(), egptr(), egptr());
+		}
+	} catch (...) {
+		while (current_) {
+			delete current_;
+		}
+		throw;
+	}
+	return res;
+}
+
+/**
+ * Hands out what is left in the get area, or else runs preprocessors for a new chunk.
+ * Text is swapped with @a chunk, so no character is copied and old chunk's memory is reused.
+ */
+bool preprocessor_streambuf::next_chunk(std::string& chunk)
 {
+	chunk.clear();
+	if (gptr() && gptr() < egptr()) {
+		chunk.assign(gptr(), egptr());
+		setg(eback(), egptr(), egptr());
+		return true;
+	}
+	while (current_ && buffer_.text.size() < preproc_chunk_size) {
+		if (!current_->get_chunk()) {
+			delete current_;
+		}
+	}
+	if (buffer_.text.empty()) {
+		return false;
+	}
+	chunk.swap(buffer_.text);
+	return true;
 }
 
 /**
@@ -284,20 +658,14 @@ int preprocessor_streambuf::underflow()
 		// The buffer has been completely read; fill it again.
 		// Keep part of the previous buffer, to ensure putback capabilities.
 		sz = out_buffer_.size();
-		buffer_.str(std::string());
 		if (sz > 3) {
-			buffer_ << out_buffer_.substr(sz - 3);
 			sz = 3;
 		}
-		else
-		{
-			buffer_ << out_buffer_;
-		}
+		buffer_.text.assign(out_buffer_, out_buffer_.size() - sz, sz);
 	} else {
 		// The internal get-data pointer is null
 	}
-	const int desired_fill_amount = 2000;
-	while (current_ && buffer_.rdbuf()->in_avail() < desired_fill_amount)
+	while (current_ && buffer_.text.size() < preproc_chunk_size + sz)
 	{
 		// Process files and data chunks until the desired buffer size is reached
 		if (!current_->get_chunk()) {
@@ -306,7 +674,8 @@ int preprocessor_streambuf::underflow()
 		}
 	}
 	// Update the internal state and data pointers
-	out_buffer_ = buffer_.str();
+	out_buffer_.swap(buffer_.text);
+	buffer_.text.clear();
 	char *begin = &*out_buffer_.begin();
 	unsigned bs = out_buffer_.size();
 	setg(begin, begin + sz, begin + bs);
@@ -455,6 +824,8 @@ class preprocessor_data: preprocessor
 	 */
 	int skipping_;
 	int linenum_;
+	/** Id of segment in target's record when this is a top level file, else -1. */
+	int segment_;
 
 	std::string read_word();
 	std::string read_line();
@@ -467,6 +838,11 @@ class preprocessor_data: preprocessor
 	void put(std::string const & /*, int change_line
 	= 0 */);
 	void conditional_skip(bool skip);
+	/** Expands macro through cache of target, @return false if it isn't and caller has to. */
+	bool expand_cached(const std::string& symbol, const preproc_define& val, char* in, int in_len,
+		std::map<std::string, std::string>* defines, const std::string& dir);
+	std::string capture(const std::string& symbol, const preproc_define& val, char* in, int in_len,
+		std::map<std::string, std::string>* defines, const std::string& dir, bool& quoted);
 
 	bool in_good_get() const { return current_at_ < in_len_; }
 	int in_get()
@@ -494,6 +870,7 @@ public:
 	                  std::map<std::string, std::string> *defines);
 	~preprocessor_data();
 	virtual bool get_chunk();
+	void set_segment(int id) { segment_ = id; }
 
 	friend bool operator==(preprocessor_data::token_desc::TOKEN_TYPE, char);
 	friend bool operator==(char, preprocessor_data::token_desc::TOKEN_TYPE);
@@ -509,26 +886,161 @@ bool operator==(char lhs, preprocessor_data::token_desc::TOKEN_TYPE rhs){ return
 bool operator!=(preprocessor_data::token_desc::TOKEN_TYPE rhs, char lhs){ return !(lhs == rhs); }
 bool operator!=(char lhs, preprocessor_data::token_desc::TOKEN_TYPE rhs){ return rhs != lhs; }
 
+static std::string cfg_listing(const std::vector<std::string>& files)
+{
+	std::string listing;
+	for (std::vector<std::string>::const_iterator it = files.begin(); it != files.end(); ++ it) {
+		const std::string& name = *it;
+		if (name.size() >= 5 && std::equal(name.rbegin(), name.rbegin() + 4, "gfc.")) {
+			listing += name;
+			listing += '\n';
+		}
+	}
+	return listing;
+}
+
+std::string preproc_dir_listing(const std::string& dir)
+{
+	std::vector<std::string> files;
+	get_files_in_dir(dir, &files, NULL, ENTIRE_FILE_PATH, SKIP_MEDIA_DIR, DO_REORDER);
+	return cfg_listing(files);
+}
+
+static bool is_directive(const char* in, int len, int at, const char* name)
+{
+	const int size = strlen(name);
+	return at + size <= len && !memcmp(in + at, name, size);
+}
+
+// check "{name" at @at, return false if name can be a file or directory.
+static bool is_macro_call(const char* in, int len, int at)
+{
+	for (at ++; at < len && in[at] != '}' && !isspace(static_cast<unsigned char>(in[at])); at ++) {
+		if (in[at] == '/' || in[at] == '.' || in[at] == '~') {
+			return false;
+		}
+	}
+	return true;
+}
+
+// by its text only, file defines no macro, includes no file, and only adds whole children to
+// element it is included in. macros it calls may still break it, caller must check result.
+static bool standalone_text(const char* in, int len)
+{
+	int depth = 0;
+	int braces = 0;
+	bool quoted = false;
+	for (int at = 0; at < len; at ++) {
+		const char ch = in[at];
+		if (ch == '{') {
+			if (!is_macro_call(in, len, at)) {
+				return false;
+			}
+			if (!quoted) {
+				braces ++;
+			}
+		} else if (ch == '"') {
+			quoted = !quoted;
+		} else if (quoted) {
+			continue;
+		} else if (ch == '}') {
+			braces --;
+		} else if (ch == '#') {
+			if (is_directive(in, len, at, "#define") || is_directive(in, len, at, "#undef") ||
+				is_directive(in, len, at, "#ifhave") || is_directive(in, len, at, "#ifnhave")) {
+				return false;
+			}
+			while (at < len && in[at] != '\n') {
+				at ++;
+			}
+		} else if (ch == '<' && at + 1 < len && in[at + 1] == '<') {
+			for (at += 2; at + 1 < len && (in[at] != '>' || in[at + 1] != '>'); at ++) {}
+			if (at + 1 >= len) {
+				return false;
+			}
+			at ++;
+		} else if (braces) {
+			continue;
+		} else if (ch == '[') {
+			if (at + 1 < len && in[at + 1] == '+') {
+				return false;
+			} else if (at + 1 < len && in[at + 1] == '/') {
+				if (!depth --) {
+					return false;
+				}
+			} else {
+				depth ++;
+			}
+		} else if (ch == '=' && !depth) {
+			return false;
+		}
+	}
+	return !depth && !braces && !quoted;
+}
+
 preprocessor_file::preprocessor_file(preprocessor_streambuf &t, std::string const &name) :
 	preprocessor(t),
 	files_(),
 	pos_(),
 	end_()
 {
+	t.expansions_->side_effects ++;
 	if (is_directory(name)) {
 		increment_preprocessor_progress(name, false);
 		get_files_in_dir(name, &files_, NULL, ENTIRE_FILE_PATH, SKIP_MEDIA_DIR, DO_REORDER);
+		if (t.record_) {
+			t.record_->dirs[name] = cfg_listing(files_);
+		}
 	} else {
 		increment_preprocessor_progress(name, true);
 
 		tfile lock(name, GENERIC_READ, OPEN_EXISTING);
 		int fsize = lock.valid()? posix_fsize(lock.fp): 0;
+		char* in = NULL;
 		if (fsize) {
-			char* in = (char*)malloc(fsize);
+			in = (char*)malloc(fsize);
 			posix_fread(lock.fp, in, fsize);
-
-			new preprocessor_data(t, in, fsize, "", get_short_wml_path(name),
+		}
+		int segment = -1;
+		if (t.record_) {
+			tpreproc_record::tfile& file = t.record_->files[name];
+			file.crc = preproc_crc(in, fsize);
+			file.size = fsize;
+			file.reads ++;
+			t.record_->reads ++;
+			if (fsize && !t.macro_depth_) {
+				file.segments ++;
+				segment = t.record_->segments.size();
+				t.record_->segments.push_back(tpreproc_record::tsegment());
+				tpreproc_record::tsegment& desc = t.record_->segments.back();
+				desc.file = name;
+				desc.textdomain = t.textdomain_;
+				desc.define_events = t.record_->define_events.size();
+				desc.reads = t.record_->reads;
+				t.buffer_ << "\376segment " << segment << '\n';
+
+				if (t.deferred_ && standalone_text(in, fsize)) {
+					// as if file is read and it adds no child, caller fills children.
+					desc.last = segment;
+					desc.reads = 1;
+					t.buffer_ << "\376endsegment " << segment << '\n';
+
+					tpreproc_deferred& deferred = *t.deferred_;
+					if (deferred.files.empty() || deferred.define_events != t.record_->define_events.size()) {
+						deferred.files.push_back(tpreproc_deferred::tfile(segment, boost::shared_ptr<const preproc_map>(new preproc_map(*t.defines_))));
+						deferred.define_events = t.record_->define_events.size();
+					} else {
+						deferred.files.push_back(tpreproc_deferred::tfile(segment, deferred.files.back().defines));
+					}
+					free(in);
+					fsize = 0;
+				}
+			}
+		}
+		if (fsize) {
+			preprocessor_data* data = new preprocessor_data(t, in, fsize, "", get_short_wml_path(name),
 				1, directory_name(name), t.textdomain_, NULL);
+			data->set_segment(segment);
 		}
 	}
 	pos_ = files_.begin();
@@ -570,7 +1082,12 @@ preprocessor_data::preprocessor_data(preprocessor_streambuf &t,
 	, slowpath_(0)
 	, skipping_(0)
 	, linenum_(linenum)
+	, segment_(-1)
 {
+	if (defines) {
+		++t.macro_depth_;
+	}
+
 	std::ostringstream s;
 
 	s << history;
@@ -597,6 +1114,16 @@ preprocessor_data::preprocessor_data(preprocessor_streambuf &t,
 
 preprocessor_data::~preprocessor_data()
 {
+	if (segment_ != -1) {
+		tpreproc_record::tsegment& segment = target_.record_->segments[segment_];
+		segment.last = target_.record_->segments.size() - 1;
+		segment.reads = target_.record_->reads - segment.reads + 1;
+		segment.defines = target_.record_->define_events.size() != segment.define_events;
+		target_.buffer_ << "\376endsegment " << segment_ << '\n';
+	}
+	if (local_defines_) {
+		--target_.macro_depth_;
+	}
 	free(in_);
 	delete local_defines_;
 }
@@ -767,6 +1294,138 @@ void preprocessor_data::conditional_skip(bool skip)
 	push_token(skip ? token_desc::SKIP_ELSE : token_desc::PROCESS_IF);
 }
 
+bool preprocessor_data::expand_cached(const std::string& symbol, const preproc_define& val, char* in, int in_len,
+	std::map<std::string, std::string>* defines, const std::string& dir)
+{
+	preproc_expansion_cache& cache = *target_.expansions_;
+	if (cache.mode == PREPROC_CACHE_OFF || target_.quoted_ || target_.location_.empty()) {
+		return false;
+	}
+	// arguments of macro seldom repeat, it costs more to make keys than it saves.
+	std::pair<int, int>& repeats = cache.repeats[symbol];
+	if (repeats.first >= 32 && repeats.second * 4 < repeats.first && cache.mode != PREPROC_CACHE_VERIFY) {
+		return false;
+	}
+	repeats.first ++;
+	const int line = target_.linenum_;
+	const std::string& location = target_.location_;
+
+	// expansion chooses between newlines and a line directive by length of location.
+	char number[16];
+	const int digits = snprintf(number, sizeof(number), "%i", line);
+	snprintf(number, sizeof(number), "%i", digits + (int)location.size());
+	std::string key = symbol;
+	key += "\377d";
+	key += target_.textdomain_;
+	key += "\377s";
+	key += number;
+	// directives in arguments, an expansion copies them where it uses the argument.
+	std::vector<std::string> args;
+	std::vector<tpreproc_mark> marks;
+	for (std::map<std::string, std::string>::const_iterator it = defines->begin(); it != defines->end(); ++ it) {
+		const std::string& value = it->second;
+		marks.clear();
+		if (!relocate(value, line, location, args, true, marks)) {
+			return false;
+		}
+		key += "\377a";
+		size_t start = 0;
+		for (std::vector<tpreproc_mark>::const_iterator it2 = marks.begin(); it2 != marks.end(); ++ it2) {
+			key.append(value, start, it2->begin - start);
+			if (it2->arg != -1) {
+				snprintf(number, sizeof(number), "\377r%i", it2->arg);
+			} else {
+				snprintf(number, sizeof(number), "\377l%i", it2->line);
+			}
+			key += number;
+			start = it2->end;
+		}
+		key.append(value, start, std::string::npos);
+	}
+
+	cache.stats.calls ++;
+	preproc_expansion_cache::tentry& entry = cache.entries[key];
+	if (entry.state == preproc_expansion_cache::tentry::UNCACHEABLE) {
+		cache.stats.uncacheable ++;
+		return false;
+	}
+	if (entry.state == preproc_expansion_cache::tentry::NEW) {
+		// most calls are seen once, don't pay for capture until it is called again.
+		entry.state = preproc_expansion_cache::tentry::SEEN;
+		return false;
+	}
+	repeats.second ++;
+
+	std::string text;
+	if (entry.state == preproc_expansion_cache::tentry::STORED && cache.valid(entry)) {
+		cache.stats.hits ++;
+		text = cache.replay(entry, line, location, args);
+		if (cache.mode == PREPROC_CACHE_VERIFY) {
+			bool quoted = false;
+			const std::string fresh = capture(symbol, val, in, in_len, defines, dir, quoted);
+			if (fresh != text) {
+				cache.stats.mismatches ++;
+				ERR_CF << "cached expansion of macro " << symbol << " differs from fresh one at " << get_location(location) << '\n';
+				text = fresh;
+			}
+		} else {
+			free(in);
+			delete defines;
+		}
+
+	} else {
+		const size_t log = cache.dep_log.size();
+		const int side_effects = cache.side_effects;
+		bool quoted = false;
+		text = capture(symbol, val, in, in_len, defines, dir, quoted);
+		target_.quoted_ = quoted;
+
+		// nested expansions may have dropped entries, find it again.
+		preproc_expansion_cache::tentry& stored = cache.entries[key];
+		if (quoted || cache.side_effects != side_effects) {
+			stored.state = preproc_expansion_cache::tentry::UNCACHEABLE;
+			cache.stats.uncacheable ++;
+		} else {
+			cache.store(stored, text, line, location, args, log);
+		}
+		if (cache.bytes > expansion_cache_bytes) {
+			cache.entries.clear();
+			cache.bytes = 0;
+		}
+	}
+	if (!cache.capturing) {
+		cache.dep_log.clear();
+	}
+	put(text);
+	return true;
+}
+
+std::string preprocessor_data::capture(const std::string& symbol, const preproc_define& val, char* in, int in_len,
+	std::map<std::string, std::string>* defines, const std::string& dir, bool& quoted)
+{
+	preproc_expansion_cache& cache = *target_.expansions_;
+	cache.capturing ++;
+	cache.dep_log.push_back(symbol);
+
+	// same context as target, so output is what expanding into target outputs.
+	preprocessor_streambuf buf(target_);
+	buf.textdomain_ = target_.textdomain_;
+	buf.location_ = target_.location_;
+	buf.linenum_ = target_.linenum_;
+	buf.macro_depth_ = target_.macro_depth_;
+	std::string text;
+	try {
+		new preprocessor_data(buf, in, in_len, val.location, "", val.linenum, dir, val.textdomain, defines);
+		text = buf.drain();
+	} catch (...) {
+		cache.capturing --;
+		throw;
+	}
+	cache.capturing --;
+	quoted = buf.quoted_;
+	return text;
+}
+
 bool preprocessor_data::get_chunk()
 {
 	int c = in_get();
@@ -869,24 +1528,38 @@ bool preprocessor_data::get_chunk()
 				buffer.erase(buffer.end() - 7, buffer.end());
 				(*target_.defines_)[symbol] = preproc_define(buffer, items, target_.textdomain_,
 					                       linenum + 1, target_.location_);
+				target_.expansions_->changed(symbol);
+				if (target_.record_) {
+					tpreproc_record::tdefine_event event;
+					event.name = symbol;
+					event.undef = false;
+					event.define = (*target_.defines_)[symbol];
+					target_.record_->define_events.push_back(event);
+				}
 				LOG_CF << "defining macro " << symbol << " (location " << get_location(target_.location_) << ")\n";
 			}
 		} else if (command == "ifdef") {
 			skip_spaces();
 			std::string const &symbol = read_word();
 			bool found = target_.defines_->count(symbol) != 0;
+			target_.expansions_->depend(symbol);
 			// testing for macro 'symbol': (found ? "defined" : "not defined");
 			conditional_skip(!found);
 		} else if (command == "ifndef") {
 			skip_spaces();
 			std::string const &symbol = read_word();
 			bool found = target_.defines_->count(symbol) != 0;
+			target_.expansions_->depend(symbol);
 			// "testing for macro 'symbol': (found ? "defined" : "not defined")
 			conditional_skip(found);
 		} else if (command == "ifhave") {
 			skip_spaces();
 			std::string const &symbol = read_word();
 			bool found = !get_wml_location(symbol, directory_).empty();
+			if (target_.record_) {
+				target_.record_->ifhave = true;
+			}
+			target_.expansions_->side_effects ++;
 			DBG_CF << "testing for file or directory " << symbol << ": "
 				<< (found ? "found" : "not found") << '\n';
 			conditional_skip(!found);
@@ -894,6 +1567,10 @@ bool preprocessor_data::get_chunk()
 			skip_spaces();
 			std::string const &symbol = read_word();
 			bool found = !get_wml_location(symbol, directory_).empty();
+			if (target_.record_) {
+				target_.record_->ifhave = true;
+			}
+			target_.expansions_->side_effects ++;
 			DBG_CF << "testing for file or directory " << symbol << ": "
 				<< (found ? "found" : "not found") << '\n';
 			conditional_skip(found);
@@ -935,6 +1612,13 @@ bool preprocessor_data::get_chunk()
 			std::string const &symbol = read_word();
 			if (!skipping_) {
 				target_.defines_->erase(symbol);
+				target_.expansions_->changed(symbol);
+				if (target_.record_) {
+					tpreproc_record::tdefine_event event;
+					event.name = symbol;
+					event.undef = true;
+					target_.record_->define_events.push_back(event);
+				}
 				LOG_CF << "undefine macro " << symbol << " (location " << get_location(target_.location_) << ")\n";
 			}
 		} else if (command == "error") {
@@ -949,6 +1633,7 @@ bool preprocessor_data::get_chunk()
 			if (!skipping_) {
 				skip_spaces();
 				std::string message = read_rest_of_line();
+				target_.expansions_->side_effects ++;
 				WRN_CF << "#warning: \"" << message << "\" at "
 					<< linenum_ << ' ' << get_location(target_.location_) << '\n';
 			} else
@@ -1013,6 +1698,7 @@ bool preprocessor_data::get_chunk()
 			else if ((macro = target_.defines_->find(symbol)) != target_.defines_->end())
 			{
 				preproc_define const &val = macro->second;
+				target_.expansions_->depend(symbol);
 				size_t nb_arg = strings_.size() - token.stack_pos - 1;
 				if (nb_arg != val.arguments.size())
 				{
@@ -1033,8 +1719,10 @@ bool preprocessor_data::get_chunk()
 				std::string const &dir = directory_name(val.location.substr(0, val.location.find(' ')));
 				if (!slowpath_) {
 					DBG_CF << "substituting macro " << symbol << '\n';
-					new preprocessor_data(target_, in, in_len, val.location, "",
-					                      val.linenum, dir, val.textdomain, defines);
+					if (!expand_cached(symbol, val, in, in_len, defines, dir)) {
+						new preprocessor_data(target_, in, in_len, val.location, "",
+						                      val.linenum, dir, val.textdomain, defines);
+					}
 				} else {
 					DBG_CF << "substituting (slow) macro " << symbol << '\n';
 					std::ostringstream res;
@@ -1119,7 +1807,7 @@ preprocessor_deleter::~preprocessor_deleter()
 }
 
 
-std::istream *preprocess_file(std::string const &fname, preproc_map *defines)
+std::istream *preprocess_file(std::string const &fname, preproc_map *defines, tpreproc_record* record, tpreproc_deferred* deferred)
 {
 	preproc_map *owned_defines = NULL;
 	if (!defines) {
@@ -1131,6 +1819,144 @@ std::istream *preprocess_file(std::string const &fname, preproc_map *defines)
 		defines = owned_defines;
 	}
 	preprocessor_streambuf *buf = new preprocessor_streambuf(defines);
+	if (record) {
+		for (preproc_map::const_iterator it = defines->begin(); it != defines->end(); ++ it) {
+			tpreproc_record::tdefine_event event;
+			event.name = it->first;
+			event.undef = false;
+			event.define = it->second;
+			record->define_events.push_back(event);
+		}
+		buf->set_record(record);
+		buf->set_deferred(deferred);
+	}
 	new preprocessor_file(*buf, fname);
 	return new preprocessor_deleter(buf, owned_defines);
+}
+
+std::istream *preprocess_segment(const std::string& fname, preproc_map* defines, const std::string& textdomain, tpreproc_record& record)
+{
+	preprocessor_streambuf *buf = new preprocessor_streambuf(defines);
+	buf->set_record(&record);
+	buf->set_textdomain(textdomain);
+	new preprocessor_file(*buf, fname);
+	return new preprocessor_deleter(buf, NULL);
+}
+
+uint32_t preproc_crc(const char* data, int len)
+{
+	return crc32(crc32(0, NULL, 0), reinterpret_cast<const Bytef*>(data), len);
+}
+
+void tpreproc_record::replay_defines(size_t events, preproc_map& defines) const
+{
+	defines.clear();
+	for (size_t at = 0; at < events; at ++) {
+		const tdefine_event& event = define_events[at];
+		if (event.undef) {
+			defines.erase(event.name);
+		} else {
+			defines[event.name] = event.define;
+		}
+	}
+}
+
+void tpreproc_record::write(config& cfg) const
+{
+	cfg["reads"] = reads;
+	cfg["ifhave"] = ifhave;
+	for (std::map<std::string, tfile>::const_iterator it = files.begin(); it != files.end(); ++ it) {
+		config& file = cfg.add_child("file");
+		file["name"] = it->first;
+		file["crc"] = it->second.crc;
+		file["size"] = it->second.size;
+		file["reads"] = it->second.reads;
+		file["segments"] = it->second.segments;
+	}
+	for (std::map<std::string, std::string>::const_iterator it = dirs.begin(); it != dirs.end(); ++ it) {
+		config& dir = cfg.add_child("dir");
+		dir["name"] = it->first;
+		dir["files"] = it->second;
+	}
+	for (std::vector<tdefine_event>::const_iterator it = define_events.begin(); it != define_events.end(); ++ it) {
+		// same layout as preproc_define::write, so preproc_define::read can read it.
+		config& event = cfg.add_child("define");
+		event["name"] = it->name;
+		if (it->undef) {
+			event["undef"] = true;
+			continue;
+		}
+		const preproc_define& define = it->define;
+		event["value"] = define.value;
+		event["textdomain"] = define.textdomain;
+		event["linenum"] = define.linenum;
+		event["location"] = get_location(define.location);
+		for (std::vector<std::string>::const_iterator it2 = define.arguments.begin(); it2 != define.arguments.end(); ++ it2) {
+			event.add_child("argument")["name"] = *it2;
+		}
+	}
+	for (std::vector<tsegment>::const_iterator it = segments.begin(); it != segments.end(); ++ it) {
+		config& segment = cfg.add_child("segment");
+		segment["file"] = it->file;
+		segment["textdomain"] = it->textdomain;
+		segment["define_events"] = (int)it->define_events;
+		segment["last"] = it->last;
+		segment["reads"] = it->reads;
+		segment["defines"] = it->defines;
+		std::stringstream parent;
+		for (std::vector<int>::const_iterator it2 = it->parent.begin(); it2 != it->parent.end(); ++ it2) {
+			if (it2 != it->parent.begin()) {
+				parent << ",";
+			}
+			parent << *it2;
+		}
+		segment["parent"] = parent.str();
+		segment["first"] = it->first;
+		segment["count"] = it->count;
+		segment["clean"] = it->clean;
+	}
+}
+
+void tpreproc_record::read(const config& cfg)
+{
+	*this = tpreproc_record();
+
+	reads = cfg["reads"].to_int();
+	ifhave = cfg["ifhave"].to_bool();
+	BOOST_FOREACH (const config& file, cfg.child_range("file")) {
+		tfile& desc = files[file["name"].str()];
+		desc.crc = file["crc"].to_unsigned();
+		desc.size = file["size"].to_int();
+		desc.reads = file["reads"].to_int();
+		desc.segments = file["segments"].to_int();
+	}
+	BOOST_FOREACH (const config& dir, cfg.child_range("dir")) {
+		dirs[dir["name"].str()] = dir["files"].str();
+	}
+	BOOST_FOREACH (const config& event, cfg.child_range("define")) {
+		define_events.push_back(tdefine_event());
+		tdefine_event& desc = define_events.back();
+		desc.name = event["name"].str();
+		desc.undef = event["undef"].to_bool();
+		if (!desc.undef) {
+			desc.define.read(event);
+		}
+	}
+	BOOST_FOREACH (const config& segment, cfg.child_range("segment")) {
+		segments.push_back(tsegment());
+		tsegment& desc = segments.back();
+		desc.file = segment["file"].str();
+		desc.textdomain = segment["textdomain"].str();
+		desc.define_events = segment["define_events"].to_int();
+		desc.last = segment["last"].to_int();
+		desc.reads = segment["reads"].to_int();
+		desc.defines = segment["defines"].to_bool();
+		const std::vector<std::string> parent = utils::split(segment["parent"].str());
+		for (std::vector<std::string>::const_iterator it = parent.begin(); it != parent.end(); ++ it) {
+			desc.parent.push_back(lexical_cast<int>(*it));
+		}
+		desc.first = segment["first"].to_int();
+		desc.count = segment["count"].to_int();
+		desc.clean = segment["clean"].to_bool();
+	}
 }
\ No newline at end of file
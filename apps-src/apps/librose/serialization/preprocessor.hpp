@@ -23,6 +23,8 @@
 #include <map>
 #include <vector>
 
+#include <boost/shared_ptr.hpp>
+
 #include "game_errors.hpp"
 
 class config_writer;
@@ -63,15 +65,189 @@ struct preproc_config {
 
 std::string lineno_string(const std::string &lineno);
 
+/**
+ * What preprocess_file read and where every included file went, so a caller can
+ * rebuild config of changed files only instead of whole tree.
+ *
+ * File that is included at top level (not from a macro body or argument) is a segment.
+ * preprocessor marks segment in output by "\376segment <id>" and "\376endsegment <id>",
+ * parser fills position of segment's children in parsed config.
+ */
+struct tpreproc_record
+{
+	struct tfile
+	{
+		tfile()
+			: crc(0)
+			, size(0)
+			, reads(0)
+			, segments(0)
+		{}
+
+		uint32_t crc;
+		int size;
+		int reads;
+		int segments;
+	};
+
+	struct tdefine_event
+	{
+		std::string name;
+		bool undef;
+		preproc_define define;
+	};
+
+	struct tsegment
+	{
+		tsegment()
+			: file()
+			, textdomain()
+			, define_events(0)
+			, last(-1)
+			, reads(0)
+			, defines(false)
+			, parent()
+			, first(0)
+			, count(0)
+			, clean(false)
+		{}
+
+		std::string file;
+		/** textdomain when file is included. */
+		std::string textdomain;
+		/** events in #define_events before file. */
+		size_t define_events;
+		/** id of last segment nested in this one, segments are in inclusion order. */
+		int last;
+		/** files read while file is preprocessed, including itself. */
+		int reads;
+		/** this file, or file nested in it, defines or undefines macro. */
+		bool defines;
+
+		// filled by parser.
+		/** ordered child indexes from root to element that file's children are added to. */
+		std::vector<int> parent;
+		/** ordered index of file's first child in parent. */
+		int first;
+		int count;
+		/** file adds only whole children to parent, so children can be replaced by reparsing it. */
+		bool clean;
+	};
+
+	tpreproc_record()
+		: files()
+		, dirs()
+		, define_events()
+		, segments()
+		, reads(0)
+		, ifhave(false)
+	{}
+
+	/** defines before segment, initial defines are the first events. */
+	void replay_defines(size_t events, preproc_map& defines) const;
+
+	void write(config& cfg) const;
+	void read(const config& cfg);
+
+	std::map<std::string, tfile> files;
+	/** .cfg files of every included directory, separated by '\n'. */
+	std::map<std::string, std::string> dirs;
+	std::vector<tdefine_event> define_events;
+	std::vector<tsegment> segments;
+	int reads;
+	/** #ifhave or #ifnhave is used, result depends on files that aren't read. */
+	bool ifhave;
+};
+
+/**
+ * Files that preprocess_file left out of its output, so caller can preprocess them with
+ * preprocess_segment, on other threads, and put their children into parsed config by their
+ * segments. A file is left out only when it is a segment, and by a scan of its text, defines
+ * no macro, includes no file and only adds whole children to element it is included in.
+ * Its segment is in record as if it is read, with no children.
+ */
+struct tpreproc_deferred
+{
+	struct tfile
+	{
+		tfile(int segment, const boost::shared_ptr<const preproc_map>& defines)
+			: segment(segment)
+			, defines(defines)
+		{}
+
+		int segment;
+		/** defines when file is included, files with no #define between them share one. */
+		boost::shared_ptr<const preproc_map> defines;
+	};
+
+	tpreproc_deferred()
+		: files()
+		, define_events(0)
+	{}
+
+	std::vector<tfile> files;
+	/** record's define events when defines of last file are taken. */
+	size_t define_events;
+};
+
+uint32_t preproc_crc(const char* data, int len);
+/** .cfg files in @a dir that preprocessor includes, as tpreproc_record::dirs keeps them. */
+std::string preproc_dir_listing(const std::string& dir);
+
 std::ostream& operator<<(std::ostream& stream, const preproc_map::value_type& def);
 
+/**
+ * Macro calls are expanded once per (macro, arguments, macros the expansion depends on),
+ * later calls with same arguments replay the expansion, only line directives are moved
+ * to the caller. In verify mode every replay is compared with a fresh expansion, which
+ * is what is output, and a difference is logged as an error.
+ */
+enum {PREPROC_CACHE_OFF, PREPROC_CACHE_ON, PREPROC_CACHE_VERIFY};
+void set_preproc_cache_mode(int mode);
+int preproc_cache_mode();
+
+struct tpreproc_cache_stats
+{
+	tpreproc_cache_stats()
+		: calls(0)
+		, hits(0)
+		, stores(0)
+		, uncacheable(0)
+		, mismatches(0)
+		, bytes(0)
+	{}
+
+	/** macro calls that are looked up in cache. */
+	int calls;
+	int hits;
+	/** expansions that are put into cache, a call is stored the second time it is seen. */
+	int stores;
+	/** expansions that define macros, include files or test files, they aren't replayed. */
+	int uncacheable;
+	/** replays that differ from fresh expansion, in verify mode. */
+	int mismatches;
+	/** text of stored expansions. */
+	size_t bytes;
+};
+/** counters of preprocessed streams that are deleted since last reset. */
+tpreproc_cache_stats preproc_cache_stats();
+void reset_preproc_cache_stats();
+
 /**
  * Function to use the WML preprocessor on a file.
  *
  * @param defines                 A map of symbols defined.
+ * @param deferred                When set, with @a record, files that can be
+ *                                parsed apart are left out and listed in it.
  *
  * @returns                       The resulting preprocessed file data.
  */
-std::istream *preprocess_file(std::string const &fname, preproc_map *defines = NULL);
+std::istream *preprocess_file(std::string const &fname, preproc_map *defines = NULL, tpreproc_record* record = NULL, tpreproc_deferred* deferred = NULL);
+
+/**
+ * Preprocess one file of tree again, as it is included at segment of record.
+ * Output starts with textdomain directive, file is segment 0 of @a record.
+ */
+std::istream *preprocess_segment(const std::string& fname, preproc_map* defines, const std::string& textdomain, tpreproc_record& record);
 
 #endif
@@ -27,8 +27,13 @@ tokenizer::tokenizer(std::istream& in) :
 	startlineno_(0),
 	textdomain_("rose-lib"),
 	file_(),
+	segment_events_(),
 	token_(),
-	in_(in)
+	in_(in),
+	source_(dynamic_cast<tchunk_source*>(in.rdbuf())),
+	chunk_(),
+	pos_(NULL),
+	end_(NULL)
 {
 	for (int c = 0; c < 128; ++c)
 	{
@@ -160,7 +165,7 @@ const token &tokenizer::next_token()
 
 	if (current_ == '\0') {
 		if (game_config::savegame_cache) {
-			in_.read((char*)game_config::savegame_cache, game_config::savegame_cache_size).gcount();
+			read_raw(game_config::savegame_cache, game_config::savegame_cache_size);
 		}
 	} else if (current_ != EOF) {
 		next_char();
@@ -169,6 +174,46 @@ const token &tokenizer::next_token()
 	return token_;
 }
 
+bool tokenizer::refill()
+{
+	// chunks are larger than what a stream buffers, calls per chunk don't matter.
+	const int chunk_size = 16 * 1024;
+	do {
+		if (source_) {
+			if (!source_->next_chunk(chunk_)) {
+				return false;
+			}
+		} else {
+			if (!in_.good()) {
+				return false;
+			}
+			chunk_.resize(chunk_size);
+			const std::streamsize size = in_.rdbuf()->sgetn(&chunk_[0], chunk_size);
+			if (size <= 0) {
+				chunk_.clear();
+				in_.setstate(std::ios_base::eofbit);
+				return false;
+			}
+			chunk_.resize(size);
+		}
+	} while (chunk_.empty());
+
+	pos_ = chunk_.data();
+	end_ = pos_ + chunk_.size();
+	return true;
+}
+
+void tokenizer::read_raw(unsigned char* dst, int size)
+{
+	while (size > 0 && (pos_ < end_ || refill())) {
+		const int len = std::min<int>(size, end_ - pos_);
+		memcpy(dst, pos_, len);
+		pos_ += len;
+		dst += len;
+		size -= len;
+	}
+}
+
 bool tokenizer::skip_command(char const *cmd)
 {
 	for (; *cmd; ++cmd) {
@@ -183,6 +228,8 @@ bool tokenizer::skip_command(char const *cmd)
 
 void tokenizer::skip_comment()
 {
+	// segment markers come from preprocessor only, not from '#' comment.
+	const bool directive = current_ == 254;
 	next_char_fast();
 	if (current_ == '\n' || current_ == EOF) return;
 	std::string *dst = NULL;
@@ -204,6 +251,18 @@ void tokenizer::skip_comment()
 		next_char_fast();
 		dst = &file_;
 	}
+	else if (directive && (current_ == 's' || current_ == 'e'))
+	{
+		const bool begin = current_ == 's';
+		if (!skip_command(begin? "egment": "ndsegment")) goto fail;
+		int id = 0;
+		while (is_num(current_)) {
+			id = id * 10 + (current_ - '0');
+			next_char_fast();
+		}
+		segment_events_.push_back(begin? id + 1: -(id + 1));
+		goto fail;
+	}
 	else
 	{
 		fail:
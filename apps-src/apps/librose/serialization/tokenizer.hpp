@@ -21,6 +21,7 @@
 
 #include <istream>
 #include <string>
+#include <vector>
 
 class config;
 
@@ -53,10 +54,27 @@ struct token
 	std::string value;
 };
 
+/**
+ * Streambuf that can hand its text to tokenizer a chunk at a time, like preprocessor
+ * does, so text goes from producer to tokenizer with no copy and no call per character.
+ */
+class tchunk_source
+{
+public:
+	virtual ~tchunk_source() {}
+
+	/**
+	 * Replaces @a chunk by next text, old content of @a chunk can be reused as buffer.
+	 * @return false if there is no text left.
+	 */
+	virtual bool next_chunk(std::string& chunk) = 0;
+};
+
 /** Abstract baseclass for the tokenizer. */
 class tokenizer
 {
 public:
+	/** If streambuf of @a in is a tchunk_source, text is read from it by chunks. */
 	tokenizer(std::istream& in);
 	~tokenizer();
 
@@ -89,6 +107,15 @@ public:
 		return startlineno_;
 	}
 
+	/**
+	 * Segment markers of preprocessor read since caller cleared it,
+	 * id + 1 for "\376segment <id>", -(id + 1) for "\376endsegment <id>".
+	 */
+	std::vector<int>& segment_events()
+	{
+		return segment_events_;
+	}
+
 private:
 	tokenizer();
 	int current_;
@@ -105,8 +132,8 @@ private:
 	void next_char_fast()
 	{
 		do {
-			if (LIKELY(in_.good())) {
-				current_ = in_.get();
+			if (LIKELY(pos_ < end_) || refill()) {
+				current_ = static_cast<unsigned char>(*pos_ ++);
 			} else {
 				current_ = EOF;
 				return;
@@ -131,11 +158,19 @@ private:
 #endif
 	}
 
-	int peek_char() const
+	int peek_char()
 	{
-		return in_.peek();
+		if (LIKELY(pos_ < end_) || refill()) {
+			return static_cast<unsigned char>(*pos_);
+		}
+		return EOF;
 	}
 
+	/** Reads next chunk of input, @return false at end of input. */
+	bool refill();
+	/** Reads input as it is, for savegame data after '\0'. */
+	void read_raw(unsigned char* dst, int size);
+
 	enum
 	{
 		TOK_SPACE = 1,
@@ -173,11 +208,16 @@ private:
 
 	std::string textdomain_;
 	std::string file_;
+	std::vector<int> segment_events_;
 	token token_;
 #ifdef DEBUG
 	token previous_token_;
 #endif
 	std::istream &in_;
+	tchunk_source* source_;
+	std::string chunk_;
+	const char* pos_;
+	const char* end_;
 	char char_types_[128];
 };
 
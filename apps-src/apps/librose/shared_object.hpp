@@ -21,6 +21,8 @@
 #include <boost/multi_index/hashed_index.hpp>
 #include <boost/multi_index/member.hpp>
 
+#include "SDL_atomic.h"
+
 template <typename T>
 struct shared_node {
 	T val;
@@ -48,7 +50,9 @@ public:
 
 	shared_object(const shared_object& o) : val_(o.val_) {
 		assert(valid());
+		SDL_AtomicLock(&lock());
 		val_->count++;
+		SDL_AtomicUnlock(&lock());
 	}
 
 	operator const T &() const {
@@ -76,10 +80,12 @@ public:
 		if (valid() && o == get()) return;
 		clear();
 
-		val_ = &*index().insert(node(o)).first;
+		const node n(o);
+		SDL_AtomicLock(&lock());
+		val_ = &*index().insert(n).first;
 		val_->count++;
-
 		assert((val_->count) < (node::max_count));
+		SDL_AtomicUnlock(&lock());
 	}
 
 	const T& get() const {
@@ -110,6 +116,8 @@ protected:
 
 	static hash_map& map() { static hash_map* map = new hash_map; return *map; }
 	static hash_index& index() { return map().template get<0>(); }
+	// config is parsed on several threads at same time, map and counts are shared by all of them.
+	static SDL_SpinLock& lock() { static SDL_SpinLock lock = 0; return lock; }
 
 	const node* val_;
 
@@ -119,9 +127,11 @@ protected:
 
 	void clear() {
 		if (!valid()) return;
+		SDL_AtomicLock(&lock());
 		val_->count--;
 
 		if (val_->count == 0) index().erase(index().find(val_->val));
+		SDL_AtomicUnlock(&lock());
 		val_ = NULL;
 	}
 
@@ -15,6 +15,7 @@
 
 #include "global.hpp"
 
+#include <algorithm>
 #include <vector>
 
 #include "log.hpp"
@@ -92,4 +93,172 @@ bool condition::notify_all()
 	return true;
 }
 
+namespace {
+
+// worker threads of parallel_for. created when first used, joined at exit.
+// every worker takes part in every job, so a job is done when all of them left it.
+class tpool
+{
+public:
+	tpool();
+	~tpool();
+
+	int threads() const { return threads_.size(); }
+
+	// return false if pool can't take job now, caller should run it itself.
+	bool run(int count, int grain, const boost::function<void (int begin, int end)>& fn);
+
+private:
+	static int thread_main(void* param);
+	void run_chunks();
+
+private:
+	std::vector<SDL_Thread*> threads_;
+	mutex mutex_;
+	condition start_;
+	condition done_;
+	bool quit_;
+	bool busy_;
+	uint32_t generation_;
+	int active_;
+
+	const boost::function<void (int begin, int end)>* fn_;
+	int count_;
+	int grain_;
+	SDL_atomic_t next_;
+};
+
+// jobs are short and memory bound, more threads than this don't pay.
+const int max_pool_threads = 7;
+
+tpool::tpool()
+	: threads_()
+	, mutex_()
+	, start_()
+	, done_()
+	, quit_(false)
+	, busy_(false)
+	, generation_(0)
+	, active_(0)
+	, fn_(NULL)
+	, count_(0)
+	, grain_(1)
+{
+	SDL_AtomicSet(&next_, 0);
+
+	const int threads = std::min(SDL_GetCPUCount(), max_pool_threads + 1) - 1;
+	for (int n = 0; n < threads; n ++) {
+		SDL_Thread* thread = SDL_CreateThread(thread_main, "parallel_for", this);
+		if (!thread) {
+			ERR_G << "SDL_CreateThread: " << SDL_GetError() << "\n";
+			break;
+		}
+		threads_.push_back(thread);
+	}
+}
+
+tpool::~tpool()
+{
+	{
+		lock lock(mutex_);
+		quit_ = true;
+		start_.notify_all();
+	}
+	for (std::vector<SDL_Thread*>::const_iterator it = threads_.begin(); it != threads_.end(); ++ it) {
+		SDL_WaitThread(*it, NULL);
+	}
+}
+
+int tpool::thread_main(void* param)
+{
+	tpool& pool = *static_cast<tpool*>(param);
+	uint32_t generation = 0;
+
+	while (true) {
+		{
+			lock lock(pool.mutex_);
+			while (!pool.quit_ && pool.generation_ == generation) {
+				pool.start_.wait(pool.mutex_);
+			}
+			if (pool.quit_) {
+				return 0;
+			}
+			generation = pool.generation_;
+		}
+
+		pool.run_chunks();
+
+		{
+			lock lock(pool.mutex_);
+			if (!-- pool.active_) {
+				pool.done_.notify_one();
+			}
+		}
+	}
+}
+
+void tpool::run_chunks()
+{
+	for (int begin = SDL_AtomicAdd(&next_, grain_); begin < count_; begin = SDL_AtomicAdd(&next_, grain_)) {
+		(*fn_)(begin, std::min(begin + grain_, count_));
+	}
+}
+
+bool tpool::run(int count, int grain, const boost::function<void (int begin, int end)>& fn)
+{
+	{
+		lock lock(mutex_);
+		// busy when called from a worker, or from another thread at same time.
+		if (busy_ || threads_.empty()) {
+			return false;
+		}
+		busy_ = true;
+		fn_ = &fn;
+		count_ = count;
+		grain_ = grain;
+		SDL_AtomicSet(&next_, 0);
+		active_ = threads_.size();
+		generation_ ++;
+		start_.notify_all();
+	}
+
+	run_chunks();
+
+	{
+		lock lock(mutex_);
+		while (active_) {
+			done_.wait(mutex_);
+		}
+		fn_ = NULL;
+		busy_ = false;
+	}
+	return true;
+}
+
+tpool& get_pool()
+{
+	static tpool pool;
+	return pool;
+}
+
+}
+
+int hardware_concurrency()
+{
+	return get_pool().threads() + 1;
+}
+
+void parallel_for(int count, int grain, const boost::function<void (int begin, int end)>& fn)
+{
+	if (count <= 0) {
+		return;
+	}
+	if (grain < 1) {
+		grain = 1;
+	}
+	if (count <= grain || !get_pool().run(count, grain, fn)) {
+		fn(0, count);
+	}
+}
+
 }
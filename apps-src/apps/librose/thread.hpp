@@ -23,6 +23,7 @@
 
 #include <boost/scoped_ptr.hpp>
 #include <boost/smart_ptr.hpp>
+#include <boost/function.hpp>
 
 #include "webrtc/base/signalthread.h"
 #include "webrtc/base/bind.h"
@@ -187,6 +188,15 @@ private:
 	SDL_cond* const cond_;
 };
 
+// number of threads parallel_for runs on, including calling thread.
+int hardware_concurrency();
+
+// split [0, count) into chunks of grain and call fn(begin, end) for each chunk,
+// on calling thread and a shared pool of worker threads. return after all chunks are done.
+// chunks run in any order and on any thread, fn must only write state owned by its range.
+// it is serial when count <= grain, on single core, or when called from within another parallel_for.
+void parallel_for(int count, int grain, const boost::function<void (int begin, int end)>& fn);
+
 }
 
 #endif
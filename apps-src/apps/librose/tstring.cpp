@@ -27,6 +27,7 @@
 #include "gettext.hpp"
 #include "log.hpp"
 #include <boost/functional/hash.hpp>
+#include "SDL_atomic.h"
 
 static lg::log_domain log_config("config");
 #define LOG_CF LOG_STREAM(info, log_config)
@@ -42,6 +43,8 @@ namespace {
 
 	std::vector<std::string> id_to_textdomain;
 	std::map<std::string, unsigned int> textdomain_to_id;
+	// config may be parsed on several threads at same time.
+	SDL_SpinLock textdomain_lock = 0;
 }
 
 size_t t_string_base::hash_value() const {
@@ -106,12 +109,15 @@ void t_string_base::walker::update()
 			end_ = string_.size();
 
 		id = string_[begin_ + 1] + string_[begin_ + 2] * 256;
+		SDL_AtomicLock(&textdomain_lock);
 		if(id >= id_to_textdomain.size()) {
+			SDL_AtomicUnlock(&textdomain_lock);
 			ERR_CF << "Error: invalid string: " << string_ << "\n";
 			begin_ = string_.size();
 			return;
 		}
 		textdomain_ = id_to_textdomain[id];
+		SDL_AtomicUnlock(&textdomain_lock);
 		begin_ += 3;
 		translatable_ = true;
 
@@ -185,6 +191,7 @@ t_string_base::t_string_base(const std::string& string, const std::string& textd
 		return;
 	}
 
+	SDL_AtomicLock(&textdomain_lock);
 	std::map<std::string, unsigned int>::const_iterator idi = textdomain_to_id.find(textdomain);
 	unsigned int id;
 
@@ -195,6 +202,7 @@ t_string_base::t_string_base(const std::string& string, const std::string& textd
 	} else {
 		id = idi->second;
 	}
+	SDL_AtomicUnlock(&textdomain_lock);
 
 	value_ += char(id & 0xff);
 	value_ += char(id >> 8);
@@ -424,13 +432,11 @@ bool t_string_base::operator<(const t_string_base &that) const
 	return value_ < that.value_;
 }
 
-const std::vector<t_string_base::trans_str>& t_string_base::valuex() const
+std::vector<t_string_base::trans_str> t_string_base::valuex() const
 {
-	static std::vector<trans_str>	t;
+	std::vector<trans_str>	t;
 	trans_str				ti;
 
-	t.clear();
-
 	if (translatable_) {
 		for(walker w(*this); !w.eos(); w.next()) {
 			std::string part(w.begin(), w.end());
@@ -110,7 +110,7 @@ public:
 		std::string		str;
 		std::string		td;
 	};
-	const std::vector<trans_str>& valuex() const;
+	std::vector<trans_str> valuex() const;
 private:
 	std::string value_;
 	mutable std::string translated_value_;
@@ -180,7 +180,7 @@ public:
 	static void add_textdomain(const std::string &name, const std::string &path);
 	static void reset_translations();
 
-	const std::vector<t_string_base::trans_str>& valuex() const { return get().valuex(); }
+	std::vector<t_string_base::trans_str> valuex() const { return get().valuex(); }
 	const t_string_base& get() const { return super::get(); }
 };
 inline std::ostream& operator<<(std::ostream& os, const t_string& str) { return os << str.get(); }
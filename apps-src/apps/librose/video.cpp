@@ -25,6 +25,7 @@
 #include "image.hpp"
 #include "preferences.hpp"
 #include "preferences_display.hpp"
+#include "render_target_pool.hpp"
 #include "sdl_utils.hpp"
 #include "video.hpp"
 #include "display.hpp"
@@ -131,6 +132,7 @@ SDL_Rect screen_area()
 
 static void clear_textures()
 {
+	trender_target_pool::singleton().clear();
 	if (frameTexture.get() == NULL) {
 		return;
 	}
@@ -372,45 +374,3 @@ int CVideo::getBpp()
 	return bpp_;
 }
 
-surface render_scale_surface(const surface &surf, int w, int h)
-{
-	VALIDATE(surf->w != w || surf->h != h, null_str);
-
-	int ret;
-	surface dst;
-
-	uint32_t t1, t2, t3, t4, t5, t6;
-	t1 = SDL_GetTicks();
-
-	texture src = SDL_CreateTextureFromSurface(renderer, surf);
-
-	t2 = SDL_GetTicks();
-	texture target = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, w, h);
-
-	// below will change target. require save/recover clip setting of preview target.
-	texture_clip_rect_setter clip(NULL);
-	{
-		trender_target_lock lock(renderer, target);
-		// if src is alpha-blend, non-transpant pixel will becam dark. Cr = As*Cs + (1-As)*Cd
-		ttexture_blend_none_lock lock2(src);
-		t3 = SDL_GetTicks();
-
-		SDL_RenderClear(renderer);
-		ret = SDL_RenderCopy(renderer, src.get(), NULL, NULL);
-
-		t4 = SDL_GetTicks();
-
-		dst = create_neutral_surface(w, h);
-		{
-			surface_lock dst_lock(dst);
-
-			t5 = SDL_GetTicks();
-			ret = SDL_RenderReadPixels(renderer, NULL, SDL_PIXELFORMAT_ARGB8888, dst->pixels, 4 * w);
-		}
-
-		t6 = SDL_GetTicks();
-		// posix_print("update: %i, create: %i, RenderCopy: %i, create2: %i, ReadPixels: %i\n", t2 - t1, t3 - t2, t4 - t3, t5 - t4, t6 - t5);
-	}
-
-	return dst;
-}
@@ -4,10 +4,11 @@
 #include <string>
 #include <vector>
 
-#include "config.hpp"
+#include "xwml.hpp"
 #include "filesystem.hpp"
 #include "tstring.hpp"
 #include "rose_config.hpp"
+#include "wml_exception.hpp"
 
 // terrain_builder
 #include "builder.hpp"
@@ -18,12 +19,62 @@
 #include <boost/algorithm/string.hpp>
 #include <boost/foreach.hpp>
 #include "posix2.h"
+#include <zlib.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
 
 #define WMLBIN_MARK_CONFIG		"[cfg]"
 #define WMLBIN_MARK_CONFIG_LEN	5
 #define WMLBIN_MARK_VALUE		"[val]"
 #define WMLBIN_MARK_VALUE_LEN	5
 
+// index section that txwml_view uses. see xwml.hpp
+struct txwml_index
+{
+	typedef std::map<std::string, uint32_t> tstring_map;
+
+	struct tnode {
+		tnode(tstring_map::iterator key, uint32_t offset)
+			: key(key)
+			, offset(offset)
+			, first_child(txwml_view::npos)
+			, next_sibling(txwml_view::npos)
+			, first_attr(0)
+			, nattrs(0)
+		{}
+
+		tstring_map::iterator key;
+		// offset of {[cfg]} in data section. xwml v2 splits data section by it.
+		uint32_t offset;
+		uint32_t first_child;
+		uint32_t next_sibling;
+		uint32_t first_attr;
+		uint32_t nattrs;
+	};
+
+	txwml_index(int64_t data_start)
+		: data_start(data_start)
+	{
+		// root
+		nodes.push_back(tnode(strings.end(), 0));
+	}
+
+	tstring_map::iterator intern(const std::string& str)
+	{
+		return strings.insert(std::make_pair(str, 0)).first;
+	}
+
+	int64_t data_start;
+	tstring_map strings;
+	std::vector<tnode> nodes;
+	std::vector<std::pair<tstring_map::iterator, uint32_t> > attrs;
+};
+
 // find index of textdomain. it doesn't exist in current tds, insert it.
 static uint32_t tstring_textdomain_idx(const char *textdomain, std::vector<std::string>& tds, std::vector<std::set<std::string> >& msgids) 
 {
@@ -41,9 +92,11 @@ static uint32_t tstring_textdomain_idx(const char *textdomain, std::vector<std::
 }
 
 // @deep: nesting deep. top level: 0
-static uint32_t wml_config_to_fp(posix_file_t fp, const config &cfg, uint32_t *max_str_len, std::vector<std::string>& td, uint16_t deep, std::vector<std::set<std::string> >& msgids)
+// @parent: node index of cfg in index.
+static uint32_t wml_config_to_fp(posix_file_t fp, const config &cfg, uint32_t *max_str_len, std::vector<std::string>& td, uint16_t deep, std::vector<std::set<std::string> >& msgids, txwml_index& index, uint32_t parent)
 {
 	uint32_t u32n, bytes = 0;
+	uint32_t last_child = txwml_view::npos;
 	int first;
 		
 	// config::child_list::const_iterator	ichildlist;
@@ -51,6 +104,8 @@ static uint32_t wml_config_to_fp(posix_file_t fp, const config &cfg, uint32_t *m
 
 	// recursively resolve children
 	BOOST_FOREACH (const config::any_child &value, cfg.all_children_range()) {
+		const uint32_t offset = SDL_RWtell(fp) - index.data_start;
+
 		// save {[cfg]}{len}{name}
 		posix_fwrite(fp, WMLBIN_MARK_CONFIG, WMLBIN_MARK_CONFIG_LEN);
 		u32n = posix_mku32(value.key.size(), deep);
@@ -61,6 +116,16 @@ static uint32_t wml_config_to_fp(posix_file_t fp, const config &cfg, uint32_t *m
 
 		*max_str_len = posix_max(*max_str_len, value.key.size());
 
+		const uint32_t node = index.nodes.size();
+		index.nodes.push_back(txwml_index::tnode(index.intern(value.key), offset));
+		if (last_child == txwml_view::npos) {
+			index.nodes[parent].first_child = node;
+		} else {
+			index.nodes[last_child].next_sibling = node;
+		}
+		last_child = node;
+		index.nodes[node].first_attr = index.attrs.size();
+
 		// save {[val]}{len}{name0}{len}{val0}{len}{name1}{len}{val1}{...}
 		// string_map	&values = value.cfg.gvalues();
 		// for (istrmap = values.begin(); istrmap != values.end(); istrmap ++) {
@@ -80,6 +145,8 @@ static uint32_t wml_config_to_fp(posix_file_t fp, const config &cfg, uint32_t *m
 
 			bytes += sizeof(u32n) + u32n;
 
+			index.attrs.push_back(std::make_pair(index.intern(istrmap.first), (uint32_t)(SDL_RWtell(fp) - index.data_start)));
+
 			if (istrmap.second.t_str().translatable()) {
 				// parse translatable string
 				std::vector<t_string_base::trans_str> trans = istrmap.second.t_str().valuex();
@@ -127,8 +194,10 @@ static uint32_t wml_config_to_fp(posix_file_t fp, const config &cfg, uint32_t *m
 			}
 			*max_str_len = posix_max(*max_str_len, u32n);
 
-		}		
-		bytes += wml_config_to_fp(fp, value.cfg, max_str_len, td, deep + 1, msgids);
+		}
+		index.nodes[node].nattrs = index.attrs.size() - index.nodes[node].first_attr;
+
+		bytes += wml_config_to_fp(fp, value.cfg, max_str_len, td, deep + 1, msgids, index, node);
 	}
 
 	return bytes;
@@ -223,7 +292,70 @@ static void generate_cfg_cpp(const std::string& fname, const std::vector<std::st
 	return;
 }
 
-void wml_config_to_file(const std::string& fname, const config &cfg, uint32_t nfiles, uint32_t sum_size, uint32_t modified, const std::map<std::string, std::string>& app_domains)
+static void wml_index_pad_to_fp(posix_file_t fp)
+{
+	const uint32_t zero = 0;
+	int64_t pos = SDL_RWtell(fp);
+	if (pos & 3) {
+		posix_fwrite(fp, &zero, 4 - (pos & 3));
+	}
+}
+
+// {pad}{XIDX}{nstrings}{offsets}{lens}{pool_len}{pool}{pad}{nnodes}{nodes}{nattrs}{attrs}
+static void wml_index_to_fp(posix_file_t fp, txwml_index& index)
+{
+	uint32_t u32n, at = 0, pool_len = 0;
+	std::vector<uint32_t> offsets, lens;
+
+	offsets.reserve(index.strings.size());
+	lens.reserve(index.strings.size());
+	for (txwml_index::tstring_map::iterator it = index.strings.begin(); it != index.strings.end(); ++ it, at ++) {
+		// std::map is sorted, rank is index of string.
+		it->second = at;
+		offsets.push_back(pool_len);
+		lens.push_back(it->first.size());
+		// terminate every string with '\0', so string_at can be used as c-string.
+		pool_len += it->first.size() + 1;
+	}
+
+	wml_index_pad_to_fp(fp);
+	u32n = mmioFOURCC('X', 'I', 'D', 'X');
+	posix_fwrite(fp, &u32n, 4);
+	u32n = index.strings.size();
+	posix_fwrite(fp, &u32n, sizeof(u32n));
+	if (u32n) {
+		posix_fwrite(fp, &offsets[0], u32n * sizeof(uint32_t));
+		posix_fwrite(fp, &lens[0], u32n * sizeof(uint32_t));
+	}
+	posix_fwrite(fp, &pool_len, sizeof(pool_len));
+	for (txwml_index::tstring_map::const_iterator it = index.strings.begin(); it != index.strings.end(); ++ it) {
+		posix_fwrite(fp, it->first.c_str(), it->first.size() + 1);
+	}
+
+	wml_index_pad_to_fp(fp);
+	u32n = index.nodes.size();
+	posix_fwrite(fp, &u32n, sizeof(u32n));
+	for (std::vector<txwml_index::tnode>::const_iterator it = index.nodes.begin(); it != index.nodes.end(); ++ it) {
+		txwml_view::tnode node;
+		node.key = it->key != index.strings.end()? it->key->second: txwml_view::npos;
+		node.first_child = it->first_child;
+		node.next_sibling = it->next_sibling;
+		node.first_attr = it->first_attr;
+		node.nattrs = it->nattrs;
+		posix_fwrite(fp, &node, sizeof(node));
+	}
+
+	u32n = index.attrs.size();
+	posix_fwrite(fp, &u32n, sizeof(u32n));
+	for (std::vector<std::pair<txwml_index::tstring_map::iterator, uint32_t> >::const_iterator it = index.attrs.begin(); it != index.attrs.end(); ++ it) {
+		txwml_view::tattr attr;
+		attr.key = it->first->second;
+		attr.value = it->second;
+		posix_fwrite(fp, &attr, sizeof(attr));
+	}
+}
+
+void wml_config_to_file(const std::string& fname, const config &cfg, uint32_t nfiles, uint32_t sum_size, uint32_t modified, const std::map<std::string, std::string>& app_domains, bool index_section)
 {
 	uint32_t							max_str_len, u32n; 
 
@@ -240,7 +372,8 @@ void wml_config_to_file(const std::string& fname, const config &cfg, uint32_t nf
 	posix_fseek(lock.fp, header_len);
 
 	std::vector<std::set<std::string> > msgids;
-	uint32_t data_len = wml_config_to_fp(lock.fp, cfg, &max_str_len, tdomain, 0, msgids);
+	txwml_index index(header_len);
+	uint32_t data_len = wml_config_to_fp(lock.fp, cfg, &max_str_len, tdomain, 0, msgids, index, 0);
 
 	// update max_str_len/data_len
 	posix_fseek(lock.fp, 0);
@@ -270,15 +403,63 @@ void wml_config_to_file(const std::string& fname, const config &cfg, uint32_t nf
 		posix_fwrite(lock.fp, str.c_str(), u32n);
 	}
 
+	// write index section
+	if (index_section) {
+		wml_index_to_fp(lock.fp, index);
+	}
+
 	generate_cfg_cpp(fname, tdomain, msgids, max_str_len, app_domains);
 }
 
 
-bool wml_config_from_data(uint8_t *data, uint32_t datalen, uint8_t *namebuf, uint8_t *valbuf, std::vector<std::string> &tdomain, config &cfg)
+// read {flag}{len}{val}[{flag}{len}{val}...] of one attribute, return position after it.
+static const uint8_t* wml_attribute_from_data(const uint8_t* rdpos, const std::vector<std::string>& tdomain, config::attribute_value& value)
+{
+	uint32_t u32n, len, transcnt, tdidx;
+
+	memcpy(&u32n, rdpos, sizeof(u32n));
+	rdpos = rdpos + sizeof(u32n);
+
+	transcnt = posix_hi8(posix_hi16(u32n));
+	tdidx = posix_lo8(posix_hi16(u32n));
+
+	memcpy(&len, rdpos, sizeof(len));
+	rdpos = rdpos + sizeof(len);
+
+	if (!transcnt) {
+		value = t_string(std::string((const char*)rdpos, len));
+		return rdpos + len;
+	}
+
+	t_string tstr = tdidx? t_string(std::string((const char*)rdpos, len), tdomain[tdidx - 1]): t_string(std::string((const char*)rdpos, len));
+	rdpos = rdpos + len;
+	transcnt --;
+	while (transcnt != 0) {
+		memcpy(&u32n, rdpos, sizeof(u32n));
+		rdpos = rdpos + sizeof(u32n);
+
+		tdidx = posix_lo8(posix_hi16(u32n));
+
+		memcpy(&len, rdpos, sizeof(len));
+		rdpos = rdpos + sizeof(len);
+
+		if (tdidx) {
+			tstr = tstr + t_string(std::string((const char*)rdpos, len), tdomain[tdidx - 1]);
+		} else {
+			tstr = tstr + t_string(std::string((const char*)rdpos, len));
+		}
+		rdpos = rdpos + len;
+		transcnt --;
+	}
+	value = tstr;
+	return rdpos;
+}
+
+bool wml_config_from_data(uint8_t *data, uint32_t datalen, uint8_t *namebuf, const std::vector<std::string> &tdomain, config &cfg)
 {
 	int									retval;
-	uint8_t								*rdpos = data;
-	uint32_t							u32n, len, transcnt, tdidx;
+	const uint8_t						*rdpos = data;
+	uint32_t							u32n, len;
 	uint16_t							deep;
 
 	config::child_list					lastcfg;							
@@ -329,49 +510,7 @@ bool wml_config_from_data(uint8_t *data, uint32_t datalen, uint8_t *namebuf, uin
 				rdpos = rdpos + len;
 
 				// value
-				memcpy(&u32n, rdpos, sizeof(u32n));
-				rdpos = rdpos + sizeof(u32n);
-				
-				transcnt = posix_hi8(posix_hi16(u32n));
-				tdidx = posix_lo8(posix_hi16(u32n));
-
-				memcpy(&len, rdpos, sizeof(len));
-				rdpos = rdpos + sizeof(len);
-				memcpy(valbuf, rdpos, len);
-				valbuf[len] = 0;
-				rdpos = rdpos + len;
-
-				if (transcnt) {
-					if (tdidx) {
-						cfgtmp[std::string((char *)namebuf)] = t_string((const char *)valbuf, tdomain[tdidx - 1]);
-					} else {
-						cfgtmp[std::string((char *)namebuf)] = t_string((const char *)valbuf);
-					}
-					transcnt --;
-					while (transcnt != 0) {
-						// value
-						memcpy(&u32n, rdpos, sizeof(u32n));
-						rdpos = rdpos + sizeof(u32n);
-
-						tdidx = posix_lo8(posix_hi16(u32n));
-
-						memcpy(&len, rdpos, sizeof(len));
-						rdpos = rdpos + sizeof(len);
-						memcpy(valbuf, rdpos, len);
-						valbuf[len] = 0;
-						rdpos = rdpos + len;
-
-						if (tdidx) {
-							cfgtmp[std::string((char *)namebuf)] = cfgtmp[std::string((char *)namebuf)].t_str() + t_string((const char *)valbuf, tdomain[tdidx - 1]);
-						} else {
-							cfgtmp[std::string((char *)namebuf)] = cfgtmp[std::string((char *)namebuf)].t_str() + t_string((const char *)valbuf);
-						}
-						transcnt --;
-					}
-					
-				} else {
-					cfgtmp[std::string((char *)namebuf)] = t_string((const char *)valbuf);
-				}
+				rdpos = wml_attribute_from_data(rdpos, tdomain, cfgtmp[std::string((char *)namebuf)]);
 			}
 		}
 	}
@@ -385,7 +524,7 @@ void wml_config_from_file(const std::string &fname, config &cfg, uint32_t* nfile
 {
 	int64_t fsize;
 	uint32_t							max_str_len, data_len, tdcnt, idx, len;
-	uint8_t								*namebuf = NULL, *valbuf = NULL;
+	uint8_t								*namebuf = NULL;
 	char								tdname[MAXLEN_TEXTDOMAIN + 1];
 
 	std::vector<std::string>			tdomain;
@@ -405,6 +544,20 @@ void wml_config_from_file(const std::string &fname, config &cfg, uint32_t* nfile
 	}
 	posix_fseek(lock.fp, 0);
 	posix_fread(lock.fp, &len, 4);
+	if (len == mmioFOURCC('X', 'W', 'M', '2')) {
+		txwml_archive archive(fname);
+		if (nfiles) {
+			*nfiles = archive.nfiles();
+		}
+		if (sum_size) {
+			*sum_size = archive.sum_size();
+		}
+		if (modified) {
+			*modified = archive.modified();
+		}
+		archive.to_config(cfg);
+		return;
+	}
 	if (len != mmioFOURCC('X', 'W', 'M', 'L')) {
 		return;
 	}
@@ -442,20 +595,16 @@ void wml_config_from_file(const std::string &fname, config &cfg, uint32_t* nfile
 	lock.resize_data(data_len);
 
 	namebuf = (uint8_t *)malloc(max_str_len + 1 + 1024);
-	valbuf = (uint8_t *)malloc(max_str_len + 1 + 1024);
 
 	// read data to memory
 	posix_fseek(lock.fp, header_len);
 	posix_fread(lock.fp, lock.data, data_len);
 
-	wml_config_from_data((uint8_t*)lock.data, data_len, namebuf, valbuf, tdomain, cfg);
+	wml_config_from_data((uint8_t*)lock.data, data_len, namebuf, tdomain, cfg);
 
 	if (namebuf) {
 		free(namebuf);
 	}
-	if (valbuf) {
-		free(valbuf);
-	}
 }
 
 bool wml_checksum_from_file(const std::string &fname, uint32_t* nfiles, uint32_t* sum_size, uint32_t* modified)
@@ -473,7 +622,8 @@ bool wml_checksum_from_file(const std::string &fname, uint32_t* nfiles, uint32_t
 	}
 	posix_fseek(lock.fp, 0);
 	posix_fread(lock.fp, &tmp, 4);
-	if (tmp != mmioFOURCC('X', 'W', 'M', 'L')) {
+	// v2 has same checksum fields.
+	if (tmp != mmioFOURCC('X', 'W', 'M', 'L') && tmp != mmioFOURCC('X', 'W', 'M', '2')) {
 		return false;
 	}
 	posix_fread(lock.fp, &tmp, 4);
@@ -492,6 +642,941 @@ bool wml_checksum_from_file(const std::string &fname, uint32_t* nfiles, uint32_t
 	return true;
 }
 
+txwml_view::txwml_view(const std::string& fname)
+	: file_data_(NULL)
+	, file_size_(0)
+	, mapped_(false)
+#ifdef _WIN32
+	, map_handle_(NULL)
+#endif
+	, nfiles_(0)
+	, sum_size_(0)
+	, modified_(0)
+	, data_(NULL)
+	, data_len_(0)
+	, nstrings_(0)
+	, string_offsets_(NULL)
+	, string_lens_(NULL)
+	, string_pool_(NULL)
+	, nnodes_(0)
+	, nodes_(NULL)
+	, nattrs_(0)
+	, attrs_(NULL)
+{
+	uint32_t max_str_len, tdcnt, idx, len;
+
+	map_file(fname);
+	if (file_size_ <= MIN_XMIN_BIN_SIZE) {
+		return;
+	}
+	const uint8_t* rdpos = file_data_;
+	const uint8_t* end = file_data_ + file_size_;
+
+	memcpy(&len, rdpos, 4);
+	if (len != mmioFOURCC('X', 'W', 'M', 'L')) {
+		return;
+	}
+	memcpy(&nfiles_, rdpos + 4, 4);
+	memcpy(&sum_size_, rdpos + 8, 4);
+	memcpy(&modified_, rdpos + 12, 4);
+	memcpy(&max_str_len, rdpos + 16, sizeof(max_str_len));
+	memcpy(&data_len_, rdpos + 20, sizeof(data_len_));
+
+	uint32_t header_len = 16 + sizeof(max_str_len) + sizeof(data_len_);
+	if ((uint64_t)header_len + data_len_ + sizeof(tdcnt) > file_size_) {
+		return;
+	}
+	data_ = file_data_ + header_len;
+	rdpos = data_ + data_len_;
+
+	// read textdomain
+	memcpy(&tdcnt, rdpos, sizeof(tdcnt));
+	rdpos += sizeof(tdcnt);
+	for (idx = 0; idx < tdcnt; idx ++) {
+		if (rdpos + sizeof(len) > end) {
+			return;
+		}
+		memcpy(&len, rdpos, sizeof(len));
+		rdpos += sizeof(len);
+		if (len > MAXLEN_TEXTDOMAIN || rdpos + len > end) {
+			return;
+		}
+		tdomain_.push_back(std::string((const char*)rdpos, len));
+		rdpos += len;
+
+		t_string::add_textdomain(tdomain_.back(), get_intl_dir());
+	}
+
+	if (!parse_index(rdpos)) {
+		posix_print("------<xwml.cpp>::txwml_view, %s hasn't index section\n", fname.c_str());
+		nodes_ = NULL;
+	}
+}
+
+txwml_view::~txwml_view()
+{
+	unmap_file();
+}
+
+void txwml_view::map_file(const std::string& fname)
+{
+#ifdef _WIN32
+	int wlen = MultiByteToWideChar(CP_UTF8, 0, fname.c_str(), -1, NULL, 0);
+	WCHAR *wc = new WCHAR[wlen];
+	MultiByteToWideChar(CP_UTF8, 0, fname.c_str(), -1, wc, wlen);
+	HANDLE file = CreateFileW(wc, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	delete [] wc;
+
+	if (file != INVALID_HANDLE_VALUE) {
+		LARGE_INTEGER size;
+		if (GetFileSizeEx(file, &size) && size.QuadPart && !size.HighPart) {
+			map_handle_ = CreateFileMapping(file, NULL, PAGE_READONLY, 0, 0, NULL);
+			if (map_handle_) {
+				file_data_ = (uint8_t*)MapViewOfFile(map_handle_, FILE_MAP_READ, 0, 0, 0);
+				if (file_data_) {
+					file_size_ = size.LowPart;
+					mapped_ = true;
+				} else {
+					CloseHandle(map_handle_);
+					map_handle_ = NULL;
+				}
+			}
+		}
+		CloseHandle(file);
+	}
+#else
+	int fd = open(fname.c_str(), O_RDONLY);
+	if (fd != -1) {
+		struct stat st;
+		if (!fstat(fd, &st) && st.st_size > 0 && st.st_size <= 0xffffffff) {
+			void* addr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (addr != MAP_FAILED) {
+				file_data_ = (uint8_t*)addr;
+				file_size_ = st.st_size;
+				mapped_ = true;
+			}
+		}
+		close(fd);
+	}
+#endif
+	if (mapped_) {
+		return;
+	}
+
+	// ex: file is in android's apk. read it to memory by SDL_RWops.
+	tfile lock(fname, GENERIC_READ, OPEN_EXISTING);
+	if (!lock.valid()) {
+		posix_print("------<xwml.cpp>::txwml_view, cannot open %s for read\n", fname.c_str());
+		return;
+	}
+	int64_t fsize = posix_fsize(lock.fp);
+	if (fsize <= 0 || fsize > 0xffffffff) {
+		return;
+	}
+	file_data_ = (uint8_t*)malloc(fsize);
+	posix_fseek(lock.fp, 0);
+	file_size_ = posix_fread(lock.fp, file_data_, fsize);
+}
+
+void txwml_view::unmap_file()
+{
+	if (!file_data_) {
+		return;
+	}
+	if (mapped_) {
+#ifdef _WIN32
+		UnmapViewOfFile(file_data_);
+		CloseHandle(map_handle_);
+		map_handle_ = NULL;
+#else
+		munmap(file_data_, file_size_);
+#endif
+	} else {
+		free(file_data_);
+	}
+	file_data_ = NULL;
+	file_size_ = 0;
+	mapped_ = false;
+}
+
+bool txwml_view::parse_index(const uint8_t* rdpos)
+{
+	uint32_t u32n, pool_len;
+	const uint8_t* end = file_data_ + file_size_;
+
+	rdpos = file_data_ + posix_align_ceil(rdpos - file_data_, 4);
+	if (rdpos + 8 > end) {
+		return false;
+	}
+	memcpy(&u32n, rdpos, 4);
+	if (u32n != mmioFOURCC('X', 'I', 'D', 'X')) {
+		return false;
+	}
+	memcpy(&nstrings_, rdpos + 4, sizeof(nstrings_));
+	rdpos += 8;
+	if ((uint64_t)nstrings_ * 2 * sizeof(uint32_t) + sizeof(pool_len) > (uint64_t)(end - rdpos)) {
+		return false;
+	}
+	string_offsets_ = (const uint32_t*)rdpos;
+	string_lens_ = string_offsets_ + nstrings_;
+	rdpos += nstrings_ * 2 * sizeof(uint32_t);
+
+	memcpy(&pool_len, rdpos, sizeof(pool_len));
+	rdpos += sizeof(pool_len);
+	if (pool_len > (uint64_t)(end - rdpos)) {
+		return false;
+	}
+	string_pool_ = (const char*)rdpos;
+	rdpos += pool_len;
+
+	rdpos = file_data_ + posix_align_ceil(rdpos - file_data_, 4);
+	if (rdpos + sizeof(nnodes_) > end) {
+		return false;
+	}
+	memcpy(&nnodes_, rdpos, sizeof(nnodes_));
+	rdpos += sizeof(nnodes_);
+	if (!nnodes_ || (uint64_t)nnodes_ * sizeof(tnode) + sizeof(nattrs_) > (uint64_t)(end - rdpos)) {
+		return false;
+	}
+	nodes_ = (const tnode*)rdpos;
+	rdpos += nnodes_ * sizeof(tnode);
+
+	memcpy(&nattrs_, rdpos, sizeof(nattrs_));
+	rdpos += sizeof(nattrs_);
+	if ((uint64_t)nattrs_ * sizeof(tattr) > (uint64_t)(end - rdpos)) {
+		return false;
+	}
+	attrs_ = (const tattr*)rdpos;
+
+	// check every index once, so accessors don't need to. nodes are in pre-order, child and sibling
+	// are after node, so they can't form cycle.
+	for (uint32_t at = 0; at < nstrings_; at ++) {
+		if ((uint64_t)string_offsets_[at] + string_lens_[at] >= pool_len || string_pool_[string_offsets_[at] + string_lens_[at]] != '\0') {
+			return false;
+		}
+	}
+	for (uint32_t at = 0; at < nnodes_; at ++) {
+		const tnode& n = nodes_[at];
+		if (at? n.key >= nstrings_: n.key != npos) {
+			return false;
+		}
+		if (n.first_child != npos && (n.first_child <= at || n.first_child >= nnodes_)) {
+			return false;
+		}
+		if (n.next_sibling != npos && (n.next_sibling <= at || n.next_sibling >= nnodes_)) {
+			return false;
+		}
+		if ((uint64_t)n.first_attr + n.nattrs > nattrs_) {
+			return false;
+		}
+	}
+	for (uint32_t at = 0; at < nattrs_; at ++) {
+		if (attrs_[at].key >= nstrings_ || !valid_value(attrs_[at].value)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool txwml_view::valid_value(uint32_t offset) const
+{
+	// {flag}{len}{val}, flag of first one has count of them.
+	uint32_t flag, len, count = 1;
+	for (uint32_t at = 0; at < count; at ++) {
+		if ((uint64_t)offset + sizeof(flag) + sizeof(len) > data_len_) {
+			return false;
+		}
+		memcpy(&flag, data_ + offset, sizeof(flag));
+		memcpy(&len, data_ + offset + sizeof(flag), sizeof(len));
+		if (!at && posix_hi8(posix_hi16(flag))) {
+			count = posix_hi8(posix_hi16(flag));
+		}
+		if (posix_lo8(posix_hi16(flag)) > tdomain_.size()) {
+			return false;
+		}
+		offset += sizeof(flag) + sizeof(len);
+		if (len > data_len_ - offset) {
+			return false;
+		}
+		offset += len;
+	}
+	return true;
+}
+
+uint32_t txwml_view::string_index(const char* str, size_t len) const
+{
+	uint32_t lo = 0, hi = nstrings_;
+	while (lo < hi) {
+		uint32_t mid = lo + (hi - lo) / 2;
+		const uint32_t mid_len = string_lens_[mid];
+		int ret = memcmp(string_pool_ + string_offsets_[mid], str, posix_min(mid_len, len));
+		if (!ret) {
+			ret = mid_len < len? -1: (mid_len > len? 1: 0);
+		}
+		if (!ret) {
+			return mid;
+		} else if (ret < 0) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	return npos;
+}
+
+const char* txwml_view::string_at(uint32_t index, uint32_t* len) const
+{
+	VALIDATE(index < nstrings_, "txwml_view::string_at, index overflow!");
+	if (len) {
+		*len = string_lens_[index];
+	}
+	return string_pool_ + string_offsets_[index];
+}
+
+void txwml_view::value_at(uint32_t offset, config::attribute_value& value) const
+{
+	VALIDATE(offset < data_len_, "txwml_view::value_at, offset overflow!");
+	wml_attribute_from_data(data_ + offset, tdomain_, value);
+}
+
+void txwml_view::node_to_config(uint32_t node, config& cfg) const
+{
+	const tnode& n = nodes_[node];
+	for (uint32_t at = n.first_attr; at < n.first_attr + n.nattrs; at ++) {
+		const tattr& attr = attrs_[at];
+		value_at(attr.value, cfg[string_at(attr.key, NULL)]);
+	}
+	for (uint32_t child = n.first_child; child != npos; child = nodes_[child].next_sibling) {
+		node_to_config(child, cfg.add_child(string_at(nodes_[child].key, NULL)));
+	}
+}
+
+std::string tconfig_view::key() const
+{
+	if (!view_ || view_->nodes_[node_].key == txwml_view::npos) {
+		return null_str;
+	}
+	uint32_t len;
+	const char* str = view_->string_at(view_->nodes_[node_].key, &len);
+	return std::string(str, len);
+}
+
+unsigned tconfig_view::child_count(const std::string& key) const
+{
+	if (!view_) {
+		return 0;
+	}
+	const uint32_t key_index = view_->string_index(key.c_str(), key.size());
+	if (key_index == txwml_view::npos) {
+		return 0;
+	}
+	unsigned count = 0;
+	for (uint32_t child = view_->nodes_[node_].first_child; child != txwml_view::npos; child = view_->nodes_[child].next_sibling) {
+		if (view_->nodes_[child].key == key_index) {
+			count ++;
+		}
+	}
+	return count;
+}
+
+tconfig_view tconfig_view::child(const std::string& key, int n) const
+{
+	if (!view_) {
+		return tconfig_view();
+	}
+	const uint32_t key_index = view_->string_index(key.c_str(), key.size());
+	if (key_index == txwml_view::npos) {
+		return tconfig_view();
+	}
+	if (n < 0) {
+		n += child_count(key);
+		if (n < 0) {
+			return tconfig_view();
+		}
+	}
+	for (uint32_t child = view_->nodes_[node_].first_child; child != txwml_view::npos; child = view_->nodes_[child].next_sibling) {
+		if (view_->nodes_[child].key == key_index && !n --) {
+			return tconfig_view(view_, child);
+		}
+	}
+	return tconfig_view();
+}
+
+tconfig_view tconfig_view::find_child(const std::string& key, const std::string& name, const std::string& value) const
+{
+	if (!view_) {
+		return tconfig_view();
+	}
+	const uint32_t key_index = view_->string_index(key.c_str(), key.size());
+	if (key_index == txwml_view::npos) {
+		return tconfig_view();
+	}
+	for (uint32_t child = view_->nodes_[node_].first_child; child != txwml_view::npos; child = view_->nodes_[child].next_sibling) {
+		if (view_->nodes_[child].key != key_index) {
+			continue;
+		}
+		tconfig_view cfg(view_, child);
+		if (cfg[name] == value) {
+			return cfg;
+		}
+	}
+	return tconfig_view();
+}
+
+tconfig_view tconfig_view::first_child() const
+{
+	if (!view_ || view_->nodes_[node_].first_child == txwml_view::npos) {
+		return tconfig_view();
+	}
+	return tconfig_view(view_, view_->nodes_[node_].first_child);
+}
+
+tconfig_view tconfig_view::next_sibling() const
+{
+	if (!view_ || view_->nodes_[node_].next_sibling == txwml_view::npos) {
+		return tconfig_view();
+	}
+	return tconfig_view(view_, view_->nodes_[node_].next_sibling);
+}
+
+bool tconfig_view::has_attribute(const std::string& key) const
+{
+	return find_attribute(key, NULL);
+}
+
+config::attribute_value tconfig_view::operator[](const std::string& key) const
+{
+	config::attribute_value result;
+	uint32_t value;
+	if (find_attribute(key, &value)) {
+		view_->value_at(value, result);
+	}
+	return result;
+}
+
+bool tconfig_view::find_attribute(const std::string& key, uint32_t* value) const
+{
+	if (!view_) {
+		return false;
+	}
+	const uint32_t key_index = view_->string_index(key.c_str(), key.size());
+	if (key_index == txwml_view::npos) {
+		return false;
+	}
+	// attributes of one node are sorted by key.
+	const txwml_view::tnode& n = view_->nodes_[node_];
+	const txwml_view::tattr* first = view_->attrs_ + n.first_attr;
+	uint32_t lo = 0, hi = n.nattrs;
+	while (lo < hi) {
+		uint32_t mid = lo + (hi - lo) / 2;
+		if (first[mid].key == key_index) {
+			if (value) {
+				*value = first[mid].value;
+			}
+			return true;
+		} else if (first[mid].key < key_index) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	return false;
+}
+
+size_t tconfig_view::attribute_count() const
+{
+	return view_? view_->nodes_[node_].nattrs: 0;
+}
+
+void tconfig_view::to_config(config& cfg) const
+{
+	cfg.clear();
+	if (view_) {
+		view_->node_to_config(node_, cfg);
+	}
+}
+
+// growable SDL_RWops in memory, so wml_config_to_fp can encode to it.
+struct tmemory_rwops
+{
+	std::string data;
+	size_t pos;
+};
+
+static Sint64 SDLCALL memory_rwops_size(SDL_RWops* context)
+{
+	return ((tmemory_rwops*)context->hidden.unknown.data1)->data.size();
+}
+
+static Sint64 SDLCALL memory_rwops_seek(SDL_RWops* context, Sint64 offset, int whence)
+{
+	tmemory_rwops& mem = *(tmemory_rwops*)context->hidden.unknown.data1;
+	if (whence == RW_SEEK_CUR) {
+		offset += mem.pos;
+	} else if (whence == RW_SEEK_END) {
+		offset += mem.data.size();
+	}
+	if (offset < 0) {
+		return -1;
+	}
+	mem.pos = offset;
+	return offset;
+}
+
+static size_t SDLCALL memory_rwops_read(SDL_RWops* context, void* ptr, size_t size, size_t maxnum)
+{
+	tmemory_rwops& mem = *(tmemory_rwops*)context->hidden.unknown.data1;
+	if (!size || mem.pos >= mem.data.size()) {
+		return 0;
+	}
+	const size_t num = posix_min(maxnum, (mem.data.size() - mem.pos) / size);
+	memcpy(ptr, mem.data.c_str() + mem.pos, num * size);
+	mem.pos += num * size;
+	return num;
+}
+
+static size_t SDLCALL memory_rwops_write(SDL_RWops* context, const void* ptr, size_t size, size_t num)
+{
+	tmemory_rwops& mem = *(tmemory_rwops*)context->hidden.unknown.data1;
+	const size_t bytes = size * num;
+	if (mem.pos + bytes > mem.data.size()) {
+		mem.data.resize(mem.pos + bytes);
+	}
+	memcpy(&mem.data[mem.pos], ptr, bytes);
+	mem.pos += bytes;
+	return num;
+}
+
+static int SDLCALL memory_rwops_close(SDL_RWops* context)
+{
+	SDL_FreeRW(context);
+	return 0;
+}
+
+static SDL_RWops* memory_rwops(tmemory_rwops& mem)
+{
+	SDL_RWops* context = SDL_AllocRW();
+	VALIDATE(context, null_str);
+	context->size = memory_rwops_size;
+	context->seek = memory_rwops_seek;
+	context->read = memory_rwops_read;
+	context->write = memory_rwops_write;
+	context->close = memory_rwops_close;
+	context->type = SDL_RWOPS_UNKNOWN;
+	context->hidden.unknown.data1 = &mem;
+	mem.pos = 0;
+	return context;
+}
+
+static void wml_string_to_fp(posix_file_t fp, const std::string& str)
+{
+	uint32_t u32n = str.size();
+	posix_fwrite(fp, &u32n, sizeof(u32n));
+	posix_fwrite(fp, str.c_str(), u32n);
+}
+
+// node that is encoded to more than this is split to a header block and blocks of its children.
+// blocks are compressed separately, so smaller one compresses worse.
+static const uint32_t xwml_v2_split_size = 32 * 1024;
+
+// split children of @parent to blocks. @end is offset where @parent ends in data section.
+static void wml_split_blocks(const txwml_index& index, const config& cfg, uint32_t parent, int parent_block, uint32_t end, std::vector<txwml_archive::tblock>& blocks)
+{
+	uint32_t node = index.nodes[parent].first_child;
+	BOOST_FOREACH (const config::any_child& value, cfg.all_children_range()) {
+		const txwml_index::tnode& n = index.nodes[node];
+		const uint32_t next_offset = n.next_sibling != txwml_view::npos? index.nodes[n.next_sibling].offset: end;
+
+		const int at = blocks.size();
+		blocks.push_back(txwml_archive::tblock());
+		blocks[at].key = value.key;
+		blocks[at].id = value.cfg["id"].str();
+		blocks[at].parent = parent_block;
+		// before compressed, offset/len is range in data section.
+		blocks[at].offset = n.offset;
+		if (next_offset - n.offset > xwml_v2_split_size && n.first_child != txwml_view::npos) {
+			// header block has {[cfg]} and {[val]} of this node.
+			blocks[at].len = index.nodes[n.first_child].offset - n.offset;
+			wml_split_blocks(index, value.cfg, node, at, next_offset, blocks);
+		} else {
+			blocks[at].len = next_offset - n.offset;
+		}
+		blocks[at].end = blocks.size();
+		node = n.next_sibling;
+	}
+}
+
+void wml_config_to_file_v2(const std::string& fname, const config& cfg, uint32_t nfiles, uint32_t sum_size, uint32_t modified, const std::map<std::string, std::string>& app_domains)
+{
+	uint32_t max_str_len = posix_max(WMLBIN_MARK_CONFIG_LEN, WMLBIN_MARK_VALUE_LEN);
+	std::vector<std::string> tdomain;
+	std::vector<std::set<std::string> > msgids;
+
+	// encode as data section of v1, then split it to blocks.
+	tmemory_rwops mem;
+	txwml_index index(0);
+	{
+		SDL_RWops* fp = memory_rwops(mem);
+		wml_config_to_fp(fp, cfg, &max_str_len, tdomain, 0, msgids, index, 0);
+		posix_fclose(fp);
+	}
+	std::vector<txwml_archive::tblock> blocks;
+	wml_split_blocks(index, cfg, 0, -1, mem.data.size(), blocks);
+
+	tfile lock(fname, GENERIC_WRITE, CREATE_ALWAYS);
+	if (!lock.valid()) {
+		posix_print("------<xwml.cpp>::wml_config_to_file_v2, cannot create %s for write\n", fname.c_str());
+		return;
+	}
+
+	uint32_t u32n = mmioFOURCC('X', 'W', 'M', '2');
+	posix_fwrite(lock.fp, &u32n, 4);
+	posix_fwrite(lock.fp, &nfiles, 4);
+	posix_fwrite(lock.fp, &sum_size, 4);
+	posix_fwrite(lock.fp, &modified, 4);
+	posix_fwrite(lock.fp, &max_str_len, sizeof(max_str_len));
+
+	std::vector<Bytef> zdata;
+	for (std::vector<txwml_archive::tblock>::iterator it = blocks.begin(); it != blocks.end(); ++ it) {
+		// blocks are compressed once when bin is generated, and inflated on device. size matters more.
+		uLongf zlen = compressBound(it->len);
+		zdata.resize(zlen);
+		int ret = compress2(&zdata[0], &zlen, (const Bytef*)mem.data.c_str() + it->offset, it->len, Z_BEST_COMPRESSION);
+		VALIDATE(ret == Z_OK, null_str);
+		it->offset = SDL_RWtell(lock.fp);
+		it->zlen = zlen;
+		posix_fwrite(lock.fp, &zdata[0], zlen);
+	}
+
+	// write [textdomain]
+	u32n = tdomain.size();
+	posix_fwrite(lock.fp, &u32n, sizeof(u32n));
+	for (std::vector<std::string>::const_iterator it = tdomain.begin(); it != tdomain.end(); ++ it) {
+		wml_string_to_fp(lock.fp, *it);
+	}
+
+	// write index
+	const uint32_t index_offset = SDL_RWtell(lock.fp);
+	u32n = blocks.size();
+	posix_fwrite(lock.fp, &u32n, sizeof(u32n));
+	for (std::vector<txwml_archive::tblock>::const_iterator it = blocks.begin(); it != blocks.end(); ++ it) {
+		posix_fwrite(lock.fp, &it->offset, sizeof(it->offset));
+		posix_fwrite(lock.fp, &it->zlen, sizeof(it->zlen));
+		posix_fwrite(lock.fp, &it->len, sizeof(it->len));
+		posix_fwrite(lock.fp, &it->parent, sizeof(it->parent));
+		posix_fwrite(lock.fp, &it->end, sizeof(it->end));
+		wml_string_to_fp(lock.fp, it->key);
+		wml_string_to_fp(lock.fp, it->id);
+	}
+	posix_fwrite(lock.fp, &index_offset, sizeof(index_offset));
+	u32n = mmioFOURCC('X', 'E', 'N', 'D');
+	posix_fwrite(lock.fp, &u32n, 4);
+
+	generate_cfg_cpp(fname, tdomain, msgids, max_str_len, app_domains);
+}
+
+txwml_archive::txwml_archive(const std::string& fname)
+	: valid_(false)
+	, fname_(fname)
+	, file_size_(0)
+	, nfiles_(0)
+	, sum_size_(0)
+	, modified_(0)
+	, max_str_len_(0)
+	, tdomain_()
+	, blocks_()
+	, firsts_()
+	, ids_()
+	, decoded_()
+{
+	valid_ = parse_index();
+	if (!valid_) {
+		blocks_.clear();
+	}
+	for (std::vector<tblock>::const_iterator it = blocks_.begin(); it != blocks_.end(); ++ it) {
+		const int at = it - blocks_.begin();
+		firsts_.insert(std::make_pair(it->key, at));
+		// equal keys keep order they are inserted, that is order in file.
+		ids_.insert(std::make_pair(std::make_pair(it->key, it->id), at));
+	}
+	decoded_.resize(blocks_.size(), NULL);
+}
+
+txwml_archive::~txwml_archive()
+{
+	for (std::vector<config*>::const_iterator it = decoded_.begin(); it != decoded_.end(); ++ it) {
+		delete *it;
+	}
+}
+
+// read {len}{str} at @rdpos, return false if it exceeds @end.
+static bool wml_string_from_data(const uint8_t*& rdpos, const uint8_t* end, std::string& str)
+{
+	uint32_t len;
+	if (rdpos + sizeof(len) > end) {
+		return false;
+	}
+	memcpy(&len, rdpos, sizeof(len));
+	rdpos += sizeof(len);
+	if (len > (uint32_t)(end - rdpos)) {
+		return false;
+	}
+	str.assign((const char*)rdpos, len);
+	rdpos += len;
+	return true;
+}
+
+// read [@offset, @offset + @size) of file to @buf.
+static bool wml_read_range(posix_file_t fp, uint32_t offset, uint32_t size, std::vector<uint8_t>& buf)
+{
+	buf.resize(size);
+	if (posix_fseek(fp, offset) != offset) {
+		return false;
+	}
+	return !size || posix_fread(fp, &buf[0], size) == size;
+}
+
+bool txwml_archive::same_file(posix_file_t fp) const
+{
+	uint8_t header[20];
+	const int64_t fsize = posix_fsize(fp);
+	if (fsize != file_size_ || posix_fseek(fp, 0) != 0 || posix_fread(fp, header, sizeof(header)) != sizeof(header)) {
+		return false;
+	}
+	const uint32_t fields[] = {mmioFOURCC('X', 'W', 'M', '2'), nfiles_, sum_size_, modified_, max_str_len_};
+	return !memcmp(header, fields, sizeof(header));
+}
+
+bool txwml_archive::parse_index()
+{
+	uint32_t u32n, tdcnt, nblocks, index_offset;
+
+	// header, index and [textdomain] are read. blocks are read and inflated only when they are accessed.
+	tfile lock(fname_, GENERIC_READ, OPEN_EXISTING);
+	if (!lock.valid()) {
+		return false;
+	}
+	const int64_t fsize = posix_fsize(lock.fp);
+	if (fsize <= 20 + 4 + 4 + 8 || fsize > 0xffffffff) {
+		return false;
+	}
+	file_size_ = fsize;
+	std::vector<uint8_t> buf;
+	if (!wml_read_range(lock.fp, 0, 20, buf)) {
+		return false;
+	}
+	memcpy(&u32n, &buf[0], 4);
+	if (u32n != mmioFOURCC('X', 'W', 'M', '2')) {
+		return false;
+	}
+	memcpy(&nfiles_, &buf[4], 4);
+	memcpy(&sum_size_, &buf[8], 4);
+	memcpy(&modified_, &buf[12], 4);
+	memcpy(&max_str_len_, &buf[16], 4);
+
+	if (!wml_read_range(lock.fp, (uint32_t)file_size_ - 8, 8, buf)) {
+		return false;
+	}
+	memcpy(&index_offset, &buf[0], 4);
+	memcpy(&u32n, &buf[4], 4);
+	if (u32n != mmioFOURCC('X', 'E', 'N', 'D') || index_offset < 20 || (int64_t)index_offset + sizeof(nblocks) > file_size_ - 8) {
+		return false;
+	}
+	if (!wml_read_range(lock.fp, index_offset, (uint32_t)file_size_ - 8 - index_offset, buf)) {
+		return false;
+	}
+	const uint8_t* rdpos = &buf[0];
+	const uint8_t* end = rdpos + buf.size();
+	memcpy(&nblocks, rdpos, sizeof(nblocks));
+	rdpos += sizeof(nblocks);
+	uint32_t data_end = 20;
+	// every string is in a block, so a longer max_str_len_ is corrupted, and decode would size buffer by it.
+	uint32_t max_len = posix_max(WMLBIN_MARK_CONFIG_LEN, WMLBIN_MARK_VALUE_LEN);
+	for (uint32_t at = 0; at < nblocks; at ++) {
+		tblock block;
+		if (rdpos + 5 * sizeof(uint32_t) > end) {
+			return false;
+		}
+		memcpy(&block.offset, rdpos, sizeof(uint32_t));
+		memcpy(&block.zlen, rdpos + 4, sizeof(uint32_t));
+		memcpy(&block.len, rdpos + 8, sizeof(uint32_t));
+		memcpy(&block.parent, rdpos + 12, sizeof(uint32_t));
+		memcpy(&block.end, rdpos + 16, sizeof(uint32_t));
+		rdpos += 5 * sizeof(uint32_t);
+		if (!wml_string_from_data(rdpos, end, block.key) || !wml_string_from_data(rdpos, end, block.id)) {
+			return false;
+		}
+		if (block.offset < 20 || (uint64_t)block.offset + block.zlen > index_offset) {
+			return false;
+		}
+		// blocks are in pre-order, parent is before and subtree is after block.
+		if (block.parent < -1 || block.parent >= (int)at || block.end <= at || block.end > nblocks) {
+			return false;
+		}
+		data_end = posix_max(data_end, block.offset + block.zlen);
+		max_len = posix_max(max_len, block.len);
+		blocks_.push_back(block);
+	}
+	if (max_str_len_ > max_len) {
+		return false;
+	}
+
+	// [textdomain] is between blocks and index.
+	if (!wml_read_range(lock.fp, data_end, index_offset - data_end, buf)) {
+		return false;
+	}
+	rdpos = buf.empty()? NULL: &buf[0];
+	end = rdpos + buf.size();
+	if (buf.size() < sizeof(tdcnt)) {
+		return false;
+	}
+	memcpy(&tdcnt, rdpos, sizeof(tdcnt));
+	rdpos += sizeof(tdcnt);
+	for (uint32_t at = 0; at < tdcnt; at ++) {
+		std::string textdomain;
+		if (!wml_string_from_data(rdpos, end, textdomain) || textdomain.size() > MAXLEN_TEXTDOMAIN) {
+			return false;
+		}
+		tdomain_.push_back(textdomain);
+		t_string::add_textdomain(tdomain_.back(), get_intl_dir());
+	}
+	return true;
+}
+
+bool txwml_archive::inflate_block(posix_file_t fp, int at, std::vector<uint8_t>& zdata, std::vector<uint8_t>& buf) const
+{
+	const tblock& block = blocks_[at];
+	if (!wml_read_range(fp, block.offset, block.zlen, zdata)) {
+		posix_print("------<xwml.cpp>::txwml_archive, cannot read block#%i([%s])\n", at, block.key.c_str());
+		return false;
+	}
+	const size_t size = buf.size();
+	buf.resize(size + block.len);
+	uLongf len = block.len;
+	if (block.len && (!block.zlen || uncompress(&buf[size], &len, &zdata[0], block.zlen) != Z_OK || len != block.len)) {
+		posix_print("------<xwml.cpp>::txwml_archive, block#%i([%s]) is corrupted\n", at, block.key.c_str());
+		buf.resize(size);
+		return false;
+	}
+	return true;
+}
+
+bool txwml_archive::decode(int at, int end, const std::string& skip, config& cfg) const
+{
+	tfile lock(fname_, GENERIC_READ, OPEN_EXISTING);
+	if (!lock.valid() || !same_file(lock.fp)) {
+		// index that is read doesn't locate blocks of this one.
+		posix_print("------<xwml.cpp>::txwml_archive, %s is changed since it is opened\n", fname_.c_str());
+		return false;
+	}
+	// subtree of child block is at deep of its parent, header blocks of its ancestors are decoded first.
+	std::vector<int> ancestors;
+	for (int parent = at != -1? blocks_[at].parent: -1; parent != -1; parent = blocks_[parent].parent) {
+		ancestors.push_back(parent);
+	}
+	std::vector<uint8_t> zdata, buf;
+	for (std::vector<int>::const_reverse_iterator it = ancestors.rbegin(); it != ancestors.rend(); ++ it) {
+		if (!inflate_block(lock.fp, *it, zdata, buf)) {
+			return false;
+		}
+	}
+	for (int block = at != -1? at: 0; block < end; ) {
+		if (block != at && !skip.empty() && blocks_[block].key == skip) {
+			// without its subtree, data is still pre-order nodes, it is only that node isn't there.
+			block = blocks_[block].end;
+			continue;
+		}
+		if (!inflate_block(lock.fp, block, zdata, buf)) {
+			return false;
+		}
+		block ++;
+	}
+	if (buf.empty()) {
+		return true;
+	}
+	std::vector<uint8_t> namebuf(max_str_len_ + 1 + 1024);
+	return wml_config_from_data(&buf[0], buf.size(), &namebuf[0], tdomain_, cfg);
+}
+
+int txwml_archive::find(const std::string& key, const std::string& id) const
+{
+	if (id.empty()) {
+		std::map<std::string, int>::const_iterator it = firsts_.find(key);
+		return it != firsts_.end()? it->second: -1;
+	}
+	std::multimap<std::pair<std::string, std::string>, int>::const_iterator it = ids_.lower_bound(std::make_pair(key, id));
+	return it != ids_.end() && it->first.first == key && it->first.second == id? it->second: -1;
+}
+
+std::vector<int> txwml_archive::find_all(const std::string& key, const std::string& id) const
+{
+	std::vector<int> result;
+	typedef std::multimap<std::pair<std::string, std::string>, int>::const_iterator titerator;
+	const std::pair<titerator, titerator> range = ids_.equal_range(std::make_pair(key, id));
+	for (titerator it = range.first; it != range.second; ++ it) {
+		result.push_back(it->second);
+	}
+	return result;
+}
+
+config& txwml_archive::subtree(int at, config& decoded) const
+{
+	// every ancestor has one child, that is header block of next one.
+	std::vector<int> path;
+	for (int block = at; block != -1; block = blocks_[block].parent) {
+		path.push_back(block);
+	}
+	config* cfg = &decoded;
+	for (std::vector<int>::const_reverse_iterator it = path.rbegin(); it != path.rend() && *cfg; ++ it) {
+		cfg = &cfg->child(blocks_[*it].key);
+	}
+	return *cfg;
+}
+
+const config& txwml_archive::child(int at) const
+{
+	VALIDATE(at >= 0 && at < (int)blocks_.size(), null_str);
+	if (!decoded_[at]) {
+		config* cfg = new config;
+		decode(at, blocks_[at].end, null_str, *cfg);
+		decoded_[at] = cfg;
+	}
+	return subtree(at, *decoded_[at]);
+}
+
+bool txwml_archive::child(int at, config& cfg) const
+{
+	VALIDATE(at >= 0 && at < (int)blocks_.size(), null_str);
+	cfg.clear();
+	config decoded;
+	if (!decode(at, blocks_[at].end, null_str, decoded)) {
+		return false;
+	}
+	config& child = subtree(at, decoded);
+	if (!child) {
+		return false;
+	}
+	cfg.swap(child);
+	return true;
+}
+
+const config& txwml_archive::find_child(const std::string& key, const std::string& id) const
+{
+	const int at = find(key, id);
+	if (at == -1) {
+		// child of empty config is config::invalid.
+		static const config empty;
+		return empty.child(key);
+	}
+	return child(at);
+}
+
+bool txwml_archive::to_config(config& cfg, const std::string& skip) const
+{
+	cfg.clear();
+	return decode(-1, blocks_.size(), skip, cfg);
+}
+
 unsigned char calcuate_xor_from_file(const std::string &fname)
 {
 	int64_t fsize, pos;
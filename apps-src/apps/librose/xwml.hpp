@@ -0,0 +1,232 @@
+#ifndef LIBROSE_XWML_HPP_INCLUDED
+#define LIBROSE_XWML_HPP_INCLUDED
+
+#include "config.hpp"
+#include "posix2.h"
+#include <map>
+#include <string>
+#include <vector>
+
+//
+// zero-copy reader of .bin that wml_config_to_file writes.
+//
+// wml_config_to_file appends an index section after [textdomain] when it is asked to, system bins
+// that are read through txwml_view have it:
+// {pad to 4}{XIDX}{nstrings}{offsets[nstrings]}{lens[nstrings]}{pool_len}{pool}
+// {pad to 4}{nnodes}{tnode[nnodes]}{nattrs}{tattr[nattrs]}
+// strings are deduplicated and sorted, so string index order is lexical order. tnode/tattr only
+// save index of string, and tattr.value is offset to {flag}{len}{val} in data section.
+// txwml_view maps file, and decodes attribute_value only when it is accessed.
+// old reader(wml_config_from_file) stops after [textdomain], so it ignores this section.
+//
+class txwml_view;
+
+class tconfig_view
+{
+	friend class txwml_view;
+public:
+	tconfig_view()
+		: view_(NULL)
+		, node_(0)
+	{}
+
+	bool valid() const { return view_ != NULL; }
+	std::string key() const;
+
+	unsigned child_count(const std::string& key) const;
+	bool has_child(const std::string& key) const { return child(key).valid(); }
+
+	/**
+	 * Returns the nth child with the given @a key, or invalid view if there is none.
+	 * negative @a n accesses from the end of the object.
+	 */
+	tconfig_view child(const std::string& key, int n = 0) const;
+	// child of tag @a key with a @a name attribute containing @a value.
+	tconfig_view find_child(const std::string& key, const std::string& name, const std::string& value) const;
+
+	// in-order iteration over all children. first_child().valid() is false if there is no child.
+	tconfig_view first_child() const;
+	tconfig_view next_sibling() const;
+
+	bool has_attribute(const std::string& key) const;
+	// decode value of attribute. if not exist, return blank attribute.
+	config::attribute_value operator[](const std::string& key) const;
+	size_t attribute_count() const;
+
+	// materialize this subtree to config. cfg will be cleared first.
+	void to_config(config& cfg) const;
+
+private:
+	// true if node has attribute @key, @value receives offset of its value.
+	bool find_attribute(const std::string& key, uint32_t* value) const;
+
+	tconfig_view(const txwml_view* view, uint32_t node)
+		: view_(view)
+		, node_(node)
+	{}
+
+private:
+	const txwml_view* view_;
+	uint32_t node_;
+};
+
+class txwml_view
+{
+	friend class tconfig_view;
+public:
+	struct tnode {
+		uint32_t key;
+		uint32_t first_child;
+		uint32_t next_sibling;
+		uint32_t first_attr;
+		uint32_t nattrs;
+	};
+	struct tattr {
+		uint32_t key;
+		uint32_t value;
+	};
+	static const uint32_t npos = 0xffffffff;
+
+	explicit txwml_view(const std::string& fname);
+	~txwml_view();
+
+	// false if file doesn't exist, or it is written by old wml_config_to_file without index section.
+	bool valid() const { return nodes_ != NULL; }
+	tconfig_view root() const { return valid()? tconfig_view(this, 0): tconfig_view(); }
+
+	// index of @str in string table. npos if not exist, in this case no node/attribute has this key.
+	uint32_t string_index(const char* str, size_t len) const;
+	const char* string_at(uint32_t index, uint32_t* len) const;
+
+	uint32_t nfiles() const { return nfiles_; }
+	uint32_t sum_size() const { return sum_size_; }
+	uint32_t modified() const { return modified_; }
+	bool mapped() const { return mapped_; }
+
+private:
+	void map_file(const std::string& fname);
+	void unmap_file();
+	bool parse_index(const uint8_t* rdpos);
+	// value at @offset of data section doesn't exceed it.
+	bool valid_value(uint32_t offset) const;
+
+	void value_at(uint32_t offset, config::attribute_value& value) const;
+	void node_to_config(uint32_t node, config& cfg) const;
+
+private:
+	uint8_t* file_data_;
+	uint32_t file_size_;
+	bool mapped_;
+#ifdef _WIN32
+	void* map_handle_;
+#endif
+
+	uint32_t nfiles_;
+	uint32_t sum_size_;
+	uint32_t modified_;
+
+	const uint8_t* data_;
+	uint32_t data_len_;
+	std::vector<std::string> tdomain_;
+
+	uint32_t nstrings_;
+	const uint32_t* string_offsets_;
+	const uint32_t* string_lens_;
+	const char* string_pool_;
+
+	uint32_t nnodes_;
+	const tnode* nodes_;
+	uint32_t nattrs_;
+	const tattr* attrs_;
+};
+
+//
+// xwml v2: data section of v1 is split to zlib-compressed blocks, footer indexes blocks by tag and id.
+// {XWM2}{nfiles}{sum_size}{modified}{max_str_len}{block0}{block1}...{textdomain}{index}{index_offset}{XEND}
+// index is {nblocks}{offset}{zlen}{len}{parent}{end}{len}{tag}{len}{id}...
+// every top-level child is a block. large one is split to a header block with its attributes,
+// and blocks of its children, so one [window] of gui.bin is a block. blocks are in pre-order,
+// concatenated they are data section of v1.
+// txwml_archive reads header, index and [textdomain] only. blocks are read, inflated and parsed
+// when their subtree is accessed. wml_config_from_file reads v2 by inflating all blocks.
+// gui.bin is v2, gui2::load_settings parses a [window] when it is built first.
+//
+void wml_config_to_file_v2(const std::string& fname, const config& cfg, uint32_t nfiles = 0, uint32_t sum_size = 0, uint32_t modified = 0, const std::map<std::string, std::string>& app_domains = std::map<std::string, std::string>());
+
+class txwml_archive
+{
+public:
+	struct tblock {
+		std::string key;
+		// value of id attribute, empty if there is not.
+		std::string id;
+		uint32_t offset;
+		uint32_t zlen;
+		uint32_t len;
+		// block of parent node, -1 if it is top-level child.
+		int parent;
+		// blocks of subtree are [this, end).
+		uint32_t end;
+	};
+
+	explicit txwml_archive(const std::string& fname);
+	~txwml_archive();
+
+	// false if file doesn't exist, or it isn't v2.
+	bool valid() const { return valid_; }
+	const std::vector<tblock>& blocks() const { return blocks_; }
+
+	// index of first block with tag @key and, if @id isn't empty, with id @id. -1 if there is none.
+	int find(const std::string& key, const std::string& id = std::string()) const;
+	// indexes of blocks with tag @key and id @id, in order they are in file.
+	std::vector<int> find_all(const std::string& key, const std::string& id) const;
+
+	// subtree of block @at. it is inflated and parsed at first access, and kept until archive is destroyed.
+	// not thread-safe, one archive should be used by one thread.
+	const config& child(int at) const;
+	// same subtree, parsed to @cfg and not kept. false if it can't be read.
+	bool child(int at, config& cfg) const;
+	// config::invalid if there is none.
+	const config& find_child(const std::string& key, const std::string& id = std::string()) const;
+
+	// inflate and parse all blocks, but not blocks with tag @skip and their subtrees. cfg will be cleared first.
+	// false if a block can't be read, for example file is written again since archive is opened.
+	bool to_config(config& cfg, const std::string& skip = std::string()) const;
+
+	const std::string& fname() const { return fname_; }
+	uint32_t nfiles() const { return nfiles_; }
+	uint32_t sum_size() const { return sum_size_; }
+	uint32_t modified() const { return modified_; }
+
+private:
+	txwml_archive(const txwml_archive&);
+	void operator=(const txwml_archive&);
+
+	bool parse_index();
+	// @fp is still file whose index is read.
+	bool same_file(posix_file_t fp) const;
+	// read block @at to @zdata, and append inflated one to @buf.
+	bool inflate_block(posix_file_t fp, int at, std::vector<uint8_t>& zdata, std::vector<uint8_t>& buf) const;
+	// parse blocks [at, end) to @cfg. -1 @at parses from first block.
+	bool decode(int at, int end, const std::string& skip, config& cfg) const;
+	// subtree of block @at in @decoded, that decode(at, ...) parses.
+	config& subtree(int at, config& decoded) const;
+
+private:
+	bool valid_;
+	std::string fname_;
+	int64_t file_size_;
+	uint32_t nfiles_;
+	uint32_t sum_size_;
+	uint32_t modified_;
+	uint32_t max_str_len_;
+	std::vector<std::string> tdomain_;
+	std::vector<tblock> blocks_;
+	// tag to first block, and tag/id to blocks.
+	std::map<std::string, int> firsts_;
+	std::multimap<std::pair<std::string, std::string>, int> ids_;
+	// parsed blocks, every one has one child that is subtree of block.
+	mutable std::vector<config*> decoded_;
+};
+
+#endif
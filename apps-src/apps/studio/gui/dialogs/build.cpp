@@ -62,22 +62,30 @@ void tbuild::DoWork()
 	const std::vector<std::pair<teditor_::BIN_TYPE, teditor_::wml2bin_desc> >& descs = editor_.wml2bin_descs();
 	set_increment_progress progress(increment_progress_cb2, &build_ctx_);
 
+	std::vector<int> ats;
 	int count = (int)descs.size();
-	for (int at = 0; at < count && !exit_task_; at ++) {
-		const std::pair<teditor_::BIN_TYPE, teditor_::wml2bin_desc>& desc = descs[at];
-		if (!desc.second.require_build) {
-			continue;
+	for (int at = 0; at < count; at ++) {
+		if (descs[at].second.require_build) {
+			ats.push_back(at);
 		}
-		main_->Invoke<void>(RTC_FROM_HERE, rtc::Bind(&tbuild::handle_desc, this, desc, true, at, true));
-
-		bool ret = false;
-		try {
-			ret = editor_.cfgs_2_cfg(desc.first, desc.second.bin_name, desc.second.app, true, desc.second.wml_nfiles, desc.second.wml_sum_size, (uint32_t)desc.second.wml_modified, tdomains);
-		} catch (twml_exception& e) {
-			e.show();
-		}
-		main_->Invoke<void>(RTC_FROM_HERE, rtc::Bind(&tbuild::handle_desc, this, desc, false, at, ret));
 	}
+	if (ats.empty() || exit_task_) {
+		return;
+	}
+	main_->Invoke<void>(RTC_FROM_HERE, rtc::Bind(&tbuild::start_descs, this, ats));
+
+	// bins are built at same time, cfgs_2_cfgs reports each when it is done.
+	// it checks exit_task_ before every file, as loop of cfgs_2_cfg did before every bin.
+	try {
+		editor_.cfgs_2_cfgs(ats, tdomains, boost::bind(&tbuild::did_build, this, _1, _2), &exit_task_);
+	} catch (twml_exception& e) {
+		e.show();
+	}
+}
+
+void tbuild::did_build(const int at, const bool ret)
+{
+	main_->Invoke<void>(RTC_FROM_HERE, rtc::Bind(&tbuild::handle_desc, this, at, ret));
 }
 
 void tbuild::OnWorkStart()
@@ -94,12 +102,19 @@ void tbuild::OnWorkDone()
 	task_status_->set_dirty();
 }
 
-void tbuild::handle_desc(const std::pair<teditor_::BIN_TYPE, teditor_::wml2bin_desc>& desc, const bool started, const int at, const bool ret)
+void tbuild::start_descs(const std::vector<int>& ats)
 {
-	if (started) {
-		build_ctx_.reset(at);
+	size_t wml_nfiles = 0;
+	for (std::vector<int>::const_iterator it = ats.begin(); it != ats.end(); ++ it) {
+		wml_nfiles += editor_.wml2bin_descs()[*it].second.wml_nfiles;
+		app_handle_desc(true, *it, true);
 	}
-	app_handle_desc(started, at, ret);
+	build_ctx_.reset(ats.front(), wml_nfiles);
+}
+
+void tbuild::handle_desc(const int at, const bool ret)
+{
+	app_handle_desc(false, at, ret);
 }
 
 void tbuild::did_task_status(gui2::ttrack& widget, const SDL_Rect& widget_rect, const bool bg_drawn)
@@ -128,14 +143,12 @@ void tbuild::did_task_status(gui2::ttrack& widget, const SDL_Rect& widget_rect,
 		SDL_RenderCopy(renderer, widget.background_texture().get(), NULL, &widget_rect);
 	}
 
-	const std::pair<teditor_::BIN_TYPE, teditor_::wml2bin_desc>& desc = editor_.wml2bin_descs()[build_ctx_.desc_at];
-
-	VALIDATE(desc.second.wml_nfiles, null_str);
-	dst.w = build_ctx_.nfiles * widget_rect.w / desc.second.wml_nfiles;
+	VALIDATE(build_ctx_.wml_nfiles, null_str);
+	dst.w = std::min(build_ctx_.nfiles, build_ctx_.wml_nfiles) * widget_rect.w / build_ctx_.wml_nfiles;
 	render_rect(renderer, dst, 0xff00ff00);
 
 	std::stringstream ss;
-	ss << build_ctx_.nfiles << "/" << desc.second.wml_nfiles;
+	ss << build_ctx_.nfiles << "/" << build_ctx_.wml_nfiles;
 	if (!build_ctx_.name.empty()) {
 		ss << "    " << build_ctx_.name.substr(editor_.working_dir().size());
 	}
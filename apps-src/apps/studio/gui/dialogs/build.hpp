@@ -21,16 +21,20 @@ public:
 		tbuild_ctx(tbuild& owner)
 			: owner(owner)
 			, nfiles(0)
+			, wml_nfiles(0)
 			, desc_at(gui2::twidget::npos)
 		{}
-		void reset(int _desc_at)
+		void reset(int _desc_at, size_t _wml_nfiles = 0)
 		{
 			nfiles = 0;
+			wml_nfiles = _wml_nfiles;
 			name.clear();
 			desc_at = _desc_at;
 		}
 
 		size_t nfiles;
+		// bins are built at same time, files of all bins.
+		size_t wml_nfiles;
 		std::string name;
 		int desc_at;
 		tbuild& owner;
@@ -46,7 +50,9 @@ protected:
 	void OnWorkDone() override;
 
 private:
-	void handle_desc(const std::pair<teditor_::BIN_TYPE, teditor_::wml2bin_desc>& desc, const bool started, const int at, const bool ret);
+	void start_descs(const std::vector<int>& ats);
+	void did_build(const int at, const bool ret);
+	void handle_desc(const int at, const bool ret);
 	void did_task_status(gui2::ttrack& widget, const SDL_Rect& widget_rect, const bool bg_drawn);
 
 	virtual void app_work_start() = 0;
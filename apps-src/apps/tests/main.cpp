@@ -0,0 +1,50 @@
+#include "test.hpp"
+#include "environment.hpp"
+
+#include <stdio.h>
+#include <string.h>
+
+// usage: tests [--res=dir] [filter]
+// runs every case whose name contains filter. exit code is 1 if any case failed.
+// --res is apps-res directory, cases that read data from it are skipped without it.
+int main(int argc, char** argv)
+{
+	const char* filter = NULL;
+	for (int at = 1; at < argc; at ++) {
+		const char* arg = argv[at];
+		if (!strncmp(arg, "--res=", 6)) {
+			benchmark::set_res_dir(arg + 6);
+		} else {
+			filter = arg[0]? arg: NULL;
+		}
+	}
+
+	int failed = 0, passed = 0, skipped = 0;
+	const std::vector<test::tcase>& cases = test::cases();
+	for (std::vector<test::tcase>::const_iterator it = cases.begin(); it != cases.end(); ++ it) {
+		if (filter && !strstr(it->name.c_str(), filter)) {
+			continue;
+		}
+		test::tstate state;
+		it->function(state);
+
+		if (!state.failures().empty()) {
+			printf("%-48s FAILED\n", it->name.c_str());
+			for (std::vector<std::string>::const_iterator it2 = state.failures().begin(); it2 != state.failures().end(); ++ it2) {
+				printf("    %s\n", it2->c_str());
+			}
+			failed ++;
+		} else if (!state.skipped().empty()) {
+			printf("%-48s skipped: %s\n", it->name.c_str(), state.skipped().c_str());
+			skipped ++;
+		} else {
+			printf("%-48s ok\n", it->name.c_str());
+			passed ++;
+		}
+		fflush(stdout);
+	}
+	printf("%d passed, %d failed, %d skipped\n", passed, failed, skipped);
+
+	benchmark::release_environment();
+	return failed? 1: 0;
+}
@@ -0,0 +1,26 @@
+#include "test.hpp"
+
+namespace test {
+
+void tstate::fail(const char* file, int line, const std::string& message)
+{
+	std::stringstream err;
+	err << file << ":" << line << ": " << message;
+	failures_.push_back(err.str());
+}
+
+std::vector<tcase>& cases()
+{
+	static std::vector<tcase> ret;
+	return ret;
+}
+
+tregister::tregister(const char* name, tfunction function)
+{
+	tcase c;
+	c.name = name;
+	c.function = function;
+	cases().push_back(c);
+}
+
+}
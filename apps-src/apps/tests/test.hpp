@@ -0,0 +1,78 @@
+#ifndef TESTS_TEST_HPP_INCLUDED
+#define TESTS_TEST_HPP_INCLUDED
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+//
+// minimal unit test harness, same shape as benchmark's. every test_*.cpp registers its cases
+// with TEST, main runs them in registration order and fails if any check failed.
+//
+// void test_foo(test::tstate& state)
+// {
+//     CHECK(state, condition);
+//     CHECK_EQUAL(state, expected, actual);
+// }
+// TEST(test_foo);
+//
+namespace test {
+
+class tstate
+{
+public:
+	tstate()
+		: failures_()
+		, skipped_()
+	{}
+
+	void fail(const char* file, int line, const std::string& message);
+
+	// case can't run here, i.e. dataset is missing. call it, then return.
+	void skip(const std::string& reason) { skipped_ = reason; }
+
+	const std::vector<std::string>& failures() const { return failures_; }
+	const std::string& skipped() const { return skipped_; }
+
+private:
+	std::vector<std::string> failures_;
+	std::string skipped_;
+};
+
+typedef void (*tfunction)(tstate& state);
+
+struct tcase
+{
+	std::string name;
+	tfunction function;
+};
+
+std::vector<tcase>& cases();
+
+struct tregister
+{
+	tregister(const char* name, tfunction function);
+};
+
+template<typename E, typename A>
+void check_equal(tstate& state, const char* file, int line, const char* expr, const E& expected, const A& actual)
+{
+	if (!(expected == actual)) {
+		std::stringstream err;
+		err << expr << ": expected " << expected << ", actual " << actual;
+		state.fail(file, line, err.str());
+	}
+}
+
+}
+
+#define TEST(function) \
+	static test::tregister test_register_##function(#function, function)
+
+#define CHECK(state, cond) \
+	do { if (!(cond)) (state).fail(__FILE__, __LINE__, #cond); } while (0)
+
+#define CHECK_EQUAL(state, expected, actual) \
+	test::check_equal(state, __FILE__, __LINE__, #actual, expected, actual)
+
+#endif
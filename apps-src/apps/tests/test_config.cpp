@@ -0,0 +1,255 @@
+#include "test.hpp"
+#include "environment.hpp"
+
+#include "config.hpp"
+#include "config_cache.hpp"
+#include "filesystem.hpp"
+#include "rose_config.hpp"
+#include "serialization/parser.hpp"
+#include "serialization/preprocessor.hpp"
+#include "serialization/string_utils.hpp"
+
+#include <boost/foreach.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <fstream>
+
+namespace {
+
+// "key=id,..." of children in order.
+std::string children_str(const config& cfg)
+{
+	std::stringstream ss;
+	BOOST_FOREACH (const config::any_child& value, cfg.all_children_range()) {
+		ss << value.key << "=" << value.cfg["id"].str() << ",";
+	}
+	return ss.str();
+}
+
+// children of @keys, "a,b" gives [a] id=<first_id>, [b] id=<first_id + 1>.
+config make_children(const std::string& keys, int first_id)
+{
+	config cfg;
+	const std::vector<std::string> vstr = utils::split(keys);
+	for (std::vector<std::string>::const_iterator it = vstr.begin(); it != vstr.end(); ++ it) {
+		config& child = cfg.add_child(*it);
+		child["id"] = first_id ++;
+		child.add_child("sub")["id"] = *it;
+	}
+	return cfg;
+}
+
+void write_text(const std::string& fname, const std::string& text)
+{
+	std::ofstream file(fname.c_str(), std::ios::binary);
+	file << text;
+}
+
+std::string window_cfg(const std::string& id, int labels)
+{
+	std::stringstream ss;
+	ss << "[window]\n\tid = \"" << id << "\"\n";
+	for (int at = 0; at < labels; at ++) {
+		ss << "\t[label]\n\t\tlabel = \"" << id << "-" << at << "\"\n\t[/label]\n";
+	}
+	ss << "[/window]\n";
+	return ss.str();
+}
+
+// small gui tree: settings, then windows of window directory, then tail.cfg, all in [gui].
+bool write_gui_tree(test::tstate& state, const std::string& res)
+{
+	const std::string window_dir = res + "/data/gui/window";
+	if (!create_directory_if_missing_recursive(window_dir) || !create_directory_if_missing_recursive(res + "/xwml")) {
+		state.skip("cannot create " + res);
+		return false;
+	}
+	write_text(res + "/data/gui/_main.cfg",
+		"#textdomain rose-lib\n"
+		"[gui]\n"
+		"\tid = \"default\"\n"
+		"\t[settings]\n"
+		"\t\tdouble_click_time = 500\n"
+		"\t[/settings]\n"
+		"{gui/window/}\n"
+		"{gui/tail.cfg}\n"
+		"[/gui]\n");
+	write_text(res + "/data/gui/tail.cfg", window_cfg("tail", 1));
+	write_text(window_dir + "/a.cfg", window_cfg("a", 2));
+	write_text(window_dir + "/b.cfg", window_cfg("b", 3));
+	write_text(window_dir + "/c.cfg", window_cfg("c", 1));
+	return true;
+}
+
+int count_of(const std::string& text, const std::string& what)
+{
+	int count = 0;
+	for (size_t pos = text.find(what); pos != std::string::npos; pos = text.find(what, pos + what.size())) {
+		count ++;
+	}
+	return count;
+}
+
+// build gui.bin of @res by cfgs_2_cfgs. return true if it is incremental.
+bool build_gui_bin(test::tstate& state, teditor_& editor)
+{
+	editor.get_wml2bin_desc_from_wml(std::vector<teditor_::BIN_TYPE>(1, teditor_::GUI));
+	CHECK(state, editor.cfgs_2_cfgs(std::vector<int>(1, 0), std::map<std::string, std::string>()));
+	CHECK_EQUAL(state, 1, (int)editor.build_timings().size());
+	return !editor.build_timings().empty() && editor.build_timings()[0].incremental;
+}
+
+}
+
+// children of src are moved in place of range, children of every key keep in-order position.
+static void config_replace_ordered_children(test::tstate& state)
+{
+	config cfg = make_children("a,b,c,b,d", 0);
+	config src = make_children("x,b,b", 5);
+	cfg.replace_ordered_children(1, 2, src);
+	CHECK_EQUAL(state, "a=0,x=5,b=6,b=7,b=3,d=4,", children_str(cfg));
+	CHECK_EQUAL(state, 0, (int)src.all_children_count());
+	CHECK_EQUAL(state, "6", cfg.child("b", 0)["id"].str());
+	CHECK_EQUAL(state, "3", cfg.child("b", 2)["id"].str());
+	CHECK(state, !cfg.child("c"));
+	CHECK_EQUAL(state, "b", cfg.ordered_child(3).child("sub")["id"].str());
+
+	// insert, erase, and at end.
+	src = make_children("c", 8);
+	cfg.replace_ordered_children(0, 0, src);
+	CHECK_EQUAL(state, "c=8,a=0,x=5,b=6,b=7,b=3,d=4,", children_str(cfg));
+	src.clear();
+	cfg.replace_ordered_children(2, 3, src);
+	CHECK_EQUAL(state, "c=8,a=0,b=3,d=4,", children_str(cfg));
+	src = make_children("d,e", 9);
+	cfg.replace_ordered_children(4, 0, src);
+	CHECK_EQUAL(state, "c=8,a=0,b=3,d=4,d=9,e=10,", children_str(cfg));
+
+	src = make_children("f", 11);
+	bool thrown = false;
+	try {
+		cfg.replace_ordered_children(5, 2, src);
+	} catch (config::error&) {
+		thrown = true;
+	}
+	CHECK(state, thrown);
+}
+TEST(config_replace_ordered_children);
+
+// one changed file of a tree is reparsed alone and spliced into last bin, bin is byte-identical to full build.
+static void config_incremental_gui_bin(test::tstate& state)
+{
+	// record of last build is in cache of user data.
+	if (!benchmark::init_user_data()) {
+		state.skip("no writable directory");
+		return;
+	}
+	const std::string res = benchmark::work_dir() + "test-incremental";
+	const std::string window_dir = res + "/data/gui/window";
+	const std::string bin = res + "/xwml/gui.bin";
+	if (!write_gui_tree(state, res)) {
+		return;
+	}
+	SDL_DeleteFiles(bin.c_str());
+
+	teditor_ editor(res);
+	CHECK(state, !build_gui_bin(state, editor));
+	CHECK(state, file_exists(bin));
+	const std::string original = read_file(bin);
+
+	// b.cfg has one more window and other labels, so segments after it move.
+	write_text(window_dir + "/b.cfg", window_cfg("b", 1) + window_cfg("b2", 4));
+	CHECK(state, build_gui_bin(state, editor));
+	const std::string incremental = read_file(bin);
+	CHECK(state, incremental != original);
+
+	SDL_DeleteFiles(bin.c_str());
+	CHECK(state, !build_gui_bin(state, editor));
+	const std::string full = read_file(bin);
+	CHECK(state, !full.empty());
+	if (incremental != full) {
+		state.fail(__FILE__, __LINE__, "incremental gui.bin differs from full build");
+	}
+
+	// c.cfg, after moved segments, is spliced right too.
+	write_text(window_dir + "/c.cfg", window_cfg("c", 5));
+	CHECK(state, build_gui_bin(state, editor));
+	const std::string incremental2 = read_file(bin);
+	SDL_DeleteFiles(bin.c_str());
+	CHECK(state, !build_gui_bin(state, editor));
+	if (incremental2 != read_file(bin)) {
+		state.fail(__FILE__, __LINE__, "second incremental gui.bin differs from full build");
+	}
+}
+TEST(config_incremental_gui_bin);
+
+// every file included at top level is a segment, marked in output, and record has where its children went.
+static void config_preproc_record_segments(test::tstate& state)
+{
+	if (benchmark::work_dir().empty()) {
+		state.skip("no writable directory");
+		return;
+	}
+	const std::string res = benchmark::work_dir() + "test-segments";
+	if (!write_gui_tree(state, res)) {
+		return;
+	}
+
+	const std::string original_path = game_config::path;
+	game_config::path = res;
+	tpreproc_record record;
+	std::string text;
+	{
+		preproc_map defines;
+		boost::scoped_ptr<std::istream> stream(preprocess_file(res + "/data/gui", &defines, &record));
+		std::stringstream ss;
+		ss << stream->rdbuf();
+		text = ss.str();
+	}
+	game_config::path = original_path;
+
+	config cfg;
+	std::istringstream in(text);
+	read(cfg, in, record);
+
+	// _main.cfg, a.cfg, b.cfg, c.cfg and tail.cfg.
+	CHECK_EQUAL(state, 5, (int)record.segments.size());
+	CHECK_EQUAL(state, (int)record.segments.size(), count_of(text, "\376segment "));
+	CHECK_EQUAL(state, (int)record.segments.size(), count_of(text, "\376endsegment "));
+	const std::string window_dir = res + "/data/gui/window";
+	CHECK_EQUAL(state, 1, (int)(record.dirs.count(window_dir) + record.dirs.count(window_dir + "/")));
+
+	const char* files[] = {"window/a.cfg", "window/b.cfg", "window/c.cfg", "tail.cfg"};
+	for (int at = 0; at < (int)(sizeof(files) / sizeof(files[0])); at ++) {
+		const std::string file = res + "/data/gui/" + files[at];
+		const tpreproc_record::tsegment* segment = NULL;
+		BOOST_FOREACH (const tpreproc_record::tsegment& that, record.segments) {
+			if (that.file == file) {
+				segment = &that;
+			}
+		}
+		CHECK(state, segment != NULL);
+		if (!segment) {
+			continue;
+		}
+		// children go to [gui], after [settings].
+		CHECK(state, segment->parent == std::vector<int>(1, 0));
+		CHECK_EQUAL(state, at + 1, segment->first);
+		CHECK_EQUAL(state, 1, segment->count);
+		CHECK(state, segment->clean);
+		CHECK(state, !segment->defines);
+		CHECK_EQUAL(state, 1, record.files[file].reads);
+		CHECK_EQUAL(state, 1, record.files[file].segments);
+	}
+	CHECK_EQUAL(state, 5, (int)cfg.child("gui").all_children_count());
+	CHECK_EQUAL(state, "b", cfg.child("gui").ordered_child(2)["id"].str());
+
+	// record is kept in bin's record file, it reads back same.
+	config record_cfg;
+	record.write(record_cfg);
+	tpreproc_record record2;
+	record2.read(record_cfg);
+	config record_cfg2;
+	record2.write(record_cfg2);
+	CHECK(state, record_cfg == record_cfg2);
+}
+TEST(config_preproc_record_segments);
@@ -0,0 +1,37 @@
+#include "test.hpp"
+
+#include "gui/auxiliary/event/dispatcher_private.hpp"
+
+using namespace gui2;
+using namespace gui2::event;
+
+namespace {
+
+// widgets are only carried by chain, never dereferenced.
+twidget* fake_widget(int at)
+{
+	return reinterpret_cast<twidget*>(static_cast<uintptr_t>(at + 1) * 16);
+}
+
+}
+
+// chain grows from inline items to heap several times, every item keeps its position.
+static void event_chain_grow(test::tstate& state)
+{
+	const int count = 100;
+	implementation::tevent_chain chain;
+	for (int at = 0; at < count; at ++) {
+		chain.push_back(std::make_pair(fake_widget(at), at & 1? LEFT_BUTTON_DOWN: LEFT_BUTTON_UP));
+	}
+	CHECK_EQUAL(state, count, chain.size());
+	for (int at = 0; at < chain.size(); at ++) {
+		CHECK(state, chain[at].first == fake_widget(at));
+		CHECK(state, chain[at].second == (at & 1? LEFT_BUTTON_DOWN: LEFT_BUTTON_UP));
+	}
+
+	chain.reverse();
+	for (int at = 0; at < chain.size(); at ++) {
+		CHECK(state, chain[at].first == fake_widget(count - 1 - at));
+	}
+}
+TEST(event_chain_grow);
@@ -0,0 +1,185 @@
+#include "test.hpp"
+#include "environment.hpp"
+
+#include "filesystem.hpp"
+#include "hero.hpp"
+#include "serialization/string_utils.hpp"
+
+#include <sstream>
+#include <stdlib.h>
+
+namespace {
+
+const int heros_count = 3000;
+
+// heros file of random records, every 10th record is invalid.
+std::string write_heros(test::tstate& state)
+{
+	if (benchmark::work_dir().empty()) {
+		state.skip("no writable directory");
+		return null_str;
+	}
+	const std::string fname = benchmark::work_dir() + "test-hero.dat";
+
+	std::vector<uint8_t> data(HEROS_FILE_PREFIX_BYTES + heros_count * HEROS_BYTES_PER_HERO, 0);
+	*(uint32_t*)&data[0] = mmioFOURCC('H', 'E', 'R', '0');
+	srand(1);
+	for (int number = 0; number < heros_count; number ++) {
+		hero h(number, ftofxp9(rand() % 100), ftofxp9(rand() % 100), ftofxp9(rand() % 100), ftofxp9(rand() % 100), ftofxp9(rand() % 100));
+		h.side_ = rand() % 16;
+		h.city_ = rand() % 256;
+		h.feature_ = rand() % 64;
+		if (!(number % 10)) {
+			h.number_ = HEROS_INVALID_NUMBER;
+		}
+		h.write(&data[HEROS_FILE_PREFIX_BYTES + number * HEROS_BYTES_PER_HERO]);
+	}
+	tfile lock(fname, GENERIC_WRITE, CREATE_ALWAYS);
+	if (!lock.valid()) {
+		state.skip("cannot write " + fname);
+		return null_str;
+	}
+	posix_fwrite(lock.fp, &data[0], data.size());
+	return fname;
+}
+
+// value of @column in @fields, stat columns in integer as select takes them.
+int column_value(const hero_fields_t& fields, int column)
+{
+	switch (column) {
+	case thero_store::COLUMN_SIDE:
+		return fields.side_;
+	case thero_store::COLUMN_CITY:
+		return fields.city_;
+	case thero_store::COLUMN_FEATURE:
+		return fields.feature_;
+	case thero_store::COLUMN_LEADERSHIP:
+		return fxptoi9(fields.leadership_);
+	case thero_store::COLUMN_FORCE:
+		return fxptoi9(fields.force_);
+	case thero_store::COLUMN_INTELLECT:
+		return fxptoi9(fields.intellect_);
+	case thero_store::COLUMN_SPIRIT:
+		return fxptoi9(fields.spirit_);
+	case thero_store::COLUMN_CHARM:
+		return fxptoi9(fields.charm_);
+	}
+	return 0;
+}
+
+std::vector<int> scan(const thero_store& store, int column, int min, int max)
+{
+	std::vector<int> result;
+	for (int number = 0; number < store.size(); number ++) {
+		const hero_fields_t& fields = store.fields(number);
+		const int value = column_value(fields, column);
+		if (fields.number_ != HEROS_INVALID_NUMBER && value >= min && value <= max) {
+			result.push_back(number);
+		}
+	}
+	return result;
+}
+
+// select of every column and range returns what scanning records returns.
+void check_select(test::tstate& state, const thero_store& store)
+{
+	const int ranges[][2] = {{0, 0}, {3, 3}, {10, 40}, {60, 80}, {99, 99}, {-5, 2}, {90, 100000}, {50, 20}};
+	std::vector<int> result;
+	for (int column = 0; column < thero_store::COLUMN_COUNT; column ++) {
+		for (size_t at = 0; at < sizeof(ranges) / sizeof(ranges[0]); at ++) {
+			store.select(column, ranges[at][0], ranges[at][1], result);
+			if (result != scan(store, column, ranges[at][0], ranges[at][1])) {
+				std::stringstream err;
+				err << "column " << column << ", [" << ranges[at][0] << ", " << ranges[at][1] << "] differs from scan";
+				state.fail(__FILE__, __LINE__, err.str());
+			}
+		}
+	}
+}
+
+}
+
+// select on built columns is same as scanning every record.
+static void hero_store_select_equals_scan(test::tstate& state)
+{
+	const std::string fname = write_heros(state);
+	if (fname.empty()) {
+		return;
+	}
+	thero_store store(fname);
+	CHECK(state, store.valid());
+	CHECK_EQUAL(state, heros_count, store.size());
+	check_select(state, store);
+
+	std::vector<int> result;
+	store.select(thero_store::COLUMN_SIDE, 0, 15, result);
+	CHECK_EQUAL(state, heros_count - heros_count / 10, (int)result.size());
+
+	// hero_map constructs valid records only.
+	hero_map heros;
+	CHECK(state, heros.map_from_file(fname));
+	CHECK_EQUAL(state, (int)result.size(), (int)heros.size());
+}
+TEST(hero_store_select_equals_scan);
+
+// update changes built columns at once, flush writes only dirty pages, and file reopened has updated records.
+static void hero_store_update_flush(test::tstate& state)
+{
+	const std::string fname = write_heros(state);
+	if (fname.empty()) {
+		return;
+	}
+	const int numbers[] = {1, 2, 777, heros_count - 1};
+	{
+		thero_store store(fname);
+		std::vector<int> result;
+		// column of side is built before update, column of force after.
+		store.select(thero_store::COLUMN_SIDE, 20, 20, result);
+		CHECK(state, result.empty());
+
+		for (size_t at = 0; at < sizeof(numbers) / sizeof(numbers[0]); at ++) {
+			hero_fields_t fields = store.fields(numbers[at]);
+			fields.side_ = 20;
+			fields.force_ = ftofxp9(120);
+			store.update(numbers[at], fields);
+		}
+		// valid record becomes invalid, and invalid one valid.
+		hero_fields_t fields = store.fields(11);
+		fields.number_ = HEROS_INVALID_NUMBER;
+		store.update(11, fields);
+		fields = store.fields(20);
+		fields.number_ = 20;
+		fields.side_ = 20;
+		store.update(20, fields);
+
+		CHECK(state, store.dirty_pages() > 0);
+		CHECK(state, store.dirty_pages() < (int)(file_size(fname, false) / thero_store::page_size));
+		check_select(state, store);
+		store.select(thero_store::COLUMN_SIDE, 20, 20, result);
+		CHECK_EQUAL(state, 5, (int)result.size());
+		store.select(thero_store::COLUMN_FORCE, 120, 120, result);
+		CHECK_EQUAL(state, 4, (int)result.size());
+
+		// file isn't changed until flush.
+		thero_store before(fname);
+		CHECK(state, before.fields(1).side_ != 20);
+		CHECK(state, before.fields(20).number_ == HEROS_INVALID_NUMBER);
+
+		CHECK(state, store.flush());
+		CHECK_EQUAL(state, 0, store.dirty_pages());
+	}
+
+	thero_store store(fname);
+	CHECK_EQUAL(state, heros_count, store.size());
+	for (size_t at = 0; at < sizeof(numbers) / sizeof(numbers[0]); at ++) {
+		CHECK_EQUAL(state, 20, (int)store.fields(numbers[at]).side_);
+		CHECK_EQUAL(state, 120, fxptoi9(store.fields(numbers[at]).force_));
+	}
+	CHECK(state, store.fields(11).number_ == HEROS_INVALID_NUMBER);
+	CHECK_EQUAL(state, 20, (int)store.fields(20).number_);
+	std::vector<int> result;
+	store.select(thero_store::COLUMN_SIDE, 20, 20, result);
+	CHECK_EQUAL(state, 5, (int)result.size());
+	check_select(state, store);
+}
+TEST(hero_store_update_flush);
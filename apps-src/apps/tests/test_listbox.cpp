@@ -0,0 +1,171 @@
+#include "test.hpp"
+#include "environment.hpp"
+
+#include "gui/widgets/listbox.hpp"
+#include "gui/widgets/toggle_panel.hpp"
+#include "gui/widgets/window.hpp"
+
+#include <algorithm>
+#include <boost/bind.hpp>
+#include <set>
+#include <sstream>
+
+namespace {
+
+const int model_rows = 10000;
+
+std::string row_label(const int at)
+{
+	std::stringstream ss;
+	ss << "row " << at;
+	return ss.str();
+}
+
+const std::string& panel_label(const gui2::ttoggle_panel& panel)
+{
+	return gui2::find_widget<const gui2::tcontrol>(&panel, "label", false).label();
+}
+
+class trow_model
+{
+public:
+	trow_model()
+		: panels()
+		, fills(0)
+	{}
+
+	void fill(gui2::tlistbox& list, gui2::ttoggle_panel& widget, const int at)
+	{
+		gui2::find_widget<gui2::tcontrol>(&widget, "label", false).set_label(row_label(at));
+		panels.insert(&widget);
+		fills ++;
+	}
+
+	// every panel that is ever filled.
+	std::set<gui2::ttoggle_panel*> panels;
+	int fills;
+};
+
+gui2::twindow* row_model_window(test::tstate& state, trow_model& model, gui2::tlistbox*& list)
+{
+	gui2::twindow* window = benchmark::build_window("rose__combo_box");
+	if (!window) {
+		state.skip("gui isn't available");
+		return NULL;
+	}
+	list = gui2::find_widget<gui2::tlistbox>(window, "listbox", false, true);
+	list->set_row_model(boost::bind(&trow_model::fill, &model, _1, _2, _3), model_rows);
+	window->layout();
+	return window;
+}
+
+// rows in window are continuous and every panel shows its own row. return number of them.
+int check_window(test::tstate& state, const gui2::tlistbox& list)
+{
+	const gui2::tgrid::titerator it = list.iterator();
+	for (int n = 0; n < it.size; n ++) {
+		const gui2::ttoggle_panel* panel = dynamic_cast<const gui2::ttoggle_panel*>(it.children[n].widget_);
+		CHECK_EQUAL(state, row_label(panel->at()), panel_label(*panel));
+		if (n) {
+			const gui2::ttoggle_panel* prev = dynamic_cast<const gui2::ttoggle_panel*>(it.children[n - 1].widget_);
+			CHECK_EQUAL(state, prev->at() + 1, panel->at());
+		}
+	}
+	return it.size;
+}
+
+// panel of row if it is in window, else NULL.
+gui2::ttoggle_panel* window_panel(const gui2::tlistbox& list, const int at)
+{
+	const gui2::tgrid::titerator it = list.iterator();
+	for (int n = 0; n < it.size; n ++) {
+		gui2::ttoggle_panel* panel = dynamic_cast<gui2::ttoggle_panel*>(it.children[n].widget_);
+		if (panel->at() == at) {
+			return panel;
+		}
+	}
+	return NULL;
+}
+
+}
+
+// only rows near visible area have panel, and panels of rows that scroll out are reused for rows that scroll in.
+static void listbox_row_model_recycle(test::tstate& state)
+{
+	trow_model model;
+	gui2::tlistbox* list = NULL;
+	gui2::twindow* window = row_model_window(state, model, list);
+	if (!window) {
+		return;
+	}
+	CHECK_EQUAL(state, model_rows, list->rows());
+	int max_window = check_window(state, *list);
+	CHECK(state, max_window > 0 && max_window < model_rows);
+	CHECK(state, window_panel(*list, 0) != NULL);
+
+	const int rows[] = {5000, 5001, 9999, 20, 7000, 0};
+	for (size_t at = 0; at < sizeof(rows) / sizeof(rows[0]); at ++) {
+		list->scroll_to_row(rows[at]);
+		max_window = std::max(max_window, check_window(state, *list));
+		CHECK(state, window_panel(*list, rows[at]) != NULL);
+	}
+
+	// a jump binds rows of new window before old window gives back panels, so at most two windows of panels.
+	CHECK(state, (int)model.panels.size() <= 2 * max_window);
+	CHECK(state, (int)model.panels.size() < model.fills);
+
+	delete window;
+}
+TEST(listbox_row_model_recycle);
+
+// selected panel is kept out of pool while its row is out of window, and shows it again when row scrolls in.
+static void listbox_row_model_selection(test::tstate& state)
+{
+	trow_model model;
+	gui2::tlistbox* list = NULL;
+	gui2::twindow* window = row_model_window(state, model, list);
+	if (!window) {
+		return;
+	}
+
+	list->select_row(3);
+	gui2::ttoggle_panel* selected = list->cursel();
+	CHECK(state, selected && selected->at() == 3 && selected->get_value());
+	if (!selected) {
+		delete window;
+		return;
+	}
+
+	list->scroll_to_row(5000);
+	check_window(state, *list);
+	CHECK(state, window_panel(*list, 3) == NULL);
+	CHECK(state, list->cursel() == selected);
+	CHECK_EQUAL(state, 3, selected->at());
+	CHECK_EQUAL(state, row_label(3), panel_label(*selected));
+	CHECK(state, selected->get_value());
+
+	list->scroll_to_row(0);
+	check_window(state, *list);
+	CHECK(state, window_panel(*list, 3) == selected);
+	CHECK(state, list->cursel() == selected && selected->get_value());
+
+	// select row that is out of window, it gets panel outside window. row 3 keeps its panel, unselected.
+	list->select_row(6000);
+	selected = list->cursel();
+	CHECK(state, selected && selected->at() == 6000 && selected->get_value());
+	if (!selected) {
+		delete window;
+		return;
+	}
+	CHECK(state, window_panel(*list, 6000) == NULL);
+	const gui2::ttoggle_panel* row3 = window_panel(*list, 3);
+	CHECK(state, row3 && row3 != selected && !row3->get_value());
+
+	list->scroll_to_row(6000);
+	check_window(state, *list);
+	CHECK(state, window_panel(*list, 6000) == selected);
+	CHECK(state, list->cursel() == selected && selected->get_value());
+
+	delete window;
+}
+TEST(listbox_row_model_selection);
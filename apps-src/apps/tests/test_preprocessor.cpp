@@ -0,0 +1,62 @@
+#include "test.hpp"
+#include "environment.hpp"
+
+#include "filesystem.hpp"
+#include "rose_config.hpp"
+#include "serialization/preprocessor.hpp"
+
+#include <boost/scoped_ptr.hpp>
+#include <sstream>
+
+namespace {
+
+std::string preprocess_text(const std::string& fname, const std::string& define, int mode)
+{
+	set_preproc_cache_mode(mode);
+	preproc_map defines;
+	if (!define.empty()) {
+		defines[define] = preproc_define();
+	}
+	std::stringstream text;
+	{
+		boost::scoped_ptr<std::istream> stream(preprocess_file(fname, &defines));
+		text << stream->rdbuf();
+	}
+	return text.str();
+}
+
+void verify_tree(test::tstate& state, const std::string& name, const std::string& define)
+{
+	const std::string fname = game_config::path + "/" + name;
+	if (!is_directory(fname)) {
+		return;
+	}
+	const int mode = preproc_cache_mode();
+
+	reset_preproc_cache_stats();
+	const std::string verified = preprocess_text(fname, define, PREPROC_CACHE_VERIFY);
+	const tpreproc_cache_stats stats = preproc_cache_stats();
+	const std::string plain = preprocess_text(fname, define, PREPROC_CACHE_OFF);
+	set_preproc_cache_mode(mode);
+
+	CHECK_EQUAL(state, 0, stats.mismatches);
+	if (verified != plain) {
+		state.fail(__FILE__, __LINE__, name + ": output differs from the one without cache");
+	}
+}
+
+}
+
+// trees of data.bin, gui.bin and language.bin, with defines that studio uses.
+// every cached expansion is expanded again and compared, and output is what it is without cache.
+static void preprocess_verify_data(test::tstate& state)
+{
+	if (!benchmark::init_res()) {
+		state.skip("apps-res isn't found");
+		return;
+	}
+	verify_tree(state, "data", "CORE");
+	verify_tree(state, "data/gui", "");
+	verify_tree(state, "data/languages", "");
+}
+TEST(preprocess_verify_data);
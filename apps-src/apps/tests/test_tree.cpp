@@ -0,0 +1,134 @@
+#include "test.hpp"
+#include "environment.hpp"
+
+#include "gui/widgets/listbox.hpp"
+#include "gui/widgets/toggle_panel.hpp"
+#include "gui/widgets/tree.hpp"
+#include "gui/widgets/window.hpp"
+#include "util.hpp"
+
+#include <algorithm>
+#include <boost/bind.hpp>
+#include <set>
+
+namespace {
+
+const int branches = 100;
+const int leaves = 100;
+
+class tnode_model
+{
+public:
+	tnode_model()
+		: panels()
+		, fills(0)
+	{}
+
+	void fill(gui2::tlistbox& list, gui2::ttoggle_panel& widget, const gui2::ttree_model::tnode& node)
+	{
+		gui2::find_widget<gui2::tcontrol>(&widget, "label", false).set_label(str_cast(node.cookie));
+		panels.insert(&widget);
+		fills ++;
+	}
+
+	// every panel that is ever filled.
+	std::set<gui2::ttoggle_panel*> panels;
+	int fills;
+};
+
+// rows in window are continuous and every panel shows node of its row. return number of them.
+int check_window(test::tstate& state, const gui2::tlistbox& list, const gui2::ttree_model& tree)
+{
+	const gui2::tgrid::titerator it = list.iterator();
+	for (int n = 0; n < it.size; n ++) {
+		const gui2::ttoggle_panel* panel = dynamic_cast<const gui2::ttoggle_panel*>(it.children[n].widget_);
+		const std::string& label = gui2::find_widget<const gui2::tcontrol>(panel, "label", false).label();
+		CHECK_EQUAL(state, str_cast(tree.row_node(panel->at()).cookie), label);
+		if (n) {
+			const gui2::ttoggle_panel* prev = dynamic_cast<const gui2::ttoggle_panel*>(it.children[n - 1].widget_);
+			CHECK_EQUAL(state, prev->at() + 1, panel->at());
+		}
+	}
+	return it.size;
+}
+
+}
+
+// visible nodes are rows of listbox's row model, so only nodes in window have panel. fold, insert and erase
+// keep rows in display order, and selected node keeps selected while it has row.
+static void tree_model_rows(test::tstate& state)
+{
+	gui2::twindow* window = benchmark::build_window("rose__combo_box");
+	if (!window) {
+		state.skip("gui isn't available");
+		return;
+	}
+	gui2::tlistbox* list = gui2::find_widget<gui2::tlistbox>(window, "listbox", false, true);
+	tnode_model model;
+	gui2::ttree_model* tree = new gui2::ttree_model(*list, boost::bind(&tnode_model::fill, &model, _1, _2, _3));
+
+	std::vector<gui2::ttree_model::tnode*> nodes;
+	for (int at = 0; at < branches; at ++) {
+		gui2::ttree_model::tnode& branch = tree->insert_node(tree->root(), at * 1000, true);
+		nodes.push_back(&branch);
+		for (int n = 0; n < leaves; n ++) {
+			tree->insert_node(branch, at * 1000 + n + 1, false);
+		}
+	}
+	window->layout();
+	CHECK_EQUAL(state, branches * (leaves + 1), list->rows());
+	CHECK_EQUAL(state, 1, nodes[0]->children[0]->depth);
+	CHECK_EQUAL(state, leaves + 1, tree->node_row(*nodes[1]));
+	int max_window = check_window(state, *list, *tree);
+	CHECK(state, max_window > 0 && max_window < list->rows());
+
+	// select leaf of branch 50, fold branches before it. it follows its node.
+	gui2::ttree_model::tnode& leaf = *nodes[50]->children[7];
+	tree->select_node(&leaf);
+	CHECK(state, tree->cursel() == &leaf);
+	tree->set_folded(*nodes[0], true);
+	tree->set_folded(*nodes[3], true);
+	CHECK_EQUAL(state, branches * (leaves + 1) - 2 * leaves, list->rows());
+	CHECK_EQUAL(state, 1, tree->node_row(*nodes[1]));
+	CHECK_EQUAL(state, 50 * (leaves + 1) - 2 * leaves + 8, tree->node_row(leaf));
+	CHECK(state, tree->cursel() == &leaf);
+	CHECK(state, list->cursel() && list->cursel()->at() == tree->node_row(leaf));
+
+	list->scroll_to_row(tree->node_row(leaf));
+	max_window = std::max(max_window, check_window(state, *list, *tree));
+
+	// insert into folded branch doesn't add row, unfold shows it.
+	tree->insert_node(*nodes[3], 3999, false, 0);
+	CHECK_EQUAL(state, branches * (leaves + 1) - 2 * leaves, list->rows());
+	tree->set_folded(*nodes[3], false);
+	CHECK_EQUAL(state, tree->node_row(*nodes[3]) + 1, tree->node_row(*nodes[3]->children[0]));
+	CHECK_EQUAL(state, 3999, (int)tree->row_node(tree->node_row(*nodes[3]) + 1).cookie);
+	CHECK(state, tree->cursel() == &leaf);
+
+	// fold branch of selected node, node has no row and nothing is selected.
+	tree->set_folded(*nodes[50], true);
+	CHECK_EQUAL(state, gui2::twidget::npos, tree->node_row(leaf));
+	CHECK(state, !tree->cursel() && !list->cursel());
+	tree->set_folded(*nodes[50], false);
+
+	// erase branch, its subtree's rows go.
+	const int rows = list->rows();
+	tree->erase_node(*nodes[10]);
+	CHECK_EQUAL(state, rows - leaves - 1, list->rows());
+	CHECK_EQUAL(state, 11000, (int)tree->row_node(tree->node_row(*nodes[9]) + leaves + 1).cookie);
+
+	const int rows2[] = {5000, 9000, 20, 0};
+	for (size_t at = 0; at < sizeof(rows2) / sizeof(rows2[0]); at ++) {
+		list->scroll_to_row(rows2[at]);
+		max_window = std::max(max_window, check_window(state, *list, *tree));
+	}
+	CHECK(state, (int)model.panels.size() <= 2 * max_window);
+	CHECK(state, (int)model.panels.size() < model.fills);
+
+	tree->clear();
+	CHECK_EQUAL(state, 0, list->rows());
+
+	delete window;
+	delete tree;
+}
+TEST(tree_model_rows);
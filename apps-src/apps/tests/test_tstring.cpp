@@ -0,0 +1,49 @@
+#include "test.hpp"
+
+#include "tstring.hpp"
+
+#include <sstream>
+#include <thread>
+
+namespace {
+
+void make_strings(int seed, std::vector<t_string>* result)
+{
+	std::vector<t_string> live;
+	for (int at = 0; at < 20000; at ++) {
+		std::stringstream str;
+		str << "str" << (at + seed) % 500;
+		live.push_back(t_string(str.str()));
+		const t_string copy = live.back();
+		if (live.size() > 100) {
+			live.erase(live.begin(), live.begin() + 50);
+		}
+	}
+	*result = live;
+}
+
+}
+
+// bins are parsed on several threads, all t_strings share one map of values.
+static void tstring_threads(test::tstate& state)
+{
+	const int threads = 4;
+	std::vector<std::vector<t_string> > results(threads);
+	std::vector<std::thread> workers;
+	for (int at = 0; at < threads; at ++) {
+		workers.push_back(std::thread(make_strings, at * 7, &results[at]));
+	}
+	for (int at = 0; at < threads; at ++) {
+		workers[at].join();
+	}
+
+	for (int at = 0; at < threads; at ++) {
+		std::vector<t_string> expected;
+		make_strings(at * 7, &expected);
+		CHECK_EQUAL(state, expected.size(), results[at].size());
+		for (size_t n = 0; n < expected.size() && n < results[at].size(); n ++) {
+			CHECK(state, expected[n] == results[at][n]);
+		}
+	}
+}
+TEST(tstring_threads);
@@ -0,0 +1,204 @@
+#include "test.hpp"
+#include "environment.hpp"
+
+#include "config.hpp"
+#include "filesystem.hpp"
+#include "loadscreen.hpp"
+#include "rose_config.hpp"
+#include "util.hpp"
+#include "xwml.hpp"
+
+#include <boost/foreach.hpp>
+#include <fstream>
+
+namespace {
+
+void patch_u32(const std::string& fname, int offset, uint32_t value)
+{
+	std::fstream file(fname.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+	file.seekp(offset);
+	file.write((const char*)&value, sizeof(value));
+}
+
+// @view has same attributes and children, in same order, as @cfg. @path names node in failure.
+void check_view(test::tstate& state, const config& cfg, const tconfig_view& view, const std::string& path)
+{
+	if (view.attribute_count() != (size_t)std::distance(cfg.attribute_range().first, cfg.attribute_range().second)) {
+		state.fail(__FILE__, __LINE__, path + ": attribute count differs");
+	}
+	BOOST_FOREACH (const config::attribute& attr, cfg.attribute_range()) {
+		if (!view.has_attribute(attr.first) || view[attr.first] != attr.second) {
+			state.fail(__FILE__, __LINE__, path + ": value of " + attr.first + " differs");
+		}
+	}
+	CHECK(state, !view.has_attribute("no_such_key"));
+
+	tconfig_view child = view.first_child();
+	std::map<std::string, int> nth;
+	BOOST_FOREACH (const config::any_child& value, cfg.all_children_range()) {
+		const std::string child_path = path + "/" + value.key;
+		if (!child.valid() || child.key() != value.key) {
+			state.fail(__FILE__, __LINE__, child_path + ": child differs");
+			return;
+		}
+		CHECK(state, view.child(value.key, nth[value.key] ++).valid());
+		check_view(state, value.cfg, child, child_path);
+		child = child.next_sibling();
+	}
+	CHECK(state, !child.valid());
+	CHECK(state, !view.child("no_such_tag").valid());
+}
+
+// write @cfg with index section, and check view of it against @cfg and its own to_config.
+void check_view_file(test::tstate& state, const std::string& fname, const config& cfg)
+{
+	wml_config_to_file(fname, cfg, 0, 0, 0, std::map<std::string, std::string>(), true);
+	txwml_view view(fname);
+	CHECK(state, view.valid());
+	if (!view.valid()) {
+		return;
+	}
+	check_view(state, cfg, view.root(), "");
+
+	config from_file, from_view;
+	wml_config_from_file(fname, from_file);
+	view.root().to_config(from_view);
+	CHECK(state, from_file == cfg);
+	CHECK(state, from_view == cfg);
+}
+
+}
+
+// txwml_view gives same attribute and child values as wml_config_from_file, bin without index section has no view.
+static void xwml_view_equals_config(test::tstate& state)
+{
+	if (benchmark::work_dir().empty()) {
+		state.skip("no writable directory");
+		return;
+	}
+	const std::string fname = benchmark::work_dir() + "test-view.bin";
+
+	config cfg;
+	config& window = cfg.add_child("window");
+	window["id"] = "main";
+	window["width"] = 640;
+	window["scale"] = 0.5;
+	window["modal"] = true;
+	window["title"] = t_string("Main", "rose-lib");
+	window.add_child("label")["label"] = "first";
+	window.add_child("spacer");
+	window.add_child("label")["label"] = "second";
+	cfg.add_child("style")["id"] = "default";
+	cfg.add_child("window")["id"] = "second";
+	check_view_file(state, fname, cfg);
+
+	wml_config_to_file(fname, cfg);
+	CHECK(state, !txwml_view(fname).valid());
+
+	// and data.bin of apps-res, if there is.
+	if (benchmark::init_res() && file_exists(game_config::path + "/xwml/data.bin")) {
+		config data;
+		wml_config_from_file(game_config::path + "/xwml/data.bin", data);
+		check_view_file(state, fname, data);
+	}
+}
+TEST(xwml_view_equals_config);
+
+// max_str_len in header sizes decode's name buffer, archive that claims more than a block holds is rejected.
+static void xwml_v2_max_str_len(test::tstate& state)
+{
+	if (benchmark::work_dir().empty()) {
+		state.skip("no writable directory");
+		return;
+	}
+	const std::string fname = benchmark::work_dir() + "test-v2.bin";
+
+	config cfg;
+	config& window = cfg.add_child("window");
+	window["id"] = "main";
+	window.add_child("label")["label"] = "hello";
+	cfg.add_child("style")["id"] = "default";
+	wml_config_to_file_v2(fname, cfg);
+	{
+		txwml_archive archive(fname);
+		CHECK(state, archive.valid());
+		CHECK_EQUAL(state, 2, (int)archive.blocks().size());
+		CHECK(state, archive.find_child("window", "main") == window);
+	}
+
+	patch_u32(fname, 16, 0x7fffffff);
+	{
+		txwml_archive archive(fname);
+		CHECK(state, !archive.valid());
+		CHECK(state, archive.blocks().empty());
+		CHECK(state, !archive.find_child("window", "main"));
+	}
+}
+TEST(xwml_v2_max_str_len);
+
+// blocks are found through index, and only blocks that are accessed are read.
+static void xwml_v2_lookup(test::tstate& state)
+{
+	if (benchmark::work_dir().empty()) {
+		state.skip("no writable directory");
+		return;
+	}
+	const std::string fname = benchmark::work_dir() + "test-v2.bin";
+
+	// [gui] is larger than a block, so every [window] is a block of its own.
+	config cfg;
+	config& gui = cfg.add_child("gui");
+	gui["id"] = "default";
+	gui.add_child("settings")["double_click_time"] = 500;
+	for (int at = 0; at < 64; at ++) {
+		config& window = gui.add_child("window");
+		window["id"] = at % 2? "second": "first";
+		window["app"] = str_cast(at);
+		for (int n = 0; n < 64; n ++) {
+			window.add_child("label")["label"] = str_cast(at * 1000 + n);
+		}
+	}
+	wml_config_to_file_v2(fname, cfg);
+
+	txwml_archive archive(fname);
+	CHECK(state, archive.valid());
+	const int gui_at = archive.find("gui", "default");
+	CHECK_EQUAL(state, 0, gui_at);
+	const std::vector<int> firsts = archive.find_all("window", "first");
+	const std::vector<int> seconds = archive.find_all("window", "second");
+	CHECK_EQUAL(state, 32, (int)firsts.size());
+	CHECK_EQUAL(state, 32, (int)seconds.size());
+	CHECK(state, archive.find_all("window", "third").empty());
+	CHECK_EQUAL(state, -1, archive.find("window", "third"));
+	CHECK_EQUAL(state, archive.find("window"), archive.find("window", "first"));
+	for (size_t at = 1; at < seconds.size(); at ++) {
+		CHECK(state, seconds[at - 1] < seconds[at]);
+	}
+	for (int at = 0; at < (int)seconds.size(); at ++) {
+		CHECK_EQUAL(state, gui_at, archive.blocks()[seconds[at]].parent);
+		config window;
+		CHECK(state, archive.child(seconds[at], window));
+		CHECK(state, window == gui.child("window", 2 * at + 1));
+	}
+
+	config without;
+	CHECK(state, archive.to_config(without, "window"));
+	CHECK_EQUAL(state, 0, (int)without.child("gui").child_count("window"));
+	CHECK(state, without.child("gui").child("settings") == gui.child("settings"));
+	CHECK_EQUAL(state, "default", without.child("gui")["id"].str());
+
+	// block that isn't accessed isn't read, other blocks read well when it is corrupted.
+	const txwml_archive::tblock& corrupted = archive.blocks()[firsts[0]];
+	patch_u32(fname, corrupted.offset, 0xffffffff);
+	config window;
+	CHECK(state, archive.child(seconds[0], window));
+	CHECK(state, window == gui.child("window", 1));
+	CHECK(state, !archive.child(firsts[0], window));
+
+	// file that is written again isn't read by index of old one.
+	gui["id"] = "other";
+	wml_config_to_file_v2(fname, cfg, 1);
+	CHECK(state, !archive.child(seconds[0], window));
+	CHECK(state, !archive.to_config(without));
+}
+TEST(xwml_v2_lookup);